@@ -6,7 +6,13 @@ layout (location = 2) in float i_normal;
 
 out vec3 o_tex_coord;
 
-uniform mat4 u_combo_mat; // combo_mat = projection_mat * view_mat
+// Per-frame constants, shared by every program, see Renderer::FrameConstants
+layout (std140, binding = 0) uniform FrameConstants
+{
+    mat4 u_combo_mat;   // combo_mat = projection_mat * view_mat
+    vec4 u_camera_pos;  // w is unused
+    float u_time;       // seconds since the start
+};
 
 void main()
 {
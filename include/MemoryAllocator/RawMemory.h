@@ -58,11 +58,23 @@ struct RawMemory
     // Parameters: data pointer, data size
     void WriteDangerous( const uint8_t * data, size_t data_size)
     {
-        if (this->offset + data_size >= this->size)     // if the new data size is larger than the current data size,
+        if (this->offset + data_size > this->size)      // if the new data size is larger than the current data size,
                                                         // then we reallocate the memory
         {
             size_t new_size = (this->offset + data_size) * 2;
+            auto new_data = (uint8_t *) AmoMemory_ReAlloc(this->data, new_size);
+            if (!new_data)
+            {
+                AmoLogger_Error("Failed to grow serialized memory to '%zu' bytes", new_size);
+                return;
+            }
+            this->data = new_data;
+            this->size = new_size;
         }
+
+        if (data_size > 0)
+            AmoBase::AmoMemory_CopyMem(this->data + this->offset, (void *)data, data_size);
+        this->offset += data_size;
     }
 
     // A Dangerous Reading of memory
@@ -82,6 +94,25 @@ struct RawMemory
         this->offset += data_size;
     }
 
+    // Read without copying, the cursor skips the data
+    // return a pointer into the memory, nullptr if it's out of bounds
+    // Parameters: data size
+    const uint8_t * ReadInPlace(size_t data_size)
+    {
+        if (this->offset + data_size > this->size)
+        {
+            AmoLogger_Error("Deserialized bad data. Read boundary out of bounds"
+                            ", cannot access '%zu' bytes in memory of size '%zu' bytes",
+                            this->offset + data_size,
+                            this->size);
+            return nullptr;
+        }
+
+        const uint8_t * res = this->data + this->offset;
+        this->offset += data_size;
+        return res;
+    }
+
 
     // a Safer Writing to memory
     // Parameters: data pointer
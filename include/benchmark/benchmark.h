@@ -0,0 +1,164 @@
+//
+// Created by Amo on 2022/7/20.
+//
+
+#ifndef SYMOCRAFT_BENCHMARK_H
+#define SYMOCRAFT_BENCHMARK_H
+#include "core.h"
+
+namespace SymoCraft
+{
+    namespace Benchmark
+    {
+        struct Measurement
+        {
+            std::string name;
+            double value;
+            std::string unit;
+        };
+
+        // Collect the measurements of a benchmark run
+        class Report
+        {
+        public:
+            // Add a measurement
+            // Parameters: name, value, unit
+            void Add(std::string_view name, double value, std::string_view unit);
+
+            // Count a failed correctness check, Run returns a non-zero exit code if any check failed
+            // Call it next to the error logged for the check
+            void Fail();
+
+            inline uint32 GetNumFailedChecks() const
+            {
+                return m_num_failed_checks;
+            }
+
+            // Print all measurements to the console
+            void Print() const;
+
+            // Write all measurements as a JSON object
+            // Parameters: output file path, benchmark name
+            bool WriteJson(std::string_view file_path, std::string_view benchmark_name) const;
+
+        private:
+            std::vector<Measurement> m_measurements;
+            uint32 m_num_failed_checks = 0;
+        };
+
+        typedef void (*BenchmarkFunction)(Report& report);
+
+        // Run a benchmark without opening a window
+        // Return the exit code of the application, 1 if the benchmark is unknown or a check failed
+        // Parameters: benchmark name("all" runs every benchmark, a trailing '*' runs every benchmark with the prefix),
+        //             JSON output path(empty for none)
+        int Run(std::string_view name, std::string_view json_output_path);
+
+        // Milliseconds since a time point
+        inline double MillisecondsSince(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Generate the same world as the application does, free it with ChunkManager::FreeAllChunks
+        void GenerateWorld();
+
+        // -------------------------------------------------------------------
+        // Benchmarks
+
+        // Vertex count of every level of detail ring compared to full detail meshes
+        void LodRings(Report& report);
+
+        // Remove the floor of a reservoir of 23k water sources above the terrain and run ticks until the water settles,
+        // with the per tick cell budget and without it
+        void FluidBreach(Report& report);
+
+        // A random tick round over the sections with tickable blocks against picks over every section,
+        // then a pillar of 64 sand blocks falling onto the terrain
+        void BlockTicks(Report& report);
+
+        // Neighbor updates of 8 x 8 blocks of sand of growing height collapsing onto the terrain,
+        // then stone set on top of 4096 grass blocks
+        void NeighborUpdates(Report& report);
+
+        // Uniform upload cost through name lookups and through resolved handles, on the null render device
+        void UniformLookup(Report& report);
+
+        // Cook the atlas cache, then compare loading it with slicing the PNG at startup
+        // Also checks every cached texel against a reference slice and box filter
+        void TextureCacheLoad(Report& report);
+
+        // GetComponent<Transform> cost at 1k, 100k and 1M entities, in entity order and in random order
+        void EcsGetComponent(Report& report);
+
+        // View<Transform, RigidBody, HitBox> over 100k entities where 10% have all three,
+        // compared with walking every entity and looking the components up, and with a loop over the RigidBody storage
+        void EcsView(Report& report);
+
+        // Physics-like iteration and add/remove cost of the archetype backend against the sparse set registry
+        void EcsArchetype(Report& report);
+
+        // TransformSystem and a velocity system over 100k entities, serial against the parallel scheduler
+        void EcsScheduler(Report& report);
+
+        // Spawn 100k entities directly, and through command buffers recorded by thread pool jobs and played back
+        void EcsCommandBuffers(Report& report);
+
+        // TransformSystem over 100k entities of which 1% rotate every frame, every entity against only the changed ones
+        void EcsChangeTracking(Report& report);
+
+        // Full and delta snapshots of 100k entities, written and loaded into a second registry that must match
+        void EcsSnapshot(Report& report);
+
+        // Spawn 100k mobs with 4 components each, one AddComponent at a time against bulk prefab instantiation,
+        // then respawn them from the prefab into the free entity slots
+        void EcsPrefab(Report& report);
+
+        // -------------------------------------------------------------------
+        // ECS stress suite, 1M entities each, run them all with --bench "ecs_stress*"
+        // Run it before and after every change to the component containers or the registry
+
+        // Create 1M entities, then destroy and recreate a random tenth of them ten times through the free list
+        void EcsStressChurn(Report& report);
+
+        // Add and remove a RigidBody on 1M entities, in entity order and in random order
+        void EcsStressAddRemove(Report& report);
+
+        // Random GetComponent, and HasComponent then GetComponent on a component half of the entities have
+        void EcsStressRandomGet(Report& report);
+
+        // Views over 1 to 5 component types at component densities of 100%, 50%, 10% and 1%
+        void EcsStressView(Report& report);
+
+        // -------------------------------------------------------------------
+        // Physics
+
+        // 120Hz steps of 10k moving bodies pushing each other through the spatial hash broadphase,
+        // checked against brute force pairs first
+        void PhysicsContacts(Report& report);
+
+        // 10k bodies falling onto the generated terrain, some at terminal velocity, until they come to rest
+        void PhysicsFalling(Report& report);
+
+        // 10k bodies come to rest and fall asleep, then steps with 100, 1k and 5k of them woken,
+        // and a body must wake and fall when the blocks under it are removed
+        void PhysicsSleeping(Report& report);
+
+        // A crowd of 20k bodies falling onto the terrain, stepped on the calling thread and replayed on
+        // 1, 3 and 7 worker threads, every step of a replay must hash the same as the single threaded run
+        void PhysicsDeterminism(Report& report);
+
+        // 200k rays of up to 32 blocks through the generated terrain, one at a time and batched, in rays per second
+        void PhysicsRaycast(Report& report);
+
+        // Rays, moves and a frustum query against an AABB tree of 5k and 50k entity boxes, checked against
+        // brute force, then ray, segment and frustum queries of 50k entities through the physics system
+        void PhysicsEntityQueries(Report& report);
+
+        // Frame times after a hitch with and without the tick cap of the simulation clock, and the speed error
+        // of a body drawn at its last tick against drawn interpolated, at jittering frame times
+        void SimulationClockTicks(Report& report);
+    }
+}
+
+#endif //SYMOCRAFT_BENCHMARK_H
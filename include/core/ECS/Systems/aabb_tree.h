@@ -0,0 +1,206 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#ifndef SYMOCRAFT_AABB_TREE_H
+#define SYMOCRAFT_AABB_TREE_H
+#include "core.h"
+#include "core/ECS/Systems/spatial_hash.h"
+
+namespace SymoCraft
+{
+    namespace Physics
+    {
+        // Six planes facing inwards, xyz is the normal and w the offset
+        struct Frustum
+        {
+            glm::vec4 planes[6];
+
+            // Parameters: projection * view matrix
+            static Frustum FromMatrix(const glm::mat4& view_projection);
+
+            // Conservative, a box near a corner outside of the frustum may still count as overlapping
+            inline bool IsOverlapping(const AABB& box) const
+            {
+                for (const glm::vec4& plane : planes)
+                {
+                    // The corner of the box furthest along the plane normal
+                    const glm::vec3 corner(plane.x >= 0.0f ? box.max.x : box.min.x,
+                                           plane.y >= 0.0f ? box.max.y : box.min.y,
+                                           plane.z >= 0.0f ? box.max.z : box.min.z);
+                    if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+                        return false;
+                }
+                return true;
+            }
+        };
+
+        // Slab test of a ray against a box
+        // return whether the ray enters the box within max_distance, a ray starting inside enters at 0
+        // Parameters: box, ray origin, 1 / ray direction, max distance, output entry distance
+        inline bool IntersectRay(const AABB& box, const glm::vec3& origin, const glm::vec3& inverse_direction,
+                                 float max_distance, float& out_distance)
+        {
+            const glm::vec3 t1 = (box.min - origin) * inverse_direction;
+            const glm::vec3 t2 = (box.max - origin) * inverse_direction;
+            const glm::vec3 t_near = glm::min(t1, t2), t_far = glm::max(t1, t2);
+            const float enter = std::max({t_near.x, t_near.y, t_near.z, 0.0f});
+            const float exit = std::min({t_far.x, t_far.y, t_far.z, max_distance});
+            out_distance = enter;
+            return enter <= exit;
+        }
+
+        /* ---------------------------------------------------------------------------------------------------
+           About AABB tree:
+           A bounding volume hierarchy of boxes that move, for queries against entities rather than for pairs.
+           Every leaf holds a proxy: the box of an entity fattened by a margin. A proxy only moves in the tree
+           when its box leaves the fattened box, which is also stretched ahead of a moving box, so an entity
+           walking or falling is reinserted every few frames and a resting one never. Leaves are inserted next
+           to the sibling that grows the tree's surface area least, and subtrees are rotated on the way up to
+           keep the tree balanced, queries visit O(log n) nodes.
+
+           Ray casts visit the nearer child first and clip the ray at the nearest hit so far, so nodes behind
+           the hit are skipped. The tree is rebuilt by nothing, there is no per frame cost besides moved proxies.
+        */
+        class AABBTree
+        {
+        public:
+            static constexpr int32 kNullNode = -1;
+            static constexpr float kDisplacementMultiplier = 4.0f;
+
+            // Parameters: margin the boxes are fattened by on every side
+            explicit AABBTree(float margin = 0.2f);
+
+            // Parameters: box, user data(e.g. an entity id)
+            // return the proxy id, kept until the proxy is destroyed
+            int32 CreateProxy(const AABB& box, uint64 user_data);
+
+            void DestroyProxy(int32 proxy);
+
+            // Parameters: proxy, new box, distance moved since the last move(the fattened box is stretched
+            //             kDisplacementMultiplier times as far ahead, so a body moving steadily is rarely reinserted)
+            // return whether the box left the fattened box and the proxy was reinserted
+            bool MoveProxy(int32 proxy, const AABB& box, const glm::vec3& displacement = glm::vec3(0.0f));
+
+            inline uint64 GetUserData(int32 proxy) const
+            {
+                return m_nodes[proxy].user_data;
+            }
+
+            inline const AABB& GetFatBox(int32 proxy) const
+            {
+                return m_nodes[proxy].box;
+            }
+
+            // Find the proxies whose fattened box overlaps a box
+            // Parameters: box, output proxies, cleared first
+            void QueryAABB(const AABB& box, std::vector<int32>& out_proxies) const;
+
+            // Find the proxies whose fattened box overlaps a frustum
+            // Parameters: frustum, output proxies, cleared first
+            void QueryFrustum(const Frustum& frustum, std::vector<int32>& out_proxies) const;
+
+            // Visit the proxies whose fattened box the ray crosses within the max distance, nearer subtrees first
+            // Parameters: origin, unit direction, max distance,
+            //             callback float(int32 proxy, float max_distance) returning the distance to clip the ray at,
+            //             the distance of a hit, or max_distance to go on unchanged,
+            //             the callback must not cast rays through the tree itself
+            template<typename Callback>
+            void RayCast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, Callback&& callback) const;
+
+            // Height of the root, 0 for a single leaf
+            int32 GetHeight() const;
+
+            inline uint32 NumProxies() const
+            {
+                return m_num_proxies;
+            }
+
+            void Clear();
+
+        private:
+            struct Node
+            {
+                // Fattened box of a leaf, union of the children of an internal node
+                AABB box;
+                uint64 user_data;
+                // Next free node while the node is free
+                int32 parent;
+                int32 left;
+                int32 right;
+                // 0 for a leaf, -1 for a free node
+                int32 height;
+
+                inline bool IsLeaf() const
+                {
+                    return left == kNullNode;
+                }
+            };
+
+            float m_margin;
+            std::vector<Node> m_nodes;
+            int32 m_root = kNullNode;
+            int32 m_free_list = kNullNode;
+            uint32 m_num_proxies = 0;
+
+            int32 AllocateNode();
+            void FreeNode(int32 node);
+            void InsertLeaf(int32 leaf);
+            void RemoveLeaf(int32 leaf);
+            // Rotate the higher grandchild up if the children of a node differ in height by more than one
+            // return the node that took the place of the node
+            int32 Balance(int32 node);
+        };
+
+        template<typename Callback>
+        void AABBTree::RayCast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, Callback&& callback) const
+        {
+            if (m_root == kNullNode)
+                return;
+
+            // Division by a zero component gives an infinity, the slab test handles it
+            const glm::vec3 inverse_direction = 1.0f / direction;
+            // Nodes with their entry distance, a node entered after a clip is skipped
+            // Growable like the stacks of the other queries, a degenerate tree may be deeper than balancing keeps it
+            static thread_local std::vector<std::pair<int32, float>> stack;
+            stack.clear();
+            float distance;
+            if (IntersectRay(m_nodes[m_root].box, origin, inverse_direction, max_distance, distance))
+                stack.emplace_back(m_root, distance);
+
+            while (!stack.empty())
+            {
+                const auto [index, enter] = stack.back();
+                stack.pop_back();
+                if (enter > max_distance)
+                    continue;
+
+                const Node& node = m_nodes[index];
+                if (node.IsLeaf())
+                {
+                    max_distance = std::min(max_distance, callback(index, max_distance));
+                    continue;
+                }
+
+                float left_distance, right_distance;
+                const bool is_left_hit = IntersectRay(m_nodes[node.left].box, origin, inverse_direction, max_distance, left_distance);
+                const bool is_right_hit = IntersectRay(m_nodes[node.right].box, origin, inverse_direction, max_distance, right_distance);
+                // The nearer child is pushed last and visited first
+                if (is_left_hit && is_right_hit && left_distance < right_distance)
+                {
+                    stack.emplace_back(node.right, right_distance);
+                    stack.emplace_back(node.left, left_distance);
+                }
+                else
+                {
+                    if (is_left_hit)
+                        stack.emplace_back(node.left, left_distance);
+                    if (is_right_hit)
+                        stack.emplace_back(node.right, right_distance);
+                }
+            }
+        }
+    }
+}
+
+#endif //SYMOCRAFT_AABB_TREE_H
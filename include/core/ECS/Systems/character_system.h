@@ -5,6 +5,7 @@
 #ifndef SYMOCRAFT_CHARACTER_SYSTEM_H
 #define SYMOCRAFT_CHARACTER_SYSTEM_H
 #include "core.h"
+#include "core/ECS/scheduler.h"
 
 
 namespace SymoCraft
@@ -20,6 +21,12 @@ namespace SymoCraft
         {
             void Init();
             void Update(ECS::Registry& registry);
+
+            // Update a slice of the system's view
+            void UpdateSlice(ECS::Registry& registry, const ECS::SystemSlice& slice);
+
+            // Reads and writes of the system, for the scheduler
+            ECS::System GetSystem();
         }
     }
 }
@@ -7,29 +7,125 @@
 #include "core.h"
 #include "core/ECS/registry.h"
 #include "core/ECS/component.h"
+#include "core/ECS/scheduler.h"
+#include "core/ECS/Systems/spatial_hash.h"
+#include "core/ECS/Systems/aabb_tree.h"
 
 namespace SymoCraft
 {
+    class GlobalThreadPool;
+
     struct RaycastStaticResult
     {
         glm::vec3 point;
         glm::vec3 block_center;
         glm::vec3 block_size;
+        // Normal of the face the ray hit
+        glm::vec3 hit_normal;
+        // Integer coordinates of the block hit
+        glm::ivec3 block_position;
+        // Distance from the origin to the point
+        float distance;
+        bool hit;
+    };
+
+    struct RaycastEntityResult
+    {
+        // null_entity when nothing was hit
+        ECS::EntityId entity;
+        glm::vec3 point;
+        // Normal of the face of the hit box the ray hit, zero for a ray starting inside the box
         glm::vec3 hit_normal;
+        // Distance from the origin to the point
+        float distance;
         bool hit;
     };
 
     namespace Physics
     {
-        // TODO: Make Physic System a System object
-        // Initializing physics system
+        // A sensor body started or stopped overlapping another body
+        struct SensorEvent
+        {
+            ECS::EntityId sensor;
+            ECS::EntityId other;
+            // true when the overlap starts, false when it ends
+            bool is_enter;
+        };
 
         // physic update function
         void Update(ECS::Registry& registry);
 
+        // Run a single fixed step, whatever the frame time is
+        void Step(ECS::Registry& registry);
+
+        // Forget the bodies and sensor overlaps of the last step, call it when the registry is cleared
+        void Clear();
+
+        // Wake the sleeping bodies standing on a block, the block was set or removed
+        // They wake at the start of the next step
+        // Parameters: block position
+        void OnBlockChanged(const glm::ivec3& block_position);
+
+        // Bodies awake in the last step, the others are asleep
+        uint32 GetNumAwakeBodies();
+
+        // Split the steps into jobs on a thread pool, nullptr runs them on the calling thread
+        // The results are the same either way, bit for bit
+        void SetThreadPool(GlobalThreadPool* pool);
+
+        // Reads and writes of the system, for the scheduler
+        ECS::System GetSystem();
+
+        // -------------------------------------------------------------------
+        // Broadphase queries, against the bodies as they were at the end of the last step
+
+        // Parameters: box min corner, box max corner, output entities(cleared first)
+        void QueryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<ECS::EntityId>& out_entities);
+
+        // Parameters: center, radius, output entities(cleared first)
+        void QueryRadius(const glm::vec3& center, float radius, std::vector<ECS::EntityId>& out_entities);
+
+        // Sensor events of the steps of the current frame
+        const std::vector<SensorEvent>& GetSensorEvents();
+
         // Ray Casting for player on the block
+        // Parameters: origin, unit direction, max distance, draw(unused)
         RaycastStaticResult RayCastStatic(const glm::vec3 &origin, const glm::vec3 &normal_direction
                                            , float max_distance, bool draw = false);
+
+        struct Ray
+        {
+            glm::vec3 origin;
+            // Unit length
+            glm::vec3 direction;
+            float max_distance;
+        };
+
+        // Cast many rays at once, e.g. line of sight of mobs, explosions or ambient occlusion
+        // The rays are cast grouped by the chunk they start in, split into jobs on the thread pool of SetThreadPool
+        // Parameters: rays, number of rays, results(one per ray, in the order of the rays)
+        void RayCastMany(const Ray* rays, uint32 num_rays, RaycastStaticResult* out_results);
+
+        // -------------------------------------------------------------------
+        // Entity queries, against the hit boxes of every entity with a Transform and a HitBox as they were
+        // at the end of the last step, kept in a dynamic AABB tree. The first query after the steps updates
+        // the tree, so it must run on the thread of the steps while the registry of the steps is alive
+
+        // Nearest entity hit along a ray
+        // Parameters: origin, unit direction, max distance, entity to ignore(e.g. the one casting the ray)
+        RaycastEntityResult RayCastEntities(const glm::vec3& origin, const glm::vec3& normal_direction, float max_distance,
+                                            ECS::EntityId ignored_entity);
+
+        // Nearest entity hit along a segment, from the start
+        // Parameters: start, end, entity to ignore
+        RaycastEntityResult SegmentCastEntities(const glm::vec3& start, const glm::vec3& end, ECS::EntityId ignored_entity);
+
+        // Find the entities overlapping a frustum, nearest to the eye first
+        // Parameters: frustum, eye position, output entities(cleared first)
+        void QueryFrustum(const Frustum& frustum, const glm::vec3& eye, std::vector<ECS::EntityId>& out_entities);
+
+        // Entities in the entity tree
+        uint32 GetNumEntityTreeProxies();
     }
 }
 
@@ -0,0 +1,113 @@
+//
+// Created by Amo on 2022/7/29.
+//
+
+#ifndef SYMOCRAFT_SPATIAL_HASH_H
+#define SYMOCRAFT_SPATIAL_HASH_H
+#include "core.h"
+
+namespace SymoCraft
+{
+    namespace Physics
+    {
+        // Axis aligned bounding box
+        struct AABB
+        {
+            glm::vec3 min;
+            glm::vec3 max;
+
+            inline bool IsOverlapping(const AABB& other) const
+            {
+                return min.x <= other.max.x && other.min.x <= max.x
+                       && min.y <= other.max.y && other.min.y <= max.y
+                       && min.z <= other.max.z && other.min.z <= max.z;
+            }
+        };
+
+        /* ---------------------------------------------------------------------------------------------------
+           About spatial hash:
+           The broadphase of the physics system. Space is cut into uniform cells, every box is put into
+           the hash bucket of each cell it touches. The buckets are built with a counting sort every step,
+           so there is nothing to update incrementally and no allocation once the arrays are big enough.
+
+           Two boxes share every cell their intersection touches, a pair or a query result is only reported
+           in the cell that holds the min corner of the intersection, so nothing is reported twice.
+           Pairs come in bucket order and query results in box order, the same input always gives the same output.
+        */
+        class SpatialHash
+        {
+        public:
+            // Parameters: cell size, about twice the size of a typical box
+            explicit SpatialHash(float cell_size = 2.0f);
+
+            // Rebuild the hash, the index of a box is its id in pairs and queries
+            // Parameters: boxes, number of boxes
+            void Build(const AABB* boxes, uint32 num_boxes);
+
+            // Find every pair of overlapping boxes, the first id is always the smaller one
+            // Parameters: output pairs, cleared first
+            void FindPairs(std::vector<std::pair<uint32, uint32>>& out_pairs) const;
+
+            // Find the pairs in a range of buckets, for splitting FindPairs into jobs
+            // Concatenating the results of consecutive ranges gives the result of FindPairs
+            // Parameters: output pairs(cleared first), first bucket, one past the last bucket
+            void FindPairs(std::vector<std::pair<uint32, uint32>>& out_pairs, uint32 first_bucket, uint32 end_bucket) const;
+
+            // Number of hash buckets of the last Build
+            inline uint32 NumBuckets() const
+            {
+                return m_boxes.empty() ? 0 : m_bucket_mask + 1;
+            }
+
+            // Find the boxes overlapping a box
+            // Parameters: box, output box ids, cleared first
+            void QueryAABB(const AABB& box, std::vector<uint32>& out_ids) const;
+
+            // Find the boxes overlapping a sphere
+            // Parameters: center, radius, output box ids, cleared first
+            void QueryRadius(const glm::vec3& center, float radius, std::vector<uint32>& out_ids) const;
+
+            inline uint32 NumBoxes() const
+            {
+                return (uint32)m_boxes.size();
+            }
+
+            inline const AABB& GetBox(uint32 id) const
+            {
+                return m_boxes[id];
+            }
+
+        private:
+            // A box in one of its cells
+            struct CellEntry
+            {
+                glm::ivec3 cell;
+                uint32 id;
+            };
+
+            float m_cell_size;
+            float m_inverse_cell_size;
+            std::vector<AABB> m_boxes;
+            // Entries of bucket b are m_entries[m_bucket_starts[b], m_bucket_starts[b + 1])
+            std::vector<uint32> m_bucket_starts;
+            std::vector<CellEntry> m_entries;
+            uint32 m_bucket_mask = 0;
+
+            inline glm::ivec3 GetCell(const glm::vec3& position) const
+            {
+                return glm::ivec3(glm::floor(position * m_inverse_cell_size));
+            }
+
+            inline uint32 GetBucket(const glm::ivec3& cell) const
+            {
+                return ((uint32)cell.x * 73856093u ^ (uint32)cell.y * 19349663u ^ (uint32)cell.z * 83492791u) & m_bucket_mask;
+            }
+
+            // Visit the boxes overlapping a box once each, in bucket order
+            template<typename Visitor>
+            void VisitOverlaps(const AABB& box, Visitor&& visit) const;
+        };
+    }
+}
+
+#endif //SYMOCRAFT_SPATIAL_HASH_H
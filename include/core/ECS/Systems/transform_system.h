@@ -6,12 +6,19 @@
 #define SYMOCRAFT_TRANSFORM_SYSTEM_H
 #include "core.h"
 #include "core/ECS/registry.h"
+#include "core/ECS/scheduler.h"
 
 namespace SymoCraft
 {
     namespace TransformSystem
     {
         void Update(ECS::Registry& registry);
+
+        // Update the transforms of a slice of the system's view that changed since the slice's last run tick
+        void UpdateSlice(ECS::Registry& registry, const ECS::SystemSlice& slice);
+
+        // Reads and writes of the system, for the scheduler
+        ECS::System GetSystem();
     }
 }
 
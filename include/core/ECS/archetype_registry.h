@@ -0,0 +1,428 @@
+//
+// Created by Amo on 2022/7/23.
+//
+
+#ifndef SYMOCRAFT_ARCHETYPE_REGISTRY_H
+#define SYMOCRAFT_ARCHETYPE_REGISTRY_H
+#include "core.h"
+#include "component_container.h"
+
+namespace SymoCraft
+{
+    namespace ECS
+    {
+        typedef uint32 EntityIndex;
+        typedef uint64 EntityId;
+
+        namespace Internal
+        {
+            // Target size of one chunk of an archetype table
+            const uint32 kArchetypeChunkBytes = 16 * 1024;
+            // Alignment of every column inside a chunk
+            const uint32 kArchetypeColumnAlignment = 16;
+            // The column index of a component that is not part of an archetype
+            const int16 kNullColumn = -1;
+
+            struct ArchetypeChunk
+            {
+                uint8* data;
+                uint32 num_entities;
+            };
+
+            /* ---------------------------------------------------------------------------------------------------
+               An archetype is the table of all entities with exactly the same components.
+               The table is split into chunks, every chunk stores its entities as columns (SoA):
+               [entity ids][component A][component B]...
+               Rows are packed, so every chunk but the last one is full.
+            */
+            class Archetype
+            {
+            public:
+                ComponentSignature signature;
+                // Component types in ascending order, one column each
+                std::vector<int32> component_types;
+                std::vector<uint32> component_sizes;
+                // Byte offset of each column inside a chunk
+                std::vector<uint32> column_offsets;
+                // Column index of every component type, kNullColumn if the archetype doesn't have it
+                std::array<int16, kMaxNumComponents> column_of_type;
+
+                uint32 chunk_capacity;
+                uint32 chunk_bytes;
+                uint32 num_entities;
+                std::vector<ArchetypeChunk> chunks;
+
+                // Archetypes reached by adding or removing one component
+                robin_hood::unordered_flat_map<int32, uint32> add_edges;
+                robin_hood::unordered_flat_map<int32, uint32> remove_edges;
+
+                // Lay out the columns of a new archetype
+                // Parameters: signature, size of every registered component
+                void Init(const ComponentSignature& archetype_signature, const std::vector<uint32>& sizes);
+
+                void Free();
+
+                // Append a row, allocate a new chunk if the last one is full
+                // return the row index
+                uint32 AllocateRow(EntityId entity);
+
+                // Remove a row by moving the last row into it
+                // return the entity that was moved into the row, null_entity if none
+                EntityId RemoveRow(uint32 row);
+
+                inline EntityId* GetEntities(uint32 chunk) const
+                {
+                    return (EntityId*)chunks[chunk].data;
+                }
+
+                // Get the column of a component in a chunk, the archetype must have the component
+                inline uint8* GetColumn(uint32 chunk, int32 component_type) const
+                {
+                    return chunks[chunk].data + column_offsets[column_of_type[component_type]];
+                }
+
+                // Get the component of a row, the archetype must have the component
+                inline uint8* GetComponent(uint32 row, int32 component_type) const
+                {
+                    const int16 column = column_of_type[component_type];
+                    return chunks[row / chunk_capacity].data + column_offsets[column]
+                           + (size_t)(row % chunk_capacity) * component_sizes[column];
+                }
+            };
+
+            // Where the components of an entity live
+            struct EntityLocation
+            {
+                uint32 archetype;
+                uint32 row;
+            };
+        }
+
+        template<typename ...Components>
+        class ArchetypeViewer;
+
+        /* ---------------------------------------------------------------------------------------------------
+           About archetype registry:
+           The sparse set Registry stores every component type in its own array,
+           so a system that reads several components jumps between unrelated arrays for every entity.
+
+           ArchetypeRegistry is the other storage backend. It has the same interface as Registry,
+           but groups the entities with the same components into chunked SoA tables,
+           so a view streams linearly over the columns.
+           The price is that adding or removing a component moves the entity to another table.
+
+           Use it for the large crowds (mobs, items, particles) which are iterated a lot and rarely
+           change their components. Component references are invalidated by adding or removing
+           components of any entity, and by destroying entities.
+        */
+        class ArchetypeRegistry
+        {
+        public:
+            // -------------------------------------------------------------------
+            // Registry Functions
+
+            // Free
+            void Free();
+
+            // Clear
+            // Brief: clear all data member
+            void Clear();
+
+            // -------------------------------------------------------------------
+            // Entity Registry
+
+            // Create an entity
+            // return a new entity id
+            EntityId CreateEntity();
+
+            // The component number of entity
+            // Parameters: entity id
+            int NumComponents(EntityId entity) const;
+
+            // Check if the entity is valid
+            // Parameters: Entity id
+            bool IsEntityValid(EntityId entity) const;
+
+            // Destroy an entity
+            // Parameters: entity id
+            void DestroyEntity(EntityId entity);
+
+            // -------------------------------------------------------------------
+            // Component Registry
+
+            // Register a component, the id of T is fixed by ECS::RegisteredComponents so the order doesn't matter
+            // Parameters: debug name
+            template<typename T>
+            void RegisterComponent(const char *debug_name)
+            {
+                static_assert(std::is_trivially_copyable<T>(), "Components are moved between archetypes byte wise.");
+                constexpr int32 com_type = Internal::GetComponentType<T>();
+                AmoLogger_Assert(!IsComponentRegistered(com_type), "Tried to register component '%s' twice", debug_name);
+                if (component_sizes.size() <= com_type)
+                {
+                    // Size 0 marks the components that aren't registered yet
+                    component_sizes.resize(com_type + 1, 0);
+                    debug_component_names.resize(com_type + 1);
+                }
+                component_sizes[com_type] = (uint32)sizeof(T);
+                debug_component_names[com_type] = debug_name;
+            }
+
+            // Check if a component type was registered
+            // Parameters: component type
+            inline bool IsComponentRegistered(int32 component_type) const
+            {
+                return component_type >= 0 && component_type < (int32)component_sizes.size()
+                       && component_sizes[component_type] != 0;
+            }
+
+            // Add a Component to an entity, moves the entity to another archetype
+            // return a component reference
+            // Parameters: entity id
+            template<typename T>
+            T& AddComponent(EntityId entity)
+            {
+                int32 component_type = Internal::GetComponentType<T>();
+                AmoLogger_Assert(IsComponentRegistered(component_type),
+                                 "Component '%s' was not registered.", typeid(T).name());
+
+                bool is_new = !HasComponentByType(entity, component_type);
+                T* component = (T*)AddOrGetComponentByType(entity, component_type);
+                if (is_new)
+                    new(component) T{};
+                return *component;
+            }
+
+            // Has Component by Component Type?
+            // Parameters: entity id, component type
+            bool HasComponentByType(EntityId entity, int32 component_type) const;
+
+            // Has Component?
+            // Parameters: entity id
+            template<typename T>
+            bool HasComponent(EntityId entity) const
+            {
+                return HasComponentByType(entity, Internal::GetComponentType<T>());
+            }
+
+            // Get Component By Type
+            // return a data pointer, nullptr if the entity doesn't have the component
+            // Parameters: entity id, component type
+            uint8* GetComponentByType(EntityId entity, int32 component_type) const;
+
+            // Get Component
+            // return a component reference
+            // Parameters: entity id
+            template<typename T>
+            T& GetComponent(EntityId entity) const
+            {
+                uint8* component = GetComponentByType(entity, Internal::GetComponentType<T>());
+                AmoLogger_Assert(component != nullptr, "Entity '%d' does not have component '%d'"
+                                 , entity, Internal::GetComponentType<T>());
+                return *(T*)component;
+            }
+
+            // Add or get a component, the new component is zeroed
+            // return a data pointer
+            // Parameters: entity id, component type
+            uint8* AddOrGetComponentByType(EntityId entity, int32 component_type);
+
+            // Remove Component by Component Type, moves the entity to another archetype
+            // Parameters: entity id, component type
+            void RemoveComponentByType(EntityId entity, int32 component_type);
+
+            // Remove Component
+            // Parameters: entity id
+            template<typename T>
+            void RemoveComponent(EntityId entity)
+            {
+                RemoveComponentByType(entity, Internal::GetComponentType<T>());
+            }
+
+            // Remove all component of an entity
+            void RemoveAllComponent(EntityId entity);
+
+            // Number of archetypes, including the empty one
+            inline uint32 NumArchetypes() const
+            {
+                return (uint32)archetypes.size();
+            }
+
+            // ---------------------------------------------------------------------------------------------------
+            // Archetype Viewer
+            // Iterate all entities that have every component, yielding tuples of the entity id and component references
+            // Don't add or remove components while iterating
+            template<typename... Components>
+            ArchetypeViewer<Components...> View()
+            {
+                return ArchetypeViewer<Components...>(*this);
+            }
+
+        public:
+            std::vector<EntityId> entities;
+
+        private:
+            template<typename... Components>
+            friend class ArchetypeViewer;
+
+            std::vector<Internal::Archetype> archetypes;
+            robin_hood::unordered_flat_map<Internal::ComponentSignature, uint32> archetype_of_signature;
+            std::vector<Internal::EntityLocation> locations;
+            std::vector<uint32> component_sizes;
+            std::vector<EntityIndex> free_entities;
+            std::vector<std::string> debug_component_names;
+
+            // Find or create the archetype of a signature
+            uint32 GetArchetype(const Internal::ComponentSignature& signature);
+
+            // Find the archetype reached by adding (or removing) one component, cached as an edge
+            uint32 GetNeighbourArchetype(uint32 archetype, int32 component_type, bool add);
+
+            // Move an entity to another archetype, copying the components they share
+            // Components the old archetype doesn't have are zeroed
+            void MoveEntity(EntityId entity, uint32 target_archetype);
+        };
+
+        /* ---------------------------------------------------------------------------------------------------
+           About archetype viewer:
+           The viewer collects the archetypes that contain every viewed component,
+           then walks their chunks row by row. Inside a chunk the components are read
+           straight from the columns, there are no lookups at all.
+        */
+        template<typename... Components>
+        class ArchetypeViewer
+        {
+            static_assert(sizeof...(Components) > 0, "A view needs at least one component");
+            static constexpr size_t kNumComponents = sizeof...(Components);
+
+        public:
+            using value_type = std::tuple<EntityId, Components&...>;
+
+            class Iterator
+            {
+            public:
+                // constructor
+                // Parameters: viewer, index in the matched archetypes
+                Iterator(const ArchetypeViewer* viewer, uint32 archetype)
+                : m_viewer(viewer), m_archetype(archetype), m_chunk(0)
+                {
+                    LoadChunk();
+                }
+
+                // Indirect operator
+                // Return the entity id and references of its components
+                value_type operator*() const
+                {
+                    return Dereference(std::index_sequence_for<Components...>{});
+                }
+
+                // Every row has its own entity slot, so comparing it is enough
+                bool operator ==(const Iterator& other) const
+                {
+                    return m_entity == other.m_entity;
+                }
+
+                bool operator !=(const Iterator& other) const
+                {
+                    return m_entity != other.m_entity;
+                }
+
+                // Increment operator
+                // move to the next chunk or archetype at the end of a chunk
+                Iterator& operator++()
+                {
+                    m_entity++;
+                    Advance(std::index_sequence_for<Components...>{});
+                    if (m_entity == m_chunk_end)
+                        NextChunk();
+                    return *this;
+                }
+
+            private:
+                const ArchetypeViewer* m_viewer;
+                uint32 m_archetype;
+                uint32 m_chunk;
+                // Current row of the entity column and of every component column
+                EntityId* m_entity = nullptr;
+                EntityId* m_chunk_end = nullptr;
+                std::tuple<Components*...> m_components;
+
+                void NextChunk()
+                {
+                    if (++m_chunk == m_viewer->m_archetypes[m_archetype]->chunks.size())
+                    {
+                        m_chunk = 0;
+                        m_archetype++;
+                    }
+                    LoadChunk();
+                }
+
+                void LoadChunk()
+                {
+                    if (m_archetype >= m_viewer->m_archetypes.size())
+                    {
+                        // The end of the view
+                        m_entity = m_chunk_end = nullptr;
+                        return;
+                    }
+
+                    const Internal::Archetype* archetype = m_viewer->m_archetypes[m_archetype];
+                    m_entity = archetype->GetEntities(m_chunk);
+                    m_chunk_end = m_entity + archetype->chunks[m_chunk].num_entities;
+                    LoadColumns(archetype, std::index_sequence_for<Components...>{});
+                }
+
+                template<size_t... I>
+                inline void LoadColumns(const Internal::Archetype* archetype, std::index_sequence<I...>)
+                {
+                    ((std::get<I>(m_components) =
+                            (Components*)archetype->GetColumn(m_chunk, m_viewer->m_component_types[I])), ...);
+                }
+
+                template<size_t... I>
+                inline void Advance(std::index_sequence<I...>)
+                {
+                    (std::get<I>(m_components)++, ...);
+                }
+
+                template<size_t... I>
+                inline value_type Dereference(std::index_sequence<I...>) const
+                {
+                    return value_type(*m_entity, *std::get<I>(m_components)...);
+                }
+            };
+
+            explicit ArchetypeViewer(ArchetypeRegistry &reg)
+            : m_component_types{Internal::GetComponentType<Components>() ...}
+            {
+                Internal::ComponentSignature required;
+                for (int32 component_type : m_component_types)
+                {
+                    AmoLogger_Assert(reg.IsComponentRegistered(component_type),
+                                     "Tried to view a component that was not registered.");
+                    required.set(component_type);
+                }
+
+                for (const Internal::Archetype& archetype : reg.archetypes)
+                    if (archetype.num_entities > 0 && (archetype.signature & required) == required)
+                        m_archetypes.push_back(&archetype);
+            }
+
+            Iterator begin() const
+            {
+                return Iterator(this, 0);
+            }
+
+            Iterator end() const
+            {
+                return Iterator(this, (uint32)m_archetypes.size());
+            }
+
+        private:
+            std::array<int32, kNumComponents> m_component_types;
+            std::vector<const Internal::Archetype*> m_archetypes;
+        };
+    }
+}
+
+#endif //SYMOCRAFT_ARCHETYPE_REGISTRY_H
@@ -0,0 +1,107 @@
+//
+// Created by Amo on 2022/7/25.
+//
+
+#ifndef SYMOCRAFT_COMMAND_BUFFER_H
+#define SYMOCRAFT_COMMAND_BUFFER_H
+#include "core.h"
+#include "core/ECS/component_container.h"
+
+namespace SymoCraft
+{
+    namespace ECS
+    {
+        typedef uint64 EntityId;
+
+        namespace Internal
+        {
+            // Entities created by a command buffer carry this version until the buffer is played back
+            const EntityVersion kDeferredEntityVersion = UINT32_MAX;
+
+            // A new id for the command buffers of a registry, never 0
+            uint64 GenerateCommandBuffersId();
+
+            enum class CommandType : uint8
+            {
+                CreateEntity = 0,
+                DestroyEntity,
+                AddComponent,
+                RemoveComponent
+            };
+
+            // Every command is a header, followed by payload_size bytes of component data
+            struct CommandHeader
+            {
+                CommandType type;
+                int32 component_type;
+                EntityId entity;
+                uint32 payload_size;
+            };
+        }
+
+        /* ---------------------------------------------------------------------------------------------------
+           About command buffer:
+           Creating or destroying entities and adding or removing components changes the arrays of the registry,
+           so it can't happen on worker threads or while a view is iterating.
+           A command buffer records these changes instead, and the registry plays them back at a sync point.
+
+           Every thread gets its own buffer from Registry::GetCommandBuffer(), so recording never locks.
+           Commands of one buffer are played back in the order they were recorded.
+        */
+        class CommandBuffer
+        {
+        public:
+            // Record the creation of an entity
+            // return a deferred entity id, which is only valid in the later commands of this buffer
+            EntityId CreateEntity();
+
+            // Record the destruction of an entity
+            // Parameters: entity id or deferred entity id
+            void DestroyEntity(EntityId entity);
+
+            // Record adding a component, an existing component is overwritten
+            // Parameters: entity id or deferred entity id, component value
+            template<typename T>
+            void AddComponent(EntityId entity, const T& component = T{})
+            {
+                static_assert(std::is_trivially_copyable<T>(), "Components are copied into the command buffer byte wise.");
+                Record(Internal::CommandType::AddComponent, entity, Internal::GetComponentType<T>(), &component, sizeof(T));
+            }
+
+            // Record removing a component
+            // Parameters: entity id or deferred entity id
+            template<typename T>
+            void RemoveComponent(EntityId entity)
+            {
+                Record(Internal::CommandType::RemoveComponent, entity, Internal::GetComponentType<T>(), nullptr, 0);
+            }
+
+            inline bool IsEmpty() const
+            {
+                return m_num_commands == 0;
+            }
+
+            inline uint32 NumCommands() const
+            {
+                return m_num_commands;
+            }
+
+            // Drop all commands, the memory is kept
+            void Clear();
+
+        private:
+            friend class Registry;
+
+            std::vector<uint8> m_data;
+            uint32 m_num_commands = 0;
+            uint32 m_num_created_entities = 0;
+            // The thread recording into this buffer, for Registry::GetCommandBuffer
+            std::thread::id m_owner_thread;
+
+            void Record(Internal::CommandType type, EntityId entity, int32 component_type,
+                        const void* payload, uint32 payload_size);
+        };
+    }
+}
+
+#endif //SYMOCRAFT_COMMAND_BUFFER_H
@@ -5,6 +5,7 @@
 #ifndef SYMOCRAFT_COMPONENT_H
 #define SYMOCRAFT_COMPONENT_H
 #include "core.h"
+#include "core/ECS/internal.h"
 
 namespace SymoCraft
 {
@@ -20,6 +21,14 @@ namespace SymoCraft
         glm::vec3 right;        // z axis
     };
 
+    // Positions of an entity after the last two fixed ticks, kept by physics
+    // Draw the entity at glm::mix(previous_position, current_position, SimulationClock::GetAlpha())
+    struct InterpolatedTransform
+    {
+        glm::vec3 previous_position;
+        glm::vec3 current_position;
+    };
+
     namespace Physics
     {
         struct RigidBody
@@ -29,6 +38,10 @@ namespace SymoCraft
             bool on_ground;
             bool is_sensor;
             bool use_gravity;
+            // Set by physics, a sleeping body is not moved until something wakes it
+            bool is_sleeping;
+            // Steps in a row the body has been at rest, kept by physics
+            uint16 num_still_steps;
 
             void zero_forces()
             {
@@ -71,6 +84,18 @@ namespace SymoCraft
         };
     }
 
+    namespace ECS
+    {
+        // Every component type, the index in the list is the component id,
+        // append new components at the end
+        using RegisteredComponents = Internal::ComponentList<
+                Transform,
+                Physics::RigidBody,
+                Physics::HitBox,
+                Character::CharacterComponent,
+                Character::PlayerComponent,
+                InterpolatedTransform>;
+    }
 
 }
 
@@ -6,6 +6,7 @@
 #define SYMOCRAFT_COMPONENT_CONTAINER_H
 #include "core.h"
 #include "internal.h"
+#include "component.h"
 
 namespace SymoCraft
 {
@@ -18,24 +19,38 @@ namespace SymoCraft
 
         namespace Internal
         {
-            extern int32 m_counter;
+            // The component id of T, fixed at compile time by its place in RegisteredComponents
             template<typename T>
-            int32 GetComponentType()
+            constexpr int32 GetComponentType()
             {
-                static int32 m_component_type = Internal::m_counter++;
-                return m_component_type;
+                constexpr int32 component_type = IndexOfComponent<T>(RegisteredComponents{});
+                static_assert(component_type >= 0, "The component is not in ECS::RegisteredComponents.");
+                return component_type;
             }
 
-            const int kSpareSetPoolSize = 8;
             const int32 kMaxNumComponents = 256;
+            const int32 kNumRegisteredComponents = RegisteredComponents::kSize;
+            static_assert(kNumRegisteredComponents <= kMaxNumComponents, "Exceeded the maximum number of components.");
+            const uint32 kInitialDenseCapacity = 8;
 
-            struct SparseSetPool
+            // One bit per component type
+            typedef std::bitset<kMaxNumComponents> ComponentSignature;
+
+            template<typename... Components>
+            ComponentSignature MakeComponentSignature()
             {
-                EntityIndex start_entity_index;
-                ComponentIndex component_index_in_data[kSpareSetPoolSize];
+                ComponentSignature signature;
+                (signature.set(GetComponentType<Components>()), ...);
+                return signature;
+            }
 
-                void Init();
-            };
+            // The sparse side is split into pages of (1 << kSparsePageShift) slots, allocated on first use
+            // The slot of an entity index is pages[index >> kSparsePageShift][index & kSparsePageMask]
+            const uint32 kSparsePageShift = 12;
+            const uint32 kSparsePageSize = 1u << kSparsePageShift;
+            const uint32 kSparsePageMask = kSparsePageSize - 1;
+            // An empty slot
+            const ComponentIndex kNullComponentIndex = UINT32_MAX;
 
             class ComponentContainer
             {
@@ -58,63 +73,56 @@ namespace SymoCraft
                     , "Component must be POD. Component %s is not POD.", typeid(T).name());
                     component_size = sizeof(T);
 
-                    num_pools = 1;
-                    pools = (SparseSetPool*) AmoMemory_Allocate(num_pools * sizeof(SparseSetPool));
-                    pools[0].Init();
-                    pools[0].start_entity_index = GetPoolAlignedIndex(entity_index);
+                    num_pages = 0;
+                    pages = nullptr;
 
                     num_components = 0;
-                    max_num_components = Internal::kSpareSetPoolSize;
+                    max_num_components = Internal::kInitialDenseCapacity;
                     data = (char*) AmoMemory_Allocate(component_size * max_num_components);
                     entities = (EntityIndex*) AmoMemory_Allocate(sizeof(EntityIndex) * max_num_components);
+                    added_ticks = (uint32*) AmoMemory_Allocate(sizeof(uint32) * max_num_components);
+                    changed_ticks = (uint32*) AmoMemory_Allocate(sizeof(uint32) * max_num_components);
                 }
 
 
                 void Free();
 
-                inline uint32 GetPoolAlignedIndex(EntityIndex index) const
+                // Get the sparse slot of an entity, nullptr if its page is not allocated
+                // Parameters: entity index
+                inline ComponentIndex* GetSparseSlot(EntityIndex index) const
                 {
-                    // we need to make sure pools al
-                    return (index / kSpareSetPoolSize) * kSpareSetPoolSize;
+                    const uint32 page = index >> kSparsePageShift;
+                    if (page >= num_pages || !pages[page])
+                        return nullptr;
+                    return &pages[page][index & kSparsePageMask];
                 }
 
-                // Get the pool where entity in
-                SparseSetPool* GetPool(EntityIndex index) const;
-
                 // Get the component data
                 // Parameters: entity index
                 template<typename T>
                 inline T* Get(EntityIndex index) const
                 {
-                    SparseSetPool* pool = GetPool(index);
-                    if (!pool)
+                    ComponentIndex* slot = GetSparseSlot(index);
+                    if (!slot || *slot == kNullComponentIndex)
                     {
                         AmoLogger_Error("Invalid entity '%d' for component '%d'", index, component_type);
                         return nullptr;
                     }
-
-                    auto dense_array_component_index =
-                            (ComponentIndex)pool->component_index_in_data[index - pool->start_entity_index];
-                    AmoLogger_Assert((dense_array_component_index < num_components && dense_array_component_index >=0)
-                    , "Invalid dense array index");
-                    return (T*)(data + dense_array_component_index * component_size);
+                    return (T*)data + *slot;
                 }
 
                 // byte wise Get
                 inline uint8* Get(EntityIndex index) const
                 {
-                    SparseSetPool* pool = GetPool(index);
-                    if (!pool)
+                    ComponentIndex* slot = GetSparseSlot(index);
+                    if (!slot || *slot == kNullComponentIndex)
                     {
                         AmoLogger_Error("Invalid entity '%d' for component '%d'", index, component_type);
                         return nullptr;
                     }
 
-                    auto dense_array_component_index =
-                            (ComponentIndex)pool->component_index_in_data[index - pool->start_entity_index];
-                    AmoLogger_Assert((dense_array_component_index < num_components && dense_array_component_index >=0)
-                    , "Invalid dense array index");
-                    return (uint8*)(data + dense_array_component_index * component_size);
+                    AmoLogger_Assert(*slot < num_components, "Invalid dense array index");
+                    return (uint8*)(data + *slot * component_size);
                 }
 
                 // Add component to entity
@@ -122,54 +130,9 @@ namespace SymoCraft
                 template<typename T>
                 void Add(EntityId entity, const T& component)
                 {
-                    EntityIndex entity_index = GetEntityIndex(entity);
-                    SparseSetPool* pool = GetPool(entity_index);
-                    // no satisfying pool, add one
-                    if (!pool)
-                    {
-                        const int new_num_pools = num_pools + 1;
-                        // reallocate pools
-                        SparseSetPool* new_pools = (SparseSetPool*) AmoMemory_ReAlloc(pools
-                        , new_num_pools * sizeof(SparseSetPool));
-                        if (!new_pools)
-                        {
-                            AmoLogger_Error("Failed to allocate memory for new sparse set pool for component '%d'", component_type);
-                            return;
-                        }
-                        num_pools = new_num_pools;
-                        pools = new_pools;
-                        pools[num_pools - 1].Init();
-                        pools[num_pools - 1].start_entity_index = GetPoolAlignedIndex(entity_index);
-                        pool = &pools[num_pools - 1];
-                    }
-
-                    // allocate memory for data
-                    ComponentIndex next_component_index = num_components;
-                    if (next_component_index >= max_num_components)
-                    {
-                        int new_max_num_components = max_num_components * 2;
-                        char* new_component_memory = (char*) AmoMemory_ReAlloc(data
-                        , component_size * new_max_num_components);
-                        EntityIndex* new_entity_memory = (EntityIndex*) AmoMemory_ReAlloc(entities
-                        , sizeof(EntityIndex) * new_max_num_components);
-                        if (!new_component_memory || !new_entity_memory)
-                        {
-                            AmoMemory_Free(new_entity_memory);
-                            AmoMemory_Free(new_component_memory);
-                            AmoLogger_Error("Failed to allocate new memory for "
-                                            "component pool or entities for component '%d'"
-                            , component_type);
-                            return;
-                        }
-                        data = new_component_memory;
-                        entities = new_entity_memory;
-                        max_num_components = new_max_num_components;
-                    }
-
-                    pool->component_index_in_data[entity_index - pool->start_entity_index] = next_component_index;
-                    AmoBase::AmoMemory_CopyMem(data + next_component_index * component_size, (void*)&component, component_size);
-                    entities[next_component_index] = entity_index;
-                    num_components++;
+                    uint8* component_data = AllocateComponent(GetEntityIndex(entity));
+                    if (component_data)
+                        AmoBase::AmoMemory_CopyMem(component_data, (void*)&component, component_size);
                 }
 
                 // Add a null component to entity
@@ -197,11 +160,8 @@ namespace SymoCraft
                 // Parameters: entity id
                 inline bool IsComponentExist(EntityId entity) const
                 {
-                    const EntityIndex index = GetEntityIndex(entity);
-                    SparseSetPool* pool = GetPool(index);
-                    if (!pool) return false;
-
-                    return pool->component_index_in_data[index - pool->start_entity_index] != UINT32_MAX;
+                    ComponentIndex* slot = GetSparseSlot(GetEntityIndex(entity));
+                    return slot && *slot != kNullComponentIndex;
                 }
 
                 // Remove a component of an entity
@@ -213,20 +173,190 @@ namespace SymoCraft
                 {
                     return component_size;
                 }
+
+                // Get the component of an entity that is known to have it, no checks
+                // Parameters: entity index
+                template<typename T>
+                inline T* GetUnchecked(EntityIndex index) const
+                {
+                    return (T*)data + *GetSparseSlot(index);
+                }
+
+                // Get the dense index of an entity that is known to have the component, no checks
+                // Parameters: entity index
+                inline ComponentIndex GetDenseIndex(EntityIndex index) const
+                {
+                    return *GetSparseSlot(index);
+                }
+
+                // Get a component by its dense index, no checks
+                // Parameters: dense index
+                template<typename T>
+                inline T* GetDense(ComponentIndex dense_index) const
+                {
+                    return (T*)data + dense_index;
+                }
+
+                // byte wise GetDense
+                inline uint8* GetDense(ComponentIndex dense_index) const
+                {
+                    return (uint8*)(data + (size_t)dense_index * component_size);
+                }
+
+                // -------------------------------------------------------------------
+                // Change ticks
+                // Every dense slot remembers the registry tick it was added at and last changed at
+
+                // Parameters: dense index, tick
+                inline void MarkChanged(ComponentIndex dense_index, uint32 tick) const
+                {
+                    changed_ticks[dense_index] = tick;
+                }
+
+                // Parameters: dense index, tick
+                inline void MarkAdded(ComponentIndex dense_index, uint32 tick) const
+                {
+                    added_ticks[dense_index] = tick;
+                    changed_ticks[dense_index] = tick;
+                }
+
+                // Parameters: tick
+                inline void MarkAllChanged(uint32 tick) const
+                {
+                    std::fill_n(changed_ticks, num_components, tick);
+                }
+
+                // Parameters: dense index
+                inline uint32 GetChangedTick(ComponentIndex dense_index) const
+                {
+                    return changed_ticks[dense_index];
+                }
+
+                // Parameters: dense index
+                inline uint32 GetAddedTick(ComponentIndex dense_index) const
+                {
+                    return added_ticks[dense_index];
+                }
+
+                // Grow the dense array to hold at least capacity components
+                // return false if it's out of memory
+                // Parameters: capacity
+                bool Reserve(uint32 capacity);
+
+                // Replace all components with whole columns, the components are stamped as added at tick
+                // return false if it's out of memory
+                // Parameters: entity indices, component data, number of components, tick
+                bool Assign(const EntityIndex* entity_indices, const uint8* component_data, uint32 count, uint32 tick);
+
+                // Append a copy of one component for every entity, the copies are contiguous in the dense array
+                // The entities must not have the component yet, the copies are stamped as added at tick
+                // return false if it's out of memory
+                // Parameters: entity indices, component data, number of entities, tick
+                bool AppendCopies(const EntityIndex* entity_indices, const uint8* component_data, uint32 count, uint32 tick);
+
+                // Number of components in the dense array
+                inline uint32 Size() const
+                {
+                    return num_components;
+                }
+
+                // Number of components the dense array holds without growing
+                inline uint32 Capacity() const
+                {
+                    return max_num_components;
+                }
+
+                // Entities of the dense array, in the same order as the components
+                inline const EntityIndex* GetEntities() const
+                {
+                    return entities;
+                }
             private:
+                // Get the sparse slot of an entity, allocating its page if needed
+                // Parameters: entity index
+                ComponentIndex* AssureSparseSlot(EntityIndex index);
+
+                // Append an uninitialized component for an entity to the dense array
+                // Return the component data, nullptr if it's out of memory
+                // Parameters: entity index
+                uint8* AllocateComponent(EntityIndex index);
+
                 int component_type;
                 uint32 max_num_components;
                 uint32 num_components;
-                int num_pools;
+                uint32 num_pages;
 
-                SparseSetPool* pools;
+                ComponentIndex** pages;
                 // Numbers of entities is always equal to num_components for a sparse set
                 EntityIndex* entities;
                 char * data;
                 size_t component_size;
+                // Parallel to the dense array
+                uint32* added_ticks;
+                uint32* changed_ticks;
             };
         }
 
+        /* ---------------------------------------------------------------------------------------------------
+           About component storage:
+           The component container is type erased, so it can copy components byte wise for snapshots and
+           command buffers. A ComponentStorage<T> is a typed window on the dense array of a container,
+           a plain loop over it indexes a T array, which the compiler can vectorise.
+           Components can't be added or removed through it, and it's invalid once the container grows.
+        */
+        template<typename T>
+        class ComponentStorage
+        {
+        public:
+            using Component = std::remove_const_t<T>;
+
+            explicit ComponentStorage(const Internal::ComponentContainer& container)
+            : m_components(container.template GetDense<Component>(0)), m_entities(container.GetEntities()),
+              m_size(container.Size())
+            {
+                AmoLogger_Assert(container.GetComponentSize() == sizeof(Component),
+                                 "The container doesn't hold '%s' components.", typeid(Component).name());
+            }
+
+            // Number of components
+            inline uint32 Size() const
+            {
+                return m_size;
+            }
+
+            // The dense component array
+            inline T* Data() const
+            {
+                return m_components;
+            }
+
+            // Entities of the dense array, in the same order as the components
+            inline const EntityIndex* GetEntities() const
+            {
+                return m_entities;
+            }
+
+            // Parameters: dense index
+            inline T& operator[](ComponentIndex dense_index) const
+            {
+                return m_components[dense_index];
+            }
+
+            inline T* begin() const
+            {
+                return m_components;
+            }
+
+            inline T* end() const
+            {
+                return m_components + m_size;
+            }
+
+        private:
+            T* m_components;
+            const EntityIndex* m_entities;
+            uint32 m_size;
+        };
     }
 }
 
@@ -38,6 +38,22 @@ namespace SymoCraft::ECS
                 return GetEntityIndex(id) != GetEntityIndex(null_entity);
             }
              */
+
+            // A list of component types, see ECS::RegisteredComponents
+            template<typename... Components>
+            struct ComponentList
+            {
+                static constexpr int32 kSize = sizeof...(Components);
+            };
+
+            // Index of T in a component list, -1 if it's not in the list
+            template<typename T, typename... Components>
+            constexpr int32 IndexOfComponent(ComponentList<Components...>)
+            {
+                int32 index = 0;
+                const bool found = ((std::is_same_v<T, Components> || (index++, false)) || ...);
+                return found ? index : -1;
+            }
         }
 
     }
@@ -0,0 +1,89 @@
+//
+// Created by Amo on 2022/7/28.
+//
+
+#ifndef SYMOCRAFT_PREFAB_H
+#define SYMOCRAFT_PREFAB_H
+#include "core.h"
+#include "core/ECS/component_container.h"
+
+namespace SymoCraft
+{
+    namespace ECS
+    {
+        /* ---------------------------------------------------------------------------------------------------
+           About prefab:
+           A prefab is a bundle of components with default values, e.g. everything a mob needs.
+           Registry::Instantiate creates entities from it, N at a time: every container is grown once
+           and the copies of a component are written next to each other at the end of its dense array,
+           instead of one lookup and possible reallocation per entity and component.
+        */
+        class Prefab
+        {
+        public:
+            // Add a component to the prefab, or replace its value
+            // return the component in the prefab, valid until the next Set
+            // Parameters: component value
+            template<typename T>
+            T& Set(const T& component = T{})
+            {
+                static_assert(std::is_trivially_copyable<T>(), "Prefab components are copied byte wise.");
+                constexpr int32 component_type = Internal::GetComponentType<T>();
+                if (!m_signature.test(component_type))
+                {
+                    m_signature.set(component_type);
+                    // Keep the offsets aligned for Get
+                    const size_t offset = (m_data.size() + alignof(T) - 1) / alignof(T) * alignof(T);
+                    m_data.resize(offset + sizeof(T));
+                    m_components.push_back({component_type, (uint32)offset, (uint32)sizeof(T)});
+                }
+
+                T* data = (T*)(m_data.data() + FindComponent(component_type)->offset);
+                *data = component;
+                return *data;
+            }
+
+            // Get a component of the prefab
+            // return the component, valid until the next Set
+            template<typename T>
+            T& Get()
+            {
+                const ComponentEntry* entry = FindComponent(Internal::GetComponentType<T>());
+                AmoLogger_Assert(entry != nullptr, "The prefab has no component '%s'.", typeid(T).name());
+                return *(T*)(m_data.data() + entry->offset);
+            }
+
+            template<typename T>
+            bool Has() const
+            {
+                return m_signature.test(Internal::GetComponentType<T>());
+            }
+
+            inline const Internal::ComponentSignature& GetSignature() const
+            {
+                return m_signature;
+            }
+
+            // Remove every component
+            void Clear();
+
+        private:
+            friend class Registry;
+
+            struct ComponentEntry
+            {
+                int32 component_type;
+                uint32 offset;
+                uint32 size;
+            };
+
+            Internal::ComponentSignature m_signature;
+            std::vector<ComponentEntry> m_components;
+            std::vector<uint8> m_data;
+
+            const ComponentEntry* FindComponent(int32 component_type) const;
+        };
+    }
+}
+
+#endif //SYMOCRAFT_PREFAB_H
@@ -6,6 +6,8 @@
 #define SYMOCRAFT_REGISTRY_H
 #include "core.h"
 #include "component_container.h"
+#include "command_buffer.h"
+#include "prefab.h"
 
 
 namespace SymoCraft
@@ -56,6 +58,15 @@ namespace SymoCraft
             // Parameters: entity id
             void DestroyEntity(EntityId entity);
 
+            // Create an entity with a copy of every component of a prefab
+            // return the new entity id
+            // Parameters: prefab
+            EntityId Instantiate(const Prefab& prefab);
+
+            // Create entities from a prefab in bulk, every container grows once
+            // Parameters: prefab, number of entities, output array for the new entity ids(nullptr if not needed)
+            void Instantiate(const Prefab& prefab, uint32 count, EntityId* out_entities = nullptr);
+
             // Find an entity
             // Return an entity id
             // Parameters: TagType
@@ -64,17 +75,30 @@ namespace SymoCraft
             // -------------------------------------------------------------------
             // Component Registry
 
-            // Register a component
+            // Register a component, the id of T is fixed by ECS::RegisteredComponents so the order doesn't matter
             // Parameters: debug name
             template<typename T>
             void RegisterComponent(const char *debug_name)
             {
-                int32 com_type = ECS::Internal::GetComponentType<T>();
+                constexpr int32 com_type = ECS::Internal::GetComponentType<T>();
                 EntityIndex index = 0;
-                AmoLogger_Assert(com_type == component_set.size(), "Tried to register component '%s' twice", debug_name);
-                component_set.emplace_back(Internal::ComponentContainer::DefaultComponentContainer<T>(index));
-                AmoLogger_Assert(com_type < Internal::kMaxNumComponents, "Exceeded the maximum number of components.");
-                debug_component_names.emplace_back(std::string(debug_name));
+                AmoLogger_Assert(!IsComponentRegistered(com_type), "Tried to register component '%s' twice", debug_name);
+                if (component_set.size() <= com_type)
+                {
+                    // The slots of the components that aren't registered yet stay empty
+                    component_set.resize(com_type + 1, Internal::ComponentContainer{});
+                    debug_component_names.resize(com_type + 1);
+                }
+                component_set[com_type] = Internal::ComponentContainer::DefaultComponentContainer<T>(index);
+                debug_component_names[com_type] = debug_name;
+            }
+
+            // Check if a component type was registered
+            // Parameters: component type
+            inline bool IsComponentRegistered(int32 component_type) const
+            {
+                return component_type >= 0 && component_type < (int32)component_set.size()
+                       && component_set[component_type].GetComponentSize() != 0;
             }
 
             // Add a Component to an entity
@@ -86,12 +110,17 @@ namespace SymoCraft
                 int32 component_type = ECS::Internal::GetComponentType<T>();
                 const EntityIndex index = Internal::GetEntityIndex(entity);
 
-                AmoLogger_Assert(component_type < component_set.size(),
-                                 "You need to register all components in the same order *everywhere*. "
+                AmoLogger_Assert(IsComponentRegistered(component_type),
                                  "Component '%s' was not registered.", typeid(T).name());
 
                 // Get or Add the component at this index
-                T& component = *component_set[component_type].template AddOrGet<T>(entity);
+                Internal::ComponentContainer& container = component_set[component_type];
+                const bool is_new = !container.IsComponentExist(entity);
+                T& component = *container.template AddOrGet<T>(entity);
+                if (is_new)
+                    container.MarkAdded(container.GetDenseIndex(index), GetChangeTick());
+                else
+                    container.MarkChanged(container.GetDenseIndex(index), GetChangeTick());
                 return component;
             }
 
@@ -114,6 +143,8 @@ namespace SymoCraft
 
             // Get Component
             // return a component reference
+            // A mutable reference marks the component changed, ask for a const T to only read
+            // e.g. const Transform& transform = registry.GetComponent<const Transform>(entity);
             // Parameters: entity id
             template<typename T>
             T& GetComponent(EntityId entity) const
@@ -124,20 +155,25 @@ namespace SymoCraft
                     , entity);
                 }
 
-                int32 component_type = Internal::GetComponentType<T>();
+                int32 component_type = Internal::GetComponentType<std::remove_const_t<T>>();
 
-                if (component_type >= component_set.size() || component_type < 0)
+                if (!IsComponentRegistered(component_type))
                 {
                     AmoLogger_Warning("Tried to check if an entity had component '%d', "
                                       "but a component of type '%d' does not exist in the registry."
                     , component_type, component_type);
                 }
 
-                AmoLogger_Assert(HasComponent<T>(entity), "Entity '%d' does not have component '%d'"
+                AmoLogger_Assert(HasComponentByType(entity, component_type), "Entity '%d' does not have component '%d'"
                                  , entity, component_type);
                 // TODO: This will crash if the component is null,
                 //  should we return a null component?
-                return *component_set[component_type].template Get<T>(Internal::GetEntityIndex(entity));
+                // Handing out a mutable reference counts as a change
+                const Internal::ComponentContainer& container = component_set[component_type];
+                const ComponentIndex dense_index = container.GetDenseIndex(Internal::GetEntityIndex(entity));
+                if constexpr (!std::is_const_v<T>)
+                    container.MarkChanged(dense_index, GetChangeTick());
+                return *container.template GetDense<T>(dense_index);
             }
 
             uint8 *AddOrGetComponentByType(EntityId entity, int32 component_id);
@@ -173,24 +209,113 @@ namespace SymoCraft
             // Remove all component of an entity
             void RemoveAllComponent(EntityId entity);
 
+            // Typed access to the dense array of a component, for plain loops over every component
+            // A mutable storage marks every component changed, ask for a const T to only read
+            // e.g. for (const Physics::HitBox& hit_box : registry.GetStorage<const Physics::HitBox>())
+            template<typename T>
+            ComponentStorage<T> GetStorage()
+            {
+                constexpr int32 component_type = Internal::GetComponentType<std::remove_const_t<T>>();
+                AmoLogger_Assert(IsComponentRegistered(component_type),
+                                 "Component '%s' was not registered.", typeid(T).name());
+                const Internal::ComponentContainer& container = component_set[component_type];
+                if constexpr (!std::is_const_v<T>)
+                    container.MarkAllChanged(GetChangeTick());
+                return ComponentStorage<T>(container);
+            }
+
+            // ---------------------------------------------------------------------------------------------------
+            // Change Ticks
+            // Adding a component or taking a mutable reference to it stamps its dense slot with the current tick,
+            // a system compares the stamps with the tick of its last run to find what changed since
+
+            inline uint32 GetChangeTick() const
+            {
+                return change_tick.load(std::memory_order_relaxed);
+            }
+
+            // Start a new tick, e.g. before a system runs
+            // return the new tick
+            inline uint32 AdvanceChangeTick()
+            {
+                return change_tick.fetch_add(1, std::memory_order_relaxed) + 1;
+            }
+
             // ---------------------------------------------------------------------------------------------------
             // Registry Viewer
+            // Iterate all entities that have every component, yielding tuples of the entity id and component references
+            // Non-const components are marked changed as they are visited, view const components to only read them
+            // Don't add or remove the viewed components while iterating
+            // e.g. for (auto [entity, transform, hit_box] : registry.View<Transform, const Physics::HitBox>())
             template<typename... Components>
             RegistryViewer<Components...> View()
             {
                 return RegistryViewer<Components...>(*this);
             }
 
-            RawMemory Serialize();
+            // ---------------------------------------------------------------------------------------------------
+            // Deferred Commands
+
+            // Get the command buffer of the calling thread
+            // Safe to call from any thread and while views are iterating
+            CommandBuffer& GetCommandBuffer();
+
+            // Play back and clear the command buffers of all threads
+            // Call it at a sync point, when no other thread uses the registry
+            void PlaybackCommands();
+
+            // Play back and clear one command buffer
+            // Parameters: command buffer
+            void Playback(CommandBuffer& buffer);
+
+            /* ---------------------------------------------------------------------------------------------------
+               About snapshots:
+               A snapshot stores the entity array and every component container as columns,
+               the dense entity indices and the dense component data are copied with one memcpy each.
+
+               A delta snapshot against a baseline tick only stores the components changed after the baseline,
+               plus the dense entity indices of every container so removed components are removed too.
+               Pass GetLastSnapshotTick() of an earlier snapshot as the baseline,
+               and only apply the delta to a registry that holds that earlier snapshot.
+               Both registries must register the same components.
+            */
+
+            // Write a snapshot
+            // return the snapshot, free it when done
+            // Parameters: baseline tick, 0 writes every component
+            RawMemory Serialize(uint32 baseline_tick = 0);
+
+            // Load a snapshot, a full snapshot replaces everything, a delta snapshot is applied on top
+            // Parameters: snapshot
             void Deserialize(RawMemory &memory);
 
+            // Every change up to this tick is in the last snapshot, pass it as the baseline of the next delta
+            inline uint32 GetLastSnapshotTick() const
+            {
+                return last_snapshot_tick;
+            }
+
         public:
             std::vector<EntityId> entities;
 
         private:
+            template<typename... Components>
+            friend class RegistryViewer;
+
             std::vector<Internal::ComponentContainer> component_set;
             std::vector<EntityId> free_entities;
             std::vector<std::string> debug_component_names;
+
+            // Command buffers of the threads, created on first use
+            std::vector<std::unique_ptr<CommandBuffer>> thread_command_buffers;
+            std::mutex command_buffers_mtx;
+            // Identifies the buffers of this registry in the per thread cache, changes on Clear
+            uint64 command_buffers_id = Internal::GenerateCommandBuffersId();
+            // Real entities of the deferred entities of the buffer being played back
+            std::vector<EntityId> deferred_entities;
+            // Tick 0 is older than every stamp
+            std::atomic<uint32> change_tick{1};
+            uint32 last_snapshot_tick = 0;
         };
 
         /* ---------------------------------------------------------------------------------------------------
@@ -199,96 +324,222 @@ namespace SymoCraft
            of registry itself are not enough.
            What I want to do is create a viewer that can look through the registry to get this kind of entity.
 
-           The first thing is to store what kinds of components does the entity has?
-           The solution is to create a bitset of all the components. set the corresponding component_type bit to 1
+           Walking every entity of the registry wastes most of the time on entities we don't want.
+           Instead, the viewer walks the dense array of the component with the fewest entities,
+           and checks the other components in O(1) through their sparse arrays.
 
-           The second problem is how to loop the registry and get what we want?
-           The solution is to create an iterator for the registry looping all the entities in it
+           The iterator yields the entity id and references of all the components,
+           so systems don't need to look the components up again.
         */
-        class Iterator
+        template<typename... Components>
+        class RegistryViewer
         {
+            static_assert(sizeof...(Components) > 0, "A view needs at least one component");
+            static constexpr size_t kNumComponents = sizeof...(Components);
+
+            // Only keep the candidates whose component was added or changed after a tick
+            struct TickFilter
+            {
+                const Internal::ComponentContainer* container;
+                uint32 since_tick;
+                bool is_added;
+            };
+
         public:
-            // constructor
-            // Parameters: Registry reference, entity index, components need, is searching for all the component
-            Iterator( Registry& reg, EntityIndex index
-                       , std::bitset<Internal::kMaxNumComponents>com_need
-                       , bool all);
+            using value_type = std::tuple<EntityId, Components&...>;
 
-            // Indirect operator = Indexing operator
-            // Return an entity index
-            EntityIndex operator*() const;
+            class Iterator
+            {
+            public:
+                // constructor
+                // Parameters: viewer, index in the dense array of the driving component
+                Iterator(const RegistryViewer* viewer, uint32 dense_index)
+                : m_viewer(viewer), m_dense_index(dense_index)
+                {
+                    SkipUnqualified();
+                }
 
-            // identity operator
-            bool operator ==(Iterator& other) const;
+                // Indirect operator
+                // Return the entity id and references of its components
+                value_type operator*() const
+                {
+                    return m_viewer->Dereference(m_dense_index, std::index_sequence_for<Components...>{});
+                }
 
-            bool operator !=(Iterator& other) const;
+                bool operator ==(const Iterator& other) const
+                {
+                    return m_dense_index == other.m_dense_index;
+                }
 
-            // Increment operator
-            // skip the unqualified elements
-            Iterator& operator++();
+                bool operator !=(const Iterator& other) const
+                {
+                    return m_dense_index != other.m_dense_index;
+                }
 
-        private:
-            Registry& registry;
-            EntityIndex entity_index;
-            std::bitset<Internal::kMaxNumComponents>components_need;
-            bool _is_searching_all;
+                // Increment operator
+                // skip the unqualified elements
+                Iterator& operator++()
+                {
+                    m_dense_index++;
+                    SkipUnqualified();
+                    return *this;
+                }
 
-            // Is it a valid index and has the correct component;
-            bool IsIndexValid();
-        };
+            private:
+                const RegistryViewer* m_viewer;
+                uint32 m_dense_index;
+
+                void SkipUnqualified()
+                {
+                    const uint32 end = m_viewer->m_end;
+                    while (m_dense_index < end && !m_viewer->IsQualified(m_dense_index))
+                        m_dense_index++;
+                }
+            };
 
-        template<typename... Components>
-        class RegistryViewer
-        {
-            friend class Iterator;
-        public:
             explicit RegistryViewer(Registry &reg)
-            : registry(reg)
+            : registry(reg), m_tick(reg.GetChangeTick())
             {
-                _is_searching_all = sizeof...(Components) == 0;
-                if (!_is_searching_all)
+                int32 component_types[] = {Internal::GetComponentType<std::remove_const_t<Components>>() ...};
+                for (size_t i = 0; i < kNumComponents; i++)
                 {
-                    int component_type[] = {0 , ECS::Internal::GetComponentType<Components>() ...};
-                    for (int i = 1; i <= (sizeof...(Components)); i++)
-                        components_need.set(component_type[i]);
+                    AmoLogger_Assert(reg.IsComponentRegistered(component_types[i]),
+                                     "Tried to view a component that was not registered.");
+                    m_containers[i] = &reg.component_set[component_types[i]];
                 }
+
+                // Drive the iteration with the smallest dense array
+                m_driver = m_containers[0];
+                for (const Internal::ComponentContainer* container : m_containers)
+                    if (container->Size() < m_driver->Size())
+                        m_driver = container;
+                m_begin = 0;
+                m_end = m_driver->Size();
             }
 
-            const Iterator begin() const
+            Iterator begin() const
             {
-                int first_index = 0;
-                for (; first_index < registry.entities.size() &&
-                        (
-                                !HasRequiredComponents(registry, components_need, registry.entities[first_index]) ||
-                                !registry.IsEntityValid(registry.entities[first_index])
-                                );)
-                    first_index++;
-                return Iterator(registry, first_index, components_need, _is_searching_all);
+                return Iterator(this, m_begin);
             }
 
-            const Iterator end() const
+            Iterator end() const
+            {
+                return Iterator(this, m_end);
+            }
+
+            // Number of candidates, the size of the driving dense array
+            // Not every candidate has all the components
+            inline uint32 Size() const
+            {
+                return m_driver->Size();
+            }
+
+            // A view of the candidates [begin, end) only, so slices of one view can run on different threads
+            // Returned by value, the viewer is a temporary in range-for loops
+            // Parameters: first candidate, one past the last candidate
+            RegistryViewer Slice(uint32 begin, uint32 end) const
+            {
+                RegistryViewer slice = *this;
+                slice.m_end = glm::min(end, m_driver->Size());
+                slice.m_begin = glm::min(begin, slice.m_end);
+                return slice;
+            }
+
+            // A view stamping the mutable components it visits with a tick instead of the registry's current one
+            // A system passes the run tick of its slice, other systems may advance the registry's tick meanwhile
+            // Parameters: tick
+            RegistryViewer StampWith(uint32 tick) const
+            {
+                RegistryViewer stamped = *this;
+                stamped.m_tick = tick;
+                return stamped;
+            }
+
+            // A view of the entities whose component T changed after a tick
+            // T must be one of the viewed components
+            // Parameters: tick, usually the tick of the system's last run
+            template<typename T>
+            RegistryViewer Changed(uint32 since_tick) const
             {
-                return Iterator(registry, (EntityIndex)registry.entities.size(), components_need, _is_searching_all);
+                return WithFilter<T>(since_tick, false);
+            }
+
+            // A view of the entities whose component T was added after a tick
+            // T must be one of the viewed components
+            // Parameters: tick, usually the tick of the system's last run
+            template<typename T>
+            RegistryViewer Added(uint32 since_tick) const
+            {
+                return WithFilter<T>(since_tick, true);
             }
 
         private:
             Registry& registry;
-            std::bitset<Internal::kMaxNumComponents> components_need;
-            bool _is_searching_all;
+            std::array<const Internal::ComponentContainer*, kNumComponents> m_containers;
+            const Internal::ComponentContainer* m_driver;
+            uint32 m_begin;
+            uint32 m_end;
+            // Tick to stamp the visited mutable components with
+            uint32 m_tick;
+            std::array<TickFilter, kNumComponents> m_filters;
+            uint32 m_num_filters = 0;
+
+            template<typename T>
+            RegistryViewer WithFilter(uint32 since_tick, bool is_added) const
+            {
+                constexpr bool kIsViewed = (std::is_same_v<std::remove_const_t<T>, std::remove_const_t<Components>> || ...);
+                static_assert(kIsViewed, "Only viewed components can be filtered");
+
+                RegistryViewer filtered = *this;
+                if (filtered.m_num_filters < kNumComponents)
+                {
+                    const Internal::ComponentContainer* container =
+                            &registry.component_set[Internal::GetComponentType<std::remove_const_t<T>>()];
+                    filtered.m_filters[filtered.m_num_filters++] = {container, since_tick, is_added};
+                }
+                return filtered;
+            }
 
-            static bool HasRequiredComponents(Registry& reg, const std::bitset<Internal::kMaxNumComponents> &need,
-                                             EntityIndex entity_index)
+            inline bool IsQualified(uint32 driver_dense_index) const
             {
-                bool has_required_components = true;
-                for (int i = 0; i < need.size(); i++)
-                    if (need.test(i) && !reg.HasComponentByType(entity_index, i))
-                    {
-                        has_required_components = false;
-                        break;
-                    }
-                return has_required_components;
+                const EntityIndex entity_index = m_driver->GetEntities()[driver_dense_index];
+                for (const Internal::ComponentContainer* container : m_containers)
+                    if (container != m_driver && !container->IsComponentExist(entity_index))
+                        return false;
+
+                for (uint32 i = 0; i < m_num_filters; i++)
+                {
+                    const TickFilter& filter = m_filters[i];
+                    const ComponentIndex dense_index = filter.container == m_driver
+                            ? driver_dense_index : filter.container->GetDenseIndex(entity_index);
+                    const uint32 tick = filter.is_added
+                            ? filter.container->GetAddedTick(dense_index) : filter.container->GetChangedTick(dense_index);
+                    if (tick <= filter.since_tick)
+                        return false;
+                }
+                return true;
+            }
+
+            template<typename T>
+            inline T& Fetch(const Internal::ComponentContainer* container, EntityIndex entity_index,
+                            uint32 driver_dense_index) const
+            {
+                const ComponentIndex dense_index = container == m_driver
+                        ? driver_dense_index : container->GetDenseIndex(entity_index);
+                if constexpr (!std::is_const_v<T>)
+                    container->MarkChanged(dense_index, m_tick);
+                return *container->template GetDense<T>(dense_index);
+            }
+
+            template<size_t... I>
+            inline value_type Dereference(uint32 driver_dense_index, std::index_sequence<I...>) const
+            {
+                const EntityIndex entity_index = m_driver->GetEntities()[driver_dense_index];
+                return value_type(registry.entities[entity_index],
+                                  Fetch<Components>(m_containers[I], entity_index, driver_dense_index)...);
             }
         };
     }
 }
+
 #endif //SYMOCRAFT_REGISTRY_H
@@ -0,0 +1,146 @@
+//
+// Created by Amo on 2022/7/24.
+//
+
+#ifndef SYMOCRAFT_SCHEDULER_H
+#define SYMOCRAFT_SCHEDULER_H
+#include "core.h"
+#include "core/ECS/component_container.h"
+
+namespace SymoCraft
+{
+    class GlobalThreadPool;
+
+    namespace ECS
+    {
+        class Registry;
+
+        // The part of a system's view one job updates
+        struct SystemSlice
+        {
+            // First and one past the last candidate of the view
+            uint32 begin;
+            uint32 end;
+            // Change tick of the system's previous run, 0 on the first run
+            // Pass it to RegistryViewer::Changed to only visit what changed since
+            uint32 last_run_tick;
+            // Change tick of this run, pass it to RegistryViewer::StampWith so the system's own writes
+            // are not newer than the tick its next run compares with
+            uint32 run_tick;
+        };
+
+        // Parameters: registry, slice
+        typedef void (*SystemUpdateFunction)(Registry& registry, const SystemSlice& slice);
+        // return the number of candidates of the system's view
+        typedef uint32 (*SystemCountFunction)(Registry& registry);
+        typedef void (*SystemPrepareFunction)(Registry& registry);
+
+        // A system declares the components it reads and writes,
+        // systems that don't conflict run at the same time
+        // Systems must not add or remove components while they run,
+        // they record it in Registry::GetCommandBuffer() and the scheduler plays it back after the last system
+        struct System
+        {
+            const char* name = nullptr;
+            Internal::ComponentSignature reads{};
+            Internal::ComponentSignature writes{};
+            // Update a slice of the view
+            SystemUpdateFunction update = nullptr;
+            // Size of the view, nullptr runs the whole update as one job
+            SystemCountFunction count = nullptr;
+            // Runs once per frame before the slices, optional
+            SystemPrepareFunction prepare = nullptr;
+        };
+
+        struct SystemTiming
+        {
+            const char* name;
+            // Wall time from the start of the first slice to the end of the last one
+            double last_time_ms;
+            double total_time_ms;
+            uint32 num_frames;
+            uint32 last_num_slices;
+        };
+
+        /* ---------------------------------------------------------------------------------------------------
+           About scheduler:
+           Every frame, the scheduler orders the systems by their access sets:
+           a system waits for the earlier systems that write what it reads or writes,
+           and for the earlier systems that read what it writes.
+           The others run at the same time on the global thread pool.
+
+           A system with a count function is split into slices of its view,
+           every slice is a job of its own. The calling thread runs jobs too while it waits,
+           so the scheduler works with no worker threads at all.
+
+           Every system runs at a change tick of its own, the components it writes are stamped with it.
+           Its slices get the tick of its previous run, so a system can skip the entities nothing touched since.
+        */
+        class Scheduler
+        {
+        public:
+            // Add a system, systems run in the order they are added unless they don't conflict
+            // Parameters: system
+            void AddSystem(const System& system);
+
+            // Run all systems once and wait for them
+            // Parameters: registry, thread pool
+            void Run(Registry& registry, GlobalThreadPool& thread_pool);
+
+            // Log the average time of every system
+            void LogTimings() const;
+
+            inline const std::vector<SystemTiming>& GetTimings() const
+            {
+                return m_timings;
+            }
+
+            void Clear();
+
+        private:
+            // Per frame state of a system
+            struct SystemState
+            {
+                std::atomic<uint32> num_waiting_dependencies;
+                std::atomic<uint32> num_unfinished_slices;
+                // Range in m_dependents of the systems that wait for this one
+                uint32 first_dependent;
+                uint32 num_dependents;
+                std::chrono::steady_clock::time_point start_time;
+                // Change tick the system runs at
+                uint32 run_tick;
+            };
+
+            struct SliceJob
+            {
+                Scheduler* scheduler;
+                uint32 system_index;
+                SystemSlice slice;
+            };
+
+            std::vector<System> m_systems;
+            std::vector<SystemTiming> m_timings;
+            // Change tick of every system's previous run
+            std::vector<uint32> m_last_run_ticks;
+            // Per frame state, kept to reuse the memory
+            std::vector<SystemState> m_states;
+            // Every system owns m_max_slices jobs, so the jobs never move while the threads use them
+            std::vector<SliceJob> m_jobs;
+            uint32 m_max_slices = 1;
+            std::vector<uint32> m_dependents;
+            std::vector<uint32> m_roots;
+            Registry* m_registry = nullptr;
+            GlobalThreadPool* m_thread_pool = nullptr;
+            std::atomic<uint32> m_num_unfinished_systems{0};
+
+            // Split a system whose dependencies are done into slices and queue them
+            void StartSystem(uint32 system_index);
+            // Called by the last slice of a system
+            void FinishSystem(uint32 system_index);
+
+            static void RunSliceJob(void* data, size_t data_size);
+        };
+    }
+}
+
+#endif //SYMOCRAFT_SCHEDULER_H
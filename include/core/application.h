@@ -6,12 +6,15 @@
 #define SYMOCRAFT_APPLICATION_H
 
 
+#include "core.h"
+
 struct GLFWwindow;
 namespace SymoCraft
 {
     struct Window;
     //struct FrameBuffer;
     class GlobalThreadPool;
+    class SimulationClock;
     class Camera;
     namespace ECS
     {
@@ -20,8 +23,21 @@ namespace SymoCraft
 
     namespace Application
     {
+        struct LaunchOptions
+        {
+            // Run the full game loop without a window, on the null render device
+            bool headless{false};
+            // Frames to run in headless mode
+            uint32 num_frames{600};
+            // Input replay file, optional
+            std::string_view replay_path;
+            // Headless run report in json, optional
+            std::string_view report_path;
+        };
+
         // Initializing application
-        void Init();
+        // Parameters: launch options
+        void Init(const LaunchOptions& options = {});
 
         // Run application
         void Run();
@@ -35,6 +51,9 @@ namespace SymoCraft
         // Get Global Thread Pool Reference
         GlobalThreadPool& GetGlobalThreadPool();
 
+        // Get the clock of the fixed ticks, advanced once per frame before the systems run
+        SimulationClock& GetSimulationClock();
+
         // Get Camera Pointer
         Camera* GetCamera();
 
@@ -42,9 +61,11 @@ namespace SymoCraft
         ECS::Registry &GetRegistry();
 
         // Process input and some functions call back
-        void processInput(GLFWwindow* window);
+        void processInput();
         void MouseMovementCallBack(GLFWwindow* window, double x_pos_in, double y_pos_in);
         void MouseScrollCallBack(GLFWwindow* window, double x_pos_in, double y_pos_in);
+        void KeyCallBack(GLFWwindow* window, int key, int scancode, int action, int mods);
+        void MouseButtonCallBack(GLFWwindow* window, int button, int action, int mods);
 
 
         // Delta time
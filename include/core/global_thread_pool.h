@@ -66,16 +66,28 @@ namespace SymoCraft
         // Parameters: _is notifyALL?
         void BeginWork(bool _is_notify_all = true);
 
+        // Run one queued task on the calling thread, so a waiting thread can help the workers
+        // return false if there was no task
+        bool RunPendingTask();
+
+        // Number of worker threads, the calling thread not included
+        inline uint32_t NumThreads() const
+        {
+            return num_threads;
+        }
+
     private:
         // Priority queue for thread tasks
         // the lesser, the more forward
         std::priority_queue<ThreadTask, std::vector<ThreadTask>, CompareThreadTask> tasks;
         std::thread* worker_threads;    // thread pointer
-        std::condition_variable cv;     // condition_variable
-        std::mutex general_mtx;         // general mutex in thread pool
-        std::mutex queue_mtx;           // mutex for queueing task
+        std::condition_variable cv;     // condition_variable, waits on queue_mtx
+        std::mutex queue_mtx;           // mutex for queueing task and working status
         bool do_work;                   // working status of thread pool
         uint32_t num_threads;           // number of threads
+
+        // Run a task and its callback
+        static void RunTask(const ThreadTask& task);
     };
 
 }
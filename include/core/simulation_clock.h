@@ -0,0 +1,80 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#ifndef SYMOCRAFT_SIMULATION_CLOCK_H
+#define SYMOCRAFT_SIMULATION_CLOCK_H
+#include "core.h"
+
+namespace SymoCraft
+{
+    // Length of one fixed tick of the simulation, 120Hz
+    inline constexpr float kFixedTickDuration = 1.0f / 120.0f;
+
+    // More ticks than this in one frame are dropped
+    inline constexpr uint32 kDefaultMaxTicksPerFrame = 8;
+
+    /* ---------------------------------------------------------------------------------------------------
+       About simulation clock:
+       Physics and every other tick based system run a whole number of fixed ticks per frame. The clock
+       turns the frame time into that number once per frame, so all of them agree on it.
+
+       The number of ticks of a frame is capped. Without a cap, a slow frame(e.g. a big UpdateAllChunks)
+       owes many ticks, running them makes the next frame slower still and the game never catches up.
+       The ticks over the cap are dropped, the simulation runs slower than real time for that frame.
+
+       The time left over after the ticks is less than a tick. GetAlpha is that part of a tick, drawing
+       things between their positions of the last two ticks by alpha hides that ticks and frames don't line up.
+    */
+    class SimulationClock
+    {
+    public:
+        // Parameters: tick duration in seconds, maximum number of ticks per frame
+        explicit SimulationClock(float tick_duration = kFixedTickDuration,
+                                 uint32 max_ticks_per_frame = kDefaultMaxTicksPerFrame);
+
+        // Add the time of a frame, call it once per frame before the tick based systems run
+        // return the number of ticks to run this frame
+        // Parameters: frame time in seconds
+        uint32 Advance(float delta_time);
+
+        // Ticks to run in the current frame
+        inline uint32 GetFrameTicks() const
+        {
+            return m_frame_ticks;
+        }
+
+        // Ticks run since the start, not counting the current frame
+        inline uint64 GetTick() const
+        {
+            return m_tick;
+        }
+
+        // Part of a tick left over after the ticks of the current frame, in [0, 1)
+        inline float GetAlpha() const
+        {
+            return (float)(m_accumulated_time / m_tick_duration);
+        }
+
+        inline float GetTickDuration() const
+        {
+            return (float)m_tick_duration;
+        }
+
+        // Ticks dropped by the cap since the start
+        inline uint64 GetNumDroppedTicks() const
+        {
+            return m_num_dropped_ticks;
+        }
+
+    private:
+        double m_tick_duration;
+        double m_accumulated_time = 0.0;
+        uint32 m_max_ticks_per_frame;
+        uint32 m_frame_ticks = 0;
+        uint64 m_tick = 0;
+        uint64 m_num_dropped_ticks = 0;
+    };
+}
+
+#endif //SYMOCRAFT_SIMULATION_CLOCK_H
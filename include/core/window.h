@@ -24,7 +24,8 @@ namespace SymoCraft
         int width;
         int height;
         const char* title;
-        void* window_ptr;
+        void* window_ptr;       // nullptr for a headless window
+        bool close_requested{false};    // Headless windows only
 
         // GLFW function interface
         void MakeContextCurrent();
@@ -62,10 +63,17 @@ namespace SymoCraft
         // Parameters: Window title
         static Window* Create(const char* window_title);
 
+        // Create a window without a surface or GL context, for headless runs
+        // Static
+        // Parameters: Window title, width, height
+        static Window* CreateHeadless(const char* window_title, int width, int height);
+
         // Initialize glfw
         // Static
         static void Init();
 
+        bool IsHeadless() const { return window_ptr == nullptr; }
+
         // Free window
         // Static
         static void Free();
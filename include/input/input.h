@@ -12,6 +12,7 @@ namespace SymoCraft
     {
         extern bool key_pressed[GLFW_KEY_LAST];             // key pressing
         extern bool key_begin_pressed[GLFW_KEY_LAST];  // key begin pressed
+        extern bool mouse_button_pressed[GLFW_MOUSE_BUTTON_LAST + 1];  // mouse button pressing
 
         // Set Window Size
         // Parameters: new window size
@@ -31,6 +32,14 @@ namespace SymoCraft
         // Return Key Begin Pressed status
         // Parameters: key
         bool IsKeyBeginPressed( int key);
+
+        // Process Mouse Button Event
+        // Parameters: button, action
+        void ProcessMouseButtonEvent( int button, int action);
+
+        // Return Mouse Button Pressing status
+        // Parameters: button
+        bool IsMouseButtonPressed( int button);
     }
 }
 
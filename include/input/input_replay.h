@@ -0,0 +1,34 @@
+//
+// Created by Amo on 2022/7/20.
+//
+
+#ifndef SYMOCRAFT_INPUT_REPLAY_H
+#define SYMOCRAFT_INPUT_REPLAY_H
+#include "core.h"
+
+namespace SymoCraft
+{
+    // Feeds recorded input into Input frame by frame, so a run can be reproduced without a window
+    // Replay file format, one event per line, '#' starts a comment:
+    //     <frame> key <glfw key code> press|release
+    //     <frame> button <glfw mouse button> press|release
+    //     <frame> mouse <x> <y>
+    namespace InputReplay
+    {
+        // Load a replay file, the events are sorted by frame
+        // Parameters: replay file path
+        bool Load(std::string_view filepath);
+
+        // Apply all events of a frame
+        // Parameters: frame index
+        void Apply(uint32 frame);
+
+        // Are all events applied
+        bool IsFinished();
+
+        // Drop all events
+        void Clear();
+    }
+}
+
+#endif //SYMOCRAFT_INPUT_REPLAY_H
@@ -19,11 +19,10 @@ namespace SymoCraft
         class Registry;
     }
 
-    class Window;
     namespace PlayerController
     {
         static const uint16 kBlockInventor[10] = {2, 3, 4, 5, 6, 7, 10, 11};
-        void DoRayCast(ECS::Registry &registry, Window &window);
+        void DoRayCast(ECS::Registry &registry);
         void DisplayCurrentBlockName();
     }
 }
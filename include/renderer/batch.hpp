@@ -1,12 +1,13 @@
 #pragma once
 #include "core.h"
 #include "world/world.h"
+#include "renderer/render_device.h"
 
 namespace SymoCraft{
 
     // Batch Procedure:
     // I.Initialization
-    //  1. Create and bind buffers (full DSA)
+    //  1. Create buffers through the render device
     //  2. Allocate maximum batch memory to the VBO
     //  3. Configure vertex attributes
     // II.Feed 'data' with vertices
@@ -28,13 +29,6 @@ namespace SymoCraft{
         glm::ivec3 pos_coord;
     };
 
-    struct VertexAttribute{
-        uint16 attribute_slot;
-        uint16 element_amount;
-        GLenum data_type;
-        uint16 offset;
-    };
-
     struct DrawArraysIndirectCommand
     {
         uint16  count;
@@ -53,27 +47,10 @@ namespace SymoCraft{
             data = (T*)AmoMemory_Allocate(m_data_size);
             m_vertex_count = 0;
 
-            // Create buffers
-            glCreateBuffers(1, &m_vertex_data_vbo);
-//            glCreateBuffers(1, &m_draw_command_vbo);
-            glCreateVertexArrays(1, &m_vao);
-
-            // Allocate memory for the VBO, and bind the buffers
-            glNamedBufferStorage(m_vertex_data_vbo, m_data_size, nullptr, GL_DYNAMIC_STORAGE_BIT);
-//            glNamedBufferStorage(m_draw_command_vbo, World::chunk_radius * World::chunk_radius, nullptr, GL_DYNAMIC_DRAW);
-            glVertexArrayVertexBuffer(m_vao, 0, m_vertex_data_vbo, 0, sizeof(BlockVertex3D));
-
-
-            // Configure vertex attributes
-            // Draw float data solely for now
-            // Add support for other data in the future
-            for (const auto& attribute : vertex_attributes)
-            {
-                glEnableVertexArrayAttrib(m_vao, attribute.attribute_slot);
-                glVertexArrayAttribFormat(m_vao, attribute.attribute_slot, attribute.element_amount, attribute.data_type, GL_FALSE, attribute.offset);
-                glVertexArrayAttribBinding(m_vao, attribute.attribute_slot, 0);
-            }
-
+            // Create buffers, allocate memory for the VBO, and configure vertex attributes
+            RenderDevice& device = RenderDevice::Get();
+            m_vertex_data_vbo = device.CreateBuffer(m_data_size);
+            m_vao = device.CreateVertexArray(m_vertex_data_vbo, sizeof(T), vertex_attributes);
         }
 
         void AddVertex(const T& vertex)
@@ -110,7 +87,7 @@ namespace SymoCraft{
                 return;
             }
 
-            glNamedBufferSubData(m_vertex_data_vbo, m_vertex_count * sizeof(BlockVertex3D), vertex_amount * sizeof(BlockVertex3D), vertex);
+            RenderDevice::Get().UpdateBuffer(m_vertex_data_vbo, m_vertex_count * sizeof(T), vertex_amount * sizeof(T), vertex);
             m_vertex_count += vertex_amount;
         }
 
@@ -122,16 +99,14 @@ namespace SymoCraft{
 //                return;
 //            }
 
-            glBindVertexArray(m_vao);
-            glDrawArrays(m_primitive_type, 0, m_vertex_count);
-            glBindVertexArray(0);
+            RenderDevice::Get().Draw(m_vao, m_primitive_type, 0, m_vertex_count);
 
             Clear();
         }
 
         inline void ReloadData()
         {
-            glNamedBufferSubData(m_vertex_data_vbo, 0, m_data_size, data);
+            RenderDevice::Get().UpdateBuffer(m_vertex_data_vbo, 0, m_data_size, data);
         }
 
         inline void Clear()
@@ -146,6 +121,10 @@ namespace SymoCraft{
                 AmoMemory_Free(data);
                 data = nullptr;
                 m_data_size = 0;
+
+                RenderDevice& device = RenderDevice::Get();
+                device.DestroyVertexArray(m_vao);
+                device.DestroyBuffer(m_vertex_data_vbo);
             }
         }
 
@@ -0,0 +1,303 @@
+#ifndef SYMOCRAFT_RENDER_DEVICE_H
+#define SYMOCRAFT_RENDER_DEVICE_H
+
+#include "core.h"
+#include "renderer/shader.h"
+
+namespace SymoCraft
+{
+    enum class RenderBackend : uint8
+    {
+        OpenGL = 0,
+        Null,       // Records commands without a GPU, for headless runs and CPU benchmarks
+    };
+
+    enum class RenderCommand : uint8
+    {
+        SetViewport = 0,
+        Clear,
+        CreateBuffer,
+        UpdateBuffer,
+        DestroyBuffer,
+        BindUniformBuffer,
+        CreateVertexArray,
+        DestroyVertexArray,
+        Draw,
+        CreateShader,
+        DestroyShader,
+        LinkProgram,
+        DestroyProgram,
+        UseProgram,
+        SetUniform,
+        CreateTexture,
+        UploadTexture,
+        CopyTexture,
+        GenerateMipmaps,
+        BindTexture,
+        DestroyTexture,
+        Count
+    };
+
+    enum class UniformType : uint8
+    {
+        Float,
+        Int,
+        UInt,
+        Vec2,
+        Vec3,
+        Vec4,
+        IVec2,
+        IVec3,
+        IVec4,
+        Mat3,
+        Mat4,
+    };
+
+    struct VertexAttribute{
+        uint16 attribute_slot;
+        uint16 element_amount;
+        GLenum data_type;
+        uint16 offset;
+    };
+
+    struct TextureDesc
+    {
+        GLenum target;          // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+        int width;
+        int height;
+        int layers;             // 1 for a 2D texture
+        int levels;             // number of mipmap levels
+        GLenum internal_format;
+        bool pixelated;         // nearest filtering
+    };
+
+    struct ActiveUniform
+    {
+        std::string name;
+        int32 location;
+    };
+
+    // Counters of everything handed to a render device
+    struct RenderDeviceStats
+    {
+        std::array<uint64, (size_t)RenderCommand::Count> num_commands{};
+        uint64 num_vertices_drawn{};
+        uint64 bytes_uploaded{};    // buffer, uniform and texture data
+
+        inline uint64 GetCommandCount(RenderCommand command) const
+        {
+            return num_commands[(size_t)command];
+        }
+
+        uint64 GetTotalCommandCount() const;
+
+        void Reset();
+    };
+
+    // A thin interface over the graphics API, everything on the frame path talks to the GPU through it
+    // Object handles are plain uint32 names, UINT32_MAX is an invalid handle
+    class RenderDevice
+    {
+    public:
+        virtual ~RenderDevice() = default;
+
+        // Create the device of a backend, and make it the current device
+        // Static
+        // Parameters: backend
+        static void Init(RenderBackend backend);
+
+        // Free the current device
+        // Static
+        static void Free();
+
+        // Get the current device
+        // Static
+        static RenderDevice& Get();
+
+        RenderBackend GetBackend() const { return m_backend; }
+        const RenderDeviceStats& GetStats() const { return m_stats; }
+        void ResetStats() { m_stats.Reset(); }
+
+        // ----------------------------------------------------------------------
+        // Frame state
+
+        // Enable depth test and back face culling
+        virtual void InitState() = 0;
+        virtual void SetViewport(int x, int y, int width, int height) = 0;
+        // Clear the default framebuffer
+        virtual void Clear(const std::array<float, 4>& color, float depth) = 0;
+
+        // ----------------------------------------------------------------------
+        // Buffers and vertex arrays
+
+        // Create a buffer with a fixed size that can be updated
+        virtual uint32 CreateBuffer(size_t size) = 0;
+        virtual void UpdateBuffer(uint32 buffer, size_t offset, size_t size, const void* data) = 0;
+        virtual void DestroyBuffer(uint32 buffer) = 0;
+        // Bind a buffer to a uniform block binding point, shared by every program
+        virtual void BindUniformBuffer(uint32 binding, uint32 buffer) = 0;
+
+        // Create a vertex array reading interleaved vertices from one buffer
+        // Parameters: vertex buffer, vertex size in bytes, vertex attributes
+        virtual uint32 CreateVertexArray(uint32 vertex_buffer, uint32 stride,
+                                         std::initializer_list<VertexAttribute> attributes) = 0;
+        virtual void DestroyVertexArray(uint32 vertex_array) = 0;
+        virtual void Draw(uint32 vertex_array, GLenum primitive_type, uint32 first_vertex, uint32 vertex_count) = 0;
+
+        // ----------------------------------------------------------------------
+        // Shaders
+
+        // Return UINT32_MAX and fill the info log if the compilation failed
+        virtual uint32 CreateShader(ShaderType type, std::string_view source, std::string& info_log) = 0;
+        virtual void DestroyShader(uint32 shader) = 0;
+        // Return UINT32_MAX and fill the info log if the linking failed
+        virtual uint32 LinkProgram(uint32 vertex_shader, uint32 fragment_shader, std::string& info_log) = 0;
+        virtual std::vector<ActiveUniform> GetActiveUniforms(uint32 program) = 0;
+        virtual void DestroyProgram(uint32 program) = 0;
+        virtual void UseProgram(uint32 program) = 0;
+        // Upload a uniform of the program in use
+        // Parameters: location, type, pointer to the values, number of array elements
+        virtual void SetUniform(int32 location, UniformType type, const void* data, int32 count = 1) = 0;
+
+        // ----------------------------------------------------------------------
+        // Textures
+
+        // Create a texture with immutable storage, wrapping set to repeat
+        virtual uint32 CreateTexture(const TextureDesc& desc) = 0;
+        // Parameters: texture, mipmap level, offset(z is the layer), size(z is the layer count)
+        //             , pixel format, pixel data type, pixels
+        virtual void UploadTexture(uint32 texture, int level, const glm::ivec3& offset, const glm::ivec3& size,
+                                   GLenum format, GLenum data_type, const void* pixels) = 0;
+        // Copy a region of mipmap level 0 between textures
+        virtual void CopyTexture(uint32 src_texture, GLenum src_target, const glm::ivec3& src_offset,
+                                 uint32 dst_texture, GLenum dst_target, const glm::ivec3& dst_offset,
+                                 const glm::ivec3& size) = 0;
+        virtual void GenerateMipmaps(uint32 texture) = 0;
+        virtual void BindTexture(uint32 unit, uint32 texture) = 0;
+        virtual void DestroyTexture(uint32 texture) = 0;
+
+    protected:
+        explicit RenderDevice(RenderBackend backend) : m_backend(backend) {}
+
+        inline void Record(RenderCommand command, uint64 bytes = 0)
+        {
+            m_stats.num_commands[(size_t)command]++;
+            m_stats.bytes_uploaded += bytes;
+        }
+
+        RenderDeviceStats m_stats;
+
+    private:
+        RenderBackend m_backend;
+    };
+
+    // Get the size of a uniform type in bytes
+    size_t GetUniformTypeSize(UniformType type);
+
+    // Get the size of one pixel in bytes
+    // Parameters: pixel format, pixel data type
+    size_t GetPixelSize(GLenum format, GLenum data_type);
+
+    class OpenGLRenderDevice : public RenderDevice
+    {
+    public:
+        OpenGLRenderDevice() : RenderDevice(RenderBackend::OpenGL) {}
+
+        void InitState() override;
+        void SetViewport(int x, int y, int width, int height) override;
+        void Clear(const std::array<float, 4>& color, float depth) override;
+
+        uint32 CreateBuffer(size_t size) override;
+        void UpdateBuffer(uint32 buffer, size_t offset, size_t size, const void* data) override;
+        void DestroyBuffer(uint32 buffer) override;
+        void BindUniformBuffer(uint32 binding, uint32 buffer) override;
+
+        uint32 CreateVertexArray(uint32 vertex_buffer, uint32 stride,
+                                 std::initializer_list<VertexAttribute> attributes) override;
+        void DestroyVertexArray(uint32 vertex_array) override;
+        void Draw(uint32 vertex_array, GLenum primitive_type, uint32 first_vertex, uint32 vertex_count) override;
+
+        uint32 CreateShader(ShaderType type, std::string_view source, std::string& info_log) override;
+        void DestroyShader(uint32 shader) override;
+        uint32 LinkProgram(uint32 vertex_shader, uint32 fragment_shader, std::string& info_log) override;
+        std::vector<ActiveUniform> GetActiveUniforms(uint32 program) override;
+        void DestroyProgram(uint32 program) override;
+        void UseProgram(uint32 program) override;
+        void SetUniform(int32 location, UniformType type, const void* data, int32 count) override;
+
+        uint32 CreateTexture(const TextureDesc& desc) override;
+        void UploadTexture(uint32 texture, int level, const glm::ivec3& offset, const glm::ivec3& size,
+                           GLenum format, GLenum data_type, const void* pixels) override;
+        void CopyTexture(uint32 src_texture, GLenum src_target, const glm::ivec3& src_offset,
+                         uint32 dst_texture, GLenum dst_target, const glm::ivec3& dst_offset,
+                         const glm::ivec3& size) override;
+        void GenerateMipmaps(uint32 texture) override;
+        void BindTexture(uint32 unit, uint32 texture) override;
+        void DestroyTexture(uint32 texture) override;
+
+    private:
+        robin_hood::unordered_flat_map<uint32, GLenum> m_texture_targets;
+    };
+
+    // Accepts every command without a GPU
+    // Keeps a log of the commands of the current frame and the bytes they carry
+    class NullRenderDevice : public RenderDevice
+    {
+    public:
+        struct RecordedCommand
+        {
+            RenderCommand command;
+            uint32 handle;
+            uint64 bytes;
+        };
+
+        NullRenderDevice() : RenderDevice(RenderBackend::Null) {}
+
+        // Drop the command log, usually at the beginning of a frame
+        void ClearCommandLog() { m_command_log.clear(); }
+        const std::vector<RecordedCommand>& GetCommandLog() const { return m_command_log; }
+
+        void InitState() override;
+        void SetViewport(int x, int y, int width, int height) override;
+        void Clear(const std::array<float, 4>& color, float depth) override;
+
+        uint32 CreateBuffer(size_t size) override;
+        void UpdateBuffer(uint32 buffer, size_t offset, size_t size, const void* data) override;
+        void DestroyBuffer(uint32 buffer) override;
+        void BindUniformBuffer(uint32 binding, uint32 buffer) override;
+
+        uint32 CreateVertexArray(uint32 vertex_buffer, uint32 stride,
+                                 std::initializer_list<VertexAttribute> attributes) override;
+        void DestroyVertexArray(uint32 vertex_array) override;
+        void Draw(uint32 vertex_array, GLenum primitive_type, uint32 first_vertex, uint32 vertex_count) override;
+
+        uint32 CreateShader(ShaderType type, std::string_view source, std::string& info_log) override;
+        void DestroyShader(uint32 shader) override;
+        uint32 LinkProgram(uint32 vertex_shader, uint32 fragment_shader, std::string& info_log) override;
+        std::vector<ActiveUniform> GetActiveUniforms(uint32 program) override;
+        void DestroyProgram(uint32 program) override;
+        void UseProgram(uint32 program) override;
+        void SetUniform(int32 location, UniformType type, const void* data, int32 count) override;
+
+        uint32 CreateTexture(const TextureDesc& desc) override;
+        void UploadTexture(uint32 texture, int level, const glm::ivec3& offset, const glm::ivec3& size,
+                           GLenum format, GLenum data_type, const void* pixels) override;
+        void CopyTexture(uint32 src_texture, GLenum src_target, const glm::ivec3& src_offset,
+                         uint32 dst_texture, GLenum dst_target, const glm::ivec3& dst_offset,
+                         const glm::ivec3& size) override;
+        void GenerateMipmaps(uint32 texture) override;
+        void BindTexture(uint32 unit, uint32 texture) override;
+        void DestroyTexture(uint32 texture) override;
+
+    private:
+        void Log(RenderCommand command, uint32 handle = UINT32_MAX, uint64 bytes = 0);
+
+        uint32 m_next_handle{1};
+        std::vector<RecordedCommand> m_command_log;
+        // Sources of the live shaders, the uniforms of a program are parsed from them on link
+        robin_hood::unordered_node_map<uint32, std::string> m_shader_sources;
+        robin_hood::unordered_node_map<uint32, std::vector<ActiveUniform>> m_program_uniforms;
+    };
+}
+
+#endif //SYMOCRAFT_RENDER_DEVICE_H
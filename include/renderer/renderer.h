@@ -13,6 +13,20 @@ namespace SymoCraft{
 
     namespace Renderer
     {
+        // Per-frame constants in one uniform buffer shared by every program
+        // Mirrors the FrameConstants block of the shaders, std140 layout
+        struct FrameConstants
+        {
+            glm::mat4 combo_mat;    // combo_mat = projection_mat * view_mat
+            glm::vec4 camera_pos;   // w is unused
+            float time;             // seconds since the start
+            float padding[3];
+        };
+
+        static_assert(sizeof(FrameConstants) % 16 == 0, "std140 blocks are padded to 16 bytes");
+
+        constexpr uint32 kFrameConstantsBinding = 0;
+
         void Init();
         void Free();
         void Render();
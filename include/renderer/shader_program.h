@@ -3,11 +3,72 @@
 
 #include "core.h"
 #include "renderer/shader.h"
+#include "renderer/render_device.h"
+
+// FNV-1a hash of a uniform name, evaluated at compile time for literals
+constexpr uint32 HashUniformName(std::string_view name)
+{
+	uint32 hash = 2166136261u;
+	for (char c : name)
+	{
+		hash ^= (uint8)c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Map a uniform value type to its render device type
+template<typename T>
+constexpr SymoCraft::UniformType GetUniformType()
+{
+	using SymoCraft::UniformType;
+	if constexpr (std::is_same_v<T, float>)			 return UniformType::Float;
+	else if constexpr (std::is_same_v<T, int>)		 return UniformType::Int;
+	else if constexpr (std::is_same_v<T, uint32>)	 return UniformType::UInt;
+	else if constexpr (std::is_same_v<T, glm::vec2>)	 return UniformType::Vec2;
+	else if constexpr (std::is_same_v<T, glm::vec3>)	 return UniformType::Vec3;
+	else if constexpr (std::is_same_v<T, glm::vec4>)	 return UniformType::Vec4;
+	else if constexpr (std::is_same_v<T, glm::ivec2>) return UniformType::IVec2;
+	else if constexpr (std::is_same_v<T, glm::ivec3>) return UniformType::IVec3;
+	else if constexpr (std::is_same_v<T, glm::ivec4>) return UniformType::IVec4;
+	else if constexpr (std::is_same_v<T, glm::mat3>)	 return UniformType::Mat3;
+	else
+	{
+		static_assert(std::is_same_v<T, glm::mat4>, "Unsupported uniform type");
+		return UniformType::Mat4;
+	}
+}
+
+// A uniform location resolved once after linking, uploading through it needs no lookup
+template<typename T>
+struct UniformHandle
+{
+	int32 location{-1};
+
+	inline bool IsValid() const { return location >= 0; }
+};
 
 struct ShaderProgram
 {
 	uint32 programId;
 
+	// Resolve a uniform of this program, the handle is invalid if the uniform is not active
+	// Parameters: hashed uniform name
+	template<typename T>
+	UniformHandle<T> GetUniformHandle(uint32 name_hash) const
+	{
+		return {getUniformLocation(name_hash)};
+	}
+
+	// Upload a uniform of this program, the program has to be bound
+	// Parameters: uniform handle, value
+	template<typename T>
+	void Upload(UniformHandle<T> handle, const T& value) const
+	{
+		if (handle.IsValid())
+			SymoCraft::RenderDevice::Get().SetUniform(handle.location, GetUniformType<T>(), &value);
+	}
+
 	bool CompileAndLink(std::string_view vertexShaderFile, std::string_view fragmentShaderFile);
 	void Bind() const;
 	void Unbind() const;
@@ -29,6 +90,9 @@ struct ShaderProgram
 	void UploadMat3(const char* varName, const glm::mat3& mat3) const;
 
 	static void clearAllShaderVariables();
+
+private:
+	int32 getUniformLocation(uint32 name_hash) const;
 };
 
 #endif
\ No newline at end of file
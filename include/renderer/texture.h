@@ -24,6 +24,11 @@ class TextureArray : public Texture
 public:
     TextureArray CreateAtlasSlice(std::string_view filepath, bool pixelated);
 
+    // Load an atlas through its texture array cache as RGBA8 with mipmaps
+    // The cache is cooked first if it's missing or older than the atlas
+    // Parameters: atlas file path, cache file path, pixelated
+    TextureArray CreateFromCache(std::string_view atlas_filepath, std::string_view cache_filepath, bool pixelated);
+
     uint16 layer_amount{};
 };
 
@@ -0,0 +1,74 @@
+//
+// Created by Amo on 2022/7/21.
+//
+
+#ifndef SYMOCRAFT_TEXTURE_CACHE_H
+#define SYMOCRAFT_TEXTURE_CACHE_H
+#include "core.h"
+
+namespace SymoCraft
+{
+    // A texture array cooked from an atlas, stored as 8-bit RGBA with a full mip chain
+    // File layout:
+    //   TextureCacheHeader
+    //   level 0 of every layer, level 1 of every layer, ... tightly packed, rows from the bottom up
+    namespace TextureCache
+    {
+        constexpr std::array<char, 4> kMagic = {'S', 'T', 'A', 'C'};
+        constexpr uint32 kVersion = 1;
+
+        struct TextureCacheHeader
+        {
+            std::array<char, 4> magic;
+            uint32 version;
+            uint32 tile_width;
+            uint32 tile_height;
+            uint32 layer_count;
+            uint32 level_count;
+            // The atlas the cache was cooked from, a cache of another atlas is outdated
+            uint64 source_size;
+            int64 source_write_time;
+        };
+
+        // A read-only mapping of a cache file
+        struct MappedTextureCache
+        {
+            const TextureCacheHeader* header{nullptr};
+            const uint8* pixels{nullptr};   // Right after the header
+            size_t file_size{0};
+            void* file_handle{nullptr};     // Platform handles
+            void* mapping_handle{nullptr};
+        };
+
+        // Slice an atlas into tiles, build the mip chains on the CPU and write the cache file
+        // Parameters: atlas file path, cache file path, tile width, tile height
+        bool Cook(std::string_view atlas_filepath, std::string_view cache_filepath,
+                  uint32 tile_width, uint32 tile_height);
+
+        // Is the cache present, valid, and cooked from the current atlas with this tile size
+        // Parameters: atlas file path, cache file path, tile width, tile height
+        bool IsUpToDate(std::string_view atlas_filepath, std::string_view cache_filepath,
+                        uint32 tile_width, uint32 tile_height);
+
+        // Map a cache file into memory, the header is validated
+        // Parameters: cache file path, mapped cache
+        bool Map(std::string_view cache_filepath, MappedTextureCache& cache);
+
+        // Parameters: mapped cache
+        void Unmap(MappedTextureCache& cache);
+
+        // Size in texels of a mipmap level
+        // Parameters: header, level
+        glm::ivec2 GetLevelSize(const TextureCacheHeader& header, uint32 level);
+
+        // Offset in bytes of a mipmap level from the first pixel
+        // Parameters: header, level
+        size_t GetLevelOffset(const TextureCacheHeader& header, uint32 level);
+
+        // Halve an RGBA8 image with a 2x2 box filter, rounding to nearest
+        // Parameters: source pixels, source width, source height, destination pixels
+        void DownsampleBox(const uint8* src, int src_width, int src_height, uint8* dst);
+    }
+}
+
+#endif //SYMOCRAFT_TEXTURE_CACHE_H
@@ -19,6 +19,8 @@ namespace SymoCraft
     uint16 get_block_id(std::string_view block_name);
     const BlockFormat& get_block(int block_id);
     const BlockFormat& get_block(std::string_view name);
+    // Solid flag of a block id, read from a dense bitset instead of the format map
+    bool is_block_solid(uint16 block_id);
 
     class Block {
     public:
@@ -29,6 +31,7 @@ namespace SymoCraft
         // Bit 1 IsTransparent
         // Bit 2 IsBlendable
         // Bit 3 IsLightSource
+        // Bit 4-6 FluidLevel
         uint16 bitwise_compressed_data;
 
         inline bool operator==(const Block& b) const
@@ -56,6 +59,12 @@ namespace SymoCraft
             return (bitwise_compressed_data & (1 << 2));
         }
 
+        // 0 for a fluid source, 1 to 7 for flowing fluid, see Fluid
+        inline uint8 GetFluidLevel() const
+        {
+            return (bitwise_compressed_data >> 3) & 0x7;
+        }
+
         inline bool IsLightPassable() const
         {
             return IsLightSource() || IsTransparent();
@@ -85,6 +94,14 @@ namespace SymoCraft
             bitwise_compressed_data |= is_lightSource ? (1 << 2) : 0;
         }
 
+        inline void SetFluidLevel(uint8 level)
+        {
+            // Clear the bits
+            bitwise_compressed_data &= ~(0x7 << 3);
+            // Set the level
+            bitwise_compressed_data |= (level & 0x7) << 3;
+        }
+
         inline void SetLightColor(const glm::ivec3& color)
         {
             // Convert from number between 0-255 to number between 0-7
@@ -0,0 +1,81 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#ifndef SYMOCRAFT_BLOCK_TICK_H
+#define SYMOCRAFT_BLOCK_TICK_H
+#include "core.h"
+
+namespace SymoCraft
+{
+    class SimulationClock;
+
+    /* ---------------------------------------------------------------------------------------------------
+       About block ticks:
+       Blocks change over time in two ways.
+
+       Scheduled ticks run a block at a given tick, e.g. sand falls a block every kSandFallDelay ticks.
+       They wait in a priority queue sorted by tick and then by position, so ticks due together always
+       run in the same order. A position is queued once, scheduling it again keeps the earlier tick.
+
+       Random ticks pick kRandomTicksPerSection random blocks of every section 20 times a second and
+       tick the ones with a random tick, e.g. grass spreads to dirt and leaves without a log nearby decay.
+       Only sections with a tickable block are visited. Chunks count the tickable blocks of each section,
+       the list of sections with a nonzero count is rebuilt when a count becomes or stops being zero,
+       so the cost follows the tickable blocks and not the size of the world.
+    */
+    namespace BlockTick
+    {
+        // Random ticks run once every this many ticks, 20 times a second at 120Hz
+        inline constexpr uint32 kTicksPerRandomTick = 6;
+
+        // Blocks picked in every section per random tick
+        inline constexpr uint32 kRandomTicksPerSection = 3;
+
+        // Ticks sand waits before falling a block
+        inline constexpr uint32 kSandFallDelay = 2;
+
+        struct TickStats
+        {
+            uint32 num_scheduled_ticks;
+            // Random blocks picked, and how many of them had a random tick
+            uint32 num_random_picks;
+            uint32 num_random_ticks;
+            uint32 num_tickable_sections;
+        };
+
+        // Whether a block id has a random tick, chunks count these per section
+        bool HasRandomTick(uint16 block_id);
+
+        // A section got its first or lost its last tickable block, or chunks were created or freed
+        void OnTickableSectionsChanged();
+
+        // Tick a block after a delay
+        // Parameters: block position, delay in ticks
+        void ScheduleTick(const glm::ivec3& position, uint32 delay);
+
+        // Whether a block id reacts to its neighbors changing, see NeighborUpdate
+        bool HasNeighborUpdate(uint16 block_id);
+
+        // Update a block, it or a block next to it was set or removed
+        // Sand schedules its fall, grass under an opaque block turns into dirt
+        // Parameters: block position, its block id, block id of the block above it
+        void OnNeighborChanged(const glm::ivec3& block_position, uint16 block_id, uint16 above_block_id);
+
+        // Run the ticks of the current frame
+        // Parameters: simulation clock, advanced for this frame
+        void Update(const SimulationClock& clock);
+
+        // Run a single tick
+        // Parameters: tick number, increasing from tick to tick
+        TickStats Tick(uint64 tick);
+
+        // Scheduled ticks waiting to run
+        uint32 GetNumScheduledTicks();
+
+        // Forget the scheduled ticks, call it when the chunks are freed
+        void Clear();
+    }
+}
+
+#endif //SYMOCRAFT_BLOCK_TICK_H
@@ -16,6 +16,40 @@ namespace SymoCraft {
         Updated,
     };
 
+    // Face directions in the order the mesher checks neighbor blocks,
+    // each direction owns one contiguous bucket of a chunk mesh
+    enum class FaceDirection : uint8
+    {
+        Front = 0,  // +x
+        Right,      // +z
+        Back,       // -x
+        Left,       // -z
+        Top,        // +y
+        Bottom,     // -y
+        Count
+    };
+
+    inline constexpr uint8 k_all_faces_mask = (1 << (uint8)FaceDirection::Count) - 1;
+
+    // Get the face buckets that may be seen from the camera
+    // A face bucket whose normal points away from the camera for the whole mesh bounding box is skipped,
+    // e.g. no west facing(-x) quad can be seen when the camera is east of the box
+    // Return a bit mask, bit i is set if FaceDirection i is visible
+    // Parameters: camera position, minimum corner of the mesh bounding box, maximum corner of the mesh bounding box
+    inline uint8 GetVisibleFaceMask(const glm::vec3& camera_pos, const glm::vec3& aabb_min, const glm::vec3& aabb_max)
+    {
+        uint8 mask = 0;
+        // A face facing +x lies on a plane no smaller than aabb_min.x + 1, so it can only be seen
+        // from a camera with a greater x coordinate. We use aabb_min to stay conservative.
+        mask |= camera_pos.x > aabb_min.x ? (1 << (uint8)FaceDirection::Front) : 0;
+        mask |= camera_pos.z > aabb_min.z ? (1 << (uint8)FaceDirection::Right) : 0;
+        mask |= camera_pos.x < aabb_max.x ? (1 << (uint8)FaceDirection::Back) : 0;
+        mask |= camera_pos.z < aabb_max.z ? (1 << (uint8)FaceDirection::Left) : 0;
+        mask |= camera_pos.y > aabb_min.y ? (1 << (uint8)FaceDirection::Top) : 0;
+        mask |= camera_pos.y < aabb_max.y ? (1 << (uint8)FaceDirection::Bottom) : 0;
+        return mask;
+    }
+
     struct NoiseGenerator
     {
         FastNoiseLite noise;
@@ -38,6 +72,12 @@ namespace SymoCraft {
         Block* m_local_blocks;
         BlockVertex3D* m_vertex_data;
         uint16 m_vertex_count;
+        // m_vertex_data is sorted by FaceDirection, one bucket for each direction
+        std::array<uint16, (size_t)FaceDirection::Count> m_face_vertex_offsets;
+        std::array<uint16, (size_t)FaceDirection::Count> m_face_vertex_counts;
+        // Bounding box of the mesh in world coordinates
+        glm::ivec3 m_mesh_min;
+        glm::ivec3 m_mesh_max;
         glm::ivec2 m_chunk_coord;
         DrawArraysIndirectCommand m_draw_command;
         uint16 m_draw_command_index;
@@ -49,6 +89,10 @@ namespace SymoCraft {
         Chunk* right_neighbor;
 
         bool m_is_fringe_chunk{false};
+        // Level of detail of the mesh, the blocks are downsampled by 2^m_lod_level before meshing
+        uint8 m_lod_level{0};
+        // Blocks with a random tick in every section, kept by SetLocalBlock and RemoveLocalBlock
+        std::array<uint16, k_num_sections> m_tickable_counts{};
 
 
         inline bool operator==(const Chunk &other) const {
@@ -78,20 +122,39 @@ namespace SymoCraft {
         bool SetWorldBlock(const glm::vec3 &world_coord, uint16 block_id);
         bool RemoveWorldBlock(const glm::vec3 &world_coord);
 
+        // Block at local coordinates of this chunk, without the bounds checks and neighbor lookups of GetLocalBlock
+        // Parameters: x in [0, 16), y in [0, 256), z in [0, 16)
+        inline const Block& GetLocalBlockInChunk(int x, int y, int z) const
+        {
+            return m_local_blocks[GetLocalBlockIndex(x, y, z)];
+        }
+
+        inline Block& GetLocalBlockInChunk(int x, int y, int z)
+        {
+            return m_local_blocks[GetLocalBlockIndex(x, y, z)];
+        }
+
         float GetNoise(int x, int z);
 
         void GenerateTerrain();
         void GenerateVegetation();
         void GenerateRenderData();
+        // Downsample the blocks of the chunk, each cell of out_blocks represents scale^3 blocks
+        // Parameters: cell size in blocks, output cells indexed by (y * size_x + x) * size_z + z
+        void GenerateLodBlocks(int scale, std::vector<Block>& out_blocks) const;
         void Free() const;
         void UpdateChunkLocalBlocks(const glm::vec3& block_world_coord);
+        // Count the blocks with a random tick of every section from scratch, after writing the blocks directly
+        void CountTickableBlocks();
 
     private:
         Block GetLocalBlock(int x, int y, int z);
         bool SetLocalBlock(int x, int y, int z, uint16 block_id);
         bool RemoveLocalBlock(int x, int y, int z);
+        // Keep the tickable count of the section of y when a block changes
+        void UpdateTickableCount(int y, uint16 old_block_id, uint16 new_block_id);
 
-        inline int GetLocalBlockIndex(int x, int y ,int z)
+        inline int GetLocalBlockIndex(int x, int y ,int z) const
         {
             return x * k_chunk_length + y * k_chunk_height + z;
         }
@@ -16,6 +16,9 @@ namespace SymoCraft{
     static constexpr uint16 k_chunk_length = 16;
     static constexpr uint16 k_chunk_width = 16;
     static constexpr uint16 k_chunk_height = 256;
+    // Chunks are cut into sections of 16 * 16 * 16 for random block ticks
+    static constexpr uint16 k_section_height = 16;
+    static constexpr uint16 k_num_sections = k_chunk_height / k_section_height;
 
     static constexpr int max_biome_height = 145;
     static constexpr int min_biome_height = 55;
@@ -35,8 +38,14 @@ namespace SymoCraft{
         void RearrangeChunkNeighborPointers();
 
         void CreateChunk(const glm::ivec2& chunk_coord);
+        // Pick the level of detail of every chunk by its distance to the camera,
+        // chunks whose level changed are remeshed by the next UpdateAllChunks
+        // Parameters: camera position
+        void UpdateLodLevels(const glm::vec3& camera_pos);
         void UpdateAllChunks();
-        void LoadAllChunks();
+        // Build the draw list of this frame
+        // Parameters: camera position, used to skip face buckets facing away from the camera
+        void LoadAllChunks(const glm::vec3& camera_pos);
         void FreeAllChunks();
     }
 }
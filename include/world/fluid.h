@@ -0,0 +1,70 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#ifndef SYMOCRAFT_FLUID_H
+#define SYMOCRAFT_FLUID_H
+#include "core.h"
+
+namespace SymoCraft
+{
+    class SimulationClock;
+
+    /* ---------------------------------------------------------------------------------------------------
+       About fluid:
+       Water is a cellular automaton over the water blocks. The flow level of a block is kept in spare bits
+       of Block, level 0 is a source, flowing water thins out by one level per block up to kMaxFluidLevel.
+       A water block falls into the air under it, and only spreads to the sides when it rests on a solid block.
+       Flowing water has to be fed by water above it or by a neighbor with a lower level, or it dries up.
+
+       Only active cells are updated. A cell is activated when it or one of its neighbors changed, and is
+       updated kTicksPerFlow ticks later. At most kDefaultCellsPerTick cells are updated in one tick,
+       the rest wait for the next tick, so a breached lake costs the same every tick until it settles.
+       Chunks changed by a tick are marked for remeshing once, at the end of the tick.
+    */
+    namespace Fluid
+    {
+        // Block id of water, the same as the terrain generator
+        inline constexpr uint16 kWaterBlockId = 9;
+
+        // Flowing water thins out by one level per block, and does not flow on from this level
+        inline constexpr uint8 kMaxFluidLevel = 7;
+
+        // Ticks from a change to the update of the cells next to it, 5 flows per second at 120Hz
+        inline constexpr uint32 kTicksPerFlow = 24;
+
+        // Cells updated in one tick at most
+        inline constexpr uint32 kDefaultCellsPerTick = 1024;
+
+        struct TickStats
+        {
+            uint32 num_updated_cells;
+            // Blocks that became water, changed level or dried up
+            uint32 num_changed_cells;
+            uint32 num_remeshed_chunks;
+        };
+
+        // Activate a water block, it or a block next to it was set or removed
+        // Parameters: water block position
+        void OnNeighborChanged(const glm::ivec3& block_position);
+
+        // Run the ticks of the current frame
+        // Parameters: simulation clock, advanced for this frame
+        void Update(const SimulationClock& clock);
+
+        // Run a single tick
+        // Parameters: tick number, increasing from tick to tick
+        TickStats Tick(uint64 tick);
+
+        // Parameters: cells updated in one tick at most
+        void SetCellsPerTick(uint32 max_cells);
+
+        // Cells waiting for an update
+        uint32 GetNumActiveCells();
+
+        // Forget the active cells, call it when the chunks are freed
+        void Clear();
+    }
+}
+
+#endif //SYMOCRAFT_FLUID_H
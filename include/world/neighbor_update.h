@@ -0,0 +1,62 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#ifndef SYMOCRAFT_NEIGHBOR_UPDATE_H
+#define SYMOCRAFT_NEIGHBOR_UPDATE_H
+#include "core.h"
+
+namespace SymoCraft
+{
+    class SimulationClock;
+
+    /* ---------------------------------------------------------------------------------------------------
+       About neighbor updates:
+       A block set or removed through the chunk manager queues a notification that its position changed.
+       Once a tick the queue is processed, the changed block and its 6 neighbors are updated: water is
+       activated, sand schedules its fall, grass covered by an opaque block turns into dirt.
+
+       Notifications are processed in batches. A batch is sorted by chunk, so the blocks of a chunk are
+       read together and the chunk map is only searched when the chunk changes. Blocks changed by the
+       updates of a batch go to the next batch, one cascade level deeper. A tick processes at most
+       kMaxCascadeDepth batches, a deeper cascade goes on in the next tick.
+
+       A position waits in the queue once however often it changes before it is processed, and a block
+       is updated once per batch however many of its neighbors changed, both through hash sets of the
+       block keys. A collapsing sand pillar or a breached lake costs at most 7 updates per changed block.
+    */
+    namespace NeighborUpdate
+    {
+        // Batches processed in one tick at most, the rest of a cascade waits for the next tick
+        inline constexpr uint32 kMaxCascadeDepth = 16;
+
+        struct TickStats
+        {
+            // Changed positions processed, and blocks updated for them
+            uint32 num_notifications;
+            uint32 num_updates;
+            uint32 num_batches;
+            // Runs of a batch in the same chunk
+            uint32 num_chunk_groups;
+        };
+
+        // Queue the neighbor updates of a block that was set or removed
+        // Parameters: block position
+        void Notify(const glm::ivec3& block_position);
+
+        // Process the queue once for every tick of the current frame
+        // Parameters: simulation clock, advanced for this frame
+        void Update(const SimulationClock& clock);
+
+        // Process the queue, up to kMaxCascadeDepth batches
+        TickStats Tick();
+
+        // Changed positions waiting to be processed
+        uint32 GetNumQueued();
+
+        // Forget the queued notifications, call it when the chunks are freed
+        void Clear();
+    }
+}
+
+#endif //SYMOCRAFT_NEIGHBOR_UPDATE_H
@@ -15,6 +15,35 @@ namespace SymoCraft
         void Init();
         inline constexpr uint16 chunk_radius = 10;
         inline constexpr uint16 max_vertices_per_chunk = UINT16_MAX;
+
+        // Level of detail rings
+        // Chunks within lod_distances[i] chunks(Chebyshev distance) of the camera are meshed at level i,
+        // level 0 is full detail, level n downsamples the blocks by 2^n
+        inline constexpr std::array<uint16, 3> lod_distances = {3, 5, 7};
+        inline constexpr uint8 max_lod_level = (uint8)lod_distances.size();
+        // Skirts hanging under the border of a mesh are at least this deep
+        inline constexpr int lod_min_skirt_depth = 16;
+
+        // Get the level of detail of a chunk
+        // Parameters: chunk coordinate, coordinate of the chunk the camera is in
+        inline uint8 GetLodLevel(const glm::ivec2& chunk_coord, const glm::ivec2& camera_chunk_coord)
+        {
+            glm::ivec2 distance = glm::abs(chunk_coord - camera_chunk_coord);
+            int ring = std::max(distance.x, distance.y);
+            for (uint8 level = 0; level < max_lod_level; level++)
+                if (ring <= lod_distances[level])
+                    return level;
+            return max_lod_level;
+        }
+
+        // Pack a block position into a key, for hash sets and for sorting blocks by x, then z, then y
+        // x and z keep their low 28 bits and y its low 8 bits
+        inline uint64 GetBlockKey(const glm::ivec3& position)
+        {
+            return ((uint64)((uint32)position.x & 0xFFFFFFF) << 36) | ((uint64)((uint32)position.z & 0xFFFFFFF) << 8)
+                   | (uint64)(position.y & 0xFF);
+        }
+
         glm::ivec2 ToChunkCoords(const glm::vec3& worldCoordinates);
         void CreatePlayer();
 
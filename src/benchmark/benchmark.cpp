@@ -0,0 +1,123 @@
+//
+// Created by Amo on 2022/7/20.
+//
+
+#include "benchmark/benchmark.h"
+#include "core.h"
+
+namespace SymoCraft::Benchmark
+{
+    struct BenchmarkEntry
+    {
+        const char* name;
+        BenchmarkFunction func;
+    };
+
+    static const BenchmarkEntry kBenchmarks[] = {
+            {"lod", LodRings},
+            {"fluid_breach", FluidBreach},
+            {"block_ticks", BlockTicks},
+            {"neighbor_updates", NeighborUpdates},
+            {"uniforms", UniformLookup},
+            {"texture_cache", TextureCacheLoad},
+            {"ecs_get", EcsGetComponent},
+            {"ecs_view", EcsView},
+            {"ecs_archetype", EcsArchetype},
+            {"ecs_scheduler", EcsScheduler},
+            {"ecs_commands", EcsCommandBuffers},
+            {"ecs_changed", EcsChangeTracking},
+            {"ecs_snapshot", EcsSnapshot},
+            {"ecs_prefab", EcsPrefab},
+            {"ecs_stress_churn", EcsStressChurn},
+            {"ecs_stress_add_remove", EcsStressAddRemove},
+            {"ecs_stress_get", EcsStressRandomGet},
+            {"ecs_stress_view", EcsStressView},
+            {"physics_contacts", PhysicsContacts},
+            {"physics_falling", PhysicsFalling},
+            {"physics_sleeping", PhysicsSleeping},
+            {"physics_determinism", PhysicsDeterminism},
+            {"physics_raycast", PhysicsRaycast},
+            {"physics_entity_queries", PhysicsEntityQueries},
+            {"simulation_clock", SimulationClockTicks},
+    };
+
+    void Report::Add(std::string_view name, double value, std::string_view unit)
+    {
+        m_measurements.push_back({std::string(name), value, std::string(unit)});
+    }
+
+    void Report::Fail()
+    {
+        m_num_failed_checks++;
+    }
+
+    void Report::Print() const
+    {
+        for (const Measurement &measurement : m_measurements)
+            AmoLogger_Info("%-48s %14.3f %s", measurement.name.c_str(), measurement.value, measurement.unit.c_str());
+    }
+
+    bool Report::WriteJson(std::string_view file_path, std::string_view benchmark_name) const
+    {
+        FILE* file = fopen(std::string(file_path).c_str(), "w");
+        if (!file)
+        {
+            AmoLogger_Error("Could not open file path '%s' to write benchmark results.", std::string(file_path).c_str());
+            return false;
+        }
+
+        fprintf(file, "{\n  \"benchmark\": \"%s\",\n  \"failed_checks\": %u,\n  \"results\": [\n",
+                std::string(benchmark_name).c_str(), m_num_failed_checks);
+        for (size_t i = 0; i < m_measurements.size(); i++)
+        {
+            const Measurement &measurement = m_measurements[i];
+            fprintf(file, "    {\"name\": \"%s\", \"value\": %.6f, \"unit\": \"%s\"}%s\n",
+                    measurement.name.c_str(), measurement.value, measurement.unit.c_str(),
+                    i + 1 < m_measurements.size() ? "," : "");
+        }
+        fprintf(file, "  ]\n}\n");
+        fclose(file);
+        return true;
+    }
+
+    // Parameters: benchmark name or pattern, entry name
+    static bool IsMatching(std::string_view name, std::string_view entry_name)
+    {
+        if (name == "all")
+            return true;
+        if (!name.empty() && name.back() == '*')
+            return entry_name.substr(0, name.size() - 1) == name.substr(0, name.size() - 1);
+        return name == entry_name;
+    }
+
+    int Run(std::string_view name, std::string_view json_output_path)
+    {
+        Report report;
+        bool found = false;
+        for (const BenchmarkEntry &entry : kBenchmarks)
+        {
+            if (!IsMatching(name, entry.name))
+                continue;
+
+            found = true;
+            AmoLogger_Info("Running benchmark '%s'", entry.name);
+            entry.func(report);
+        }
+
+        if (!found)
+        {
+            AmoLogger_Error("Unknown benchmark '%s'", std::string(name).c_str());
+            return 1;
+        }
+
+        report.Print();
+        if (!json_output_path.empty() && !report.WriteJson(json_output_path, name))
+            return 1;
+        if (report.GetNumFailedChecks() != 0)
+        {
+            AmoLogger_Error("%u benchmark checks failed.", report.GetNumFailedChecks());
+            return 1;
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,633 @@
+//
+// Created by Amo on 2022/7/22.
+//
+
+#include "benchmark/benchmark.h"
+#include "core/ECS/registry.h"
+#include "core/ECS/archetype_registry.h"
+#include "core/ECS/scheduler.h"
+#include "core/ECS/command_buffer.h"
+#include "core/ECS/Systems/transform_system.h"
+#include "core/global_thread_pool.h"
+#include "core/ECS/component.h"
+
+namespace SymoCraft::Benchmark
+{
+    // Register the components in the same order as the application does
+    template<typename RegistryType>
+    static void RegisterComponents(RegistryType &registry)
+    {
+        registry.template RegisterComponent<Transform>("Transform");
+        registry.template RegisterComponent<Physics::RigidBody>("RigidBody");
+        registry.template RegisterComponent<Physics::HitBox>("HigBox");
+        registry.template RegisterComponent<Character::CharacterComponent>("CharacterComponent");
+        registry.template RegisterComponent<Character::PlayerComponent>("PlayerComponent");
+    }
+
+    void EcsGetComponent(Report &report)
+    {
+        constexpr uint32 kEntityCounts[] = {1000, 100000, 1000000};
+        constexpr uint32 kNumLookups = 1000000;
+        std::mt19937 random_engine(42);
+
+        for (uint32 num_entities : kEntityCounts)
+        {
+            ECS::Registry registry;
+            RegisterComponents(registry);
+
+            std::vector<ECS::EntityId> entities(num_entities);
+            for (ECS::EntityId &entity : entities)
+            {
+                entity = registry.CreateEntity();
+                registry.AddComponent<Transform>(entity).position = glm::vec3(1.0f);
+            }
+
+            std::vector<ECS::EntityId> random_entities(kNumLookups);
+            std::uniform_int_distribution<uint32> distribution(0, num_entities - 1);
+            for (ECS::EntityId &entity : random_entities)
+                entity = entities[distribution(random_engine)];
+
+            // Sum the positions so the lookups can't be optimized away
+            float checksum = 0.0f;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32 i = 0; i < kNumLookups; i++)
+                checksum += registry.GetComponent<const Transform>(entities[i % num_entities]).position.x;
+            double sequential_time = MillisecondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            for (ECS::EntityId entity : random_entities)
+                checksum += registry.GetComponent<const Transform>(entity).position.x;
+            double random_time = MillisecondsSince(start);
+
+            std::string prefix = "ecs_get/" + std::to_string(num_entities) + "/";
+            report.Add(prefix + "sequential", sequential_time * 1e6 / kNumLookups, "ns");
+            report.Add(prefix + "random", random_time * 1e6 / kNumLookups, "ns");
+            if (checksum != 2.0f * kNumLookups)
+            {
+                AmoLogger_Error("GetComponent returned wrong components.");
+                report.Fail();
+            }
+
+            registry.Clear();
+        }
+    }
+
+    void EcsView(Report &report)
+    {
+        constexpr uint32 kNumEntities = 100000;
+        constexpr uint32 kPhysicsEvery = 10;
+        constexpr int kNumRounds = 20;
+
+        ECS::Registry registry;
+        RegisterComponents(registry);
+
+        std::vector<ECS::EntityId> entities(kNumEntities);
+        for (uint32 i = 0; i < kNumEntities; i++)
+        {
+            entities[i] = registry.CreateEntity();
+            registry.AddComponent<Transform>(entities[i]).position = glm::vec3(1.0f);
+            if (i % kPhysicsEvery == 0)
+            {
+                registry.AddComponent<Physics::RigidBody>(entities[i]).velocity = glm::vec3(1.0f);
+                registry.AddComponent<Physics::HitBox>(entities[i]);
+            }
+        }
+        const uint32 num_matches = kNumEntities / kPhysicsEvery;
+
+        float checksum = 0.0f;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < kNumRounds; round++)
+        {
+            for (auto [entity, transform, rb, hit_box] :
+                 registry.View<const Transform, const Physics::RigidBody, const Physics::HitBox>())
+                checksum += transform.position.x + rb.velocity.x;
+        }
+        double view_time = MillisecondsSince(start);
+
+        // The way systems iterated before views yielded components
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < kNumRounds; round++)
+        {
+            for (ECS::EntityId entity : entities)
+            {
+                if (!registry.HasComponent<Physics::RigidBody>(entity) || !registry.HasComponent<Physics::HitBox>(entity))
+                    continue;
+                checksum += registry.GetComponent<const Transform>(entity).position.x
+                          + registry.GetComponent<const Physics::RigidBody>(entity).velocity.x;
+            }
+        }
+        double lookup_time = MillisecondsSince(start);
+
+        // A plain loop over the typed dense array of one component
+        float storage_checksum = 0.0f;
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < kNumRounds; round++)
+        {
+            for (const Physics::RigidBody& rb : registry.GetStorage<const Physics::RigidBody>())
+                storage_checksum += rb.velocity.x;
+        }
+        double storage_time = MillisecondsSince(start);
+
+        report.Add("ecs_view/dense_view", view_time * 1e6 / (kNumRounds * num_matches), "ns/entity");
+        report.Add("ecs_view/entity_walk", lookup_time * 1e6 / (kNumRounds * num_matches), "ns/entity");
+        report.Add("ecs_view/storage_loop", storage_time * 1e6 / (kNumRounds * num_matches), "ns/entity");
+        if (checksum != 4.0f * kNumRounds * num_matches || storage_checksum != 1.0f * kNumRounds * num_matches)
+        {
+            AmoLogger_Error("View visited the wrong entities.");
+            report.Fail();
+        }
+
+        registry.Clear();
+    }
+
+    // Fill a registry with a mix of archetypes: every entity has a Transform,
+    // half of them are physics bodies and a quarter of those are characters
+    template<typename RegistryType>
+    static void PopulateMixedRegistry(RegistryType &registry, uint32 num_entities)
+    {
+        for (uint32 i = 0; i < num_entities; i++)
+        {
+            ECS::EntityId entity = registry.CreateEntity();
+            registry.template AddComponent<Transform>(entity).position = glm::vec3(0.0f);
+            if (i % 2 == 0)
+            {
+                auto& rb = registry.template AddComponent<Physics::RigidBody>(entity);
+                rb.velocity = glm::vec3(1.0f, 0.0f, 0.0f);
+                rb.acceleration = glm::vec3(0.0f, -1.0f, 0.0f);
+                registry.template AddComponent<Physics::HitBox>(entity).size = glm::vec3(0.6f, 1.8f, 0.6f);
+            }
+            if (i % 8 == 0)
+                registry.template AddComponent<Character::CharacterComponent>(entity);
+        }
+    }
+
+    // Integrate the physics bodies like Physics::Update does, return the time in milliseconds
+    template<typename RegistryType>
+    static double IntegrateBodies(RegistryType &registry, int num_rounds, float &checksum)
+    {
+        constexpr float kDeltaTime = 1.0f / 60.0f;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < num_rounds; round++)
+        {
+            for (auto [entity, transform, rb, hit_box] :
+                 registry.template View<Transform, Physics::RigidBody, Physics::HitBox>())
+            {
+                transform.position += rb.velocity * kDeltaTime;
+                rb.velocity += rb.acceleration * kDeltaTime;
+                checksum += hit_box.size.y;
+            }
+        }
+        return MillisecondsSince(start);
+    }
+
+    // Add and remove a component on every entity, return the time in milliseconds
+    template<typename RegistryType>
+    static double AddRemoveComponents(RegistryType &registry)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (ECS::EntityId entity : registry.entities)
+            registry.template AddComponent<Character::PlayerComponent>(entity);
+        for (ECS::EntityId entity : registry.entities)
+            registry.template RemoveComponent<Character::PlayerComponent>(entity);
+        return MillisecondsSince(start);
+    }
+
+    void EcsArchetype(Report &report)
+    {
+        constexpr uint32 kEntityCounts[] = {10000, 100000};
+        constexpr int kNumRounds = 20;
+
+        for (uint32 num_entities : kEntityCounts)
+        {
+            ECS::Registry sparse_registry;
+            ECS::ArchetypeRegistry archetype_registry;
+            RegisterComponents(sparse_registry);
+            RegisterComponents(archetype_registry);
+            PopulateMixedRegistry(sparse_registry, num_entities);
+            PopulateMixedRegistry(archetype_registry, num_entities);
+
+            const uint32 num_bodies = (num_entities + 1) / 2;
+            float sparse_checksum = 0.0f, archetype_checksum = 0.0f;
+            double sparse_time = IntegrateBodies(sparse_registry, kNumRounds, sparse_checksum);
+            double archetype_time = IntegrateBodies(archetype_registry, kNumRounds, archetype_checksum);
+            if (sparse_checksum != archetype_checksum)
+            {
+                AmoLogger_Error("The archetype view visited different entities than the sparse set view.");
+                report.Fail();
+            }
+
+            std::string prefix = "ecs_archetype/" + std::to_string(num_entities) + "/";
+            report.Add(prefix + "iterate_sparse", sparse_time * 1e6 / (kNumRounds * num_bodies), "ns/entity");
+            report.Add(prefix + "iterate_archetype", archetype_time * 1e6 / (kNumRounds * num_bodies), "ns/entity");
+            report.Add(prefix + "add_remove_sparse", AddRemoveComponents(sparse_registry) * 1e6 / (2 * num_entities), "ns");
+            report.Add(prefix + "add_remove_archetype", AddRemoveComponents(archetype_registry) * 1e6 / (2 * num_entities), "ns");
+            report.Add(prefix + "archetypes", archetype_registry.NumArchetypes(), "");
+
+            for (ECS::EntityId entity : archetype_registry.entities)
+            {
+                auto& transform = archetype_registry.GetComponent<Transform>(entity);
+                if (transform.position != sparse_registry.GetComponent<const Transform>(entity).position)
+                {
+                    AmoLogger_Error("The archetype registry lost a component while moving entities.");
+                    report.Fail();
+                    break;
+                }
+            }
+
+            sparse_registry.Clear();
+            archetype_registry.Clear();
+        }
+    }
+
+    // Doesn't touch Transform, so it can run next to TransformSystem
+    static void IntegrateVelocities(ECS::Registry &registry, const ECS::SystemSlice& slice)
+    {
+        constexpr float kDeltaTime = 1.0f / 120.0f;
+        for (auto [entity, rb, hit_box] :
+             registry.View<Physics::RigidBody, const Physics::HitBox>().Slice(slice.begin, slice.end).StampWith(slice.run_tick))
+        {
+            rb.velocity += rb.acceleration * kDeltaTime;
+            rb.velocity = glm::clamp(rb.velocity, -hit_box.size * 100.0f, hit_box.size * 100.0f);
+        }
+    }
+
+    static uint32 CountVelocities(ECS::Registry &registry)
+    {
+        return registry.View<Physics::RigidBody, Physics::HitBox>().Size();
+    }
+
+    // TransformSystem without the change filter, so the scheduled frames do the same work as the serial ones
+    static void UpdateAllTransforms(ECS::Registry &registry, const ECS::SystemSlice& slice)
+    {
+        TransformSystem::UpdateSlice(registry, {slice.begin, slice.end, 0, slice.run_tick});
+    }
+
+    void EcsScheduler(Report &report)
+    {
+        constexpr uint32 kNumEntities = 100000;
+        constexpr int kNumFrames = 50;
+
+        ECS::Registry registry;
+        RegisterComponents(registry);
+        PopulateMixedRegistry(registry, kNumEntities);
+
+        ECS::System velocity_system{"IntegrateVelocities"};
+        velocity_system.reads = ECS::Internal::MakeComponentSignature<Physics::HitBox>();
+        velocity_system.writes = ECS::Internal::MakeComponentSignature<Physics::RigidBody>();
+        velocity_system.update = IntegrateVelocities;
+        velocity_system.count = CountVelocities;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < kNumFrames; frame++)
+        {
+            TransformSystem::Update(registry);
+            IntegrateVelocities(registry, {0, UINT32_MAX, 0, registry.GetChangeTick()});
+        }
+        double serial_time = MillisecondsSince(start);
+
+        GlobalThreadPool thread_pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+        ECS::Scheduler scheduler;
+        ECS::System transform_system = TransformSystem::GetSystem();
+        transform_system.update = UpdateAllTransforms;
+        scheduler.AddSystem(transform_system);
+        scheduler.AddSystem(velocity_system);
+
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < kNumFrames; frame++)
+            scheduler.Run(registry, thread_pool);
+        double scheduled_time = MillisecondsSince(start);
+
+        report.Add("ecs_scheduler/threads", thread_pool.NumThreads() + 1, "");
+        report.Add("ecs_scheduler/serial", serial_time / kNumFrames, "ms/frame");
+        report.Add("ecs_scheduler/scheduled", scheduled_time / kNumFrames, "ms/frame");
+        for (const ECS::SystemTiming& timing : scheduler.GetTimings())
+        {
+            report.Add(std::string("ecs_scheduler/system/") + timing.name, timing.total_time_ms / timing.num_frames, "ms");
+            report.Add(std::string("ecs_scheduler/slices/") + timing.name, timing.last_num_slices, "");
+        }
+
+        thread_pool.Free();
+        registry.Clear();
+    }
+
+    struct SpawnJob
+    {
+        ECS::Registry* registry;
+        uint32 num_entities;
+        std::atomic<uint32>* num_unfinished_jobs;
+    };
+
+    // Record entities with a transform and a rigid body, then destroy every fourth one again
+    static void RecordSpawns(void* data, size_t data_size)
+    {
+        auto& job = *(SpawnJob*)data;
+        ECS::CommandBuffer& commands = job.registry->GetCommandBuffer();
+        for (uint32 i = 0; i < job.num_entities; i++)
+        {
+            ECS::EntityId entity = commands.CreateEntity();
+            Transform transform{};
+            transform.position = glm::vec3((float)i, 64.0f, 0.0f);
+            commands.AddComponent(entity, transform);
+            commands.AddComponent<Physics::RigidBody>(entity);
+            if (i % 4 == 0)
+                commands.DestroyEntity(entity);
+        }
+        job.num_unfinished_jobs->fetch_sub(1, std::memory_order_release);
+    }
+
+    void EcsCommandBuffers(Report &report)
+    {
+        constexpr uint32 kNumEntities = 100000;
+        constexpr uint32 kNumJobs = 8;
+
+        ECS::Registry registry;
+        RegisterComponents(registry);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < kNumEntities; i++)
+        {
+            ECS::EntityId entity = registry.CreateEntity();
+            registry.AddComponent<Transform>(entity).position = glm::vec3((float)i, 64.0f, 0.0f);
+            registry.AddComponent<Physics::RigidBody>(entity);
+        }
+        double direct_time = MillisecondsSince(start);
+        registry.Clear();
+
+        RegisterComponents(registry);
+        GlobalThreadPool thread_pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+        std::atomic<uint32> num_unfinished_jobs{0};
+        std::vector<SpawnJob> jobs(kNumJobs, {&registry, kNumEntities / kNumJobs, &num_unfinished_jobs});
+
+        // The first round grows the command buffers, the second one reuses their memory
+        const char* kRoundNames[] = {"cold", "warm"};
+        for (const char* round_name : kRoundNames)
+        {
+            num_unfinished_jobs.store(kNumJobs);
+            start = std::chrono::steady_clock::now();
+            for (SpawnJob& job : jobs)
+                thread_pool.QueueTask(RecordSpawns, "RecordSpawns", &job, sizeof(job));
+            thread_pool.BeginWork();
+            while (num_unfinished_jobs.load(std::memory_order_acquire) > 0)
+                if (!thread_pool.RunPendingTask())
+                    std::this_thread::yield();
+            double record_time = MillisecondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            registry.PlaybackCommands();
+            double playback_time = MillisecondsSince(start);
+
+            report.Add(std::string("ecs_commands/record_") + round_name, record_time, "ms");
+            report.Add(std::string("ecs_commands/playback_") + round_name, playback_time, "ms");
+        }
+
+        const uint32 expected_alive = 2 * (kNumEntities - kNumEntities / 4);
+        uint32 num_alive = 0;
+        for (auto [entity, transform, rb] : registry.View<Transform, Physics::RigidBody>())
+            if (transform.position.y == 64.0f)
+                num_alive++;
+        if (num_alive != expected_alive)
+        {
+            AmoLogger_Error("Command buffers left %u entities, expected %u.", num_alive, expected_alive);
+            report.Fail();
+        }
+
+        report.Add("ecs_commands/direct", direct_time, "ms");
+        report.Add("ecs_commands/alive_entities", num_alive, "");
+
+        thread_pool.Free();
+        registry.Clear();
+    }
+
+    void EcsChangeTracking(Report &report)
+    {
+        constexpr uint32 kNumEntities = 100000;
+        constexpr uint32 kNumRotatedPerFrame = kNumEntities / 100;
+        constexpr int kNumFrames = 100;
+
+        ECS::Registry registry;
+        RegisterComponents(registry);
+        std::vector<ECS::EntityId> entities(kNumEntities);
+        for (ECS::EntityId &entity : entities)
+            entity = registry.CreateEntity();
+        for (ECS::EntityId entity : entities)
+            registry.AddComponent<Transform>(entity);
+
+        std::mt19937 random_engine(42);
+        std::uniform_int_distribution<uint32> distribution(0, kNumEntities - 1);
+        std::vector<ECS::EntityId> rotated_entities(kNumRotatedPerFrame);
+        auto rotate_some = [&](int frame)
+        {
+            for (ECS::EntityId &entity : rotated_entities)
+            {
+                entity = entities[distribution(random_engine)];
+                registry.GetComponent<Transform>(entity).yaw = (float)frame;
+            }
+        };
+
+        double full_time = 0.0;
+        for (int frame = 0; frame < kNumFrames; frame++)
+        {
+            rotate_some(frame);
+            auto start = std::chrono::steady_clock::now();
+            TransformSystem::Update(registry);
+            full_time += MillisecondsSince(start);
+        }
+
+        // Ticks advance the way the scheduler advances them: one for the system, one after the frame
+        uint32 last_run_tick = registry.AdvanceChangeTick();
+        TransformSystem::UpdateSlice(registry, {0, UINT32_MAX, 0, last_run_tick});
+        registry.AdvanceChangeTick();
+        double changed_time = 0.0;
+        for (int frame = 0; frame < kNumFrames; frame++)
+        {
+            rotate_some(frame + kNumFrames);
+            auto start = std::chrono::steady_clock::now();
+            const uint32 run_tick = registry.AdvanceChangeTick();
+            TransformSystem::UpdateSlice(registry, {0, UINT32_MAX, last_run_tick, run_tick});
+            last_run_tick = run_tick;
+            changed_time += MillisecondsSince(start);
+            registry.AdvanceChangeTick();
+        }
+
+        // The rotated entities of the last frame must have been updated
+        for (ECS::EntityId entity : rotated_entities)
+        {
+            const Transform& transform = registry.GetComponent<const Transform>(entity);
+            const float yaw = glm::radians(transform.yaw);
+            if (glm::abs(transform.front.x - glm::cos(yaw)) > 1e-4f || glm::abs(transform.front.z - glm::sin(yaw)) > 1e-4f)
+            {
+                AmoLogger_Error("The change filter skipped a rotated transform.");
+                report.Fail();
+                break;
+            }
+        }
+
+        // Another system starting during the run advances the tick, the run's own writes must not count
+        // as changes for its next run
+        rotate_some(2 * kNumFrames);
+        const uint32 run_tick = registry.AdvanceChangeTick();
+        registry.AdvanceChangeTick();
+        TransformSystem::UpdateSlice(registry, {0, UINT32_MAX, last_run_tick, run_tick});
+        registry.AdvanceChangeTick();
+        if (registry.View<const Transform>().Changed<Transform>(run_tick).begin()
+            != registry.View<const Transform>().Changed<Transform>(run_tick).end())
+        {
+            AmoLogger_Error("The transform system would visit its own writes again.");
+            report.Fail();
+        }
+
+        report.Add("ecs_changed/all", full_time / kNumFrames, "ms/frame");
+        report.Add("ecs_changed/changed_only", changed_time / kNumFrames, "ms/frame");
+        registry.Clear();
+    }
+
+    // Check that every component T of the source is in the copy with the same bytes, and nothing more
+    template<typename T>
+    static bool IsSameComponents(ECS::Registry &source, ECS::Registry &copy)
+    {
+        for (auto [entity, component] : source.View<const T>())
+        {
+            if (!copy.HasComponent<T>(entity)
+                || std::memcmp(&component, &copy.GetComponent<const T>(entity), sizeof(T)) != 0)
+                return false;
+        }
+        // Every source component is in the copy, the copy must hold no more
+        return source.GetStorage<const T>().Size() == copy.GetStorage<const T>().Size();
+    }
+
+    static bool IsSameRegistry(ECS::Registry &source, ECS::Registry &copy)
+    {
+        return source.entities == copy.entities
+               && IsSameComponents<Transform>(source, copy)
+               && IsSameComponents<Physics::RigidBody>(source, copy)
+               && IsSameComponents<Physics::HitBox>(source, copy)
+               && IsSameComponents<Character::CharacterComponent>(source, copy);
+    }
+
+    void EcsSnapshot(Report &report)
+    {
+        constexpr uint32 kNumEntities = 100000;
+        constexpr uint32 kNumChanged = kNumEntities / 100;
+
+        ECS::Registry source, copy;
+        RegisterComponents(source);
+        RegisterComponents(copy);
+        PopulateMixedRegistry(source, kNumEntities);
+
+        auto start = std::chrono::steady_clock::now();
+        RawMemory snapshot = source.Serialize();
+        double write_time = MillisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        copy.Deserialize(snapshot);
+        double read_time = MillisecondsSince(start);
+        if (!IsSameRegistry(source, copy))
+        {
+            AmoLogger_Error("The registry loaded from the full snapshot doesn't match.");
+            report.Fail();
+        }
+
+        // Move some bodies, destroy some entities and add a component to others
+        std::mt19937 random_engine(42);
+        std::uniform_int_distribution<uint32> distribution(0, kNumEntities - 1);
+        const uint32 baseline_tick = source.GetLastSnapshotTick();
+        for (uint32 i = 0; i < kNumChanged; i++)
+        {
+            ECS::EntityId entity = source.entities[distribution(random_engine)];
+            if (!source.IsEntityValid(entity))
+                continue;
+            if (i % 10 == 0)
+                source.DestroyEntity(entity);
+            else if (i % 10 == 1)
+                source.AddComponent<Character::PlayerComponent>(entity);
+            else
+                source.GetComponent<Transform>(entity).position.y += 1.0f;
+        }
+
+        start = std::chrono::steady_clock::now();
+        RawMemory delta = source.Serialize(baseline_tick);
+        double delta_write_time = MillisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        copy.Deserialize(delta);
+        double delta_read_time = MillisecondsSince(start);
+        if (!IsSameRegistry(source, copy) || !IsSameComponents<Character::PlayerComponent>(source, copy))
+        {
+            AmoLogger_Error("The registry after the delta snapshot doesn't match.");
+            report.Fail();
+        }
+
+        report.Add("ecs_snapshot/write", write_time, "ms");
+        report.Add("ecs_snapshot/read", read_time, "ms");
+        report.Add("ecs_snapshot/size", (double)snapshot.size, "B");
+        report.Add("ecs_snapshot/delta_write", delta_write_time, "ms");
+        report.Add("ecs_snapshot/delta_read", delta_read_time, "ms");
+        report.Add("ecs_snapshot/delta_size", (double)delta.size, "B");
+
+        snapshot.Free();
+        delta.Free();
+        source.Clear();
+        copy.Clear();
+    }
+
+    void EcsPrefab(Report &report)
+    {
+        constexpr uint32 kNumMobs = 100000;
+
+        ECS::Prefab mob;
+        mob.Set<Transform>().position = glm::vec3(0.0f, 80.0f, 0.0f);
+        mob.Set<Physics::RigidBody>().use_gravity = true;
+        mob.Set<Physics::HitBox>().size = glm::vec3(0.6f, 1.8f, 0.6f);
+        mob.Set<Character::CharacterComponent>().base_speed = 2.0f;
+
+        ECS::Registry registry;
+        RegisterComponents(registry);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < kNumMobs; i++)
+        {
+            ECS::EntityId entity = registry.CreateEntity();
+            registry.AddComponent<Transform>(entity).position = glm::vec3(0.0f, 80.0f, 0.0f);
+            registry.AddComponent<Physics::RigidBody>(entity).use_gravity = true;
+            registry.AddComponent<Physics::HitBox>(entity).size = glm::vec3(0.6f, 1.8f, 0.6f);
+            registry.AddComponent<Character::CharacterComponent>(entity).base_speed = 2.0f;
+        }
+        double add_time = MillisecondsSince(start);
+        registry.Clear();
+
+        RegisterComponents(registry);
+        std::vector<ECS::EntityId> mobs(kNumMobs);
+        start = std::chrono::steady_clock::now();
+        registry.Instantiate(mob, kNumMobs, mobs.data());
+        double instantiate_time = MillisecondsSince(start);
+
+        uint32 num_spawned = 0;
+        for (auto [entity, transform, rb, hit_box, character] :
+             registry.View<const Transform, const Physics::RigidBody, const Physics::HitBox,
+                           const Character::CharacterComponent>())
+        {
+            if (transform.position.y == 80.0f && rb.use_gravity && hit_box.size.y == 1.8f && character.base_speed == 2.0f)
+                num_spawned++;
+        }
+        if (num_spawned != kNumMobs || !registry.IsEntityValid(mobs.back()))
+        {
+            AmoLogger_Error("Instantiated %u mobs from the prefab, expected %u.", num_spawned, kNumMobs);
+            report.Fail();
+        }
+
+        // Respawn into the memory and the free entity slots of the first wave
+        for (ECS::EntityId entity : mobs)
+            registry.DestroyEntity(entity);
+        start = std::chrono::steady_clock::now();
+        registry.Instantiate(mob, kNumMobs, mobs.data());
+        double respawn_time = MillisecondsSince(start);
+        if (registry.entities.size() != kNumMobs)
+        {
+            AmoLogger_Error("Respawning didn't reuse the free entity slots.");
+            report.Fail();
+        }
+
+        report.Add("ecs_prefab/add_components", add_time * 1e6 / kNumMobs, "ns/entity");
+        report.Add("ecs_prefab/instantiate", instantiate_time * 1e6 / kNumMobs, "ns/entity");
+        report.Add("ecs_prefab/instantiate_respawn", respawn_time * 1e6 / kNumMobs, "ns/entity");
+        registry.Clear();
+    }
+}
@@ -0,0 +1,275 @@
+//
+// Created by Amo on 2022/7/27.
+//
+
+#include "benchmark/benchmark.h"
+#include "core/ECS/registry.h"
+#include "core/ECS/component.h"
+
+namespace SymoCraft::Benchmark
+{
+    // The stress benchmarks all run on a registry of this size
+    static const uint32 kNumStressEntities = 1000000;
+
+    static void RegisterStressComponents(ECS::Registry &registry)
+    {
+        registry.RegisterComponent<Transform>("Transform");
+        registry.RegisterComponent<Physics::RigidBody>("RigidBody");
+        registry.RegisterComponent<Physics::HitBox>("HigBox");
+        registry.RegisterComponent<Character::CharacterComponent>("CharacterComponent");
+        registry.RegisterComponent<Character::PlayerComponent>("PlayerComponent");
+    }
+
+    static double NanosecondsPer(double milliseconds, uint32 count)
+    {
+        return milliseconds * 1e6 / count;
+    }
+
+    void EcsStressChurn(Report &report)
+    {
+        constexpr int kNumChurnRounds = 10;
+        constexpr uint32 kNumChurnedPerRound = kNumStressEntities / 10;
+
+        ECS::Registry registry;
+        RegisterStressComponents(registry);
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < kNumStressEntities; i++)
+        {
+            ECS::EntityId entity = registry.CreateEntity();
+            registry.AddComponent<Transform>(entity).position = glm::vec3((float)i, 0.0f, 0.0f);
+        }
+        double create_time = MillisecondsSince(start);
+
+        // Destroy a random tenth of the entities, then create as many again through the free list
+        std::mt19937 random_engine(42);
+        std::uniform_int_distribution<uint32> distribution(0, kNumStressEntities - 1);
+        std::vector<ECS::EntityId> victims;
+        victims.reserve(kNumChurnedPerRound);
+        double destroy_time = 0.0, recreate_time = 0.0;
+        uint32 num_destroyed = 0;
+        for (int round = 0; round < kNumChurnRounds; round++)
+        {
+            victims.clear();
+            for (uint32 i = 0; i < kNumChurnedPerRound; i++)
+            {
+                ECS::EntityId entity = registry.entities[distribution(random_engine)];
+                if (registry.IsEntityValid(entity))
+                    victims.push_back(entity);
+            }
+
+            uint32 num_round_destroyed = 0;
+            start = std::chrono::steady_clock::now();
+            for (ECS::EntityId entity : victims)
+            {
+                // The same entity can be picked twice in one round
+                if (registry.entities[ECS::Internal::GetEntityIndex(entity)] != entity)
+                    continue;
+                registry.DestroyEntity(entity);
+                num_round_destroyed++;
+            }
+            destroy_time += MillisecondsSince(start);
+            num_destroyed += num_round_destroyed;
+
+            start = std::chrono::steady_clock::now();
+            for (uint32 i = 0; i < num_round_destroyed; i++)
+            {
+                ECS::EntityId entity = registry.CreateEntity();
+                registry.AddComponent<Transform>(entity).position = glm::vec3(-1.0f);
+            }
+            recreate_time += MillisecondsSince(start);
+        }
+
+        // Recreated entities reuse the destroyed slots, so the entity array never grows
+        uint32 num_alive = 0;
+        for (ECS::EntityId entity : registry.entities)
+            if (registry.IsEntityValid(entity))
+                num_alive++;
+        const uint32 num_transforms = registry.View<const Transform>().Size();
+        if (num_alive != num_transforms || registry.entities.size() != kNumStressEntities)
+        {
+            AmoLogger_Error("Churn left %u transforms for %u live entities in %zu slots.", num_transforms, num_alive,
+                            registry.entities.size());
+            report.Fail();
+        }
+
+        report.Add("ecs_stress_churn/create", NanosecondsPer(create_time, kNumStressEntities), "ns/entity");
+        report.Add("ecs_stress_churn/destroy", NanosecondsPer(destroy_time, num_destroyed), "ns/entity");
+        report.Add("ecs_stress_churn/recreate", NanosecondsPer(recreate_time, num_destroyed), "ns/entity");
+        report.Add("ecs_stress_churn/entity_slots", (double)registry.entities.size(), "");
+        registry.Clear();
+    }
+
+    void EcsStressAddRemove(Report &report)
+    {
+        ECS::Registry registry;
+        RegisterStressComponents(registry);
+        std::vector<ECS::EntityId> entities(kNumStressEntities);
+        for (ECS::EntityId &entity : entities)
+        {
+            entity = registry.CreateEntity();
+            registry.AddComponent<Transform>(entity);
+        }
+
+        std::vector<ECS::EntityId> shuffled = entities;
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+
+        // In entity order the sparse pages are walked in order, in random order they are not
+        struct Order
+        {
+            const char* name;
+            const std::vector<ECS::EntityId>* entities;
+        };
+        const Order kOrders[] = {{"sequential", &entities}, {"random", &shuffled}};
+        for (const Order &order : kOrders)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (ECS::EntityId entity : *order.entities)
+                registry.AddComponent<Physics::RigidBody>(entity).velocity = glm::vec3(1.0f);
+            double add_time = MillisecondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            for (ECS::EntityId entity : *order.entities)
+                registry.RemoveComponent<Physics::RigidBody>(entity);
+            double remove_time = MillisecondsSince(start);
+
+            if (registry.View<const Physics::RigidBody>().Size() != 0)
+            {
+                AmoLogger_Error("Removing every RigidBody left some behind.");
+                report.Fail();
+            }
+
+            report.Add(std::string("ecs_stress_add_remove/add_") + order.name,
+                       NanosecondsPer(add_time, kNumStressEntities), "ns");
+            report.Add(std::string("ecs_stress_add_remove/remove_") + order.name,
+                       NanosecondsPer(remove_time, kNumStressEntities), "ns");
+        }
+        registry.Clear();
+    }
+
+    void EcsStressRandomGet(Report &report)
+    {
+        constexpr uint32 kNumLookups = 1000000;
+
+        ECS::Registry registry;
+        RegisterStressComponents(registry);
+        std::vector<ECS::EntityId> entities(kNumStressEntities);
+        for (uint32 i = 0; i < kNumStressEntities; i++)
+        {
+            entities[i] = registry.CreateEntity();
+            registry.AddComponent<Transform>(entities[i]).position = glm::vec3(1.0f);
+            if (i % 2 == 0)
+                registry.AddComponent<Physics::RigidBody>(entities[i]).velocity = glm::vec3(1.0f);
+        }
+
+        std::mt19937 random_engine(42);
+        std::uniform_int_distribution<uint32> distribution(0, kNumStressEntities - 1);
+        std::vector<ECS::EntityId> random_entities(kNumLookups);
+        for (ECS::EntityId &entity : random_entities)
+            entity = entities[distribution(random_engine)];
+
+        float checksum = 0.0f;
+        auto start = std::chrono::steady_clock::now();
+        for (ECS::EntityId entity : random_entities)
+            checksum += registry.GetComponent<const Transform>(entity).position.x;
+        double get_time = MillisecondsSince(start);
+
+        // Half of the entities have a RigidBody, so every lookup is checked first
+        start = std::chrono::steady_clock::now();
+        for (ECS::EntityId entity : random_entities)
+            if (registry.HasComponent<Physics::RigidBody>(entity))
+                checksum += registry.GetComponent<const Physics::RigidBody>(entity).velocity.x;
+        double has_get_time = MillisecondsSince(start);
+
+        report.Add("ecs_stress_get/get", NanosecondsPer(get_time, kNumLookups), "ns");
+        report.Add("ecs_stress_get/has_then_get", NanosecondsPer(has_get_time, kNumLookups), "ns");
+        if (checksum < kNumLookups)
+        {
+            AmoLogger_Error("Random lookups read the wrong components.");
+            report.Fail();
+        }
+        registry.Clear();
+    }
+
+    // Time one pass of a read only view, Transform first
+    // return the time in milliseconds
+    // Parameters: registry, number of matches(out), checksum(out)
+    template<typename... Components>
+    static double TimeView(ECS::Registry &registry, uint32 &num_matches, double &checksum)
+    {
+        num_matches = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto components : registry.View<const Transform, const Components...>())
+        {
+            num_matches++;
+            checksum += std::get<1>(components).position.x;
+        }
+        return MillisecondsSince(start);
+    }
+
+    void EcsStressView(Report &report)
+    {
+        // Every entity has a Transform, the other components each show up on this share of the entities,
+        // independent of each other
+        constexpr float kDensities[] = {1.0f, 0.5f, 0.1f, 0.01f};
+        constexpr int kNumRounds = 5;
+
+        for (float density : kDensities)
+        {
+            ECS::Registry registry;
+            RegisterStressComponents(registry);
+            std::mt19937 random_engine(42);
+            std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+            for (uint32 i = 0; i < kNumStressEntities; i++)
+            {
+                ECS::EntityId entity = registry.CreateEntity();
+                registry.AddComponent<Transform>(entity).position = glm::vec3(1.0f);
+                if (distribution(random_engine) < density)
+                    registry.AddComponent<Physics::RigidBody>(entity);
+                if (distribution(random_engine) < density)
+                    registry.AddComponent<Physics::HitBox>(entity);
+                if (distribution(random_engine) < density)
+                    registry.AddComponent<Character::CharacterComponent>(entity);
+                if (distribution(random_engine) < density)
+                    registry.AddComponent<Character::PlayerComponent>(entity);
+            }
+
+            double times[5] = {};
+            uint32 matches[5] = {};
+            double checksum = 0.0;
+            for (int round = 0; round < kNumRounds; round++)
+            {
+                times[0] += TimeView<>(registry, matches[0], checksum);
+                times[1] += TimeView<Physics::RigidBody>(registry, matches[1], checksum);
+                times[2] += TimeView<Physics::RigidBody, Physics::HitBox>(registry, matches[2], checksum);
+                times[3] += TimeView<Physics::RigidBody, Physics::HitBox,
+                                     Character::CharacterComponent>(registry, matches[3], checksum);
+                times[4] += TimeView<Physics::RigidBody, Physics::HitBox,
+                                     Character::CharacterComponent, Character::PlayerComponent>(registry, matches[4], checksum);
+            }
+
+            uint32 expected_checksum = 0;
+            for (uint32 num_matches : matches)
+                expected_checksum += num_matches;
+            if (checksum != (double)expected_checksum * kNumRounds)
+            {
+                AmoLogger_Error("Views visited the wrong entities.");
+                report.Fail();
+            }
+
+            char prefix[64];
+            snprintf(prefix, sizeof(prefix), "ecs_stress_view/density_%g/", density);
+            for (int num_types = 1; num_types <= 5; num_types++)
+            {
+                const double time = times[num_types - 1] / kNumRounds;
+                const uint32 num_matches = matches[num_types - 1];
+                report.Add(std::string(prefix) + std::to_string(num_types) + "_types", time, "ms");
+                report.Add(std::string(prefix) + std::to_string(num_types) + "_types_matches", num_matches, "");
+                if (num_matches > 0)
+                    report.Add(std::string(prefix) + std::to_string(num_types) + "_types_per_match",
+                               NanosecondsPer(time, num_matches), "ns");
+            }
+            registry.Clear();
+        }
+    }
+}
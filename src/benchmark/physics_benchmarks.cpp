@@ -0,0 +1,788 @@
+//
+// Created by Amo on 2022/7/29.
+//
+
+#include "benchmark/benchmark.h"
+#include "core/ECS/registry.h"
+#include "core/ECS/component.h"
+#include "core/ECS/Systems/physics_system.h"
+#include "core/ECS/Systems/spatial_hash.h"
+#include "core/ECS/Systems/aabb_tree.h"
+#include "world/chunk.h"
+#include "core/global_thread_pool.h"
+#include "core/simulation_clock.h"
+
+namespace SymoCraft::Benchmark
+{
+    // One fixed physics step, the time the 120Hz steps must fit in
+    static const double kPhysicsStepBudget = 1000.0 / 120.0;
+
+    // Random player sized boxes in a box of the given size
+    static void GenerateBoxes(std::vector<Physics::AABB> &boxes, uint32 num_boxes, const glm::vec3 &area, uint32 seed)
+    {
+        std::mt19937 random_engine(seed);
+        std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+        boxes.resize(num_boxes);
+        for (Physics::AABB &box : boxes)
+        {
+            glm::vec3 center(distribution(random_engine), distribution(random_engine), distribution(random_engine));
+            center *= area;
+            box = {center - glm::vec3(0.3f, 0.9f, 0.3f), center + glm::vec3(0.3f, 0.9f, 0.3f)};
+        }
+    }
+
+    // The broadphase must find exactly the pairs the n^2 loop finds
+    static bool IsBroadphaseMatchingBruteForce()
+    {
+        constexpr uint32 kNumCheckBoxes = 2000;
+        std::vector<Physics::AABB> boxes;
+        GenerateBoxes(boxes, kNumCheckBoxes, glm::vec3(40.0f, 10.0f, 40.0f), 7);
+
+        Physics::SpatialHash broadphase;
+        broadphase.Build(boxes.data(), kNumCheckBoxes);
+        std::vector<std::pair<uint32, uint32>> pairs;
+        broadphase.FindPairs(pairs);
+        std::sort(pairs.begin(), pairs.end());
+
+        std::vector<std::pair<uint32, uint32>> expected_pairs;
+        for (uint32 i = 0; i < kNumCheckBoxes; i++)
+            for (uint32 j = i + 1; j < kNumCheckBoxes; j++)
+                if (boxes[i].IsOverlapping(boxes[j]))
+                    expected_pairs.emplace_back(i, j);
+
+        // Every query result must overlap the query box, and every overlapping box must be found
+        std::vector<uint32> ids;
+        const Physics::AABB query{glm::vec3(10.0f, 2.0f, 10.0f), glm::vec3(14.0f, 6.0f, 14.0f)};
+        broadphase.QueryAABB(query, ids);
+        uint32 num_expected_ids = 0;
+        for (const Physics::AABB &box : boxes)
+            if (box.IsOverlapping(query))
+                num_expected_ids++;
+
+        return pairs == expected_pairs && ids.size() == num_expected_ids;
+    }
+
+    void PhysicsContacts(Report &report)
+    {
+        constexpr uint32 kNumBodies = 10000;
+        constexpr int kNumSteps = 120;
+
+        if (!IsBroadphaseMatchingBruteForce())
+        {
+            AmoLogger_Error("The spatial hash broadphase does not match the brute force pairs.");
+            report.Fail();
+        }
+
+        // No chunk is loaded, so the bodies only collide with each other
+        ECS::Registry registry;
+        registry.RegisterComponent<Transform>("Transform");
+        registry.RegisterComponent<Physics::RigidBody>("RigidBody");
+        registry.RegisterComponent<Physics::HitBox>("HitBox");
+
+        std::mt19937 random_engine(42);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        for (uint32 i = 0; i < kNumBodies; i++)
+        {
+            ECS::EntityId entity = registry.CreateEntity();
+            Transform &transform = registry.AddComponent<Transform>(entity);
+            transform.position = glm::vec3(distribution(random_engine) * 50.0f, distribution(random_engine) * 5.0f,
+                                           distribution(random_engine) * 50.0f);
+            Physics::RigidBody &rb = registry.AddComponent<Physics::RigidBody>(entity);
+            rb.velocity = glm::vec3(distribution(random_engine), 0.0f, distribution(random_engine)) * 4.0f;
+            rb.use_gravity = false;
+            // A few trigger volumes among the bodies
+            rb.is_sensor = i % 100 == 0;
+            registry.AddComponent<Physics::HitBox>(entity).size = glm::vec3(0.6f, 1.8f, 0.6f);
+        }
+
+        size_t num_sensor_events = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < kNumSteps; step++)
+        {
+            Physics::Step(registry);
+            num_sensor_events += Physics::GetSensorEvents().size();
+        }
+        const double step_time = MillisecondsSince(start) / kNumSteps;
+
+        // Bodies must not be left inside each other
+        uint32 num_overlapping = 0;
+        std::vector<ECS::EntityId> nearby;
+        for (auto [entity, transform, rb, hit_box] : registry.View<const Transform, const Physics::RigidBody,
+                                                                     const Physics::HitBox>())
+        {
+            if (rb.is_sensor)
+                continue;
+            // Shrink the box a little, resting contacts touch
+            const glm::vec3 half_size = hit_box.size * 0.5f - glm::vec3(0.01f);
+            Physics::QueryAABB(transform.position - half_size, transform.position + half_size, nearby);
+            for (ECS::EntityId other : nearby)
+                if (other != entity && !registry.GetComponent<const Physics::RigidBody>(other).is_sensor)
+                    num_overlapping++;
+        }
+
+        std::vector<ECS::EntityId> in_radius;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 1000; i++)
+            Physics::QueryRadius(glm::vec3(distribution(random_engine) * 50.0f, 0.0f, distribution(random_engine) * 50.0f),
+                                 4.0f, in_radius);
+        const double query_time = MillisecondsSince(start);
+
+        report.Add("physics_contacts/step", step_time, "ms");
+        report.Add("physics_contacts/step_budget_used", step_time / kPhysicsStepBudget * 100.0, "%");
+        report.Add("physics_contacts/sensor_events_per_step", (double)num_sensor_events / kNumSteps, "");
+        report.Add("physics_contacts/overlapping_after_steps", num_overlapping, "");
+        report.Add("physics_contacts/query_radius", query_time, "us/query");
+        Physics::Clear();
+        registry.Clear();
+    }
+
+    // Time the steps of a registry
+    // return the time per step in milliseconds
+    static double TimeSteps(ECS::Registry &registry, int num_steps)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < num_steps; step++)
+            Physics::Step(registry);
+        return MillisecondsSince(start) / num_steps;
+    }
+
+    void PhysicsFalling(Report &report)
+    {
+        constexpr uint32 kNumBodies = 10000;
+        constexpr int kNumSteps = 600;
+
+        GenerateWorld();
+        ECS::Registry registry;
+        registry.RegisterComponent<Transform>("Transform");
+        registry.RegisterComponent<Physics::RigidBody>("RigidBody");
+        registry.RegisterComponent<Physics::HitBox>("HitBox");
+
+        // Spread out over the center chunks, far enough apart that they rarely land on each other
+        std::mt19937 random_engine(42);
+        std::uniform_real_distribution<float> distribution(-48.0f, 48.0f);
+        for (uint32 i = 0; i < kNumBodies; i++)
+        {
+            ECS::EntityId entity = registry.CreateEntity();
+            registry.AddComponent<Transform>(entity).position = glm::vec3(distribution(random_engine), 150.0f,
+                                                                          distribution(random_engine));
+            Physics::RigidBody &rb = registry.AddComponent<Physics::RigidBody>(entity);
+            rb.use_gravity = true;
+            // A quarter of them start at terminal velocity
+            rb.velocity = glm::vec3(0.0f, i % 4 == 0 ? -50.0f : 0.0f, 0.0f);
+            registry.AddComponent<Physics::HitBox>(entity).size = glm::vec3(0.6f, 1.8f, 0.6f);
+        }
+
+        const double step_time = TimeSteps(registry, kNumSteps);
+
+        // Every body must rest on a solid block, with no solid block inside its feet
+        uint32 num_resting = 0, num_inside = 0, num_fallen_through = 0;
+        for (auto [entity, transform, rb] : registry.View<const Transform, const Physics::RigidBody>())
+        {
+            const glm::vec3 feet = transform.position - glm::vec3(0.0f, 0.9f, 0.0f);
+            if (rb.on_ground)
+                num_resting++;
+            if (get_block(ChunkManager::GetBlock(feet + glm::vec3(0.0f, 0.01f, 0.0f)).block_id).m_is_solid)
+                num_inside++;
+            if (feet.y < 1.0f)
+                num_fallen_through++;
+        }
+
+        report.Add("physics_falling/step", step_time, "ms");
+        report.Add("physics_falling/per_body", step_time * 1e6 / kNumBodies, "ns");
+        report.Add("physics_falling/resting", num_resting, "");
+        report.Add("physics_falling/inside_blocks", num_inside, "");
+        report.Add("physics_falling/fallen_through", num_fallen_through, "");
+        Physics::Clear();
+        registry.Clear();
+        ChunkManager::FreeAllChunks();
+    }
+
+    void PhysicsSleeping(Report &report)
+    {
+        constexpr uint32 kNumBodies = 10000;
+        constexpr uint32 kAwakeCounts[] = {100, 1000, 5000};
+        constexpr int kNumSteps = 30;
+
+        GenerateWorld();
+        ECS::Registry registry;
+        registry.RegisterComponent<Transform>("Transform");
+        registry.RegisterComponent<Physics::RigidBody>("RigidBody");
+        registry.RegisterComponent<Physics::HitBox>("HitBox");
+
+        std::mt19937 random_engine(42);
+        std::uniform_real_distribution<float> distribution(-48.0f, 48.0f);
+        std::vector<ECS::EntityId> entities;
+        for (uint32 i = 0; i < kNumBodies; i++)
+        {
+            ECS::EntityId entity = registry.CreateEntity();
+            registry.AddComponent<Transform>(entity).position = glm::vec3(distribution(random_engine), 150.0f,
+                                                                          distribution(random_engine));
+            registry.AddComponent<Physics::RigidBody>(entity).use_gravity = true;
+            registry.AddComponent<Physics::HitBox>(entity).size = glm::vec3(0.6f, 1.8f, 0.6f);
+            entities.push_back(entity);
+        }
+
+        // Let them land and fall asleep
+        const double falling_time = TimeSteps(registry, 600);
+        report.Add("physics_sleeping/falling_step", falling_time, "ms");
+        report.Add("physics_sleeping/awake_after_landing", Physics::GetNumAwakeBodies(), "");
+
+        report.Add("physics_sleeping/all_asleep_step", TimeSteps(registry, kNumSteps), "ms");
+        // A step must not mark the transforms of resting bodies changed
+        const uint32 asleep_tick = registry.AdvanceChangeTick();
+        Physics::Step(registry);
+        const auto changed = registry.View<const Transform>().Changed<Transform>(asleep_tick);
+        uint32 num_changed = 0;
+        for (auto it = changed.begin(); it != changed.end(); ++it)
+            num_changed++;
+        if (num_changed > Physics::GetNumAwakeBodies())
+        {
+            AmoLogger_Error("A step marked %u transforms changed with %u bodies awake.", num_changed,
+                            Physics::GetNumAwakeBodies());
+            report.Fail();
+        }
+        // Queries over the resting crowd still find every body
+        std::vector<ECS::EntityId> found;
+        Physics::QueryAABB(glm::vec3(-64.0f, 0.0f, -64.0f), glm::vec3(64.0f, 256.0f, 64.0f), found);
+        if (found.size() != kNumBodies)
+        {
+            AmoLogger_Error("The box query over the resting bodies found %zu of %u.", found.size(), kNumBodies);
+            report.Fail();
+        }
+        Physics::QueryRadius(glm::vec3(0.0f, 128.0f, 0.0f), 256.0f, found);
+        if (found.size() != kNumBodies)
+        {
+            AmoLogger_Error("The radius query over the resting bodies found %zu of %u.", found.size(), kNumBodies);
+            report.Fail();
+        }
+        for (uint32 num_awake : kAwakeCounts)
+        {
+            // Writing a velocity wakes a body, the jump keeps them awake for the steps timed
+            for (uint32 i = 0; i < num_awake; i++)
+                registry.GetComponent<Physics::RigidBody>(entities[i * (kNumBodies / num_awake)]).velocity.y = 5.0f;
+            // Woken bodies wake the ones they touch, count the bodies that were really awake
+            uint32 num_awake_steps = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int step = 0; step < kNumSteps; step++)
+            {
+                Physics::Step(registry);
+                num_awake_steps += Physics::GetNumAwakeBodies();
+            }
+            const double step_time = MillisecondsSince(start) / kNumSteps;
+
+            const std::string prefix = "physics_sleeping/woken_" + std::to_string(num_awake);
+            report.Add(prefix + "/step", step_time, "ms");
+            report.Add(prefix + "/awake_bodies", (double)num_awake_steps / kNumSteps, "");
+            TimeSteps(registry, 600);
+        }
+
+        // Removing the block under a sleeping body must wake it and let it fall
+        const ECS::EntityId entity = entities[kNumBodies / 2];
+        const glm::vec3 feet = registry.GetComponent<const Transform>(entity).position - glm::vec3(0.0f, 0.9f, 0.0f);
+        if (!registry.GetComponent<const Physics::RigidBody>(entity).is_sleeping)
+        {
+            AmoLogger_Error("A resting body is still awake after 600 steps.");
+            report.Fail();
+        }
+        for (int x = -1; x <= 1; x++)
+            for (int z = -1; z <= 1; z++)
+                ChunkManager::RemoveBLock(feet + glm::vec3(x * 0.3f, -0.5f, z * 0.3f));
+        TimeSteps(registry, 60);
+        const float fallen = feet.y - (registry.GetComponent<const Transform>(entity).position.y - 0.9f);
+        if (fallen < 0.5f)
+        {
+            AmoLogger_Error("A body fell %f after the blocks under it were removed.", fallen);
+            report.Fail();
+        }
+        report.Add("physics_sleeping/fallen_after_block_removed", fallen, "blocks");
+
+        Physics::Clear();
+        registry.Clear();
+        ChunkManager::FreeAllChunks();
+    }
+
+    // Bodies dropped onto the terrain in a crowd, so they land on and push each other
+    static void CreateCrowd(ECS::Registry &registry, uint32 num_bodies)
+    {
+        registry.RegisterComponent<Transform>("Transform");
+        registry.RegisterComponent<Physics::RigidBody>("RigidBody");
+        registry.RegisterComponent<Physics::HitBox>("HitBox");
+
+        std::mt19937 random_engine(42);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        for (uint32 i = 0; i < num_bodies; i++)
+        {
+            ECS::EntityId entity = registry.CreateEntity();
+            registry.AddComponent<Transform>(entity).position = glm::vec3(distribution(random_engine) * 24.0f,
+                                                                          150.0f + distribution(random_engine) * 10.0f,
+                                                                          distribution(random_engine) * 24.0f);
+            Physics::RigidBody &rb = registry.AddComponent<Physics::RigidBody>(entity);
+            rb.use_gravity = true;
+            rb.velocity = glm::vec3(distribution(random_engine), 0.0f, distribution(random_engine)) * 5.0f;
+            rb.is_sensor = i % 50 == 0;
+            registry.AddComponent<Physics::HitBox>(entity).size = glm::vec3(0.6f, 1.8f, 0.6f);
+        }
+    }
+
+    // Hash of the state of every body, any bit that differs changes it
+    static uint64 HashBodies(ECS::Registry &registry)
+    {
+        uint64 hash = 14695981039346656037ull;
+        auto hash_bytes = [&hash](const void* data, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+                hash = (hash ^ ((const uint8*)data)[i]) * 1099511628211ull;
+        };
+        for (auto [entity, transform, rb] : registry.View<const Transform, const Physics::RigidBody>())
+        {
+            hash_bytes(&transform.position, sizeof(transform.position));
+            hash_bytes(&rb.velocity, sizeof(rb.velocity));
+            hash_bytes(&rb.on_ground, sizeof(rb.on_ground));
+        }
+        for (const Physics::SensorEvent &event : Physics::GetSensorEvents())
+        {
+            hash_bytes(&event.sensor, sizeof(event.sensor));
+            hash_bytes(&event.other, sizeof(event.other));
+            hash_bytes(&event.is_enter, sizeof(event.is_enter));
+        }
+        return hash;
+    }
+
+    // Run the crowd on a thread pool
+    // return the time per step in milliseconds
+    // Parameters: thread pool(nullptr for the calling thread alone), number of steps, hash of every step(out)
+    static double RunCrowd(GlobalThreadPool* thread_pool, int num_steps, std::vector<uint64> &step_hashes)
+    {
+        constexpr uint32 kNumBodies = 20000;
+
+        ECS::Registry registry;
+        CreateCrowd(registry, kNumBodies);
+        Physics::SetThreadPool(thread_pool);
+
+        step_hashes.clear();
+        double step_time = 0.0;
+        for (int step = 0; step < num_steps; step++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            Physics::Step(registry);
+            step_time += MillisecondsSince(start);
+            step_hashes.push_back(HashBodies(registry));
+        }
+
+        Physics::SetThreadPool(nullptr);
+        Physics::Clear();
+        registry.Clear();
+        return step_time / num_steps;
+    }
+
+    void PhysicsDeterminism(Report &report)
+    {
+        constexpr int kNumSteps = 240;
+        constexpr uint32 kThreadCounts[] = {1, 3, 7};
+
+        GenerateWorld();
+
+        // Record the single threaded run, then replay it on thread pools of different sizes
+        std::vector<uint64> recorded_hashes, replayed_hashes;
+        const double serial_time = RunCrowd(nullptr, kNumSteps, recorded_hashes);
+        report.Add("physics_determinism/serial_step", serial_time, "ms");
+
+        for (uint32 num_threads : kThreadCounts)
+        {
+            GlobalThreadPool thread_pool(num_threads);
+            const double step_time = RunCrowd(&thread_pool, kNumSteps, replayed_hashes);
+            thread_pool.Free();
+
+            int first_mismatch = -1;
+            for (int step = 0; step < kNumSteps && first_mismatch < 0; step++)
+                if (replayed_hashes[step] != recorded_hashes[step])
+                    first_mismatch = step;
+            if (first_mismatch >= 0)
+            {
+                AmoLogger_Error("Physics on %u worker threads left the single threaded replay at step %d.",
+                                num_threads, first_mismatch);
+                report.Fail();
+            }
+
+            const std::string prefix = "physics_determinism/threads_" + std::to_string(num_threads);
+            report.Add(prefix + "/step", step_time, "ms");
+            report.Add(prefix + "/matching_steps", first_mismatch < 0 ? kNumSteps : first_mismatch, "");
+        }
+        ChunkManager::FreeAllChunks();
+    }
+
+    // Frames of a game whose ticks cost more than they simulate, after a hitch
+    // return the longest frame in milliseconds
+    // Parameters: clock, time of the last frame in milliseconds(out)
+    static double RunHitch(SimulationClock &clock, double &last_frame_time)
+    {
+        constexpr double kRenderTime = 0.006;
+        // A tick of a crowded world, longer than the 8.3ms it simulates
+        constexpr double kTickCost = 0.009;
+        constexpr double kHitchTime = 0.25;
+        constexpr int kNumFrames = 60;
+
+        double frame_time = kHitchTime, longest_frame_time = 0.0;
+        for (int frame = 0; frame < kNumFrames; frame++)
+        {
+            const uint32 num_ticks = clock.Advance((float)frame_time);
+            frame_time = kRenderTime + num_ticks * kTickCost;
+            longest_frame_time = std::max(longest_frame_time, frame_time);
+        }
+        last_frame_time = frame_time * 1000.0;
+        return longest_frame_time * 1000.0;
+    }
+
+    void SimulationClockTicks(Report &report)
+    {
+        // Uncapped, every frame owes more ticks than the one before
+        SimulationClock uncapped_clock(kFixedTickDuration, UINT32_MAX);
+        SimulationClock capped_clock;
+        double uncapped_last_frame, capped_last_frame;
+        report.Add("simulation_clock/uncapped_longest_frame", RunHitch(uncapped_clock, uncapped_last_frame), "ms");
+        report.Add("simulation_clock/uncapped_last_frame", uncapped_last_frame, "ms");
+        report.Add("simulation_clock/capped_longest_frame", RunHitch(capped_clock, capped_last_frame), "ms");
+        report.Add("simulation_clock/capped_last_frame", capped_last_frame, "ms");
+        report.Add("simulation_clock/capped_dropped_ticks", (double)capped_clock.GetNumDroppedTicks(), "ticks");
+
+        // A body moving at a constant speed, drawn at jittering frame times
+        // Drawn at its last tick it stutters, interpolated it moves at the same speed every frame
+        constexpr float kSpeed = 5.0f;
+        constexpr int kNumFrames = 10000;
+        SimulationClock clock;
+        std::mt19937 random_engine(42);
+        std::uniform_real_distribution<float> distribution(0.010f, 0.022f);
+        float previous_position = 0.0f, current_position = 0.0f;
+        float last_drawn = 0.0f, last_interpolated = 0.0f;
+        double drawn_error = 0.0, interpolated_error = 0.0;
+        for (int frame = 0; frame < kNumFrames; frame++)
+        {
+            const float delta_time = distribution(random_engine);
+            const uint32 num_ticks = clock.Advance(delta_time);
+            for (uint32 tick = 0; tick < num_ticks; tick++)
+            {
+                previous_position = current_position;
+                current_position += kSpeed * clock.GetTickDuration();
+            }
+            const float interpolated = glm::mix(previous_position, current_position, clock.GetAlpha());
+            if (clock.GetAlpha() < 0.0f || clock.GetAlpha() >= 1.0f)
+            {
+                AmoLogger_Error("Interpolation alpha %f is out of [0, 1).", clock.GetAlpha());
+                report.Fail();
+            }
+
+            // Skip the first frames, the body starts at rest
+            if (frame >= 10)
+            {
+                const double drawn_speed = (current_position - last_drawn) / delta_time;
+                const double interpolated_speed = (interpolated - last_interpolated) / delta_time;
+                drawn_error += (drawn_speed - kSpeed) * (drawn_speed - kSpeed);
+                interpolated_error += (interpolated_speed - kSpeed) * (interpolated_speed - kSpeed);
+            }
+            last_drawn = current_position;
+            last_interpolated = interpolated;
+        }
+        report.Add("simulation_clock/speed_error_last_tick", std::sqrt(drawn_error / (kNumFrames - 10)), "m/s");
+        report.Add("simulation_clock/speed_error_interpolated", std::sqrt(interpolated_error / (kNumFrames - 10)), "m/s");
+    }
+
+    // Rays from random points above the terrain in random directions
+    static void GenerateRays(std::vector<glm::vec3> &origins, std::vector<glm::vec3> &directions, uint32 num_rays)
+    {
+        std::mt19937 random_engine(42);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        origins.resize(num_rays);
+        directions.resize(num_rays);
+        for (uint32 i = 0; i < num_rays; i++)
+        {
+            origins[i] = glm::vec3(distribution(random_engine) * 150.0f, 100.0f + distribution(random_engine) * 40.0f,
+                                   distribution(random_engine) * 150.0f);
+            glm::vec3 direction;
+            do
+                direction = glm::vec3(distribution(random_engine), distribution(random_engine), distribution(random_engine));
+            while (glm::length2(direction) > 1.0f || glm::length2(direction) < 0.01f);
+            directions[i] = glm::normalize(direction);
+        }
+    }
+
+    void PhysicsRaycast(Report &report)
+    {
+        constexpr uint32 kNumRays = 200000;
+        constexpr float kMaxDistance = 32.0f;
+
+        GenerateWorld();
+        std::vector<glm::vec3> origins, directions;
+        GenerateRays(origins, directions, kNumRays);
+
+        uint32 num_hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < kNumRays; i++)
+            num_hits += Physics::RayCastStatic(origins[i], directions[i], kMaxDistance).hit ? 1 : 0;
+        const double single_time = MillisecondsSince(start);
+
+        std::vector<Physics::Ray> rays(kNumRays);
+        for (uint32 i = 0; i < kNumRays; i++)
+            rays[i] = {origins[i], directions[i], kMaxDistance};
+        std::vector<RaycastStaticResult> results(kNumRays);
+        start = std::chrono::steady_clock::now();
+        Physics::RayCastMany(rays.data(), kNumRays, results.data());
+        const double batch_time = MillisecondsSince(start);
+
+        // The batch must give the same results as single rays, and every hit must lie on the face it reports
+        uint32 num_mismatches = 0, num_bad_hits = 0;
+        for (uint32 i = 0; i < kNumRays; i++)
+        {
+            const RaycastStaticResult single = Physics::RayCastStatic(origins[i], directions[i], kMaxDistance);
+            const RaycastStaticResult& batch = results[i];
+            if (single.hit != batch.hit || (single.hit && (single.block_position != batch.block_position
+                                                           || single.hit_normal != batch.hit_normal)))
+                num_mismatches++;
+            if (!batch.hit)
+                continue;
+
+            const glm::vec3 face_center = batch.block_center + batch.hit_normal * 0.5f;
+            const glm::vec3 offset = glm::abs(batch.point - face_center);
+            if (glm::abs(glm::dot(offset, batch.hit_normal)) > 0.001f || std::max({offset.x, offset.y, offset.z}) > 0.501f
+                || batch.distance > kMaxDistance)
+                num_bad_hits++;
+        }
+        if (num_mismatches != 0)
+        {
+            AmoLogger_Error("%u batched rays differ from single rays", num_mismatches);
+            report.Fail();
+        }
+        if (num_bad_hits != 0)
+        {
+            AmoLogger_Error("%u hits are not on the face they report", num_bad_hits);
+            report.Fail();
+        }
+
+        report.Add("physics_raycast/single", kNumRays / single_time * 1000.0, "rays/s");
+        report.Add("physics_raycast/batched", kNumRays / batch_time * 1000.0, "rays/s");
+        report.Add("physics_raycast/hits", num_hits, "");
+        ChunkManager::FreeAllChunks();
+    }
+
+    // Nearest box along a ray by testing every box
+    // return the distance, or max_distance when nothing is hit
+    static float CastRayBruteForce(const std::vector<Physics::AABB> &boxes, const glm::vec3 &origin,
+                                   const glm::vec3 &direction, float max_distance)
+    {
+        const glm::vec3 inverse_direction = 1.0f / direction;
+        float nearest = max_distance, distance;
+        for (const Physics::AABB &box : boxes)
+            if (Physics::IntersectRay(box, origin, inverse_direction, nearest, distance))
+                nearest = distance;
+        return nearest;
+    }
+
+    // Nearest box along a ray through the tree, with the boxes the tree was built from
+    static float CastRayTree(const Physics::AABBTree &tree, const std::vector<Physics::AABB> &boxes,
+                             const glm::vec3 &origin, const glm::vec3 &direction, float max_distance)
+    {
+        const glm::vec3 inverse_direction = 1.0f / direction;
+        float nearest = max_distance;
+        tree.RayCast(origin, direction, max_distance, [&](int32 proxy, float distance_limit)
+        {
+            float distance;
+            if (!Physics::IntersectRay(boxes[tree.GetUserData(proxy)], origin, inverse_direction, distance_limit, distance))
+                return distance_limit;
+            nearest = distance;
+            return distance;
+        });
+        return nearest;
+    }
+
+    // Rays and queries against a tree of num_boxes boxes
+    // return the microseconds per ray
+    static double TimeTreeRays(Report &report, uint32 num_boxes, bool is_checked)
+    {
+        constexpr uint32 kNumRays = 20000;
+        constexpr float kMaxDistance = 64.0f;
+        const std::string prefix = "physics_entity_queries/" + std::to_string(num_boxes / 1000) + "k";
+        // The same density of boxes at every size
+        const float side = glm::sqrt((float)num_boxes) * 2.0f;
+
+        std::vector<Physics::AABB> boxes;
+        GenerateBoxes(boxes, num_boxes, glm::vec3(side, 16.0f, side), 11);
+        Physics::AABBTree tree;
+        // Proxy ids are node ids, the internal nodes take ids too
+        std::vector<int32> box_proxies(num_boxes);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < num_boxes; i++)
+            box_proxies[i] = tree.CreateProxy(boxes[i], i);
+        report.Add(prefix + "/insert_all", MillisecondsSince(start), "ms");
+        report.Add(prefix + "/height", tree.GetHeight(), "levels");
+
+        std::mt19937 random_engine(5);
+        std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+        std::vector<glm::vec3> origins(kNumRays), directions(kNumRays);
+        for (uint32 i = 0; i < kNumRays; i++)
+        {
+            origins[i] = glm::vec3(distribution(random_engine) * side, distribution(random_engine) * 16.0f,
+                                   distribution(random_engine) * side);
+            directions[i] = glm::normalize(glm::vec3(distribution(random_engine), distribution(random_engine),
+                                                     distribution(random_engine)) - glm::vec3(0.5f));
+        }
+
+        double total_distance = 0.0;
+        start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < kNumRays; i++)
+            total_distance += CastRayTree(tree, boxes, origins[i], directions[i], kMaxDistance);
+        const double ray_time = MillisecondsSince(start) * 1000.0 / kNumRays;
+        report.Add(prefix + "/ray", ray_time, "us");
+        // Reported so the rays can't be optimized away
+        report.Add(prefix + "/ray_checksum", total_distance, "blocks");
+        if (!is_checked)
+            return ray_time;
+
+        // Brute force on a part of the rays, the nearest hit must be the same
+        constexpr uint32 kNumCheckRays = 500;
+        uint32 num_mismatches = 0;
+        start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < kNumCheckRays; i++)
+            if (CastRayBruteForce(boxes, origins[i], directions[i], kMaxDistance)
+                != CastRayTree(tree, boxes, origins[i], directions[i], kMaxDistance))
+                num_mismatches++;
+        report.Add(prefix + "/ray_brute_force", MillisecondsSince(start) * 1000.0 / kNumCheckRays, "us");
+
+        // Move a tenth of the boxes a little every frame, most stay inside their fattened boxes
+        constexpr uint32 kNumFrames = 60;
+        std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+        uint32 num_reinserted = 0;
+        start = std::chrono::steady_clock::now();
+        for (uint32 frame = 0; frame < kNumFrames; frame++)
+            for (uint32 i = frame % 10; i < num_boxes; i += 10)
+            {
+                const glm::vec3 offset(step(random_engine), step(random_engine), step(random_engine));
+                boxes[i] = {boxes[i].min + offset, boxes[i].max + offset};
+                num_reinserted += tree.MoveProxy(box_proxies[i], boxes[i]) ? 1 : 0;
+            }
+        report.Add(prefix + "/move_tenth_per_frame", MillisecondsSince(start) / kNumFrames, "ms");
+        report.Add(prefix + "/reinserted_per_frame", (double)num_reinserted / kNumFrames, "proxies");
+        for (uint32 i = 0; i < kNumCheckRays; i++)
+            if (CastRayBruteForce(boxes, origins[i], directions[i], kMaxDistance)
+                != CastRayTree(tree, boxes, origins[i], directions[i], kMaxDistance))
+                num_mismatches++;
+        if (num_mismatches != 0)
+        {
+            AmoLogger_Error("%u tree rays differ from brute force rays.", num_mismatches);
+            report.Fail();
+        }
+
+        // A camera in the middle of the boxes, the tree finds a superset of the boxes in the frustum
+        const glm::vec3 eye(side * 0.5f, 8.0f, side * 0.5f);
+        const Physics::Frustum frustum = Physics::Frustum::FromMatrix(
+                glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 64.0f)
+                * glm::lookAt(eye, eye + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        constexpr uint32 kNumFrustumQueries = 100;
+        std::vector<int32> proxies;
+        start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < kNumFrustumQueries; i++)
+            tree.QueryFrustum(frustum, proxies);
+        report.Add(prefix + "/frustum", MillisecondsSince(start) * 1000.0 / kNumFrustumQueries, "us");
+        uint32 num_in_frustum = 0, num_missed = 0;
+        std::vector<bool> is_found(num_boxes, false);
+        for (int32 proxy : proxies)
+            is_found[tree.GetUserData(proxy)] = true;
+        for (uint32 i = 0; i < num_boxes; i++)
+            if (frustum.IsOverlapping(boxes[i]))
+            {
+                num_in_frustum++;
+                num_missed += is_found[i] ? 0 : 1;
+            }
+        report.Add(prefix + "/in_frustum", num_in_frustum, "boxes");
+        if (num_missed != 0)
+        {
+            AmoLogger_Error("The frustum query missed %u of %u boxes.", num_missed, num_in_frustum);
+            report.Fail();
+        }
+
+        // Every proxy removed must leave a valid empty tree
+        for (uint32 i = 0; i < num_boxes; i++)
+            tree.DestroyProxy(box_proxies[i]);
+        if (tree.NumProxies() != 0 || tree.GetHeight() != 0)
+        {
+            AmoLogger_Error("The tree is not empty after destroying every proxy.");
+            report.Fail();
+        }
+        return ray_time;
+    }
+
+    void PhysicsEntityQueries(Report &report)
+    {
+        constexpr uint32 kNumEntities = 50000;
+        constexpr uint32 kNumRemoved = 10;
+
+        // Ten times the boxes should cost a few more levels, not ten times the time
+        const double small_ray_time = TimeTreeRays(report, kNumEntities / 10, false);
+        const double ray_time = TimeTreeRays(report, kNumEntities, true);
+        report.Add("physics_entity_queries/ray_time_ratio_50k_to_5k", ray_time / small_ray_time, "x");
+
+        // Entities through the physics system, no chunk is loaded and no entity has a rigid body
+        ECS::Registry registry;
+        registry.RegisterComponent<Transform>("Transform");
+        registry.RegisterComponent<Physics::RigidBody>("RigidBody");
+        registry.RegisterComponent<Physics::HitBox>("HitBox");
+        std::vector<ECS::EntityId> entities;
+        for (uint32 i = 0; i < kNumEntities; i++)
+        {
+            ECS::EntityId entity = registry.CreateEntity();
+            // A row of entities along x, 2 blocks apart
+            registry.AddComponent<Transform>(entity).position = glm::vec3((float)i * 2.0f, 0.0f, 0.0f);
+            registry.AddComponent<Physics::HitBox>(entity).size = glm::vec3(0.6f, 1.8f, 0.6f);
+            entities.push_back(entity);
+        }
+
+        // The tree catches up with the steps on the first query after them
+        auto start = std::chrono::steady_clock::now();
+        Physics::Step(registry);
+        Physics::GetNumEntityTreeProxies();
+        report.Add("physics_entity_queries/first_update", MillisecondsSince(start), "ms");
+        start = std::chrono::steady_clock::now();
+        Physics::Step(registry);
+        Physics::GetNumEntityTreeProxies();
+        report.Add("physics_entity_queries/still_update", MillisecondsSince(start), "ms");
+
+        // Looking down the row from the first entity, its own box is skipped
+        const glm::vec3 eye(0.0f, 0.5f, 0.0f);
+        RaycastEntityResult result = Physics::RayCastEntities(eye, glm::vec3(1.0f, 0.0f, 0.0f), 10.0f, entities[0]);
+        if (!result.hit || result.entity != entities[1] || glm::abs(result.distance - 1.7f) > 0.001f
+            || result.hit_normal != glm::vec3(-1.0f, 0.0f, 0.0f))
+        {
+            AmoLogger_Error("The ray along the row did not hit the second entity.");
+            report.Fail();
+        }
+
+        // Destroyed entities leave the tree, the segment passes where they were
+        for (uint32 i = 1; i <= kNumRemoved; i++)
+            registry.DestroyEntity(entities[i]);
+        Physics::Step(registry);
+        if (Physics::GetNumEntityTreeProxies() != kNumEntities - kNumRemoved)
+        {
+            AmoLogger_Error("The entity tree has %u proxies, %u entities are left.", Physics::GetNumEntityTreeProxies(),
+                            kNumEntities - kNumRemoved);
+            report.Fail();
+        }
+        result = Physics::SegmentCastEntities(eye, glm::vec3(1000.0f, 0.5f, 0.0f), entities[0]);
+        if (!result.hit || result.entity != entities[kNumRemoved + 1])
+        {
+            AmoLogger_Error("The segment along the row did not hit the first entity left.");
+            report.Fail();
+        }
+
+        std::vector<ECS::EntityId> visible;
+        const Physics::Frustum frustum = Physics::Frustum::FromMatrix(
+                glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 64.0f)
+                * glm::lookAt(eye, eye + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        Physics::QueryFrustum(frustum, eye, visible);
+        // The first entity holds the eye, the next is the first one left
+        if (visible.size() < 2 || visible[0] != entities[0] || visible[1] != entities[kNumRemoved + 1])
+        {
+            AmoLogger_Error("The frustum query did not return the entities nearest first.");
+            report.Fail();
+        }
+
+        Physics::Clear();
+    }
+}
@@ -0,0 +1,166 @@
+//
+// Created by Amo on 2022/7/21.
+//
+
+#include "benchmark/benchmark.h"
+#include "renderer/render_device.h"
+#include "renderer/shader_program.h"
+#include "renderer/texture.h"
+#include "renderer/texture_cache.h"
+
+namespace SymoCraft::Benchmark
+{
+    void UniformLookup(Report &report)
+    {
+        RenderDevice::Init(RenderBackend::Null);
+        auto &device = static_cast<NullRenderDevice&>(RenderDevice::Get());
+
+        ShaderProgram shader{};
+        if (!shader.CompileAndLink("../assets/shaders/vs_BlockShader.glsl", "../assets/shaders/fs_BlockShader.glsl"))
+        {
+            report.Fail();
+            RenderDevice::Free();
+            return;
+        }
+        shader.Bind();
+
+        constexpr uint32 kNumUploads = 1000000;
+        constexpr uint32 kLogClearInterval = 4096;    // Keep the command log small, like a frame does
+
+        // Look the location up by name on every upload
+        auto start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < kNumUploads; i++)
+        {
+            shader.UploadInt("u_texture_array", 0);
+            if (i % kLogClearInterval == 0)
+                device.ClearCommandLog();
+        }
+        double name_lookup_time = MillisecondsSince(start);
+
+        // Resolve once, then upload through the handle
+        constexpr uint32 kTextureArrayUniform = HashUniformName("u_texture_array");
+        UniformHandle<int> handle = shader.GetUniformHandle<int>(kTextureArrayUniform);
+        start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < kNumUploads; i++)
+        {
+            shader.Upload(handle, 0);
+            if (i % kLogClearInterval == 0)
+                device.ClearCommandLog();
+        }
+        double handle_time = MillisecondsSince(start);
+
+        report.Add("uniforms/name_lookup_upload", name_lookup_time * 1e6 / kNumUploads, "ns");
+        report.Add("uniforms/handle_upload", handle_time * 1e6 / kNumUploads, "ns");
+        report.Add("uniforms/handle_valid", handle.IsValid() ? 1.0 : 0.0, "");
+
+        shader.Unbind();
+        shader.Destroy();
+        RenderDevice::Free();
+    }
+
+    // Count texels of the cache that differ from slicing the atlas and box filtering it texel by texel
+    static uint64 CountCacheMismatches(std::string_view atlas_filepath, const TextureCache::MappedTextureCache& cache)
+    {
+        const TextureCache::TextureCacheHeader& header = *cache.header;
+        int atlas_width, atlas_height, channel_amount;
+        stbi_set_flip_vertically_on_load(true);
+        uint8* atlas = stbi_load(atlas_filepath.data(), &atlas_width, &atlas_height, &channel_amount, 4);
+        if (!atlas)
+            return UINT64_MAX;
+
+        uint64 mismatches = 0;
+        uint32 tile_columns = atlas_width / header.tile_width;
+        std::vector<uint8> level((size_t)header.tile_width * header.tile_height * 4), next_level(level.size());
+        for (uint32 layer = 0; layer < header.layer_count; layer++)
+        {
+            uint32 x_coord = (layer % tile_columns) * header.tile_width,
+                   y_coord = (layer / tile_columns) * header.tile_height;
+            for (uint32 y = 0; y < header.tile_height; y++)
+                std::memcpy(&level[(size_t)y * header.tile_width * 4],
+                            atlas + ((size_t)(y_coord + y) * atlas_width + x_coord) * 4, header.tile_width * 4);
+
+            for (uint32 mip = 0; mip < header.level_count; mip++)
+            {
+                glm::ivec2 size = TextureCache::GetLevelSize(header, mip);
+                size_t layer_size = (size_t)size.x * size.y * 4;
+                const uint8* cached = cache.pixels + TextureCache::GetLevelOffset(header, mip) + layer * layer_size;
+                for (size_t i = 0; i < layer_size; i += 4)
+                    mismatches += std::memcmp(cached + i, &level[i], 4) != 0;
+
+                // Reference 2x2 box filter
+                glm::ivec2 next_size = TextureCache::GetLevelSize(header, mip + 1);
+                for (int y = 0; y < next_size.y; y++)
+                    for (int x = 0; x < next_size.x; x++)
+                        for (int channel = 0; channel < 4; channel++)
+                        {
+                            auto texel = [&](int tx, int ty){
+                                tx = std::min(tx, size.x - 1);
+                                ty = std::min(ty, size.y - 1);
+                                return (int)level[((size_t)ty * size.x + tx) * 4 + channel];
+                            };
+                            next_level[((size_t)y * next_size.x + x) * 4 + channel] =
+                                    (uint8)((texel(2 * x, 2 * y) + texel(2 * x + 1, 2 * y)
+                                             + texel(2 * x, 2 * y + 1) + texel(2 * x + 1, 2 * y + 1) + 2) >> 2);
+                        }
+                std::swap(level, next_level);
+            }
+        }
+        stbi_image_free(atlas);
+        return mismatches;
+    }
+
+    void TextureCacheLoad(Report &report)
+    {
+        constexpr std::string_view atlas_filepath = "../assets/textures/texture_atlas.png";
+        std::string cache_filepath = (std::filesystem::temp_directory_path() / "symocraft_bench.texcache").string();
+        RenderDevice::Init(RenderBackend::Null);
+        RenderDevice& device = RenderDevice::Get();
+
+        auto start = std::chrono::steady_clock::now();
+        if (!TextureCache::Cook(atlas_filepath, cache_filepath, 64, 64))
+        {
+            report.Fail();
+            RenderDevice::Free();
+            return;
+        }
+        report.Add("texture_cache/cook", MillisecondsSince(start), "ms");
+
+        // Startup path before the cache, PNG decode and RGBA32F
+        TextureArray texture_array;
+        device.ResetStats();
+        start = std::chrono::steady_clock::now();
+        TextureArray sliced = texture_array.CreateAtlasSlice(atlas_filepath, true);
+        report.Add("texture_cache/png_slice_load", MillisecondsSince(start), "ms");
+        report.Add("texture_cache/png_slice_uploaded", (double)device.GetStats().bytes_uploaded, "B");
+        report.Add("texture_cache/png_slice_vram", (double)sliced.layer_amount * 64 * 64 * 16, "B");
+
+        // Startup path with the cache, mapped and RGBA8 with mipmaps
+        device.ResetStats();
+        start = std::chrono::steady_clock::now();
+        TextureArray cached = texture_array.CreateFromCache(atlas_filepath, cache_filepath, true);
+        report.Add("texture_cache/cached_load", MillisecondsSince(start), "ms");
+        report.Add("texture_cache/cached_vram", (double)device.GetStats().bytes_uploaded, "B");
+        report.Add("texture_cache/layers", (double)cached.layer_amount, "");
+
+        TextureCache::MappedTextureCache cache;
+        if (!TextureCache::Map(cache_filepath, cache))
+            report.Fail();
+        else
+        {
+            report.Add("texture_cache/file_size", (double)cache.file_size, "B");
+            const uint64 num_mismatches = CountCacheMismatches(atlas_filepath, cache);
+            report.Add("texture_cache/mismatched_texels", (double)num_mismatches, "");
+            if (num_mismatches != 0)
+            {
+                AmoLogger_Error("The texture cache doesn't match the atlas it was cooked from.");
+                report.Fail();
+            }
+            TextureCache::Unmap(cache);
+        }
+
+        device.DestroyTexture(sliced.m_texture_Id);
+        device.DestroyTexture(cached.m_texture_Id);
+        std::filesystem::remove(cache_filepath);
+        RenderDevice::Free();
+    }
+}
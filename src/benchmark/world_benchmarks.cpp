@@ -0,0 +1,451 @@
+//
+// Created by Amo on 2022/7/20.
+//
+
+#include "benchmark/benchmark.h"
+#include "world/chunk.h"
+#include "world/world.h"
+#include "world/fluid.h"
+#include "world/block_tick.h"
+#include "world/neighbor_update.h"
+#include "core/constants.h"
+#include "core/simulation_clock.h"
+
+namespace SymoCraft::Benchmark
+{
+    void GenerateWorld()
+    {
+        LoadBlocks("../assets/configs/blockFormats.yaml");
+        InitializeNoise();
+        for(int x = -World::chunk_radius; x <= World::chunk_radius; x++)
+            for(int z = -World::chunk_radius; z <= World::chunk_radius; z++)
+                ChunkManager::CreateChunk({x, z});
+
+        for (auto &pair : ChunkManager::GetAllChunks())
+        {
+            pair.second.GenerateTerrain();
+            pair.second.GenerateVegetation();
+        }
+        ChunkManager::RearrangeChunkNeighborPointers();
+    }
+
+    static int GetRing(const glm::ivec2 &chunk_coord)
+    {
+        return std::max(glm::abs(chunk_coord.x), glm::abs(chunk_coord.y));
+    }
+
+    void LodRings(Report &report)
+    {
+        GenerateWorld();
+        auto &chunks = ChunkManager::GetAllChunks();
+        std::vector<uint64> full_detail_vertices(World::chunk_radius + 1, 0);
+        std::vector<uint64> lod_vertices(World::chunk_radius + 1, 0);
+        std::vector<uint32> ring_chunks(World::chunk_radius + 1, 0);
+
+        // Full detail meshes
+        auto start = std::chrono::steady_clock::now();
+        for (auto &pair : chunks)
+        {
+            pair.second.GenerateRenderData();
+            full_detail_vertices[GetRing(pair.first)] += pair.second.m_vertex_count;
+            ring_chunks[GetRing(pair.first)]++;
+        }
+        report.Add("lod/full_detail_mesh_time", MillisecondsSince(start), "ms");
+
+        // Meshes at the level of detail picked for a camera in the center chunk
+        start = std::chrono::steady_clock::now();
+        ChunkManager::UpdateLodLevels(glm::vec3(8.0f, 140.0f, 8.0f));
+        ChunkManager::UpdateAllChunks();
+        report.Add("lod/lod_mesh_time", MillisecondsSince(start), "ms");
+        for (auto &pair : chunks)
+            lod_vertices[GetRing(pair.first)] += pair.second.m_vertex_count;
+
+        uint64 total_full_detail = 0, total_lod = 0;
+        for (int ring = 0; ring <= World::chunk_radius; ring++)
+        {
+            std::string prefix = "lod/ring_" + std::to_string(ring);
+            report.Add(prefix + "/chunks", ring_chunks[ring], "chunks");
+            report.Add(prefix + "/lod_level", World::GetLodLevel({ring, 0}, {0, 0}), "level");
+            report.Add(prefix + "/full_detail_vertices", (double)full_detail_vertices[ring], "vertices");
+            report.Add(prefix + "/lod_vertices", (double)lod_vertices[ring], "vertices");
+            total_full_detail += full_detail_vertices[ring];
+            total_lod += lod_vertices[ring];
+        }
+        report.Add("lod/total_full_detail_vertices", (double)total_full_detail, "vertices");
+        report.Add("lod/total_lod_vertices", (double)total_lod, "vertices");
+
+        ChunkManager::FreeAllChunks();
+    }
+
+    // A stone basin full of water sources high above the terrain, inside x and z in [-24, 24), y in [170, 180)
+    // Written to the chunks directly, the fluid is not activated
+    static void BuildReservoir()
+    {
+        constexpr uint16 kStoneBlockId = 5;
+        for (int x = -25; x <= 24; x++)
+            for (int z = -25; z <= 24; z++)
+                for (int y = 169; y < 180; y++)
+                {
+                    const bool is_wall = y == 169 || x == -25 || x == 24 || z == -25 || z == 24;
+                    const glm::vec3 position(x, y, z);
+                    ChunkManager::GetChunk(position)->SetWorldBlock(position, is_wall ? kStoneBlockId : Fluid::kWaterBlockId);
+                }
+    }
+
+    // Dry up the flowing water, the generated and the reservoir water are sources
+    static void RemoveFlowingWater()
+    {
+        for (auto &pair : ChunkManager::GetAllChunks())
+            for (int x = 0; x < k_chunk_length; x++)
+                for (int y = 0; y < k_chunk_height; y++)
+                    for (int z = 0; z < k_chunk_width; z++)
+                    {
+                        Block &block = pair.second.GetLocalBlockInChunk(x, y, z);
+                        if (block.block_id != Fluid::kWaterBlockId || block.GetFluidLevel() == 0)
+                            continue;
+                        block.block_id = BlockConstants::AIR_BLOCK.block_id;
+                        block.SetTransparency(true);
+                        block.SetBlendability(false);
+                        block.SetFluidLevel(0);
+                    }
+    }
+
+    // Flowing water that nothing feeds should have dried up
+    static uint32 CountUnfedWater()
+    {
+        uint32 num_unfed = 0;
+        for (auto &pair : ChunkManager::GetAllChunks())
+            for (int x = 0; x < k_chunk_length; x++)
+                for (int y = 1; y < k_chunk_height - 1; y++)
+                    for (int z = 0; z < k_chunk_width; z++)
+                    {
+                        const Block &block = pair.second.GetLocalBlockInChunk(x, y, z);
+                        if (block.block_id != Fluid::kWaterBlockId || block.GetFluidLevel() == 0)
+                            continue;
+
+                        const glm::vec3 position(pair.first.x * k_chunk_length + x, y, pair.first.y * k_chunk_width + z);
+                        bool is_fed = ChunkManager::GetBlock(position + glm::vec3(0.0f, 1.0f, 0.0f)).block_id == Fluid::kWaterBlockId;
+                        for (const glm::vec3 side : {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)})
+                        {
+                            const Block neighbor = ChunkManager::GetBlock(position + side);
+                            is_fed |= neighbor.block_id == Fluid::kWaterBlockId && neighbor.GetFluidLevel() < block.GetFluidLevel();
+                        }
+                        num_unfed += is_fed ? 0 : 1;
+                    }
+        return num_unfed;
+    }
+
+    // Break the floor of the reservoir and run 120Hz ticks until the water settles
+    static void RunBreach(Report &report, const std::string &prefix, uint32 cells_per_tick)
+    {
+        constexpr uint32 kMaxTicks = 120 * 120;
+
+        Fluid::Clear();
+        Fluid::SetCellsPerTick(cells_per_tick);
+        // Breaking blocks goes through the chunk manager, like the player does
+        for (int x = -24; x < 24; x++)
+            for (int z = -24; z < 24; z++)
+                ChunkManager::RemoveBLock(glm::vec3(x, 169.0f, z));
+        NeighborUpdate::Tick();
+
+        SimulationClock clock;
+        double total_time = 0.0, longest_tick_time = 0.0;
+        uint64 num_changed_cells = 0, num_remeshed_chunks = 0;
+        uint32 num_ticks = 0, most_cells_updated = 0;
+        while (Fluid::GetNumActiveCells() > 0 && num_ticks < kMaxTicks)
+        {
+            clock.Advance(kFixedTickDuration);
+            auto start = std::chrono::steady_clock::now();
+            const Fluid::TickStats stats = Fluid::Tick(clock.GetTick());
+            const double tick_time = MillisecondsSince(start);
+
+            total_time += tick_time;
+            longest_tick_time = std::max(longest_tick_time, tick_time);
+            most_cells_updated = std::max(most_cells_updated, stats.num_updated_cells);
+            num_changed_cells += stats.num_changed_cells;
+            num_remeshed_chunks += stats.num_remeshed_chunks;
+            num_ticks++;
+        }
+
+        if (Fluid::GetNumActiveCells() > 0)
+        {
+            AmoLogger_Error("The water is still flowing after %u ticks.", num_ticks);
+            report.Fail();
+        }
+        if (most_cells_updated > cells_per_tick)
+        {
+            AmoLogger_Error("A tick updated %u cells, over the budget of %u.", most_cells_updated, cells_per_tick);
+            report.Fail();
+        }
+        const uint32 num_unfed = CountUnfedWater();
+        if (num_unfed != 0)
+        {
+            AmoLogger_Error("%u flowing water blocks are not fed by any water.", num_unfed);
+            report.Fail();
+        }
+
+        report.Add(prefix + "/ticks_to_settle", num_ticks, "ticks");
+        report.Add(prefix + "/average_tick", total_time / std::max(num_ticks, 1u), "ms");
+        report.Add(prefix + "/longest_tick", longest_tick_time, "ms");
+        report.Add(prefix + "/most_cells_in_a_tick", most_cells_updated, "cells");
+        report.Add(prefix + "/changed_cells", (double)num_changed_cells, "cells");
+        report.Add(prefix + "/remeshed_chunks", (double)num_remeshed_chunks, "chunks");
+    }
+
+    void FluidBreach(Report &report)
+    {
+        GenerateWorld();
+
+        BuildReservoir();
+        RunBreach(report, "fluid_breach/budget_" + std::to_string(Fluid::kDefaultCellsPerTick), Fluid::kDefaultCellsPerTick);
+
+        // The same breach again, every active cell updated in its tick
+        RemoveFlowingWater();
+        BuildReservoir();
+        RunBreach(report, "fluid_breach/unbounded", UINT32_MAX);
+
+        Fluid::SetCellsPerTick(Fluid::kDefaultCellsPerTick);
+        Fluid::Clear();
+        ChunkManager::FreeAllChunks();
+    }
+
+    // Tickable counts kept by SetLocalBlock that differ from a count from scratch
+    static uint32 CountStaleTickableSections()
+    {
+        uint32 num_stale = 0;
+        for (auto &pair : ChunkManager::GetAllChunks())
+        {
+            const std::array<uint16, k_num_sections> kept_counts = pair.second.m_tickable_counts;
+            pair.second.CountTickableBlocks();
+            for (uint32 section = 0; section < k_num_sections; section++)
+                num_stale += kept_counts[section] != pair.second.m_tickable_counts[section] ? 1 : 0;
+        }
+        return num_stale;
+    }
+
+    static constexpr uint16 kSandBlockId = 3;
+
+    // Sand stops on the first block below it that is neither air nor water
+    static int FindSandGround(int x, int z, int bottom)
+    {
+        int ground = bottom - 1;
+        while (ground > 0)
+        {
+            const uint16 block_id = ChunkManager::GetBlock(glm::vec3(x, ground, z)).block_id;
+            if (block_id != BlockConstants::AIR_BLOCK.block_id && block_id != Fluid::kWaterBlockId)
+                break;
+            ground--;
+        }
+        return ground;
+    }
+
+    // Whether a column of sand blocks rests on the ground with only air above it, up to top
+    static bool IsSandLanded(int x, int z, int ground, int height, int top)
+    {
+        for (int y = ground + 1; y < top; y++)
+            if ((ChunkManager::GetBlock(glm::vec3(x, y, z)).block_id == kSandBlockId) != (y <= ground + height))
+                return false;
+        return true;
+    }
+
+    // Drop a pillar of sand into the air and run ticks until it lands
+    static void RunSandPillar(Report &report)
+    {
+        constexpr int kPillarBottom = 180, kPillarHeight = 64;
+        constexpr uint32 kMaxTicks = 120 * 60;
+
+        // Placing goes through the chunk manager, like the player does
+        for (int y = kPillarBottom; y < kPillarBottom + kPillarHeight; y++)
+            ChunkManager::SetBlock(glm::vec3(0.0f, y, 0.0f), kSandBlockId);
+        const int ground = FindSandGround(0, 0, kPillarBottom);
+
+        uint32 num_ticks = 0;
+        uint64 num_scheduled_ticks = 0;
+        auto start = std::chrono::steady_clock::now();
+        while ((BlockTick::GetNumScheduledTicks() > 0 || NeighborUpdate::GetNumQueued() > 0) && num_ticks < kMaxTicks)
+        {
+            NeighborUpdate::Tick();
+            num_scheduled_ticks += BlockTick::Tick(++num_ticks).num_scheduled_ticks;
+        }
+        report.Add("block_ticks/sand_pillar_time", MillisecondsSince(start), "ms");
+        report.Add("block_ticks/sand_pillar_ticks", num_ticks, "ticks");
+        report.Add("block_ticks/sand_pillar_scheduled_ticks", (double)num_scheduled_ticks, "ticks");
+
+        if (BlockTick::GetNumScheduledTicks() > 0)
+        {
+            AmoLogger_Error("The sand is still falling after %u ticks.", num_ticks);
+            report.Fail();
+        }
+        if (!IsSandLanded(0, 0, ground, kPillarHeight, kPillarBottom + kPillarHeight))
+        {
+            AmoLogger_Error("The sand did not land as a pillar on the ground at y = %d.", ground);
+            report.Fail();
+        }
+    }
+
+    void BlockTicks(Report &report)
+    {
+        constexpr uint32 kRounds = 200;
+        GenerateWorld();
+        BlockTick::Clear();
+
+        const uint32 num_sections = (uint32)ChunkManager::GetAllChunks().size() * k_num_sections;
+        uint64 num_random_picks = 0, num_random_ticks = 0;
+        uint32 num_tickable_sections = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32 round = 0; round < kRounds; round++)
+        {
+            const BlockTick::TickStats stats = BlockTick::Tick((uint64)round * BlockTick::kTicksPerRandomTick);
+            num_random_picks += stats.num_random_picks;
+            num_random_ticks += stats.num_random_ticks;
+            num_tickable_sections = stats.num_tickable_sections;
+        }
+        report.Add("block_ticks/random_round", MillisecondsSince(start) / kRounds, "ms");
+        report.Add("block_ticks/tickable_sections", num_tickable_sections, "sections");
+        report.Add("block_ticks/all_sections", num_sections, "sections");
+        report.Add("block_ticks/picks_per_round", (double)num_random_picks / kRounds, "blocks");
+        report.Add("block_ticks/ticks_per_round", (double)num_random_ticks / kRounds, "blocks");
+
+        // The same picks over every section of the world, the cost random ticks had without the counts
+        std::mt19937 random_engine(42);
+        uint64 num_naive_ticks = 0;
+        start = std::chrono::steady_clock::now();
+        for (uint32 round = 0; round < kRounds; round++)
+            for (auto &pair : ChunkManager::GetAllChunks())
+                for (int section = 0; section < k_num_sections; section++)
+                    for (uint32 i = 0; i < BlockTick::kRandomTicksPerSection; i++)
+                    {
+                        const uint32 bits = random_engine();
+                        const int y = section * k_section_height + (int)((bits >> 8) & 15);
+                        num_naive_ticks += BlockTick::HasRandomTick(
+                                pair.second.GetLocalBlockInChunk(bits & 15, y, (bits >> 4) & 15).block_id) ? 1 : 0;
+                    }
+        report.Add("block_ticks/naive_round", MillisecondsSince(start) / kRounds, "ms");
+        report.Add("block_ticks/naive_ticks_per_round", (double)num_naive_ticks / kRounds, "blocks");
+
+        const uint32 num_stale = CountStaleTickableSections();
+        if (num_stale != 0)
+        {
+            AmoLogger_Error("%u sections have a stale tickable count.", num_stale);
+            report.Fail();
+        }
+
+        BlockTick::Clear();
+        RunSandPillar(report);
+
+        BlockTick::Clear();
+        Fluid::Clear();
+        ChunkManager::FreeAllChunks();
+    }
+
+    // Collapse a block of sand of a given height, size x size columns, and run ticks until it lands
+    static void RunSandCollapse(Report &report, int size, int height)
+    {
+        constexpr int kBottom = 180;
+        constexpr uint32 kMaxTicks = 120 * 60;
+        const std::string prefix = "neighbor_updates/sand_" + std::to_string(height);
+
+        BlockTick::Clear();
+        NeighborUpdate::Clear();
+        std::vector<int> grounds;
+        for (int x = 0; x < size; x++)
+            for (int z = 0; z < size; z++)
+            {
+                grounds.push_back(FindSandGround(x, z, kBottom));
+                for (int y = kBottom; y < kBottom + height; y++)
+                    ChunkManager::SetBlock(glm::vec3(x, y, z), kSandBlockId);
+            }
+
+        uint32 num_ticks = 0, most_batches = 0;
+        uint64 num_notifications = 0, num_updates = 0;
+        double update_time = 0.0;
+        while ((BlockTick::GetNumScheduledTicks() > 0 || NeighborUpdate::GetNumQueued() > 0) && num_ticks < kMaxTicks)
+        {
+            auto start = std::chrono::steady_clock::now();
+            const NeighborUpdate::TickStats stats = NeighborUpdate::Tick();
+            update_time += MillisecondsSince(start);
+            num_notifications += stats.num_notifications;
+            num_updates += stats.num_updates;
+            most_batches = std::max(most_batches, stats.num_batches);
+            BlockTick::Tick(++num_ticks);
+        }
+
+        if (BlockTick::GetNumScheduledTicks() > 0 || NeighborUpdate::GetNumQueued() > 0)
+        {
+            AmoLogger_Error("The sand is still falling after %u ticks.", num_ticks);
+            report.Fail();
+        }
+        uint32 num_misplaced = 0;
+        for (int x = 0; x < size; x++)
+            for (int z = 0; z < size; z++)
+                num_misplaced += IsSandLanded(x, z, grounds[x * size + z], height, kBottom + height) ? 0 : 1;
+        if (num_misplaced != 0)
+        {
+            AmoLogger_Error("%u columns of sand did not land on the ground.", num_misplaced);
+            report.Fail();
+        }
+
+        // Every fall of a block is a removal and a placement, each changes a position
+        report.Add(prefix + "/notifications", (double)num_notifications, "blocks");
+        report.Add(prefix + "/updates", (double)num_updates, "blocks");
+        report.Add(prefix + "/updates_per_notification", (double)num_updates / std::max<uint64>(num_notifications, 1), "blocks");
+        report.Add(prefix + "/update_time", update_time, "ms");
+        report.Add(prefix + "/time_per_notification", update_time * 1000000.0 / std::max<uint64>(num_notifications, 1), "ns");
+        report.Add(prefix + "/most_batches_in_a_tick", most_batches, "batches");
+    }
+
+    void NeighborUpdates(Report &report)
+    {
+        constexpr int kSize = 8;
+        GenerateWorld();
+
+        // Doubling the height doubles the falls, the updates per fall should stay the same
+        for (int height : {16, 32, 64})
+        {
+            RunSandCollapse(report, kSize, height);
+            // Clear the landed sand for the next run, the notifications are dropped with the queue
+            for (int x = 0; x < kSize; x++)
+                for (int z = 0; z < kSize; z++)
+                    for (int y = 1; y < k_chunk_height; y++)
+                        if (ChunkManager::GetBlock(glm::vec3(x, y, z)).block_id == kSandBlockId)
+                            ChunkManager::RemoveBLock(glm::vec3(x, y, z));
+        }
+
+        // A stone slab on grass turns the grass into dirt in the same tick
+        constexpr uint16 kGrassBlockId = 2, kStoneBlockId = 5;
+        NeighborUpdate::Clear();
+        uint32 num_grass = 0;
+        std::vector<glm::ivec3> covered_grass;
+        for (auto &pair : ChunkManager::GetAllChunks())
+            for (int x = 0; x < k_chunk_length && covered_grass.size() < 4096; x++)
+                for (int z = 0; z < k_chunk_width; z++)
+                    for (int y = k_chunk_height - 2; y > 0; y--)
+                    {
+                        const glm::ivec3 position(pair.first.x * k_chunk_length + x, y, pair.first.y * k_chunk_width + z);
+                        const uint16 block_id = ChunkManager::GetBlock(glm::vec3(position)).block_id;
+                        if (block_id == BlockConstants::AIR_BLOCK.block_id)
+                            continue;
+                        if (block_id == kGrassBlockId)
+                            covered_grass.push_back(position);
+                        break;
+                    }
+        for (const glm::ivec3 &position : covered_grass)
+            ChunkManager::SetBlock(glm::vec3(position + glm::ivec3(0, 1, 0)), kStoneBlockId);
+        auto start = std::chrono::steady_clock::now();
+        const NeighborUpdate::TickStats stats = NeighborUpdate::Tick();
+        report.Add("neighbor_updates/cover_grass_time", MillisecondsSince(start), "ms");
+        report.Add("neighbor_updates/cover_grass_chunk_groups", stats.num_chunk_groups, "groups");
+        report.Add("neighbor_updates/cover_grass_batches", stats.num_batches, "batches");
+        for (const glm::ivec3 &position : covered_grass)
+            num_grass += ChunkManager::GetBlock(glm::vec3(position)).block_id == kGrassBlockId ? 1 : 0;
+        if (num_grass != 0)
+        {
+            AmoLogger_Error("%u of %u grass blocks under stone were not turned into dirt.", num_grass, (uint32)covered_grass.size());
+            report.Fail();
+        }
+
+        BlockTick::Clear();
+        NeighborUpdate::Clear();
+        ChunkManager::FreeAllChunks();
+    }
+}
@@ -68,7 +68,7 @@ namespace SymoCraft
     glm::mat4 Camera::GetCameraViewMat() const
     {
         ECS::Registry &registry = Application::GetRegistry();
-        Transform &transform = registry.GetComponent<Transform>(entity_id);
+        const Transform &transform = registry.GetComponent<const Transform>(entity_id);
         return glm::lookAt( transform.position
                 ,transform.position + transform.front
                 ,transform.up);;
@@ -84,14 +84,14 @@ namespace SymoCraft
     glm::vec3 Camera::GetCameraPos() const
     {
         ECS::Registry &registry = Application::GetRegistry();
-        auto &transform = registry.GetComponent<Transform>(entity_id);
+        const auto &transform = registry.GetComponent<const Transform>(entity_id);
         return transform.position;
     }
 
     glm::vec2 Camera::GetCameraPos_vec2() const
     {
         ECS::Registry &registry = Application::GetRegistry();
-        auto &transform = registry.GetComponent<Transform>(entity_id);
+        const auto &transform = registry.GetComponent<const Transform>(entity_id);
         return glm::vec2(transform.position.x, transform.position.z);
     }
 
@@ -105,7 +105,7 @@ namespace SymoCraft
     float Camera::GetYaw() const
     {
         ECS::Registry &registry = Application::GetRegistry();
-        auto &transform = registry.GetComponent<Transform>(entity_id);
+        const auto &transform = registry.GetComponent<const Transform>(entity_id);
         return transform.yaw;
     }
 
@@ -120,7 +120,7 @@ namespace SymoCraft
     {
 
         ECS::Registry &registry = Application::GetRegistry();
-        auto &transform = registry.GetComponent<Transform>(entity_id);
+        const auto &transform = registry.GetComponent<const Transform>(entity_id);
         return transform.pitch;
     }
 
@@ -139,14 +139,14 @@ namespace SymoCraft
     glm::vec3 Camera::GetCameraFront() const
     {
         ECS::Registry &registry = Application::GetRegistry();
-        auto &transform = registry.GetComponent<Transform>(entity_id);
+        const auto &transform = registry.GetComponent<const Transform>(entity_id);
         return transform.front;
     }
 
     glm::vec3 Camera::GetCameraUp() const
     {
         ECS::Registry &registry = Application::GetRegistry();
-        auto &transform = registry.GetComponent<Transform>(entity_id);
+        const auto &transform = registry.GetComponent<const Transform>(entity_id);
         return transform.up;
     }
 
@@ -0,0 +1,328 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#include "core/ECS/Systems/aabb_tree.h"
+
+namespace SymoCraft::Physics
+    {
+        static inline AABB Union(const AABB& box1, const AABB& box2)
+        {
+            return {glm::min(box1.min, box2.min), glm::max(box1.max, box2.max)};
+        }
+
+        // Half the surface area, the cost of a node is the chance a random query visits it
+        static inline float GetArea(const AABB& box)
+        {
+            const glm::vec3 size = box.max - box.min;
+            return size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+
+        static inline bool IsContaining(const AABB& outer, const AABB& inner)
+        {
+            return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::lessThanEqual(inner.max, outer.max));
+        }
+
+        Frustum Frustum::FromMatrix(const glm::mat4 &view_projection)
+        {
+            // Gribb-Hartmann, the planes are sums and differences of the rows of the matrix
+            const glm::mat4 m = glm::transpose(view_projection);
+            Frustum frustum{};
+            frustum.planes[0] = m[3] + m[0];   // Left
+            frustum.planes[1] = m[3] - m[0];   // Right
+            frustum.planes[2] = m[3] + m[1];   // Bottom
+            frustum.planes[3] = m[3] - m[1];   // Top
+            frustum.planes[4] = m[3] + m[2];   // Near
+            frustum.planes[5] = m[3] - m[2];   // Far
+            return frustum;
+        }
+
+        AABBTree::AABBTree(float margin)
+        : m_margin(margin)
+        {
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Nodes
+
+        int32 AABBTree::AllocateNode()
+        {
+            if (m_free_list == kNullNode)
+            {
+                m_nodes.push_back({});
+                m_nodes.back().parent = kNullNode;
+                m_free_list = (int32)m_nodes.size() - 1;
+            }
+
+            const int32 node = m_free_list;
+            m_free_list = m_nodes[node].parent;
+            m_nodes[node].parent = kNullNode;
+            m_nodes[node].left = kNullNode;
+            m_nodes[node].right = kNullNode;
+            m_nodes[node].height = 0;
+            m_nodes[node].user_data = 0;
+            return node;
+        }
+
+        void AABBTree::FreeNode(int32 node)
+        {
+            m_nodes[node].parent = m_free_list;
+            m_nodes[node].height = -1;
+            m_free_list = node;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Insertion and removal
+
+        void AABBTree::InsertLeaf(int32 leaf)
+        {
+            if (m_root == kNullNode)
+            {
+                m_root = leaf;
+                m_nodes[leaf].parent = kNullNode;
+                return;
+            }
+
+            // Walk down to the sibling whose union with the leaf costs least, counting the growth of the ancestors
+            const AABB leaf_box = m_nodes[leaf].box;
+            int32 index = m_root;
+            while (!m_nodes[index].IsLeaf())
+            {
+                const Node& node = m_nodes[index];
+                const float area = GetArea(node.box);
+                const float combined_area = GetArea(Union(node.box, leaf_box));
+                // A new parent of this node and the leaf
+                const float cost = 2.0f * combined_area;
+                // Every ancestor grows by the same amount wherever the leaf goes below this node
+                const float inheritance_cost = 2.0f * (combined_area - area);
+
+                float child_costs[2];
+                const int32 children[2] = {node.left, node.right};
+                for (int i = 0; i < 2; i++)
+                {
+                    const AABB& child_box = m_nodes[children[i]].box;
+                    const float child_combined_area = GetArea(Union(child_box, leaf_box));
+                    child_costs[i] = m_nodes[children[i]].IsLeaf()
+                                     ? child_combined_area + inheritance_cost
+                                     : child_combined_area - GetArea(child_box) + inheritance_cost;
+                }
+
+                if (cost < child_costs[0] && cost < child_costs[1])
+                    break;
+                index = child_costs[0] < child_costs[1] ? node.left : node.right;
+            }
+
+            // Replace the sibling with a new parent of the sibling and the leaf
+            const int32 sibling = index;
+            const int32 old_parent = m_nodes[sibling].parent;
+            const int32 new_parent = AllocateNode();
+            m_nodes[new_parent].parent = old_parent;
+            m_nodes[new_parent].box = Union(leaf_box, m_nodes[sibling].box);
+            m_nodes[new_parent].height = m_nodes[sibling].height + 1;
+            m_nodes[new_parent].left = sibling;
+            m_nodes[new_parent].right = leaf;
+            m_nodes[sibling].parent = new_parent;
+            m_nodes[leaf].parent = new_parent;
+
+            if (old_parent == kNullNode)
+                m_root = new_parent;
+            else if (m_nodes[old_parent].left == sibling)
+                m_nodes[old_parent].left = new_parent;
+            else
+                m_nodes[old_parent].right = new_parent;
+
+            // Refit and balance the ancestors
+            index = m_nodes[leaf].parent;
+            while (index != kNullNode)
+            {
+                index = Balance(index);
+                Node& node = m_nodes[index];
+                node.height = 1 + std::max(m_nodes[node.left].height, m_nodes[node.right].height);
+                node.box = Union(m_nodes[node.left].box, m_nodes[node.right].box);
+                index = node.parent;
+            }
+        }
+
+        void AABBTree::RemoveLeaf(int32 leaf)
+        {
+            if (leaf == m_root)
+            {
+                m_root = kNullNode;
+                return;
+            }
+
+            // The sibling takes the place of the parent
+            const int32 parent = m_nodes[leaf].parent;
+            const int32 grand_parent = m_nodes[parent].parent;
+            const int32 sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+            FreeNode(parent);
+            m_nodes[sibling].parent = grand_parent;
+            if (grand_parent == kNullNode)
+            {
+                m_root = sibling;
+                return;
+            }
+
+            if (m_nodes[grand_parent].left == parent)
+                m_nodes[grand_parent].left = sibling;
+            else
+                m_nodes[grand_parent].right = sibling;
+
+            int32 index = grand_parent;
+            while (index != kNullNode)
+            {
+                index = Balance(index);
+                Node& node = m_nodes[index];
+                node.height = 1 + std::max(m_nodes[node.left].height, m_nodes[node.right].height);
+                node.box = Union(m_nodes[node.left].box, m_nodes[node.right].box);
+                index = node.parent;
+            }
+        }
+
+        int32 AABBTree::Balance(int32 a)
+        {
+            if (m_nodes[a].IsLeaf() || m_nodes[a].height < 2)
+                return a;
+
+            const int32 b = m_nodes[a].left;
+            const int32 c = m_nodes[a].right;
+            const int32 balance = m_nodes[c].height - m_nodes[b].height;
+            if (balance >= -1 && balance <= 1)
+                return a;
+
+            // The higher child f rises to the place of a, a takes the higher grandchild and f keeps the other
+            const bool is_right_higher = balance > 0;
+            const int32 f = is_right_higher ? c : b;
+            const int32 other = is_right_higher ? b : c;
+            const int32 g = m_nodes[f].left;
+            const int32 h = m_nodes[f].right;
+
+            m_nodes[f].left = a;
+            m_nodes[f].parent = m_nodes[a].parent;
+            m_nodes[a].parent = f;
+            if (m_nodes[f].parent == kNullNode)
+                m_root = f;
+            else if (m_nodes[m_nodes[f].parent].left == a)
+                m_nodes[m_nodes[f].parent].left = f;
+            else
+                m_nodes[m_nodes[f].parent].right = f;
+
+            const bool is_g_higher = m_nodes[g].height > m_nodes[h].height;
+            const int32 rising = is_g_higher ? g : h;
+            const int32 staying = is_g_higher ? h : g;
+            m_nodes[f].right = rising;
+            // a keeps its other child on the same side
+            if (is_right_higher)
+                m_nodes[a].right = staying;
+            else
+                m_nodes[a].left = staying;
+            m_nodes[staying].parent = a;
+
+            m_nodes[a].box = Union(m_nodes[other].box, m_nodes[staying].box);
+            m_nodes[a].height = 1 + std::max(m_nodes[other].height, m_nodes[staying].height);
+            m_nodes[f].box = Union(m_nodes[a].box, m_nodes[rising].box);
+            m_nodes[f].height = 1 + std::max(m_nodes[a].height, m_nodes[rising].height);
+            return f;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Functions Implementation
+
+        int32 AABBTree::CreateProxy(const AABB &box, uint64 user_data)
+        {
+            const int32 proxy = AllocateNode();
+            m_nodes[proxy].box = {box.min - glm::vec3(m_margin), box.max + glm::vec3(m_margin)};
+            m_nodes[proxy].user_data = user_data;
+            InsertLeaf(proxy);
+            m_num_proxies++;
+            return proxy;
+        }
+
+        void AABBTree::DestroyProxy(int32 proxy)
+        {
+            RemoveLeaf(proxy);
+            FreeNode(proxy);
+            m_num_proxies--;
+        }
+
+        bool AABBTree::MoveProxy(int32 proxy, const AABB &box, const glm::vec3 &displacement)
+        {
+            if (IsContaining(m_nodes[proxy].box, box))
+                return false;
+
+            RemoveLeaf(proxy);
+            AABB fat_box = {box.min - glm::vec3(m_margin), box.max + glm::vec3(m_margin)};
+            // Stretch the box where it is heading
+            const glm::vec3 ahead = displacement * kDisplacementMultiplier;
+            fat_box.min += glm::min(ahead, glm::vec3(0.0f));
+            fat_box.max += glm::max(ahead, glm::vec3(0.0f));
+            m_nodes[proxy].box = fat_box;
+            InsertLeaf(proxy);
+            return true;
+        }
+
+        void AABBTree::QueryAABB(const AABB &box, std::vector<int32> &out_proxies) const
+        {
+            out_proxies.clear();
+            if (m_root == kNullNode)
+                return;
+
+            static thread_local std::vector<int32> stack;
+            stack.clear();
+            stack.push_back(m_root);
+            while (!stack.empty())
+            {
+                const Node& node = m_nodes[stack.back()];
+                const int32 index = stack.back();
+                stack.pop_back();
+                if (!node.box.IsOverlapping(box))
+                    continue;
+                if (node.IsLeaf())
+                    out_proxies.push_back(index);
+                else
+                {
+                    stack.push_back(node.right);
+                    stack.push_back(node.left);
+                }
+            }
+        }
+
+        void AABBTree::QueryFrustum(const Frustum &frustum, std::vector<int32> &out_proxies) const
+        {
+            out_proxies.clear();
+            if (m_root == kNullNode)
+                return;
+
+            static thread_local std::vector<int32> stack;
+            stack.clear();
+            stack.push_back(m_root);
+            while (!stack.empty())
+            {
+                const Node& node = m_nodes[stack.back()];
+                const int32 index = stack.back();
+                stack.pop_back();
+                if (!frustum.IsOverlapping(node.box))
+                    continue;
+                if (node.IsLeaf())
+                    out_proxies.push_back(index);
+                else
+                {
+                    stack.push_back(node.right);
+                    stack.push_back(node.left);
+                }
+            }
+        }
+
+        int32 AABBTree::GetHeight() const
+        {
+            return m_root == kNullNode ? 0 : m_nodes[m_root].height;
+        }
+
+        void AABBTree::Clear()
+        {
+            m_nodes.clear();
+            m_root = kNullNode;
+            m_free_list = kNullNode;
+            m_num_proxies = 0;
+        }
+    }
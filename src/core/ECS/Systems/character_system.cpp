@@ -8,20 +8,28 @@
 #include "core/ECS/registry.h"
 #include "core/ECS/Systems/physics_system.h"
 #include "core/application.h"
+#include "core/simulation_clock.h"
 #include "camera/camera.h"
 
 namespace SymoCraft::Character::Player
         {
 
+            static uint32 CountCharacters(ECS::Registry &registry)
+            {
+                return registry.View<Transform, CharacterComponent, Physics::RigidBody>().Size();
+            }
+
             void Update(ECS::Registry &registry)
             {
-                for (ECS::EntityId entity : registry.View<Transform, CharacterComponent
-                                                ,  Physics::RigidBody>())
-                {
-                    auto &transform = registry.GetComponent<Transform>(entity);
-                    auto &character_com = registry.GetComponent<CharacterComponent>(entity);
-                    auto &rigid_body = registry.GetComponent<Physics::RigidBody>(entity);
+                UpdateSlice(registry, {0, UINT32_MAX, 0, registry.GetChangeTick()});
+            }
 
+            void UpdateSlice(ECS::Registry &registry, const ECS::SystemSlice& slice)
+            {
+                for (auto [entity, transform, character_com, rigid_body] :
+                     registry.View<Transform, CharacterComponent, Physics::RigidBody>().Slice(slice.begin, slice.end)
+                             .StampWith(slice.run_tick))
+                {
                     float speed = (character_com.is_running) ? character_com.run_speed : character_com.base_speed;
                     rigid_body.velocity.x = 0;
                     if (!rigid_body.use_gravity)
@@ -77,13 +85,21 @@ namespace SymoCraft::Character::Player
 
                     if (registry.HasComponent<PlayerComponent>(entity))
                     {
-                        auto &player_com = registry.GetComponent<PlayerComponent>(entity);
+                        const auto &player_com = registry.GetComponent<const PlayerComponent>(entity);
                         auto camera_entity = Application::GetCamera()->entity_id;
 
                         if (camera_entity != ECS::null_entity && registry.HasComponent<Transform>(camera_entity))
                         {
                             auto& camera_transform = registry.GetComponent<Transform>(camera_entity);
-                            camera_transform.position = transform.position + player_com.camera_offset;
+                            // Draw the camera between the last two physics ticks, frames and ticks don't line up
+                            glm::vec3 position = transform.position;
+                            if (registry.HasComponent<InterpolatedTransform>(entity))
+                            {
+                                const auto &interpolated = registry.GetComponent<const InterpolatedTransform>(entity);
+                                position = glm::mix(interpolated.previous_position, interpolated.current_position,
+                                                    Application::GetSimulationClock().GetAlpha());
+                            }
+                            camera_transform.position = position + player_com.camera_offset;
                             camera_transform.yaw = transform.yaw;
                             camera_transform.pitch = transform.pitch;
                         }
@@ -94,4 +110,15 @@ namespace SymoCraft::Character::Player
                     }
                 }
             }
+
+            ECS::System GetSystem()
+            {
+                ECS::System system{"Character::Player"};
+                system.reads = ECS::Internal::MakeComponentSignature<PlayerComponent, InterpolatedTransform>();
+                // The player also moves the camera's transform
+                system.writes = ECS::Internal::MakeComponentSignature<Transform, CharacterComponent, Physics::RigidBody>();
+                system.update = UpdateSlice;
+                system.count = CountCharacters;
+                return system;
+            }
         }
\ No newline at end of file
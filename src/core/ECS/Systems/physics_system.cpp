@@ -5,25 +5,14 @@
 #include "core/ECS/component.h"
 #include "core/ECS/registry.h"
 #include "core/application.h"
+#include "core/global_thread_pool.h"
+#include "core/simulation_clock.h"
 #include "world/chunk.h"
 #include "renderer/renderer.h"
 #include "core/constants.h"
 
 namespace SymoCraft::Physics
     {
-        // The main component of our physics system is collision
-        // The remaining part of it is to deal with collision
-        enum class Direction : uint8
-        {
-            NONE = 0,
-            TOP,
-            BOTTOM,
-            FRONT,
-            BACK,
-            LEFT,
-            RIGHT
-        };
-
         bool compare(float x, float y, float epsilon = std::numeric_limits<float>::min())
         {
             return abs(x - y) <= epsilon * std::max(1.0f, std::max(abs(x), abs(y)));
@@ -34,500 +23,1036 @@ namespace SymoCraft::Physics
             return compare(vec1.x, vec2.x, epsilon) && compare(vec1.y, vec2.y, epsilon) && compare(vec1.z, vec2.z, epsilon);
         }
 
-        struct CollisionInfo
-        {
-            glm::vec3 overlap_part;     // overlap part of two entity
-            Direction force;            // collision force direction
-            bool did_collision;     // did they really collision?
-        };
-
         // ----------------------------------------------------------------------------------------------------------
         // some useful uniform variables in physics system
         static glm::vec3 uniform_gravity = glm::vec3(0.0, 20.0, 0.0);
         static glm::vec3 terminal_velocity = glm::vec3(50.0f, 50.0f, 50.0f);
-        static const float kPhysicsUpdateRate = 1.0f / 120.0f; // 120Hz
+        static const float kPhysicsUpdateRate = kFixedTickDuration; // 120Hz
 
         // ----------------------------------------------------------------------------------------------------------
-        // some useful uniform function in physics system
-        static void ResolveStaticCollision(ECS::EntityId entity, RigidBody &rb, Transform &transform, HitBox &hit_box);
-        static CollisionInfo StaticCollisionInformation(const RigidBody& rb1, const HitBox &hb1, const Transform& tr1
-                                                        , const HitBox &hb2, const Transform& tr2);
-        static bool IsColliding(const HitBox &hb1, const Transform &tr1
-                                , const HitBox &hb2, const Transform &tr2);
+        // Voxel collision
 
-        static float PenetrationAmount(const glm::vec3 &hb1_negative, const glm::vec3 &hb1_positive
-                                       ,const glm::vec3 &hb2_negative, const glm::vec3 &hb2_positive
-                                       , const glm::vec3 &axis);
+        // A body stops this far before the face of a block, and does not count a block it only touches
+        // on the other axes, e.g. the block it stands on when it moves sideways
+        static const float kCollisionEpsilon = 0.001f;
 
-        //static Interval GetInterval(const HitBox &box, const Transform &transform, const glm::vec3 &axis);
-        static void GetQuadrantResult(const Transform &tr1, const Transform &tr2, const HitBox &hb2_expanded
-                                      , CollisionInfo* res ,Direction x_face, Direction y_face, Direction z_face);
-        //static glm::vec3 ClosetPointOnRay(const glm::vec3 ray_origin, const glm::vec3 ray_direction
-         //                                 , float ray_max_distance, glm::vec3 &point);
-
-
-        // ----------------------------------------------------------------------------------------------------------
-        // Physics system core
+        static_assert(k_chunk_length == 16 && k_chunk_width == 16, "ChunkCache splits coordinates with shifts.");
 
-        void Update(ECS::Registry& registry)
+        // Reads blocks for the sweeps of a step
+        // A body touches a handful of blocks that are nearly always in the same chunk, the chunk of the last
+        // block is kept so only a chunk change goes through the chunk map
+        struct ChunkCache
         {
-            static float accumulated_delta_time = 0.0f;
-            accumulated_delta_time += Application::delta_time;
+            glm::ivec2 chunk_coord{INT32_MAX};
+            Chunk* chunk = nullptr;
 
-            while (accumulated_delta_time >= kPhysicsUpdateRate)
+            inline bool IsSolid(int32 x, int32 y, int32 z)
             {
-                accumulated_delta_time -= kPhysicsUpdateRate;
+                if (y < 0 || y >= k_chunk_height)
+                    return false;
 
-                for (ECS::EntityId entity : registry.View<Transform, RigidBody, HitBox>())
+                // Shifts round down for negative coordinates too
+                const glm::ivec2 coord(x >> 4, z >> 4);
+                if (coord != chunk_coord)
                 {
+                    chunk_coord = coord;
+                    chunk = ChunkManager::GetChunk(coord);
+                }
+                return chunk && is_block_solid(chunk->GetLocalBlockInChunk(x & 15, y, z & 15).block_id);
+            }
+        };
 
-                    auto &rb = registry.GetComponent<RigidBody>(entity);
-                    auto &transform = registry.GetComponent<Transform>(entity);
-                    auto &hit_box = registry.GetComponent<HitBox>(entity);
-
-                    transform.position += rb.velocity * kPhysicsUpdateRate;
-                    rb.velocity += rb.acceleration * kPhysicsUpdateRate;
-                    if (rb.use_gravity)
-                    {
-                        rb.velocity -= uniform_gravity * kPhysicsUpdateRate;
-                    }
-                    rb.velocity = glm::clamp(rb.velocity, -terminal_velocity, terminal_velocity);
+        // Move a box along one axis until it touches a solid block
+        // return the distance moved, the distance asked for if nothing is in the way
+        // Parameters: chunk cache, box(moved), axis(0 x, 1 y, 2 z), signed distance to move
+        static float SweepAxis(ChunkCache& cache, AABB& box, int axis, float distance)
+        {
+            if (distance == 0.0f)
+                return 0.0f;
+
+            // Blocks the box covers on the other two axes
+            const int axis1 = (axis + 1) % 3, axis2 = (axis + 2) % 3;
+            const auto min1 = (int32)glm::floor(box.min[axis1] + kCollisionEpsilon);
+            const auto max1 = (int32)glm::floor(box.max[axis1] - kCollisionEpsilon);
+            const auto min2 = (int32)glm::floor(box.min[axis2] + kCollisionEpsilon);
+            const auto max2 = (int32)glm::floor(box.max[axis2] - kCollisionEpsilon);
+
+            // Layers of blocks the box passes through, from the one next to it to the one it ends in
+            int32 first, last, step;
+            if (distance > 0.0f)
+            {
+                first = (int32)glm::floor(box.max[axis] - kCollisionEpsilon) + 1;
+                last = (int32)glm::floor(box.max[axis] + distance - kCollisionEpsilon);
+                step = 1;
+            }
+            else
+            {
+                first = (int32)glm::floor(box.min[axis] + kCollisionEpsilon) - 1;
+                last = (int32)glm::floor(box.min[axis] + distance + kCollisionEpsilon);
+                step = -1;
+            }
 
-                    if (rb.is_sensor)
+            // Every layer is checked nearest first, so a fast body can not jump over a block
+            for (int32 layer = first; layer * step <= last * step; layer += step)
+            {
+                glm::ivec3 block;
+                block[axis] = layer;
+                bool is_blocked = false;
+                for (int32 i = min1; i <= max1 && !is_blocked; i++)
+                    for (int32 j = min2; j <= max2 && !is_blocked; j++)
                     {
-                        // not designed yet
-                        continue;
+                        block[axis1] = i;
+                        block[axis2] = j;
+                        is_blocked = cache.IsSolid(block.x, block.y, block.z);
                     }
 
-                    ResolveStaticCollision(entity, rb, transform, hit_box);
-
+                if (is_blocked)
+                {
+                    // Stop at the near face of the layer
+                    distance = step > 0 ? (float)layer - box.max[axis] : (float)(layer + 1) - box.min[axis];
+                    break;
                 }
             }
+
+            box.min[axis] += distance;
+            box.max[axis] += distance;
+            return distance;
         }
 
 
-        static bool DoRayTracing(const glm::vec3 &origin, const glm::vec3 &normal_direction,
-                              float max_distance, bool draw,
-                              const glm::vec3 &block_corner, const glm::vec3& step, RaycastStaticResult* out)
+        // ----------------------------------------------------------------------------------------------------------
+        // Bodies and broadphase of the current frame
+
+        struct Body
         {
-            glm::vec3 block_center = block_corner - (glm::vec3(0.5f) * step);
-            int block_id = ChunkManager::GetBlock(block_center).block_id;
+            ECS::EntityId entity;
+            Transform* transform;
+            RigidBody* rb;
+            const HitBox* hit_box;
+        };
 
-            if (block_id != BlockConstants::NULL_BLOCK.block_id && block_id != BlockConstants::AIR_BLOCK.block_id)
-            {
-                HitBox current_box{};
-                current_box.offset = glm::vec3();
-                current_box.size = glm::vec3(1.0f, 1.0f, 1.0f);
-                Transform currentTransform{};
-                currentTransform.position = block_center;
+        // Gathered once per frame, no component is added or removed while the physics system runs
+        static std::vector<Body> bodies;
+        static std::vector<AABB> body_boxes;
+        static SpatialHash broadphase;
+        static std::vector<std::pair<uint32, uint32>> contact_pairs;
+        // Overlapping (sensor, other) pairs of the current and the previous step, sorted
+        static std::vector<std::pair<ECS::EntityId, ECS::EntityId>> sensor_overlaps;
+        static std::vector<std::pair<ECS::EntityId, ECS::EntityId>> previous_sensor_overlaps;
+        // Sensor events of all steps of the current frame
+        static std::vector<SensorEvent> sensor_events;
+
+        /* ---------------------------------------------------------------------------------------------------
+           About sleeping:
+           A body at rest for kStepsToSleep steps in a row goes to sleep, it leaves the bodies of the frame
+           and is neither integrated nor put in the broadphase, so a step costs as much as the awake bodies.
+           The sleeping bodies get a broadphase of their own that is only rebuilt when they change.
+
+           To an awake body a sleeping one is a static box, it is pushed out without moving the sleeping one.
+           The sleeping body wakes when
+               - something writes a velocity or an acceleration to it, e.g. the character system or a force
+               - an awake body faster than kWakeVelocity touches it
+               - a block it stands on is set or removed, see OnBlockChanged
+               - a body it stands on wakes, so a stack wakes from the bottom up
+           A body woken beside a sleeping one does not wake it, or one woken body would wake a whole crowd.
+        */
+
+        // A body slower than this counts as at rest
+        static const float kSleepVelocity = 0.1f;
+        // Steps at rest before a body sleeps, half a second
+        static const uint16 kStepsToSleep = 60;
+        // A body faster than this wakes the sleeping bodies it touches
+        static const float kWakeVelocity = 1.0f;
+        // Boxes closer than this count as touching when waking bodies
+        static const float kWakeMargin = 0.01f;
+
+        static std::vector<Body> sleeping_bodies;
+        static std::vector<AABB> sleeping_boxes;
+        static SpatialHash sleeping_broadphase;
+        // Entities of the sleeping broadphase, in box order
+        static std::vector<ECS::EntityId> sleeping_broadphase_entities;
+        // Boxes of the bodies woken since the last gather, bodies standing on them wake too
+        static std::vector<AABB> wake_boxes;
+        // Boxes of the blocks changed since the last gather, OnBlockChanged may be called from any thread
+        static std::mutex changed_blocks_mutex;
+        static std::vector<AABB> changed_block_boxes;
 
-                Block block = ChunkManager::GetBlock(currentTransform.position);
-                BlockFormat blockFormat = get_block(block.block_id);
+        // ----------------------------------------------------------------------------------------------------------
+        // Entity tree
+
+        // Every entity with a hit box, for ray, segment and frustum queries, updated by the first query after the steps
+        static AABBTree entity_tree;
+        // Registry of the last steps while the tree is behind them, null once the tree is up to date
+        static ECS::Registry* stale_entity_tree_registry = nullptr;
+        // Proxy of every entity index, kNullNode for none, the user data of the proxy is the full entity id
+        static std::vector<int32> entity_proxies;
+        // Box of every proxy, the tree only keeps the fattened one, and the last update that saw it
+        static std::vector<AABB> proxy_boxes;
+        static std::vector<uint32> proxy_stamps;
+        static uint32 entity_tree_stamp = 0;
 
-                if (blockFormat.m_is_solid)
-                {
-                    glm::vec3 min = currentTransform.position - (current_box.size * 0.5f) + current_box.offset;
-                    glm::vec3 max = currentTransform.position + (current_box.size * 0.5f) + current_box.offset;
-                    float t1 = (min.x - origin.x) / (compare(normal_direction.x, 0.0f) ? 0.00001f : normal_direction.x);
-                    float t2 = (max.x - origin.x) / (compare(normal_direction.x, 0.0f) ? 0.00001f : normal_direction.x);
-                    float t3 = (min.y - origin.y) / (compare(normal_direction.y, 0.0f) ? 0.00001f : normal_direction.y);
-                    float t4 = (max.y - origin.y) / (compare(normal_direction.y, 0.0f) ? 0.00001f : normal_direction.y);
-                    float t5 = (min.z - origin.z) / (compare(normal_direction.z, 0.0f) ? 0.00001f : normal_direction.z);
-                    float t6 = (max.z - origin.z) / (compare(normal_direction.z, 0.0f) ? 0.00001f : normal_direction.z);
-
-                    float tmin = glm::max(glm::max(glm::min(t1, t2), glm::min(t3, t4)), glm::min(t5, t6));
-                    float tmax = glm::min(glm::min(glm::max(t1, t2), glm::max(t3, t4)), glm::max(t5, t6));
-                    if (tmax < 0 || tmin > tmax)
-                    {
-                        // No intersection
-                        return false;
-                    }
+        // ----------------------------------------------------------------------------------------------------------
+        // Jobs of a step
 
-                    // intersection exists
-                    float depth = 0.0f;
-                    if (tmin < 0.0f)
-                        depth = tmax;
-                    else
-                        depth = tmin;
-
-                    out->point = origin + normal_direction * depth;
-                    out->hit = true;
-                    out->block_center = currentTransform.position + current_box.offset;
-                    out->block_size = current_box.size;
-                    out->hit_normal = out->point - out->block_center;
-                    float max_component = glm::max(glm::abs(out->hit_normal.x), glm::max(glm::abs(out->hit_normal.y), glm::abs(out->hit_normal.z)));
-                    out->hit_normal = glm::abs(out->hit_normal.x) == max_component
-                                      ? glm::vec3(1, 0, 0) * glm::sign(out->hit_normal.x)
-                                      : glm::abs(out->hit_normal.y) == max_component
-                                        ? glm::vec3(0, 1, 0) * glm::sign(out->hit_normal.y)
-                                        : glm::vec3(0, 0, 1) * glm::sign(out->hit_normal.z);
-                    return true;
-                }
+        // Set by SetThreadPool, the steps run on the calling thread alone without it
+        static GlobalThreadPool* thread_pool = nullptr;
+
+        // Bodies, buckets or islands per job
+        static const uint32 kBodiesPerJob = 1024;
+        static const uint32 kBucketsPerJob = 4096;
+
+        typedef void (*RangeFunction)(uint32 begin, uint32 end);
+
+        struct RangeJob
+        {
+            RangeFunction func;
+            uint32 begin;
+            uint32 end;
+            std::atomic<uint32>* num_unfinished_jobs;
+        };
+
+        static void RunRangeJob(void* data, size_t data_size)
+        {
+            auto* job = (RangeJob*)data;
+            job->func(job->begin, job->end);
+            job->num_unfinished_jobs->fetch_sub(1, std::memory_order_release);
+        }
+
+        // Run func over [0, count) in ranges of range_size on the thread pool, and wait for them
+        // The calling thread runs ranges too while it waits
+        // The ranges never depend on the number of threads, so neither does any result built per range
+        static void ParallelFor(uint32 count, uint32 range_size, RangeFunction func)
+        {
+            const uint32 num_jobs = (count + range_size - 1) / range_size;
+            if (!thread_pool || thread_pool->NumThreads() == 0 || num_jobs <= 1)
+            {
+                for (uint32 begin = 0; begin < count; begin += range_size)
+                    func(begin, std::min(count, begin + range_size));
+                return;
+            }
+
+            static std::vector<RangeJob> jobs;
+            static std::atomic<uint32> num_unfinished_jobs{0};
+            jobs.resize(num_jobs);
+            num_unfinished_jobs.store(num_jobs, std::memory_order_relaxed);
+            for (uint32 i = 0; i < num_jobs; i++)
+            {
+                jobs[i] = {func, i * range_size, std::min(count, (i + 1) * range_size), &num_unfinished_jobs};
+                thread_pool->QueueTask(RunRangeJob, "PhysicsJob", &jobs[i], sizeof(RangeJob), Priority::High);
             }
+            thread_pool->BeginWork();
 
-            return false;
+            while (num_unfinished_jobs.load(std::memory_order_acquire) > 0)
+                if (!thread_pool->RunPendingTask())
+                    std::this_thread::yield();
         }
-        // Ray casting from player on the block
 
+        // ----------------------------------------------------------------------------------------------------------
+        // Physics system core
 
-        RaycastStaticResult RayCastStatic(const glm::vec3 &origin, const glm::vec3 &normal_direction
-                , float max_distance, bool draw)
+        // Fixed steps to run in the current frame, from the simulation clock
+        static int num_frame_steps = 0;
+
+        static void PrepareSteps(ECS::Registry& registry)
         {
-            RaycastStaticResult result{};
-            result.hit = false;
+            num_frame_steps = (int)Application::GetSimulationClock().GetFrameTicks();
+            sensor_events.clear();
+        }
+
+        static inline AABB GetBodyBox(const Transform& transform, const HitBox& hit_box)
+        {
+            const glm::vec3 center = transform.position + hit_box.offset;
+            return {center - hit_box.size * 0.5f, center + hit_box.size * 0.5f};
+        }
 
-            if (compare(normal_direction, glm::vec3(0, 0, 0)))
+        static void WakeBody(RigidBody& rb, const AABB& box)
+        {
+            rb.is_sleeping = false;
+            rb.num_still_steps = 0;
+            wake_boxes.push_back(box);
+        }
+
+        static inline AABB ExpandBox(const AABB& box, float margin)
+        {
+            return {box.min - glm::vec3(margin), box.max + glm::vec3(margin)};
+        }
+
+        static void IntegrateBody(Body& body, ChunkCache& cache)
+        {
+            Transform& transform = *body.transform;
+            RigidBody& rb = *body.rb;
+            rb.velocity += rb.acceleration * kPhysicsUpdateRate;
+            if (rb.use_gravity)
             {
-                // invalid normal direction, return null result
-                return result;
+                rb.velocity -= uniform_gravity * kPhysicsUpdateRate;
+            }
+            rb.velocity = glm::clamp(rb.velocity, -terminal_velocity, terminal_velocity);
+
+            const glm::vec3 motion = rb.velocity * kPhysicsUpdateRate;
+            // Sensors go through everything, they only report overlaps
+            if (rb.is_sensor)
+            {
+                transform.position += motion;
+                return;
+            }
+
+            // Move along y first, a body landing while it walks is stopped by the floor
+            // and not by the side of the block it lands next to
+            static constexpr int kAxisOrder[3] = {1, 0, 2};
+            AABB box = GetBodyBox(transform, *body.hit_box);
+            const glm::vec3 start = box.min;
+            rb.on_ground = false;
+            for (int axis : kAxisOrder)
+            {
+                if (SweepAxis(cache, box, axis, motion[axis]) == motion[axis])
+                    continue;
+
+                // A block is in the way, stop on this axis
+                rb.velocity[axis] = 0.0f;
+                rb.acceleration[axis] = 0.0f;
+                if (axis == 1 && motion.y < 0.0f)
+                    rb.on_ground = true;
+            }
+            transform.position += box.min - start;
+        }
+
+        // Push two solid bodies apart along the axis they overlap least on
+        static void ResolveBodyContact(ChunkCache& cache, Body& body1, Body& body2)
+        {
+            // The boxes of the broadphase are from before the earlier contacts of this step
+            AABB box1 = GetBodyBox(*body1.transform, *body1.hit_box);
+            AABB box2 = GetBodyBox(*body2.transform, *body2.hit_box);
+            if (!box1.IsOverlapping(box2))
+                return;
+
+            const glm::vec3 overlap = glm::min(box1.max, box2.max) - glm::max(box1.min, box2.min);
+            int axis = 0;
+            if (overlap.y < overlap[axis])
+                axis = 1;
+            if (overlap.z < overlap[axis])
+                axis = 2;
+
+            // body1 moves to this side of body2, each one half the way
+            // The pushes are swept too, a body standing on the floor is not pushed into it, the other one
+            // moves the whole way instead
+            const float side = body1.transform->position[axis] < body2.transform->position[axis] ? -1.0f : 1.0f;
+            const float moved1 = SweepAxis(cache, box1, axis, side * overlap[axis] * 0.5f);
+            const float moved2 = SweepAxis(cache, box2, axis, moved1 - side * overlap[axis]);
+            body1.transform->position[axis] += moved1;
+            body2.transform->position[axis] += moved2;
+
+            // Stop them moving into each other, like two equal masses that stick on that axis
+            float& velocity1 = body1.rb->velocity[axis];
+            float& velocity2 = body2.rb->velocity[axis];
+            if ((velocity1 - velocity2) * side < 0.0f)
+            {
+                const float average = (velocity1 + velocity2) * 0.5f;
+                velocity1 = average;
+                velocity2 = average;
+            }
+
+            if (axis == 1)
+            {
+                RigidBody& upper = side > 0.0f ? *body1.rb : *body2.rb;
+                upper.on_ground = true;
             }
+        }
 
-            /*
-			if (draw)
-			{
-				Renderer::drawLine(origin, origin + normal_direction * max_distance,);
-			}
-            */
-            // NOTE: the reference paper: http://www.cse.yorku.ca/~amana/research/grid.pdf
-            glm::vec3 rayEnd = origin + normal_direction * max_distance;
-
-            // Do some fancy math to figure out which voxel is the next voxel
-            glm::vec3 block_center = glm::ceil(origin);
-            // step is the sign of normal direction
-            glm::vec3 step = glm::sign(normal_direction);
-            // Max amount we can step in any direction of the ray, and remain in the voxel
-            glm::vec3 block_center_to_origin_sign = glm::sign(block_center - origin);
-            glm::vec3 revised_normal_direction = glm::vec3(
-                    normal_direction.x == 0.0f ? 1e-10 * block_center_to_origin_sign.x : normal_direction.x,
-                    normal_direction.y == 0.0f ? 1e-10 * block_center_to_origin_sign.y : normal_direction.y,
-                    normal_direction.z == 0.0f ? 1e-10 * block_center_to_origin_sign.z : normal_direction.z);
-            glm::vec3 t_delta = ((block_center + step) - origin) / revised_normal_direction;
-            // If any number is 0, then we max the delta so that we don't get a false positive
-            if (t_delta.x == 0.0f) t_delta.x = 1e10;
-            if (t_delta.y == 0.0f) t_delta.y = 1e10;
-            if (t_delta.z == 0.0f) t_delta.z = 1e10;
-            glm::vec3 t_max = t_delta;
-            float min_t_value;
-            do
-            {
-                t_delta = (block_center - origin) / revised_normal_direction;
-                t_max = t_delta;
-                min_t_value = FLT_MAX;
-                if (t_max.x < t_max.y)
+        static void UpdateSensorEvents()
+        {
+            std::sort(sensor_overlaps.begin(), sensor_overlaps.end());
+
+            // Both lists are sorted, walk them together
+            size_t current = 0, previous = 0;
+            while (current < sensor_overlaps.size() || previous < previous_sensor_overlaps.size())
+            {
+                if (previous == previous_sensor_overlaps.size()
+                    || (current < sensor_overlaps.size() && sensor_overlaps[current] < previous_sensor_overlaps[previous]))
                 {
-                    if (t_max.x < t_max.z)
-                    {
-                        block_center.x += step.x;
-                        // Check if we actually hit the block
-                        if (DoRayTracing(origin, normal_direction, max_distance, draw, block_center, step, &result))
-                            return result;
-                        min_t_value = t_max.x;
-                    }
-                    else
-                    {
-                        block_center.z += step.z;
-                        if (DoRayTracing(origin, normal_direction, max_distance, draw, block_center, step, &result))
-                            return result;
-                        min_t_value = t_max.z;
-                    }
+                    sensor_events.push_back({sensor_overlaps[current].first, sensor_overlaps[current].second, true});
+                    current++;
+                }
+                else if (current == sensor_overlaps.size() || previous_sensor_overlaps[previous] < sensor_overlaps[current])
+                {
+                    sensor_events.push_back({previous_sensor_overlaps[previous].first,
+                                             previous_sensor_overlaps[previous].second, false});
+                    previous++;
                 }
                 else
                 {
-                    if (t_max.y < t_max.z)
-                    {
-                        block_center.y += step.y;
-                        if (DoRayTracing(origin, normal_direction, max_distance, draw, block_center, step, &result))
-                            return result;
-                        min_t_value = t_max.y;
-                    }
-                    else
-                    {
-                        block_center.z += step.z;
-                        if (DoRayTracing(origin, normal_direction, max_distance, draw, block_center, step, &result))
-                            return result;
-                        min_t_value = t_max.z;
-                    }
+                    current++;
+                    previous++;
                 }
-            } while (min_t_value < max_distance);
+            }
+            std::swap(sensor_overlaps, previous_sensor_overlaps);
+        }
 
-            return result;
+        static void IntegrateBodies(uint32 begin, uint32 end)
+        {
+            ChunkCache cache;
+            for (uint32 i = begin; i < end; i++)
+            {
+                IntegrateBody(bodies[i], cache);
+                body_boxes[i] = GetBodyBox(*bodies[i].transform, *bodies[i].hit_box);
+            }
         }
 
-        // ----------------------------------------------------------------------------------------------------------
-        // Functions Implementation
+        // Pairs of every bucket range, concatenated in range order they are the pairs of FindPairs
+        static std::vector<std::vector<std::pair<uint32, uint32>>> range_pairs;
 
-        // Resolve static collision
-        // Parameters: entity id, rigid body, transform, hit box
-        static void ResolveStaticCollision(ECS::EntityId entity, RigidBody &rb, Transform &transform, HitBox &hit_box)
-        {
-            // Get all face coordinate of the hit box
-            // ceil : return the nearest integer >= expression
-            auto right_x = (int32) glm::ceil(transform.position.x + hit_box.size.x * 0.5f);
-            auto left_x = (int32) glm::ceil(transform.position.x - hit_box.size.x * 0.5f);
-            auto front_z = (int32) glm::ceil(transform.position.z + hit_box.size.z * 0.5f);
-            auto back_z = (int32) glm::ceil(transform.position.z - hit_box.size.z * 0.5f);
-            auto top_y = (int32) glm::ceil(transform.position.y + hit_box.size.y * 0.5f) ;
-            auto bottom_y = (int32) glm::ceil(transform.position.y - hit_box.size.y * 0.5f);
-
-            HitBox default_block_box{};
-            default_block_box.size = glm::vec3(1.0f, 1.0f, 1.0f);
-            Transform block_transform{};
-            block_transform.front = glm::vec3(1, 0, 0);
-            block_transform.up = glm::vec3(0, 1, 0);
-            block_transform.right = glm::vec3(0, 0, 1);
-            block_transform.yaw = 0;
-            block_transform.pitch = 0;
-            block_transform.scale = glm::vec3(1, 1, 1);
-
-            bool did_collision = false;
-            for (int32 y = top_y; y >= bottom_y; y--)
-                for  (int32 x = left_x; x <= right_x; x++)
-                    for (int32 z = back_z; z <= front_z; z++)
-                    {
-                        glm::vec3 box_pos = glm::vec3(x - 0.5f, y - 0.5f, z - 0.5f);
-                        Block block = ChunkManager::GetBlock(box_pos);
-                        BlockFormat block_format = get_block(block.block_id);
-
-                        block_transform.position = box_pos;
-
-                        if (block_format.m_is_solid && IsColliding(hit_box, transform, default_block_box, block_transform))
-                        {
-                            CollisionInfo collision_info
-                            = StaticCollisionInformation(rb, hit_box, transform, default_block_box, block_transform);
-
-                            float dot_product = glm::dot(glm::normalize(collision_info.overlap_part), glm::normalize(rb.velocity));
-                            if (dot_product < 0)
-                            {
-                                // We're already moving out of the collision, don't do anything
-                                continue;
-                            }
-                            transform.position -= collision_info.overlap_part;
-                            switch (collision_info.force)
-                            {
-                                case Direction::BOTTOM:
-                                case Direction::TOP:
-                                    rb.acceleration.y = 0;
-                                    rb.velocity.y = 0;
-                                    break;
-                                case Direction::RIGHT:
-                                case Direction::LEFT:
-                                    rb.velocity.x = 0;
-                                    rb.acceleration.x = 0;
-                                    break;
-                                case Direction::FRONT:
-                                case Direction::BACK:
-                                    rb.velocity.z = 0;
-                                    rb.acceleration.z = 0;
-                                    break;
-                                default:
-                                    break;
-                            }
-                            rb.on_ground = rb.on_ground || collision_info.force == Direction::BOTTOM;
-                            did_collision = true;
-                        }
-                    }
+        static void FindPairsInBuckets(uint32 begin, uint32 end)
+        {
+            broadphase.FindPairs(range_pairs[begin / kBucketsPerJob], begin, end);
+        }
 
-            if (!did_collision && rb.on_ground && rb.velocity.y > 0)
+        /* ---------------------------------------------------------------------------------------------------
+           About islands:
+           Bodies touching each other, directly or through other bodies, form an island. A contact only moves
+           the bodies of its island, so islands are solved at the same time, each one on a single thread.
+           Inside an island the contacts are solved in the order the broadphase found them, that is the
+           order of the single threaded solver, so the results are bit identical whatever the thread count.
+        */
+
+        // Union find over body indices, the smallest index of an island is its root
+        static std::vector<uint32> island_parents;
+        // Contacts of island r are island_contacts[island_starts[r], island_starts[r + 1])
+        static std::vector<uint32> island_starts;
+        static std::vector<std::pair<uint32, uint32>> island_contacts;
+        static std::vector<std::pair<uint32, uint32>> solid_pairs;
+
+        static uint32 FindIsland(uint32 index)
+        {
+            while (island_parents[index] != index)
             {
-                // If we're not colliding with any object it's impossible to be on the ground
-                rb.on_ground = false;
+                island_parents[index] = island_parents[island_parents[index]];
+                index = island_parents[index];
             }
+            return index;
         }
 
-        static bool IsColliding(const HitBox &hb1, const Transform &tr1
-                , const HitBox &hb2, const Transform &tr2)
+        static void BuildIslands()
         {
-            glm::vec3 test_axes[3] = {
-                    glm::vec3(1, 0, 0),
-                    glm::vec3(0, 1, 0),
-                    glm::vec3(0, 0, 1) };
+            const auto num_bodies = (uint32)bodies.size();
+            island_parents.resize(num_bodies);
+            for (uint32 i = 0; i < num_bodies; i++)
+                island_parents[i] = i;
+            for (auto [index1, index2] : solid_pairs)
+            {
+                const uint32 root1 = FindIsland(index1), root2 = FindIsland(index2);
+                if (root1 < root2)
+                    island_parents[root2] = root1;
+                else
+                    island_parents[root1] = root2;
+            }
 
-            // negative axis face's position
-            glm::vec3 hb1_negative = tr1.position - (hb1.size * 0.5f);
-            glm::vec3 hb2_negative = tr2.position - (hb2.size * 0.5f);
+            // Counting sort of the contacts by island, stable so every island keeps the broadphase order
+            island_starts.assign(num_bodies + 1, 0);
+            for (auto [index1, index2] : solid_pairs)
+                island_starts[FindIsland(index1) + 1]++;
+            for (uint32 i = 0; i < num_bodies; i++)
+                island_starts[i + 1] += island_starts[i];
+            island_contacts.resize(solid_pairs.size());
+            for (auto pair : solid_pairs)
+                island_contacts[island_starts[FindIsland(pair.first)]++] = pair;
+            // Filling moved every start to the start of the next island, move them back
+            for (uint32 i = num_bodies; i > 0; i--)
+                island_starts[i] = island_starts[i - 1];
+            island_starts[0] = 0;
+        }
 
-            // positive axis face's position
-            glm::vec3 hb1_positive = tr1.position + (hb1.size * 0.5f);
-            glm::vec3 hb2_positive = tr2.position + (hb2.size * 0.5f);
+        static void SolveIslands(uint32 begin, uint32 end)
+        {
+            ChunkCache cache;
+            for (uint32 root = begin; root < end; root++)
+                for (uint32 i = island_starts[root]; i < island_starts[root + 1]; i++)
+                    ResolveBodyContact(cache, bodies[island_contacts[i].first], bodies[island_contacts[i].second]);
+        }
 
-            // check each face if there is an overlapping
+        // Push an awake body out of a sleeping one, the sleeping body does not move
+        // Parameters: chunk cache, awake body, sleeping body, box of the sleeping body
+        static void ResolveSleepingContact(ChunkCache& cache, Body& body, Body& sleeping_body, const AABB& sleeping_box)
+        {
+            AABB box = GetBodyBox(*body.transform, *body.hit_box);
+            if (!box.IsOverlapping(sleeping_box))
+                return;
+
+            RigidBody& rb = *body.rb;
+            if (glm::length2(rb.velocity) > kWakeVelocity * kWakeVelocity && sleeping_body.rb->is_sleeping)
+                WakeBody(*sleeping_body.rb, sleeping_box);
+
+            const glm::vec3 overlap = glm::min(box.max, sleeping_box.max) - glm::max(box.min, sleeping_box.min);
+            int axis = 0;
+            if (overlap.y < overlap[axis])
+                axis = 1;
+            if (overlap.z < overlap[axis])
+                axis = 2;
+
+            const float side = body.transform->position[axis] < sleeping_body.transform->position[axis] ? -1.0f : 1.0f;
+            body.transform->position[axis] += SweepAxis(cache, box, axis, side * overlap[axis]);
+            if (rb.velocity[axis] * side < 0.0f)
+                rb.velocity[axis] = 0.0f;
+            if (axis == 1 && side > 0.0f)
+                rb.on_ground = true;
+        }
 
-            /*for (int i = 0; i < 3; i++)
-            {
-                float f1_positive = glm::dot(hb1_positive, test_axes[i]);
-                float f2_negative = glm::dot(hb2_negative, test_axes[i]);
-                if (f2_negative - f1_positive <= 0.001f)
-                    return true;
+        // Resolve the contacts of awake bodies with sleeping ones, in body order
+        static void ResolveSleepingContacts()
+        {
+            if (sleeping_broadphase.NumBoxes() == 0)
+                return;
 
-                float f1_negative = glm::dot(hb1_negative, test_axes[i]);
-                float f2_positive = glm::dot(hb2_positive, test_axes[i]);
-                if (f1_negative - f2_positive <= 0.001f)
-                    return true;
+            static std::vector<uint32> ids;
+            ChunkCache cache;
+            for (uint32 i = 0; i < bodies.size(); i++)
+            {
+                Body& body = bodies[i];
+                sleeping_broadphase.QueryAABB(GetBodyBox(*body.transform, *body.hit_box), ids);
+                for (uint32 id : ids)
+                {
+                    if (body.rb->is_sensor)
+                        sensor_overlaps.emplace_back(body.entity, sleeping_bodies[id].entity);
+                    else
+                        ResolveSleepingContact(cache, body, sleeping_bodies[id], sleeping_boxes[id]);
+                }
             }
-            return false;
-            */
+        }
 
-            for (auto test_axe : test_axes)
+        static void UpdateStillSteps(uint32 begin, uint32 end)
+        {
+            for (uint32 i = begin; i < end; i++)
             {
-                float penetration = PenetrationAmount(hb1_negative, hb1_positive
-                                                      , hb2_negative, hb2_positive
-                                                      , test_axe);
-                if (glm::abs(penetration) <= 0.001f)
-                    return false;
+                RigidBody& rb = *bodies[i].rb;
+                // Sensors never sleep, they have to keep reporting overlaps
+                const bool is_still = !rb.is_sensor && (rb.on_ground || !rb.use_gravity)
+                                      && rb.acceleration == glm::vec3(0.0f)
+                                      && glm::length2(rb.velocity) < kSleepVelocity * kSleepVelocity;
+                rb.num_still_steps = is_still ? std::min<uint16>(rb.num_still_steps + 1, kStepsToSleep) : 0;
             }
-            return true;
         }
 
-        static float PenetrationAmount(const glm::vec3 &hb1_negative, const glm::vec3 &hb1_positive
-                                    ,const glm::vec3 &hb2_negative, const glm::vec3 &hb2_positive
-                                    , const glm::vec3 &axis)
+        // Rebuild the broadphase from the moved bodies, then resolve the body pairs it finds
+        static void ResolveContacts()
         {
-            if (axis == glm::vec3(1, 0, 0))
-            {
-                if ((hb2_negative.x <= hb1_positive.x) && (hb1_negative.x <= hb2_positive.x))
+            broadphase.Build(body_boxes.data(), (uint32)body_boxes.size());
+            const uint32 num_buckets = broadphase.NumBuckets();
+            range_pairs.resize((num_buckets + kBucketsPerJob - 1) / kBucketsPerJob);
+            ParallelFor(num_buckets, kBucketsPerJob, FindPairsInBuckets);
+
+            sensor_overlaps.clear();
+            solid_pairs.clear();
+            for (const auto& pairs : range_pairs)
+                for (auto [index1, index2] : pairs)
                 {
-                    // We have penetration
-                    return hb2_negative.x - hb1_positive.x;
+                    const Body& body1 = bodies[index1];
+                    const Body& body2 = bodies[index2];
+                    if (!body1.rb->is_sensor && !body2.rb->is_sensor)
+                    {
+                        solid_pairs.emplace_back(index1, index2);
+                        continue;
+                    }
+                    if (body1.rb->is_sensor)
+                        sensor_overlaps.emplace_back(body1.entity, body2.entity);
+                    if (body2.rb->is_sensor)
+                        sensor_overlaps.emplace_back(body2.entity, body1.entity);
                 }
+
+            BuildIslands();
+            ParallelFor((uint32)bodies.size(), kBodiesPerJob, SolveIslands);
+            ResolveSleepingContacts();
+            ParallelFor((uint32)bodies.size(), kBodiesPerJob, UpdateStillSteps);
+            UpdateSensorEvents();
+        }
+
+        // Wake the sleeping bodies standing on the wake boxes, and the ones standing on those, and move them
+        // to the awake bodies
+        static void WakeTouchingBodies()
+        {
+            if (wake_boxes.empty() || sleeping_bodies.empty())
+            {
+                wake_boxes.clear();
+                return;
             }
-            else if (axis == glm::vec3(0, 1, 0))
+
+            // WakeBody adds the box of every woken body, the loop goes on until no more bodies wake
+            static std::vector<uint32> ids;
+            sleeping_broadphase.Build(sleeping_boxes.data(), (uint32)sleeping_boxes.size());
+            for (size_t i = 0; i < wake_boxes.size(); i++)
             {
-                if ((hb2_negative.y <= hb1_positive.y) && (hb1_negative.y <= hb2_positive.y))
-                {
-                    // We have penetration
-                    return hb2_positive.y - hb1_negative.y;
-                }
+                sleeping_broadphase.QueryAABB(ExpandBox(wake_boxes[i], kWakeMargin), ids);
+                for (uint32 id : ids)
+                    if (sleeping_bodies[id].rb->is_sleeping && sleeping_boxes[id].min.y >= wake_boxes[i].max.y - kWakeMargin)
+                        WakeBody(*sleeping_bodies[id].rb, sleeping_boxes[id]);
             }
-            else if (axis == glm::vec3(0, 0, 1))
+            wake_boxes.clear();
+
+            uint32 num_sleeping = 0;
+            for (uint32 i = 0; i < sleeping_bodies.size(); i++)
             {
-                if ((hb2_negative.z <= hb1_positive.z) && (hb1_negative.z <= hb2_positive.z))
+                if (!sleeping_bodies[i].rb->is_sleeping)
                 {
-                    // We have penetration
-                    return hb2_negative.z - hb1_positive.z;
+                    bodies.push_back(sleeping_bodies[i]);
+                    continue;
                 }
+                sleeping_bodies[num_sleeping] = sleeping_bodies[i];
+                sleeping_boxes[num_sleeping] = sleeping_boxes[i];
+                num_sleeping++;
             }
-
-            return 0.0f;
+            sleeping_bodies.resize(num_sleeping);
+            sleeping_boxes.resize(num_sleeping);
+            // The broadphase holds the bodies from before waking
+            sleeping_broadphase_entities.clear();
         }
 
-
-
-        static CollisionInfo StaticCollisionInformation(const RigidBody& rb1, const HitBox &hb1, const Transform& tr1
-                , const HitBox &hb2, const Transform& tr2)
+        // Rebuild the sleeping broadphase, unless the sleeping bodies and their boxes are the same as last time
+        static void UpdateSleepingBroadphase()
         {
-            CollisionInfo res{};
-            res.did_collision = true;
-            HitBox hb2_expanded = hb2;
-            hb2_expanded.size += hb1.size;
+            bool is_unchanged = sleeping_broadphase_entities.size() == sleeping_bodies.size();
+            for (uint32 i = 0; i < sleeping_bodies.size() && is_unchanged; i++)
+            {
+                const AABB& box = sleeping_broadphase.GetBox(i);
+                is_unchanged = sleeping_broadphase_entities[i] == sleeping_bodies[i].entity
+                               && box.min == sleeping_boxes[i].min && box.max == sleeping_boxes[i].max;
+            }
+            if (is_unchanged)
+                return;
 
-            // Figure out which quadrant the collision is and resolve it
-            glm::vec3 hb1_to_hb2 = tr1.position - tr2.position;
+            sleeping_broadphase.Build(sleeping_boxes.data(), (uint32)sleeping_boxes.size());
+            sleeping_broadphase_entities.clear();
+            for (const Body& body : sleeping_bodies)
+                sleeping_broadphase_entities.push_back(body.entity);
+        }
 
-            if (hb1_to_hb2.x > 0 && hb1_to_hb2.y > 0 && hb1_to_hb2.z > 0)
+        static void GatherBodies(ECS::Registry& registry)
+        {
             {
-                // We are in the top-right-front quadrant
-                GetQuadrantResult(tr1, tr2, hb2_expanded, &res, Direction::LEFT, Direction::BOTTOM, Direction::BACK);
+                std::lock_guard<std::mutex> lock(changed_blocks_mutex);
+                wake_boxes.insert(wake_boxes.end(), changed_block_boxes.begin(), changed_block_boxes.end());
+                changed_block_boxes.clear();
             }
-            else if (hb1_to_hb2.x > 0 && hb1_to_hb2.y > 0 && hb1_to_hb2.z <= 0)
+
+            bodies.clear();
+            sleeping_bodies.clear();
+            sleeping_boxes.clear();
+            // Only the awake bodies take a mutable transform, which marks it changed, resting ones stay untouched
+            for (auto [entity, transform, rb, hit_box] : registry.View<const Transform, RigidBody, const HitBox>())
             {
-                // We are in the top-right-back quadrant
-                GetQuadrantResult(tr1, tr2, hb2_expanded, &res, Direction::LEFT, Direction::BOTTOM, Direction::FRONT);
+                const AABB box = GetBodyBox(transform, hit_box);
+                if (rb.is_sleeping && (rb.velocity != glm::vec3(0.0f) || rb.acceleration != glm::vec3(0.0f)))
+                    WakeBody(rb, box);
+                else if (!rb.is_sleeping && rb.num_still_steps >= kStepsToSleep)
+                {
+                    rb.is_sleeping = true;
+                    rb.velocity = glm::vec3(0.0f);
+                }
+
+                if (rb.is_sleeping)
+                {
+                    // A sleeping body doesn't move, its transform is only read until it is gathered awake
+                    sleeping_bodies.push_back({entity, const_cast<Transform*>(&transform), &rb, &hit_box});
+                    sleeping_boxes.push_back(box);
+                }
+                else
+                    bodies.push_back({entity, &registry.GetComponent<Transform>(entity), &rb, &hit_box});
             }
-            else if (hb1_to_hb2.x > 0 && hb1_to_hb2.y <= 0 && hb1_to_hb2.z > 0)
+            const size_t num_gathered = bodies.size();
+            WakeTouchingBodies();
+            // The bodies woken by changed blocks move from now on too
+            for (size_t i = num_gathered; i < bodies.size(); i++)
+                bodies[i].transform = &registry.GetComponent<Transform>(bodies[i].entity);
+            UpdateSleepingBroadphase();
+            body_boxes.resize(bodies.size());
+        }
+
+        // Insert, move and remove the proxies of the entities with a hit box
+        // A proxy only moves in the tree when its entity leaves the fattened box
+        static void UpdateEntityTree(ECS::Registry& registry)
+        {
+            entity_tree_stamp++;
+            uint32 num_seen = 0;
+            for (auto [entity, transform, hit_box] : registry.View<const Transform, const HitBox>())
             {
-                // We are in the bottom-right-front quadrant
-                GetQuadrantResult(tr1, tr2, hb2_expanded, &res, Direction::LEFT, Direction::TOP, Direction::BACK);
+                const AABB box = GetBodyBox(transform, hit_box);
+                const ECS::EntityIndex index = ECS::Internal::GetEntityIndex(entity);
+                if (index >= entity_proxies.size())
+                    entity_proxies.resize(index + 1, AABBTree::kNullNode);
+
+                int32& proxy = entity_proxies[index];
+                // The index may belong to a destroyed entity of an older version
+                if (proxy != AABBTree::kNullNode && entity_tree.GetUserData(proxy) != entity)
+                {
+                    entity_tree.DestroyProxy(proxy);
+                    proxy = AABBTree::kNullNode;
+                }
+                if (proxy == AABBTree::kNullNode)
+                    proxy = entity_tree.CreateProxy(box, entity);
+                else
+                    entity_tree.MoveProxy(proxy, box, box.min - proxy_boxes[proxy].min);
+
+                if ((size_t)proxy >= proxy_boxes.size())
+                {
+                    proxy_boxes.resize(proxy + 1);
+                    proxy_stamps.resize(proxy + 1);
+                }
+                proxy_boxes[proxy] = box;
+                proxy_stamps[proxy] = entity_tree_stamp;
+                num_seen++;
             }
-            else if (hb1_to_hb2.x > 0 && hb1_to_hb2.y <= 0 && hb1_to_hb2.z <= 0)
+            if (num_seen == entity_tree.NumProxies())
+                return;
+
+            // Entities destroyed or without a hit box since the last update
+            for (int32& proxy : entity_proxies)
+                if (proxy != AABBTree::kNullNode && proxy_stamps[proxy] != entity_tree_stamp)
+                {
+                    entity_tree.DestroyProxy(proxy);
+                    proxy = AABBTree::kNullNode;
+                }
+        }
+
+        static void RunSteps(ECS::Registry& registry, int num_steps)
+        {
+            if (num_steps == 0)
+                return;
+
+            // Registries without drawn entities, e.g. of benchmarks, have no interpolated transforms
+            const bool has_interpolation =
+                    registry.IsComponentRegistered(ECS::Internal::GetComponentType<InterpolatedTransform>());
+
+            GatherBodies(registry);
+            for (int step = 0; step < num_steps; step++)
             {
-                // We are in the bottom-right-back quadrant
-                GetQuadrantResult(tr1, tr2, hb2_expanded, &res, Direction::LEFT, Direction::TOP, Direction::FRONT);
+                // Only the last two ticks are drawn, resting bodies already hold their position
+                if (has_interpolation && step == num_steps - 1)
+                    for (auto [entity, transform, interpolated] :
+                         registry.View<const Transform, const InterpolatedTransform>())
+                        if (interpolated.previous_position != transform.position)
+                            registry.GetComponent<InterpolatedTransform>(entity).previous_position = transform.position;
+
+                ParallelFor((uint32)bodies.size(), kBodiesPerJob, IntegrateBodies);
+                ResolveContacts();
             }
-            else if (hb1_to_hb2.x <= 0 && hb1_to_hb2.y > 0 && hb1_to_hb2.z > 0)
+
+            if (has_interpolation)
+                for (auto [entity, transform, interpolated] :
+                     registry.View<const Transform, const InterpolatedTransform>())
+                    if (interpolated.current_position != transform.position)
+                        registry.GetComponent<InterpolatedTransform>(entity).current_position = transform.position;
+            // Frames without an entity query don't pay for the tree
+            stale_entity_tree_registry = &registry;
+        }
+
+        static void RunFrameSteps(ECS::Registry& registry, const ECS::SystemSlice& slice)
+        {
+            RunSteps(registry, num_frame_steps);
+        }
+
+        void Update(ECS::Registry& registry)
+        {
+            PrepareSteps(registry);
+            RunSteps(registry, num_frame_steps);
+        }
+
+        void Clear()
+        {
+            bodies.clear();
+            body_boxes.clear();
+            broadphase.Build(nullptr, 0);
+            sensor_overlaps.clear();
+            previous_sensor_overlaps.clear();
+            sensor_events.clear();
+            sleeping_bodies.clear();
+            sleeping_boxes.clear();
+            sleeping_broadphase.Build(nullptr, 0);
+            sleeping_broadphase_entities.clear();
+            wake_boxes.clear();
+            entity_tree.Clear();
+            stale_entity_tree_registry = nullptr;
+            entity_proxies.clear();
+            proxy_boxes.clear();
+            proxy_stamps.clear();
+            std::lock_guard<std::mutex> lock(changed_blocks_mutex);
+            changed_block_boxes.clear();
+        }
+
+        void OnBlockChanged(const glm::ivec3 &block_position)
+        {
+            std::lock_guard<std::mutex> lock(changed_blocks_mutex);
+            changed_block_boxes.push_back({glm::vec3(block_position), glm::vec3(block_position) + glm::vec3(1.0f)});
+        }
+
+        uint32 GetNumAwakeBodies()
+        {
+            return (uint32)bodies.size();
+        }
+
+        void SetThreadPool(GlobalThreadPool* pool)
+        {
+            thread_pool = pool;
+        }
+
+        void Step(ECS::Registry& registry)
+        {
+            sensor_events.clear();
+            RunSteps(registry, 1);
+        }
+
+        ECS::System GetSystem()
+        {
+            ECS::System system{"Physics"};
+            system.reads = ECS::Internal::MakeComponentSignature<HitBox>();
+            system.writes = ECS::Internal::MakeComponentSignature<Transform, RigidBody, InterpolatedTransform>();
+            // Bodies push each other, so every body has to finish a step before the contacts of the step
+            // are resolved, the steps run as one job that splits every step into jobs of its own
+            system.update = RunFrameSteps;
+            system.prepare = PrepareSteps;
+            return system;
+        }
+
+        void QueryAABB(const glm::vec3 &min, const glm::vec3 &max, std::vector<ECS::EntityId> &out_entities)
+        {
+            static std::vector<uint32> ids;
+            broadphase.QueryAABB({min, max}, ids);
+            out_entities.clear();
+            for (uint32 id : ids)
+                out_entities.push_back(bodies[id].entity);
+            // Resting bodies are only in the sleeping broadphase
+            if (sleeping_broadphase.NumBoxes() == 0)
+                return;
+            sleeping_broadphase.QueryAABB({min, max}, ids);
+            for (uint32 id : ids)
+                out_entities.push_back(sleeping_bodies[id].entity);
+        }
+
+        void QueryRadius(const glm::vec3 &center, float radius, std::vector<ECS::EntityId> &out_entities)
+        {
+            static std::vector<uint32> ids;
+            broadphase.QueryRadius(center, radius, ids);
+            out_entities.clear();
+            for (uint32 id : ids)
+                out_entities.push_back(bodies[id].entity);
+            // Resting bodies are only in the sleeping broadphase
+            if (sleeping_broadphase.NumBoxes() == 0)
+                return;
+            sleeping_broadphase.QueryRadius(center, radius, ids);
+            for (uint32 id : ids)
+                out_entities.push_back(sleeping_bodies[id].entity);
+        }
+
+        const std::vector<SensorEvent>& GetSensorEvents()
+        {
+            return sensor_events;
+        }
+
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Ray casting
+
+        // Amanatides-Woo voxel traversal, see http://www.cse.yorku.ca/~amana/research/grid.pdf
+        // Steps from block to block along the ray, always into the block whose boundary the ray crosses first,
+        // the block the ray starts in is never hit
+        static RaycastStaticResult CastRay(ChunkCache& cache, const glm::vec3& origin, const glm::vec3& direction,
+                                           float max_distance)
+        {
+            RaycastStaticResult result{};
+            result.hit = false;
+            if (direction == glm::vec3(0.0f))
+                return result;
+
+            glm::ivec3 block = glm::floor(origin);
+            glm::ivec3 step;
+            // Distance along the ray to cross one block, and to the next boundary on each axis
+            glm::vec3 t_delta, t_max;
+            for (int axis = 0; axis < 3; axis++)
             {
-                // We are in the top-left-front quadrant
-                GetQuadrantResult(tr1, tr2, hb2_expanded, &res, Direction::RIGHT, Direction::BOTTOM, Direction::BACK);
+                if (direction[axis] == 0.0f)
+                {
+                    step[axis] = 0;
+                    t_delta[axis] = FLT_MAX;
+                    t_max[axis] = FLT_MAX;
+                    continue;
+                }
+                step[axis] = direction[axis] > 0.0f ? 1 : -1;
+                t_delta[axis] = glm::abs(1.0f / direction[axis]);
+                const float boundary = direction[axis] > 0.0f ? (float)(block[axis] + 1) : (float)block[axis];
+                t_max[axis] = (boundary - origin[axis]) / direction[axis];
             }
-            else if (hb1_to_hb2.x <= 0 && hb1_to_hb2.y > 0 && hb1_to_hb2.z <= 0)
+
+            while (true)
             {
-                // We are in the top-left-back quadrant
-                GetQuadrantResult(tr1, tr2, hb2_expanded, &res, Direction::RIGHT, Direction::BOTTOM, Direction::FRONT);
+                int axis = t_max.x < t_max.y ? 0 : 1;
+                if (t_max.z < t_max[axis])
+                    axis = 2;
+
+                const float distance = t_max[axis];
+                if (distance > max_distance)
+                    return result;
+
+                block[axis] += step[axis];
+                t_max[axis] += t_delta[axis];
+                if (!cache.IsSolid(block.x, block.y, block.z))
+                    continue;
+
+                result.hit = true;
+                result.distance = distance;
+                result.point = origin + direction * distance;
+                result.block_position = block;
+                result.block_center = glm::vec3(block) + glm::vec3(0.5f);
+                result.block_size = glm::vec3(1.0f);
+                // The ray entered through the face looking back at it
+                result.hit_normal = glm::vec3(0.0f);
+                result.hit_normal[axis] = (float)-step[axis];
+                return result;
             }
-            else if (hb1_to_hb2.x <= 0 && hb1_to_hb2.y <= 0 && hb1_to_hb2.z > 0)
+        }
+
+        RaycastStaticResult RayCastStatic(const glm::vec3 &origin, const glm::vec3 &normal_direction
+                , float max_distance, bool draw)
+        {
+            ChunkCache cache;
+            return CastRay(cache, origin, normal_direction, max_distance);
+        }
+
+        // Bring the entity tree up to the last steps before a query
+        static void CatchUpEntityTree()
+        {
+            if (stale_entity_tree_registry == nullptr)
+                return;
+            UpdateEntityTree(*stale_entity_tree_registry);
+            stale_entity_tree_registry = nullptr;
+        }
+
+        // Nearest entity along a ray, against the boxes of the entities at the end of the last steps
+        static RaycastEntityResult CastEntityRay(const glm::vec3& origin, const glm::vec3& direction, float max_distance,
+                                                 ECS::EntityId ignored_entity)
+        {
+            CatchUpEntityTree();
+            RaycastEntityResult result{};
+            result.entity = ECS::null_entity;
+            result.hit = false;
+            if (direction == glm::vec3(0.0f))
+                return result;
+
+            const glm::vec3 inverse_direction = 1.0f / direction;
+            int32 hit_proxy = AABBTree::kNullNode;
+            entity_tree.RayCast(origin, direction, max_distance, [&](int32 proxy, float distance_limit)
             {
-                // We are in the bottom-left-front quadrant
-                GetQuadrantResult(tr1, tr2, hb2_expanded, &res, Direction::RIGHT, Direction::TOP, Direction::BACK);
-            }
-            else if (hb1_to_hb2.x <= 0 && hb1_to_hb2.y <= 0 && hb1_to_hb2.z <= 0)
+                float distance;
+                if (entity_tree.GetUserData(proxy) == ignored_entity
+                    || !IntersectRay(proxy_boxes[proxy], origin, inverse_direction, distance_limit, distance))
+                    return distance_limit;
+                hit_proxy = proxy;
+                result.distance = distance;
+                // Nothing behind the hit can be nearer
+                return distance;
+            });
+            if (hit_proxy == AABBTree::kNullNode)
+                return result;
+
+            result.hit = true;
+            result.entity = entity_tree.GetUserData(hit_proxy);
+            result.point = origin + direction * result.distance;
+            // The ray entered through the face of the axis it crossed last, a ray starting inside has no face
+            result.hit_normal = glm::vec3(0.0f);
+            if (result.distance > 0.0f)
             {
-                // We are in the bottom-left-back quadrant
-                GetQuadrantResult(tr1, tr2, hb2_expanded, &res, Direction::RIGHT, Direction::TOP, Direction::FRONT);
+                const AABB& box = proxy_boxes[hit_proxy];
+                const glm::vec3 t_near = glm::min((box.min - origin) * inverse_direction, (box.max - origin) * inverse_direction);
+                int axis = t_near.x > t_near.y ? 0 : 1;
+                if (t_near.z > t_near[axis])
+                    axis = 2;
+                result.hit_normal[axis] = direction[axis] > 0.0f ? -1.0f : 1.0f;
             }
-            else
+            return result;
+        }
+
+        RaycastEntityResult RayCastEntities(const glm::vec3 &origin, const glm::vec3 &normal_direction, float max_distance,
+                                            ECS::EntityId ignored_entity)
+        {
+            return CastEntityRay(origin, normal_direction, max_distance, ignored_entity);
+        }
+
+        RaycastEntityResult SegmentCastEntities(const glm::vec3 &start, const glm::vec3 &end, ECS::EntityId ignored_entity)
+        {
+            const float length = glm::length(end - start);
+            if (length == 0.0f)
             {
-                AmoLogger_Error("Could not evaluate physics calculation.");
-                res.did_collision = false;
+                RaycastEntityResult result{};
+                result.entity = ECS::null_entity;
+                result.hit = false;
+                return result;
             }
-            return res;
+            return CastEntityRay(start, (end - start) / length, length, ignored_entity);
         }
 
-        static float GetDirection(Direction face)
+        void QueryFrustum(const Frustum &frustum, const glm::vec3 &eye, std::vector<ECS::EntityId> &out_entities)
         {
-            switch (face)
+            static std::vector<int32> proxies;
+            static std::vector<std::pair<float, ECS::EntityId>> sorted_entities;
+            CatchUpEntityTree();
+            entity_tree.QueryFrustum(frustum, proxies);
+            sorted_entities.clear();
+            for (int32 proxy : proxies)
             {
-                case Direction::BACK:
-                    return 1;
-                case Direction::FRONT:
-                    return -1;
-                case Direction::RIGHT:
-                    return -1;
-                case Direction::LEFT:
-                    return 1;
-                case Direction::TOP:
-                    return -1;
-                case Direction::BOTTOM:
-                    return 1;
-                case Direction::NONE:
-                    AmoLogger_Error("Could not get direction from face!");
+                const AABB& box = proxy_boxes[proxy];
+                if (!frustum.IsOverlapping(box))
+                    continue;
+                // Distance from the eye to the closest point of the box
+                const glm::vec3 offset = glm::clamp(eye, box.min, box.max) - eye;
+                sorted_entities.emplace_back(glm::dot(offset, offset), entity_tree.GetUserData(proxy));
             }
-            return 0.0001f;
+            std::sort(sorted_entities.begin(), sorted_entities.end());
+
+            out_entities.clear();
+            for (const auto& [distance_squared, entity] : sorted_entities)
+                out_entities.push_back(entity);
         }
 
-        static void GetQuadrantResult(const Transform &tr1, const Transform &tr2, const HitBox &hb2_expanded
-                , CollisionInfo* res ,Direction x_face, Direction y_face, Direction z_face)
+        uint32 GetNumEntityTreeProxies()
         {
-            float x_direction = GetDirection(x_face);
-            float y_direction = GetDirection(y_face);
-            float z_direction = GetDirection(z_face);
+            CatchUpEntityTree();
+            return entity_tree.NumProxies();
+        }
 
-            glm::vec3 hb2_expanded_size_by_direction = {
-                    hb2_expanded.size.x * x_direction,
-                    hb2_expanded.size.y * y_direction,
-                    hb2_expanded.size.z * z_direction
-            };
-            glm::vec3 quadrant = (hb2_expanded_size_by_direction * 0.5f) + tr2.position;
-            glm::vec3 delta = tr1.position - quadrant;
-            glm::vec3 abs_delta = glm::abs(delta);
+        // Rays of the current RayCastMany, and their order sorted by chunk
+        static const Ray* batch_rays = nullptr;
+        static RaycastStaticResult* batch_results = nullptr;
+        static std::vector<std::pair<uint64, uint32>> batch_order;
 
-            if (abs_delta.x < abs_delta.y && abs_delta.x < abs_delta.z)
-            {
-                // We are colliding with the right-face
-                res->overlap_part = delta.x * glm::vec3(1, 0, 0);
-                res->force = x_face;
-            }
-            else if (abs_delta.y < abs_delta.x && abs_delta.y < abs_delta.z)
+        static void CastBatchRays(uint32 begin, uint32 end)
+        {
+            ChunkCache cache;
+            for (uint32 i = begin; i < end; i++)
             {
-                // We are colliding with the top-face
-                res->overlap_part = delta.y * glm::vec3(0, 1, 0);
-                res->force = y_face;
+                const Ray& ray = batch_rays[batch_order[i].second];
+                batch_results[batch_order[i].second] = CastRay(cache, ray.origin, ray.direction, ray.max_distance);
             }
-            else
+        }
+
+        void RayCastMany(const Ray* rays, uint32 num_rays, RaycastStaticResult* out_results)
+        {
+            // Rays starting in the same chunk mostly read the same chunk, one after another they keep
+            // the chunk cache and the blocks in the CPU cache warm
+            batch_order.resize(num_rays);
+            for (uint32 i = 0; i < num_rays; i++)
             {
-                // We are colliding with the front-face
-                res->overlap_part = delta.z * glm::vec3(0, 0, 1);
-                res->force = z_face;
+                const glm::ivec3 block = glm::floor(rays[i].origin);
+                const uint64 chunk_key = ((uint64)(uint32)(block.x >> 4) << 32) | (uint32)(block.z >> 4);
+                batch_order[i] = {chunk_key, i};
             }
+            std::sort(batch_order.begin(), batch_order.end());
+
+            batch_rays = rays;
+            batch_results = out_results;
+            ParallelFor(num_rays, kBodiesPerJob, CastBatchRays);
+            batch_rays = nullptr;
+            batch_results = nullptr;
         }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Functions Implementation
+
+        // Resolve static collision
+        // Parameters: entity id, rigid body, transform, hit box
 /*
         static Interval GetInterval(const HitBox& box, const Transform& transform, const glm::vec3& axis)
         {
@@ -0,0 +1,146 @@
+//
+// Created by Amo on 2022/7/29.
+//
+
+#include "core/ECS/Systems/spatial_hash.h"
+
+namespace SymoCraft::Physics
+    {
+        SpatialHash::SpatialHash(float cell_size)
+        : m_cell_size(cell_size), m_inverse_cell_size(1.0f / cell_size)
+        {
+        }
+
+        void SpatialHash::Build(const AABB *boxes, uint32 num_boxes)
+        {
+            m_boxes.assign(boxes, boxes + num_boxes);
+
+            // Twice as many buckets as boxes keeps the chains short
+            uint32 num_buckets = 16;
+            while (num_buckets < num_boxes * 2)
+                num_buckets *= 2;
+            m_bucket_mask = num_buckets - 1;
+
+            // Count the entries of every bucket
+            m_bucket_starts.assign(num_buckets + 1, 0);
+            uint32 num_entries = 0;
+            for (const AABB& box : m_boxes)
+            {
+                const glm::ivec3 min_cell = GetCell(box.min), max_cell = GetCell(box.max);
+                for (int32 x = min_cell.x; x <= max_cell.x; x++)
+                    for (int32 y = min_cell.y; y <= max_cell.y; y++)
+                        for (int32 z = min_cell.z; z <= max_cell.z; z++)
+                        {
+                            m_bucket_starts[GetBucket({x, y, z}) + 1]++;
+                            num_entries++;
+                        }
+            }
+            for (uint32 bucket = 0; bucket < num_buckets; bucket++)
+                m_bucket_starts[bucket + 1] += m_bucket_starts[bucket];
+
+            // Fill the buckets in box order
+            m_entries.resize(num_entries);
+            std::vector<uint32>& next_entry = m_bucket_starts;
+            for (uint32 id = 0; id < num_boxes; id++)
+            {
+                const glm::ivec3 min_cell = GetCell(m_boxes[id].min), max_cell = GetCell(m_boxes[id].max);
+                for (int32 x = min_cell.x; x <= max_cell.x; x++)
+                    for (int32 y = min_cell.y; y <= max_cell.y; y++)
+                        for (int32 z = min_cell.z; z <= max_cell.z; z++)
+                        {
+                            const glm::ivec3 cell(x, y, z);
+                            m_entries[next_entry[GetBucket(cell)]++] = {cell, id};
+                        }
+            }
+            // Filling moved every start to the start of the next bucket, move them back
+            for (uint32 bucket = num_buckets; bucket > 0; bucket--)
+                m_bucket_starts[bucket] = m_bucket_starts[bucket - 1];
+            m_bucket_starts[0] = 0;
+        }
+
+        template<typename Visitor>
+        void SpatialHash::VisitOverlaps(const AABB &box, Visitor &&visit) const
+        {
+            if (m_boxes.empty())
+                return;
+
+            const glm::ivec3 min_cell = GetCell(box.min), max_cell = GetCell(box.max);
+            for (int32 x = min_cell.x; x <= max_cell.x; x++)
+                for (int32 y = min_cell.y; y <= max_cell.y; y++)
+                    for (int32 z = min_cell.z; z <= max_cell.z; z++)
+                    {
+                        const glm::ivec3 cell(x, y, z);
+                        const uint32 bucket = GetBucket(cell);
+                        for (uint32 i = m_bucket_starts[bucket]; i < m_bucket_starts[bucket + 1]; i++)
+                        {
+                            // Other cells share the bucket
+                            const CellEntry& entry = m_entries[i];
+                            if (entry.cell != cell)
+                                continue;
+
+                            const AABB& other = m_boxes[entry.id];
+                            if (!box.IsOverlapping(other) || GetCell(glm::max(box.min, other.min)) != cell)
+                                continue;
+                            visit(entry.id);
+                        }
+                    }
+        }
+
+        void SpatialHash::FindPairs(std::vector<std::pair<uint32, uint32>> &out_pairs) const
+        {
+            FindPairs(out_pairs, 0, NumBuckets());
+        }
+
+        void SpatialHash::FindPairs(std::vector<std::pair<uint32, uint32>> &out_pairs, uint32 first_bucket,
+                                    uint32 end_bucket) const
+        {
+            out_pairs.clear();
+            // Boxes sharing a cell share its bucket, so every pair is in one bucket and the entries
+            // are read in memory order instead of looking up the cells of every box
+            for (uint32 bucket = first_bucket; bucket < end_bucket; bucket++)
+            {
+                const uint32 end = m_bucket_starts[bucket + 1];
+                for (uint32 i = m_bucket_starts[bucket]; i < end; i++)
+                {
+                    const CellEntry& entry = m_entries[i];
+                    const AABB& box = m_boxes[entry.id];
+                    for (uint32 j = i + 1; j < end; j++)
+                    {
+                        const CellEntry& other_entry = m_entries[j];
+                        if (other_entry.cell != entry.cell)
+                            continue;
+
+                        const AABB& other = m_boxes[other_entry.id];
+                        if (!box.IsOverlapping(other) || GetCell(glm::max(box.min, other.min)) != entry.cell)
+                            continue;
+                        // Entries are filled in box order, the id of i is the smaller one
+                        out_pairs.emplace_back(entry.id, other_entry.id);
+                    }
+                }
+            }
+        }
+
+        void SpatialHash::QueryAABB(const AABB &box, std::vector<uint32> &out_ids) const
+        {
+            out_ids.clear();
+            VisitOverlaps(box, [&](uint32 id)
+            {
+                out_ids.push_back(id);
+            });
+        }
+
+        void SpatialHash::QueryRadius(const glm::vec3 &center, float radius, std::vector<uint32> &out_ids) const
+        {
+            out_ids.clear();
+            const AABB bounds{center - glm::vec3(radius), center + glm::vec3(radius)};
+            const float radius_squared = radius * radius;
+            VisitOverlaps(bounds, [&](uint32 id)
+            {
+                // Distance from the center to the closest point of the box
+                const glm::vec3 closest = glm::clamp(center, m_boxes[id].min, m_boxes[id].max);
+                const glm::vec3 offset = closest - center;
+                if (glm::dot(offset, offset) <= radius_squared)
+                    out_ids.push_back(id);
+            });
+        }
+    }
@@ -9,11 +9,23 @@ namespace SymoCraft
 {
     namespace TransformSystem
     {
+        static uint32 CountEntities(ECS::Registry &registry)
+        {
+            return registry.View<Transform>().Size();
+        }
+
         void Update(ECS::Registry &registry)
         {
-            for (ECS::EntityId entity : registry.View<Transform>())
+            UpdateSlice(registry, {0, UINT32_MAX, 0, registry.GetChangeTick()});
+        }
+
+        void UpdateSlice(ECS::Registry &registry, const ECS::SystemSlice& slice)
+        {
+            // The directions only depend on the transform, skip the ones nobody touched since the last run
+            for (auto [entity, transform] :
+                 registry.View<Transform>().Slice(slice.begin, slice.end).Changed<Transform>(slice.last_run_tick)
+                         .StampWith(slice.run_tick))
             {
-                Transform& transform = registry.GetComponent<Transform>(entity);
                 glm::vec3 front_direction;
                 front_direction.x = cos(glm::radians(transform.yaw)) * cos(glm::radians(transform.pitch));
                 front_direction.z = sin(glm::radians(transform.yaw)) * cos(glm::radians(transform.pitch));
@@ -25,5 +37,14 @@ namespace SymoCraft
                 transform.up = glm::normalize(glm::cross(transform.right, transform.front));
             }
         }
+
+        ECS::System GetSystem()
+        {
+            ECS::System system{"TransformSystem"};
+            system.writes = ECS::Internal::MakeComponentSignature<Transform>();
+            system.update = UpdateSlice;
+            system.count = CountEntities;
+            return system;
+        }
     }
 }
\ No newline at end of file
@@ -0,0 +1,300 @@
+//
+// Created by Amo on 2022/7/23.
+//
+
+#include "core/ECS/archetype_registry.h"
+#include "core.h"
+
+namespace SymoCraft::ECS
+    {
+        namespace Internal
+        {
+            static uint32 AlignColumn(uint32 offset)
+            {
+                return (offset + kArchetypeColumnAlignment - 1) & ~(kArchetypeColumnAlignment - 1);
+            }
+
+            // ----------------------------------------------------------------------
+            // Archetype Implement
+
+            void Archetype::Init(const ComponentSignature& archetype_signature, const std::vector<uint32>& sizes)
+            {
+                signature = archetype_signature;
+                column_of_type.fill(kNullColumn);
+
+                uint32 row_bytes = sizeof(EntityId);
+                for (int32 component_type = 0; component_type < (int32)sizes.size(); component_type++)
+                {
+                    if (!signature.test(component_type))
+                        continue;
+                    column_of_type[component_type] = (int16)component_types.size();
+                    component_types.push_back(component_type);
+                    component_sizes.push_back(sizes[component_type]);
+                    row_bytes += sizes[component_type];
+                }
+
+                // Leave room for the padding between columns, and keep at least one row per chunk
+                const uint32 padding = kArchetypeColumnAlignment * (uint32)component_types.size();
+                chunk_capacity = kArchetypeChunkBytes > padding ? (kArchetypeChunkBytes - padding) / row_bytes : 0;
+                chunk_capacity = glm::max(chunk_capacity, 1u);
+
+                uint32 offset = sizeof(EntityId) * chunk_capacity;
+                for (uint32 component_size : component_sizes)
+                {
+                    offset = AlignColumn(offset);
+                    column_offsets.push_back(offset);
+                    offset += component_size * chunk_capacity;
+                }
+                chunk_bytes = offset;
+                num_entities = 0;
+            }
+
+            void Archetype::Free()
+            {
+                for (ArchetypeChunk& chunk : chunks)
+                    AmoMemory_Free(chunk.data);
+                chunks.clear();
+                num_entities = 0;
+            }
+
+            uint32 Archetype::AllocateRow(EntityId entity)
+            {
+                if (num_entities == chunks.size() * chunk_capacity)
+                    chunks.push_back({(uint8*)AmoMemory_Allocate(chunk_bytes), 0});
+
+                const uint32 row = num_entities++;
+                ArchetypeChunk& chunk = chunks[row / chunk_capacity];
+                ((EntityId*)chunk.data)[chunk.num_entities++] = entity;
+                return row;
+            }
+
+            EntityId Archetype::RemoveRow(uint32 row)
+            {
+                const uint32 last_row = --num_entities;
+                ArchetypeChunk& last_chunk = chunks.back();
+                last_chunk.num_entities--;
+
+                EntityId moved_entity = null_entity;
+                if (row != last_row)
+                {
+                    const uint32 chunk = row / chunk_capacity, slot = row % chunk_capacity;
+                    const uint32 last_slot = last_row % chunk_capacity;
+                    moved_entity = ((EntityId*)last_chunk.data)[last_slot];
+                    ((EntityId*)chunks[chunk].data)[slot] = moved_entity;
+                    for (size_t column = 0; column < component_sizes.size(); column++)
+                    {
+                        const uint32 size = component_sizes[column];
+                        AmoBase::AmoMemory_CopyMem(chunks[chunk].data + column_offsets[column] + (size_t)slot * size,
+                                                   last_chunk.data + column_offsets[column] + (size_t)last_slot * size,
+                                                   size);
+                    }
+                }
+
+                if (last_chunk.num_entities == 0)
+                {
+                    AmoMemory_Free(last_chunk.data);
+                    chunks.pop_back();
+                }
+                return moved_entity;
+            }
+        }
+
+        // ----------------------------------------------------------------------
+        // Archetype Registry Implement
+
+        void ArchetypeRegistry::Free()
+        {
+            for (Internal::Archetype& archetype : archetypes)
+                archetype.Free();
+        }
+
+        void ArchetypeRegistry::Clear()
+        {
+            Free();
+            entities.clear();
+            archetypes.clear();
+            archetype_of_signature.clear();
+            locations.clear();
+            component_sizes.clear();
+            free_entities.clear();
+            debug_component_names.clear();
+        }
+
+        EntityId ArchetypeRegistry::CreateEntity()
+        {
+            EntityId new_id;
+            if (!free_entities.empty())
+            {
+                EntityIndex new_index = free_entities.back();
+                free_entities.pop_back();
+                new_id = Internal::CreateEntityId(new_index, Internal::GetEntityVersion(entities[new_index]));
+                entities[new_index] = new_id;
+            }
+            else
+            {
+                new_id = Internal::CreateEntityId((uint32)entities.size(), 0);
+                entities.emplace_back(new_id);
+                locations.emplace_back();
+            }
+
+            // New entities start in the archetype without components
+            const uint32 empty_archetype = GetArchetype(Internal::ComponentSignature());
+            locations[Internal::GetEntityIndex(new_id)] = {empty_archetype, archetypes[empty_archetype].AllocateRow(new_id)};
+            return new_id;
+        }
+
+        int ArchetypeRegistry::NumComponents(EntityId entity) const
+        {
+            if (!IsEntityValid(entity))
+                return 0;
+            return (int)archetypes[locations[Internal::GetEntityIndex(entity)].archetype].component_types.size();
+        }
+
+        bool ArchetypeRegistry::IsEntityValid(EntityId entity) const
+        {
+            const EntityIndex index = Internal::GetEntityIndex(entity);
+            return index < entities.size() && entities[index] == entity;
+        }
+
+        void ArchetypeRegistry::DestroyEntity(EntityId entity)
+        {
+            if (!IsEntityValid(entity))
+            {
+                AmoLogger_Error("Tried to destroy invalid entity %d.", entity);
+                return;
+            }
+
+            const EntityIndex index = Internal::GetEntityIndex(entity);
+            const Internal::EntityLocation location = locations[index];
+            EntityId moved_entity = archetypes[location.archetype].RemoveRow(location.row);
+            if (moved_entity != null_entity)
+                locations[Internal::GetEntityIndex(moved_entity)].row = location.row;
+
+            entities[index] = Internal::CreateEntityId(UINT32_MAX, Internal::GetEntityVersion(entity) + 1);
+            free_entities.push_back(index);
+        }
+
+        bool ArchetypeRegistry::HasComponentByType(EntityId entity, int32 component_type) const
+        {
+            if (!IsEntityValid(entity))
+                return false;
+
+            if (component_type >= component_sizes.size() || component_type < 0)
+            {
+                AmoLogger_Warning("Tried to check if an entity had component '%d'"
+                                  ", but a component of type '%d' does not exist in the registry "
+                                  "which only has '%d' components."
+                                  , component_type, component_type, component_sizes.size());
+                return false;
+            }
+
+            return archetypes[locations[Internal::GetEntityIndex(entity)].archetype].signature.test(component_type);
+        }
+
+        uint8* ArchetypeRegistry::GetComponentByType(EntityId entity, int32 component_type) const
+        {
+            if (!HasComponentByType(entity, component_type))
+                return nullptr;
+
+            const Internal::EntityLocation& location = locations[Internal::GetEntityIndex(entity)];
+            return archetypes[location.archetype].GetComponent(location.row, component_type);
+        }
+
+        uint8* ArchetypeRegistry::AddOrGetComponentByType(EntityId entity, int32 component_type)
+        {
+            if (!IsEntityValid(entity))
+            {
+                AmoLogger_Error("Cannot add a component to invalid entity %d.", Internal::GetEntityIndex(entity));
+                return nullptr;
+            }
+
+            if (!IsComponentRegistered(component_type))
+            {
+                AmoLogger_Warning("Tried to add component '%d', but it does not exist in the registry"
+                                  , component_type);
+                return nullptr;
+            }
+
+            const EntityIndex index = Internal::GetEntityIndex(entity);
+            if (!HasComponentByType(entity, component_type))
+                MoveEntity(entity, GetNeighbourArchetype(locations[index].archetype, component_type, true));
+
+            return archetypes[locations[index].archetype].GetComponent(locations[index].row, component_type);
+        }
+
+        void ArchetypeRegistry::RemoveComponentByType(EntityId entity, int32 component_type)
+        {
+            if (!HasComponentByType(entity, component_type))
+                return;
+
+            const uint32 archetype = locations[Internal::GetEntityIndex(entity)].archetype;
+            MoveEntity(entity, GetNeighbourArchetype(archetype, component_type, false));
+        }
+
+        void ArchetypeRegistry::RemoveAllComponent(EntityId entity)
+        {
+            if (!IsEntityValid(entity))
+            {
+                AmoLogger_Error("Tried to remove invalid entity %d 's component.", entity);
+                return;
+            }
+
+            MoveEntity(entity, GetArchetype(Internal::ComponentSignature()));
+        }
+
+        uint32 ArchetypeRegistry::GetArchetype(const Internal::ComponentSignature& signature)
+        {
+            auto iter = archetype_of_signature.find(signature);
+            if (iter != archetype_of_signature.end())
+                return iter->second;
+
+            const auto archetype = (uint32)archetypes.size();
+            archetypes.emplace_back();
+            archetypes.back().Init(signature, component_sizes);
+            archetype_of_signature[signature] = archetype;
+            return archetype;
+        }
+
+        uint32 ArchetypeRegistry::GetNeighbourArchetype(uint32 archetype, int32 component_type, bool add)
+        {
+            auto& edges = add ? archetypes[archetype].add_edges : archetypes[archetype].remove_edges;
+            auto iter = edges.find(component_type);
+            if (iter != edges.end())
+                return iter->second;
+
+            Internal::ComponentSignature signature = archetypes[archetype].signature;
+            signature.set(component_type, add);
+            // GetArchetype may grow the archetype list, so don't hold the reference across it
+            const uint32 neighbour = GetArchetype(signature);
+            (add ? archetypes[archetype].add_edges : archetypes[archetype].remove_edges)[component_type] = neighbour;
+            return neighbour;
+        }
+
+        void ArchetypeRegistry::MoveEntity(EntityId entity, uint32 target_archetype)
+        {
+            Internal::EntityLocation& location = locations[Internal::GetEntityIndex(entity)];
+            if (location.archetype == target_archetype)
+                return;
+
+            Internal::Archetype& source = archetypes[location.archetype];
+            Internal::Archetype& target = archetypes[target_archetype];
+            const uint32 target_row = target.AllocateRow(entity);
+
+            for (size_t column = 0; column < target.component_types.size(); column++)
+            {
+                const int32 component_type = target.component_types[column];
+                uint8* target_data = target.GetComponent(target_row, component_type);
+                if (source.signature.test(component_type))
+                    AmoBase::AmoMemory_CopyMem(target_data, source.GetComponent(location.row, component_type),
+                                               target.component_sizes[column]);
+                else
+                    AmoBase::AmoMemory_ZeroMem(target_data, target.component_sizes[column]);
+            }
+
+            EntityId moved_entity = source.RemoveRow(location.row);
+            if (moved_entity != null_entity)
+                locations[Internal::GetEntityIndex(moved_entity)].row = location.row;
+
+            location = {target_archetype, target_row};
+        }
+    }
@@ -0,0 +1,47 @@
+//
+// Created by Amo on 2022/7/25.
+//
+
+#include "core/ECS/command_buffer.h"
+#include "core.h"
+
+namespace SymoCraft::ECS
+    {
+        namespace Internal
+        {
+            uint64 GenerateCommandBuffersId()
+            {
+                static std::atomic<uint64> next_id{1};
+                return next_id.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        EntityId CommandBuffer::CreateEntity()
+        {
+            EntityId deferred_entity = Internal::CreateEntityId(m_num_created_entities++, Internal::kDeferredEntityVersion);
+            Record(Internal::CommandType::CreateEntity, deferred_entity, -1, nullptr, 0);
+            return deferred_entity;
+        }
+
+        void CommandBuffer::DestroyEntity(EntityId entity)
+        {
+            Record(Internal::CommandType::DestroyEntity, entity, -1, nullptr, 0);
+        }
+
+        void CommandBuffer::Clear()
+        {
+            m_data.clear();
+            m_num_commands = 0;
+            m_num_created_entities = 0;
+        }
+
+        void CommandBuffer::Record(Internal::CommandType type, EntityId entity, int32 component_type,
+                                   const void *payload, uint32 payload_size)
+        {
+            Internal::CommandHeader header{type, component_type, entity, payload_size};
+            m_data.insert(m_data.end(), (const uint8*)&header, (const uint8*)&header + sizeof(header));
+            if (payload_size > 0)
+                m_data.insert(m_data.end(), (const uint8*)payload, (const uint8*)payload + payload_size);
+            m_num_commands++;
+        }
+    }
@@ -11,30 +11,22 @@ namespace SymoCraft::ECS
 
         namespace Internal
         {
-            int32 m_counter = 0;
-
             inline bool IsNull(EntityId entity)
             {
                 return Internal::GetEntityIndex(entity) == Internal::GetEntityIndex(null_entity);
             }
 
-            // ----------------------------------------------------------------------
-            // SparseSetPool Implement
-            void SparseSetPool::Init()
-            {
-                for (unsigned int & component_index : component_index_in_data)
-                    component_index = UINT32_MAX;
-                // UINT32_MAX means null index
-            }
-
             // ----------------------------------------------------------------------
             // ComponentContainer Implement
             void ComponentContainer::Free()
             {
-                if (pools != nullptr)
+                if (pages != nullptr)
                 {
-                    AmoMemory_Free(pools);
-                    pools = nullptr;
+                    for (uint32 i = 0; i < num_pages; i++)
+                        if (pages[i] != nullptr)
+                            AmoMemory_Free(pages[i]);
+                    AmoMemory_Free(pages);
+                    pages = nullptr;
                 }
 
                 if (entities != nullptr)
@@ -49,75 +41,191 @@ namespace SymoCraft::ECS
                     data = nullptr;
                 }
 
+                if (added_ticks != nullptr)
+                {
+                    AmoMemory_Free(added_ticks);
+                    added_ticks = nullptr;
+                }
+
+                if (changed_ticks != nullptr)
+                {
+                    AmoMemory_Free(changed_ticks);
+                    changed_ticks = nullptr;
+                }
+
                 max_num_components = 0;
                 num_components = 0;
-                num_pools = 0;
+                num_pages = 0;
             }
 
-            SparseSetPool* ComponentContainer::GetPool(EntityIndex index) const
+            ComponentIndex* ComponentContainer::AssureSparseSlot(EntityIndex index)
             {
-                for (int i = 0; i < num_pools; i++)
+                const uint32 page = index >> kSparsePageShift;
+                if (page >= num_pages)
                 {
-                    SparseSetPool& pool = pools[i];
-                    if (pool.start_entity_index <= index && pool.start_entity_index + kSpareSetPoolSize > index)
+                    // Grow the page table to cover the index, new pages stay unallocated
+                    uint32 new_num_pages = std::max(page + 1, num_pages * 2);
+                    auto new_pages = (ComponentIndex**) AmoMemory_ReAlloc(pages, new_num_pages * sizeof(ComponentIndex*));
+                    if (!new_pages)
                     {
-                        return &pool;
+                        AmoLogger_Error("Failed to allocate memory for the sparse page table of component '%d'", component_type);
+                        return nullptr;
                     }
+                    for (uint32 i = num_pages; i < new_num_pages; i++)
+                        new_pages[i] = nullptr;
+                    pages = new_pages;
+                    num_pages = new_num_pages;
                 }
 
-                return nullptr;
-            }
-
-            void ComponentContainer::Add(EntityId entity)
-            {
-                EntityIndex entity_index = GetEntityIndex(entity);
-                SparseSetPool* pool = GetPool(entity_index);
-                // no satisfying pool, add one
-                if (!pool)
-                {
-                    const int new_num_pools = num_pools + 1;
-                    // reallocate pools
-                    SparseSetPool* new_pools = (SparseSetPool*) AmoMemory_ReAlloc(pools
-                    , new_num_pools * sizeof(SparseSetPool));
-                    if (!new_pools)
+                if (!pages[page])
+                {
+                    pages[page] = (ComponentIndex*) AmoMemory_Allocate(kSparsePageSize * sizeof(ComponentIndex));
+                    if (!pages[page])
                     {
-                        AmoLogger_Error("Failed to allocate memory for new sparse set pool for component '%d'", component_type);
-                        return;
+                        AmoLogger_Error("Failed to allocate memory for new sparse page for component '%d'", component_type);
+                        return nullptr;
                     }
-                    num_pools = new_num_pools;
-                    pools = new_pools;
-                    pools[num_pools - 1].Init();
-                    pools[num_pools - 1].start_entity_index = GetPoolAlignedIndex(entity_index);
-                    pool = &pools[num_pools - 1];
+                    // UINT32_MAX means null index
+                    std::fill_n(pages[page], kSparsePageSize, kNullComponentIndex);
                 }
 
+                return &pages[page][index & kSparsePageMask];
+            }
+
+            uint8* ComponentContainer::AllocateComponent(EntityIndex index)
+            {
+                ComponentIndex* slot = AssureSparseSlot(index);
+                if (!slot)
+                    return nullptr;
+
                 // allocate memory for data
                 ComponentIndex next_component_index = num_components;
-                if (next_component_index >= max_num_components)
-                {
-                    int new_max_num_components = max_num_components * 2;
-                    char* new_component_memory = (char*) AmoMemory_ReAlloc(data
-                    , component_size * new_max_num_components);
-                    EntityIndex* new_entity_memory = (EntityIndex*) AmoMemory_ReAlloc(entities
-                    , sizeof(EntityIndex) * new_max_num_components);
-                    if (!new_component_memory || !new_entity_memory)
-                    {
-                        AmoMemory_Free(new_entity_memory);
-                        AmoMemory_Free(new_component_memory);
-                        AmoLogger_Error("Failed to allocate new memory for "
-                                        "component pool or entities for component '%d'"
-                        , component_type);
-                        return;
-                    }
-                    data = new_component_memory;
-                    entities = new_entity_memory;
-                    max_num_components = new_max_num_components;
-                }
+                if (next_component_index >= max_num_components && !Reserve(max_num_components * 2))
+                    return nullptr;
 
-                pool->component_index_in_data[entity_index - pool->start_entity_index] = next_component_index;
-                AmoBase::AmoMemory_ZeroMem(data + next_component_index * component_size, component_size);
-                entities[next_component_index] = entity_index;
+                *slot = next_component_index;
+                entities[next_component_index] = index;
+                added_ticks[next_component_index] = 0;
+                changed_ticks[next_component_index] = 0;
                 num_components++;
+                return (uint8*)(data + next_component_index * component_size);
+            }
+
+            bool ComponentContainer::Reserve(uint32 capacity)
+            {
+                if (capacity <= max_num_components)
+                    return true;
+
+                char* new_component_memory = (char*) AmoMemory_ReAlloc(data, component_size * capacity);
+                if (!new_component_memory)
+                {
+                    AmoLogger_Error("Failed to allocate new memory for component pool for component '%d'"
+                    , component_type);
+                    return false;
+                }
+                data = new_component_memory;
+
+                EntityIndex* new_entity_memory = (EntityIndex*) AmoMemory_ReAlloc(entities
+                , sizeof(EntityIndex) * capacity);
+                if (!new_entity_memory)
+                {
+                    AmoLogger_Error("Failed to allocate new memory for entities for component '%d'"
+                    , component_type);
+                    return false;
+                }
+                entities = new_entity_memory;
+
+                auto new_added_ticks = (uint32*) AmoMemory_ReAlloc(added_ticks, sizeof(uint32) * capacity);
+                if (!new_added_ticks)
+                {
+                    AmoLogger_Error("Failed to allocate new memory for change ticks for component '%d'"
+                    , component_type);
+                    return false;
+                }
+                added_ticks = new_added_ticks;
+
+                auto new_changed_ticks = (uint32*) AmoMemory_ReAlloc(changed_ticks, sizeof(uint32) * capacity);
+                if (!new_changed_ticks)
+                {
+                    AmoLogger_Error("Failed to allocate new memory for change ticks for component '%d'"
+                    , component_type);
+                    return false;
+                }
+                changed_ticks = new_changed_ticks;
+                max_num_components = capacity;
+                return true;
+            }
+
+            bool ComponentContainer::Assign(const EntityIndex *entity_indices, const uint8 *component_data,
+                                            uint32 count, uint32 tick)
+            {
+                // Empty the sparse slots of the old components, the pages stay allocated
+                for (uint32 i = 0; i < num_components; i++)
+                    *GetSparseSlot(entities[i]) = kNullComponentIndex;
+                num_components = 0;
+
+                if (!Reserve(count))
+                    return false;
+
+                for (uint32 i = 0; i < count; i++)
+                {
+                    ComponentIndex* slot = AssureSparseSlot(entity_indices[i]);
+                    if (!slot)
+                        return false;
+                    *slot = i;
+                }
+
+                if (count > 0)
+                {
+                    AmoBase::AmoMemory_CopyMem(entities, (void*)entity_indices, sizeof(EntityIndex) * count);
+                    AmoBase::AmoMemory_CopyMem(data, (void*)component_data, component_size * count);
+                }
+                std::fill_n(added_ticks, count, tick);
+                std::fill_n(changed_ticks, count, tick);
+                num_components = count;
+                return true;
+            }
+
+            bool ComponentContainer::AppendCopies(const EntityIndex *entity_indices, const uint8 *component_data,
+                                                  uint32 count, uint32 tick)
+            {
+                if (count == 0)
+                    return true;
+                if (num_components + count > max_num_components
+                    && !Reserve(std::max(num_components + count, max_num_components * 2)))
+                    return false;
+
+                const ComponentIndex first = num_components;
+                for (uint32 i = 0; i < count; i++)
+                {
+                    ComponentIndex* slot = AssureSparseSlot(entity_indices[i]);
+                    if (!slot)
+                        return false;
+                    AmoLogger_Assert(*slot == kNullComponentIndex, "Entity '%d' already has component '%d'",
+                                     entity_indices[i], component_type);
+                    *slot = first + i;
+                    entities[first + i] = entity_indices[i];
+                    num_components++;
+                }
+
+                // Copy the first component, then double the copies
+                char* copies = data + first * component_size;
+                AmoBase::AmoMemory_CopyMem(copies, (void*)component_data, component_size);
+                for (uint32 num_copied = 1; num_copied < count; num_copied *= 2)
+                {
+                    const uint32 num_to_copy = std::min(num_copied, count - num_copied);
+                    AmoBase::AmoMemory_CopyMem(copies + num_copied * component_size, copies, num_to_copy * component_size);
+                }
+                std::fill_n(added_ticks + first, count, tick);
+                std::fill_n(changed_ticks + first, count, tick);
+                return true;
+            }
+
+            void ComponentContainer::Add(EntityId entity)
+            {
+                uint8* component_data = AllocateComponent(GetEntityIndex(entity));
+                if (component_data)
+                    AmoBase::AmoMemory_ZeroMem(component_data, component_size);
             }
 
             uint8* ComponentContainer::AddOrGet(EntityId entity)
@@ -130,38 +238,37 @@ namespace SymoCraft::ECS
             void ComponentContainer::Remove(EntityId entity)
             {
                 const EntityIndex entity_index = GetEntityIndex(entity);
-                SparseSetPool* pool = GetPool(entity_index);
-                if (!pool || entity_index >= num_components)
+                ComponentIndex* slot = GetSparseSlot(entity_index);
+                if (!slot || *slot == kNullComponentIndex)
                 {
                     AmoLogger_Warning("Tried to remove an entity '%d' that did not exist for component '%d'"
                                       , entity_index, component_type);
                     return;
                 }
 
-                auto dense_array_component_index =
-                        (ComponentIndex)pool->component_index_in_data[entity_index - pool->start_entity_index];
-                if (dense_array_component_index < num_components - 1 && num_components > 2)
+                ComponentIndex dense_array_component_index = *slot;
+                if (dense_array_component_index < num_components - 1)
                 {
                     // If the component data is not already at the end of the component array
                     // Swap it with the component at the end of the array and update all indices accordingly
-                    EntityIndex last_entity = entities[ num_components - 1];
-                    SparseSetPool* pool_to_swap = GetPool(last_entity);
+                    EntityIndex last_entity = entities[num_components - 1];
+                    ComponentIndex* slot_to_swap = GetSparseSlot(last_entity);
 
-                    AmoLogger_Assert( pool_to_swap != nullptr, "Invalid entity was somehow stored in the dense array.");
+                    AmoLogger_Assert( slot_to_swap != nullptr, "Invalid entity was somehow stored in the dense array.");
 
-                    pool_to_swap -> component_index_in_data[ last_entity - pool_to_swap -> start_entity_index]
-                        = dense_array_component_index;
-                    entities[dense_array_component_index] = entities[num_components - 1];
+                    *slot_to_swap = dense_array_component_index;
+                    entities[dense_array_component_index] = last_entity;
                     // Swap Component
-                    data[dense_array_component_index] = data[num_components - 1];
+                    AmoBase::AmoMemory_CopyMem(data + dense_array_component_index * component_size
+                                               , data + (num_components - 1) * component_size, component_size);
+                    added_ticks[dense_array_component_index] = added_ticks[num_components - 1];
+                    changed_ticks[dense_array_component_index] = changed_ticks[num_components - 1];
                 }
 
                 // Mark this entity as gone and decrease the num_components
-                pool -> component_index_in_data[entity_index - pool->start_entity_index] = UINT32_MAX;
+                *slot = kNullComponentIndex;
                 num_components--;
             }
-
-
         }
 
 
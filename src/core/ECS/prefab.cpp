@@ -0,0 +1,24 @@
+//
+// Created by Amo on 2022/7/28.
+//
+
+#include "core/ECS/prefab.h"
+#include "core.h"
+
+namespace SymoCraft::ECS
+    {
+        void Prefab::Clear()
+        {
+            m_signature.reset();
+            m_components.clear();
+            m_data.clear();
+        }
+
+        const Prefab::ComponentEntry* Prefab::FindComponent(int32 component_type) const
+        {
+            for (const ComponentEntry& entry : m_components)
+                if (entry.component_type == component_type)
+                    return &entry;
+            return nullptr;
+        }
+    }
@@ -23,6 +23,12 @@ namespace SymoCraft::ECS
 
         void Registry::Clear()
         {
+            {
+                std::lock_guard<std::mutex> lock(command_buffers_mtx);
+                thread_command_buffers.clear();
+                command_buffers_id = Internal::GenerateCommandBuffersId();
+            }
+            deferred_entities.clear();
             entities.clear();
             Free();
             component_set.clear();
@@ -46,6 +52,49 @@ namespace SymoCraft::ECS
             return entities.back();
         }
 
+        EntityId Registry::Instantiate(const Prefab &prefab)
+        {
+            EntityId entity;
+            Instantiate(prefab, 1, &entity);
+            return entity;
+        }
+
+        void Registry::Instantiate(const Prefab &prefab, uint32 count, EntityId *out_entities)
+        {
+            if (count == 0)
+                return;
+
+            // Reuse the free slots first, like CreateEntity, then append the rest in one go
+            std::vector<EntityIndex> new_indices(count);
+            const uint32 num_reused = (uint32)std::min<size_t>(count, free_entities.size());
+            for (uint32 i = 0; i < num_reused; i++)
+            {
+                const EntityIndex index = free_entities.back();
+                free_entities.pop_back();
+                entities[index] = Internal::CreateEntityId(index, Internal::GetEntityVersion(entities[index]));
+                new_indices[i] = index;
+            }
+            entities.reserve(entities.size() + count - num_reused);
+            for (uint32 i = num_reused; i < count; i++)
+            {
+                new_indices[i] = (EntityIndex)entities.size();
+                entities.emplace_back(Internal::CreateEntityId(new_indices[i], 0));
+            }
+
+            const uint32 tick = GetChangeTick();
+            for (const Prefab::ComponentEntry& entry : prefab.m_components)
+            {
+                AmoLogger_Assert(IsComponentRegistered(entry.component_type),
+                                 "Prefab component '%d' was not registered.", entry.component_type);
+                component_set[entry.component_type].AppendCopies(new_indices.data(), prefab.m_data.data() + entry.offset,
+                                                                  count, tick);
+            }
+
+            if (out_entities)
+                for (uint32 i = 0; i < count; i++)
+                    out_entities[i] = entities[new_indices[i]];
+        }
+
         int Registry::NumComponents(EntityId entity) const
         {
             int num_components = 0;
@@ -105,7 +154,13 @@ namespace SymoCraft::ECS
                 return nullptr;
             }
 
-            return component_set[component_type].Get(Internal::GetEntityIndex(entity));
+            // The byte wise pointer is writable, so it counts as a change
+            const Internal::ComponentContainer& container = component_set[component_type];
+            if (!container.IsComponentExist(Internal::GetEntityIndex(entity)))
+                return nullptr;
+            const ComponentIndex dense_index = container.GetDenseIndex(Internal::GetEntityIndex(entity));
+            container.MarkChanged(dense_index, GetChangeTick());
+            return container.Get(Internal::GetEntityIndex(entity));
         }
 
         uint8* Registry::AddOrGetComponentByType(EntityId entity, int32 component_id)
@@ -117,7 +172,7 @@ namespace SymoCraft::ECS
                 return nullptr;
             }
 
-            if (component_id >= component_set.size() || component_id < 0)
+            if (!IsComponentRegistered(component_id))
             {
                 AmoLogger_Warning("Tried to check if an entity had component '%d'"
                                   ", but a component of type '%d' does not exist in the registry"
@@ -125,7 +180,15 @@ namespace SymoCraft::ECS
                 return nullptr;
             }
 
-            return component_set[component_id].AddOrGet(entity);
+            Internal::ComponentContainer& container = component_set[component_id];
+            const bool is_new = !container.IsComponentExist(Internal::GetEntityIndex(entity));
+            uint8* component = container.AddOrGet(entity);
+            const ComponentIndex dense_index = container.GetDenseIndex(Internal::GetEntityIndex(entity));
+            if (is_new)
+                container.MarkAdded(dense_index, GetChangeTick());
+            else
+                container.MarkChanged(dense_index, GetChangeTick());
+            return component;
         }
 
         void Registry::RemoveAllComponent(EntityId entity)
@@ -150,112 +213,288 @@ namespace SymoCraft::ECS
                     component_set[i].Remove(entity);
         }
 
-        RawMemory Registry::Serialize()
+        // The last command buffer the thread used, so the lookup only locks once per thread and registry
+        struct ThreadCommandBufferCache
         {
-            /*
-             * uint32 number of entities
-             * Begin looping entities
-             * uint64 entity id
-             * int32 number of components
-             * Begin looping components
-             * int32 component id
-             * Copy component into this entity id or create this entity if it does not exist
-            */
+            uint64 command_buffers_id = 0;
+            CommandBuffer* buffer = nullptr;
+        };
+        static thread_local ThreadCommandBufferCache command_buffer_cache;
 
-            RawMemory memory;
-            size_t entity_id_data_size = sizeof(uint32) + (sizeof(uint16) * entities.size());
-            memory.Init(entity_id_data_size);
+        CommandBuffer& Registry::GetCommandBuffer()
+        {
+            if (command_buffer_cache.command_buffers_id == command_buffers_id)
+                return *command_buffer_cache.buffer;
+
+            std::lock_guard<std::mutex> lock(command_buffers_mtx);
+            const std::thread::id thread_id = std::this_thread::get_id();
+            CommandBuffer* buffer = nullptr;
+            for (const std::unique_ptr<CommandBuffer>& thread_buffer : thread_command_buffers)
+                if (thread_buffer->m_owner_thread == thread_id)
+                    buffer = thread_buffer.get();
+
+            if (!buffer)
+            {
+                thread_command_buffers.push_back(std::make_unique<CommandBuffer>());
+                buffer = thread_command_buffers.back().get();
+                buffer->m_owner_thread = thread_id;
+            }
+
+            command_buffer_cache = {command_buffers_id, buffer};
+            return *buffer;
+        }
+
+        void Registry::PlaybackCommands()
+        {
+            for (const std::unique_ptr<CommandBuffer>& buffer : thread_command_buffers)
+                if (!buffer->IsEmpty())
+                    Playback(*buffer);
+        }
 
-            auto num_of_entities = (uint32)entities.size();
-            memory.Write<uint32>(&num_of_entities);
-            for (ECS::EntityId entity : entities)
+        void Registry::Playback(CommandBuffer &buffer)
+        {
+            const uint8* data = buffer.m_data.data();
+            const size_t data_size = buffer.m_data.size();
+            Internal::CommandHeader header;
+
+            // Grow the entity list and the dense arrays once for the whole buffer
+            uint32 num_new_entities = 0;
+            std::vector<uint32> num_new_components(component_set.size(), 0);
+            for (size_t offset = 0; offset < data_size; offset += sizeof(header) + header.payload_size)
+            {
+                std::memcpy(&header, data + offset, sizeof(header));
+                if (header.type == Internal::CommandType::CreateEntity)
+                    num_new_entities++;
+                else if (header.type == Internal::CommandType::AddComponent && IsComponentRegistered(header.component_type))
+                    num_new_components[header.component_type]++;
+            }
+
+            if (num_new_entities > free_entities.size())
+                entities.reserve(entities.size() + num_new_entities - free_entities.size());
+            for (size_t component_type = 0; component_type < component_set.size(); component_type++)
+            {
+                Internal::ComponentContainer& container = component_set[component_type];
+                const uint32 capacity = container.Size() + num_new_components[component_type];
+                if (num_new_components[component_type] > 0 && capacity > container.Capacity())
+                    container.Reserve(std::max(capacity, container.Capacity() * 2));
+            }
+
+            deferred_entities.resize(buffer.m_num_created_entities);
+            for (size_t offset = 0; offset < data_size; offset += sizeof(header) + header.payload_size)
             {
-                memory.Write<EntityId>(&entity);
-                int32 num_components = this->NumComponents(entity);
-                memory.Write<int32>(&num_components);
-                for (int i = 0; i <  component_set.size(); i++)
+                std::memcpy(&header, data + offset, sizeof(header));
+                EntityId entity = header.entity;
+                if (Internal::GetEntityVersion(entity) == Internal::kDeferredEntityVersion)
+                    entity = header.type == Internal::CommandType::CreateEntity
+                             ? entity : deferred_entities[Internal::GetEntityIndex(entity)];
+
+                // The entity may have been destroyed by an earlier command
+                const EntityIndex entity_index = Internal::GetEntityIndex(entity);
+                if (header.type != Internal::CommandType::CreateEntity
+                    && (entity_index >= entities.size() || entities[entity_index] != entity))
+                    continue;
+
+                switch (header.type)
                 {
-                    if (HasComponentByType(entity, i))
+                    case Internal::CommandType::CreateEntity:
+                        deferred_entities[Internal::GetEntityIndex(header.entity)] = CreateEntity();
+                        break;
+                    case Internal::CommandType::DestroyEntity:
+                        DestroyEntity(entity);
+                        break;
+                    case Internal::CommandType::AddComponent:
                     {
-                        memory.Write<int32>(&i);
-                        size_t component_size = component_set[i].GetComponentSize();
-                        uint8* component_data = component_set[i].Get(Internal::GetEntityIndex(entity));
-                        memory.WriteDangerous(component_data, component_size);
+                        uint8* component_data = AddOrGetComponentByType(entity, header.component_type);
+                        if (!component_data)
+                            break;
+                        AmoLogger_Assert(header.payload_size == component_set[header.component_type].GetComponentSize(),
+                                         "Recorded component '%d' has the wrong size.", header.component_type);
+                        std::memcpy(component_data, data + offset + sizeof(header), header.payload_size);
+                        break;
                     }
+                    case Internal::CommandType::RemoveComponent:
+                        if (HasComponentByType(entity, header.component_type))
+                            component_set[header.component_type].Remove(entity);
+                        break;
                 }
             }
 
-            memory.ShrinkToFit();
-            return memory;
+            buffer.Clear();
         }
 
-        void Registry::Deserialize(RawMemory &memory)
+        // Snapshot layout, every column is written as a whole:
+        // SnapshotHeader
+        // EntityId entities[num_entities], EntityId free_entities[num_free_entities]
+        // for every component type:
+        //     ColumnHeader
+        //     EntityIndex dense_entities[num_components]
+        //     full snapshot:  component data[num_components]
+        //     delta snapshot: EntityIndex changed_entities[num_written], component data[num_written]
+        static const uint32 kSnapshotMagic = 0x534D5953; // "SYMS"
+        static const uint32 kSnapshotVersion = 1;
+
+        struct SnapshotHeader
         {
-            memory.ResetReadWriteCursor();
-
+            uint32 magic;
+            uint32 version;
+            // 0 for a full snapshot
+            uint32 baseline_tick;
             uint32 num_entities;
-            memory.Read<uint32>(&num_entities);
-            entities.resize(num_entities);
-            for (uint32 entity_counter = 0; entity_counter < num_entities; entity_counter++)
+            uint32 num_free_entities;
+            int32 num_component_types;
+        };
+
+        struct ColumnHeader
+        {
+            int32 component_type;
+            uint32 component_size;
+            uint32 num_components;
+            uint32 num_written;
+        };
+
+        RawMemory Registry::Serialize(uint32 baseline_tick)
+        {
+            // Every later change gets a newer tick than the snapshot
+            last_snapshot_tick = GetChangeTick();
+            AdvanceChangeTick();
+
+            // Find the changed components first, so the memory is allocated once
+            const bool is_delta = baseline_tick != 0;
+            std::vector<std::vector<ComponentIndex>> changed_components(is_delta ? component_set.size() : 0);
+            size_t memory_size = sizeof(SnapshotHeader)
+                    + sizeof(EntityId) * (entities.size() + free_entities.size());
+            for (size_t i = 0; i < component_set.size(); i++)
             {
-                EntityId entity;
-                memory.Read<EntityId>(&entity);
-                entities[Internal::GetEntityIndex(entity)] = entity;
-                int32 num_components;
-                memory.Read<int32>(&num_components);
-                AmoLogger_Assert(num_components >= 0, "Deserialized bad data.");
-                for (int component_counter = 0; component_counter < num_components; component_counter++)
+                const Internal::ComponentContainer& container = component_set[i];
+                uint32 num_written = container.Size();
+                if (is_delta)
                 {
-                    int32 component_id;
-                    memory.Read<int32>(&component_id);
-                    uint8 *component_data = AddOrGetComponentByType(entity, component_id);
-                    size_t component_size = component_set[component_id].GetComponentSize();
-                    memory.ReadDangerous(component_data, component_size);
+                    for (ComponentIndex dense_index = 0; dense_index < container.Size(); dense_index++)
+                        if (container.GetChangedTick(dense_index) > baseline_tick)
+                            changed_components[i].push_back(dense_index);
+                    num_written = (uint32)changed_components[i].size();
+                    memory_size += sizeof(EntityIndex) * num_written;
                 }
+                memory_size += sizeof(ColumnHeader) + sizeof(EntityIndex) * container.Size()
+                        + container.GetComponentSize() * num_written;
             }
-            AmoLogger_Info("Deserialized %d entities.", num_entities);
-        }
 
-        // ----------------------------------------------------------------------
-        // Iterator implementation
-        Iterator::Iterator(Registry &reg, EntityIndex index, std::bitset<Internal::kMaxNumComponents> com_need,
-                           bool all)
-                           : registry(reg), entity_index(index), components_need(com_need),
-                           _is_searching_all(all)
-        {/*empty*/}
-
-        EntityIndex Iterator::operator*() const
-        {
-            return registry.entities[entity_index];
-        }
+            RawMemory memory;
+            memory.Init(memory_size);
 
-        bool Iterator::operator==(Iterator &other) const
-        {
-            return entity_index==other.entity_index;
-        }
+            SnapshotHeader header{kSnapshotMagic, kSnapshotVersion, baseline_tick, (uint32)entities.size(),
+                                  (uint32)free_entities.size(), (int32)component_set.size()};
+            memory.Write<SnapshotHeader>(&header);
+            memory.WriteDangerous((const uint8*)entities.data(), sizeof(EntityId) * entities.size());
+            memory.WriteDangerous((const uint8*)free_entities.data(), sizeof(EntityId) * free_entities.size());
+
+            for (int32 i = 0; i < (int32)component_set.size(); i++)
+            {
+                const Internal::ComponentContainer& container = component_set[i];
+                const size_t component_size = container.GetComponentSize();
+                ColumnHeader column{i, (uint32)component_size, container.Size(),
+                                    is_delta ? (uint32)changed_components[i].size() : container.Size()};
+                memory.Write<ColumnHeader>(&column);
+                memory.WriteDangerous((const uint8*)container.GetEntities(), sizeof(EntityIndex) * container.Size());
+
+                if (!is_delta)
+                {
+                    memory.WriteDangerous((const uint8*)container.GetDense(0), component_size * container.Size());
+                    continue;
+                }
 
+                for (ComponentIndex dense_index : changed_components[i])
+                    memory.Write<EntityIndex>(&container.GetEntities()[dense_index]);
+                for (ComponentIndex dense_index : changed_components[i])
+                    memory.WriteDangerous(container.GetDense(dense_index), component_size);
+            }
 
-        bool Iterator::operator!=(Iterator &other) const
-        {
-            return entity_index!=other.entity_index;
+            return memory;
         }
 
-        Iterator& Iterator::operator++()
+        void Registry::Deserialize(RawMemory &memory)
         {
-            do
+            memory.ResetReadWriteCursor();
+
+            SnapshotHeader header{};
+            memory.Read<SnapshotHeader>(&header);
+            if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion)
             {
-                entity_index++;
-            } while (entity_index < registry.entities.size() && !IsIndexValid());
-            return *this;
-        }
+                AmoLogger_Error("Deserialized bad data. Not a registry snapshot of version %u.", kSnapshotVersion);
+                return;
+            }
 
-        bool Iterator::IsIndexValid()
-        {
-            return entity_index >=0 && registry.IsEntityValid(registry.entities[entity_index]) &&
-                    (
-                            _is_searching_all ||
-                            RegistryViewer<>::HasRequiredComponents(registry, components_need
-                                                                  , registry.entities[entity_index])
-                            );
+            const auto* entity_data = (const EntityId*)memory.ReadInPlace(sizeof(EntityId) * header.num_entities);
+            const auto* free_entity_data = (const EntityId*)memory.ReadInPlace(sizeof(EntityId) * header.num_free_entities);
+            if (!entity_data || !free_entity_data)
+                return;
+            entities.assign(entity_data, entity_data + header.num_entities);
+            free_entities.assign(free_entity_data, free_entity_data + header.num_free_entities);
+
+            const uint32 tick = GetChangeTick();
+            const bool is_delta = header.baseline_tick != 0;
+            // Entities of a column in a delta snapshot, by entity index
+            std::vector<bool> is_in_column(is_delta ? entities.size() : 0);
+            for (int32 column_counter = 0; column_counter < header.num_component_types; column_counter++)
+            {
+                ColumnHeader column{};
+                memory.Read<ColumnHeader>(&column);
+                if (column.component_type < 0 || column.component_type >= (int32)component_set.size()
+                    || component_set[column.component_type].GetComponentSize() != column.component_size)
+                {
+                    AmoLogger_Error("Deserialized bad data. Component '%d' doesn't match the registry.",
+                                    column.component_type);
+                    return;
+                }
+                Internal::ComponentContainer& container = component_set[column.component_type];
+
+                const auto* dense_entities = (const EntityIndex*)memory.ReadInPlace(sizeof(EntityIndex) * column.num_components);
+                if (!dense_entities)
+                    return;
+
+                if (!is_delta)
+                {
+                    const uint8* component_data = memory.ReadInPlace((size_t)column.component_size * column.num_components);
+                    if (!component_data)
+                        return;
+                    container.Assign(dense_entities, component_data, column.num_components, tick);
+                    continue;
+                }
+
+                // Remove the components that are gone from the column
+                for (uint32 i = 0; i < column.num_components; i++)
+                    if (dense_entities[i] < is_in_column.size())
+                        is_in_column[dense_entities[i]] = true;
+                for (uint32 i = container.Size(); i > 0; i--)
+                {
+                    const EntityIndex entity_index = container.GetEntities()[i - 1];
+                    if (entity_index >= is_in_column.size() || !is_in_column[entity_index])
+                        container.Remove(Internal::CreateEntityId(entity_index, 0));
+                }
+                for (uint32 i = 0; i < column.num_components; i++)
+                    if (dense_entities[i] < is_in_column.size())
+                        is_in_column[dense_entities[i]] = false;
+
+                const auto* changed_entities = (const EntityIndex*)memory.ReadInPlace(sizeof(EntityIndex) * column.num_written);
+                const uint8* component_data = memory.ReadInPlace((size_t)column.component_size * column.num_written);
+                if (!changed_entities || !component_data)
+                    return;
+                for (uint32 i = 0; i < column.num_written; i++)
+                {
+                    const EntityId entity = Internal::CreateEntityId(changed_entities[i], 0);
+                    const bool is_new = !container.IsComponentExist(entity);
+                    uint8* component = container.AddOrGet(entity);
+                    if (!component)
+                        return;
+                    AmoBase::AmoMemory_CopyMem(component, (void*)(component_data + (size_t)i * column.component_size),
+                                               column.component_size);
+                    const ComponentIndex dense_index = container.GetDenseIndex(changed_entities[i]);
+                    if (is_new)
+                        container.MarkAdded(dense_index, tick);
+                    else
+                        container.MarkChanged(dense_index, tick);
+                }
+            }
+            AmoLogger_Info("Deserialized %u entities.", header.num_entities);
         }
     }
\ No newline at end of file
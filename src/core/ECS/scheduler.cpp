@@ -0,0 +1,171 @@
+//
+// Created by Amo on 2022/7/24.
+//
+
+#include "core/ECS/scheduler.h"
+#include "core.h"
+#include "core/global_thread_pool.h"
+#include "core/ECS/registry.h"
+
+namespace SymoCraft::ECS
+    {
+        // Don't split views into slices smaller than this
+        static const uint32 kMinSliceSize = 256;
+        // Slices per thread, a few more than one balances uneven slices
+        static const uint32 kSlicesPerThread = 4;
+
+        // Two systems conflict if one writes what the other reads or writes
+        static bool IsConflicting(const System& system1, const System& system2)
+        {
+            return (system1.writes & (system2.reads | system2.writes)).any()
+                   || (system1.reads & system2.writes).any();
+        }
+
+        void Scheduler::AddSystem(const System &system)
+        {
+            AmoLogger_Assert(system.update != nullptr, "System '%s' has no update function.", system.name);
+            m_systems.push_back(system);
+            m_timings.push_back({system.name, 0.0, 0.0, 0, 0});
+            m_last_run_ticks.push_back(0);
+        }
+
+        void Scheduler::Clear()
+        {
+            m_systems.clear();
+            m_timings.clear();
+            m_last_run_ticks.clear();
+            m_states = std::vector<SystemState>();
+            m_jobs.clear();
+            m_dependents.clear();
+            m_roots.clear();
+        }
+
+        void Scheduler::Run(Registry &registry, GlobalThreadPool &thread_pool)
+        {
+            const auto num_systems = (uint32)m_systems.size();
+            if (num_systems == 0)
+                return;
+
+            m_registry = &registry;
+            m_thread_pool = &thread_pool;
+            m_max_slices = (thread_pool.NumThreads() + 1) * kSlicesPerThread;
+            m_jobs.resize((size_t)num_systems * m_max_slices);
+            // The atomics can't be moved, so the states are only reallocated when systems are added
+            if (m_states.size() != num_systems)
+                m_states = std::vector<SystemState>(num_systems);
+
+            // Build the dependency graph, a later system waits for every earlier system it conflicts with
+            m_dependents.clear();
+            for (uint32 i = 0; i < num_systems; i++)
+                m_states[i].num_waiting_dependencies.store(0, std::memory_order_relaxed);
+            for (uint32 i = 0; i < num_systems; i++)
+            {
+                SystemState& state = m_states[i];
+                state.first_dependent = (uint32)m_dependents.size();
+                for (uint32 j = i + 1; j < num_systems; j++)
+                {
+                    if (!IsConflicting(m_systems[i], m_systems[j]))
+                        continue;
+                    m_dependents.push_back(j);
+                    m_states[j].num_waiting_dependencies.fetch_add(1, std::memory_order_relaxed);
+                }
+                state.num_dependents = (uint32)m_dependents.size() - state.first_dependent;
+            }
+            m_num_unfinished_systems.store(num_systems, std::memory_order_release);
+
+            // Find the systems without dependencies before the first job is queued,
+            // the counters change as soon as the workers finish systems
+            m_roots.clear();
+            for (uint32 i = 0; i < num_systems; i++)
+                if (m_states[i].num_waiting_dependencies.load(std::memory_order_relaxed) == 0)
+                    m_roots.push_back(i);
+            for (uint32 root : m_roots)
+                StartSystem(root);
+
+            // Help the workers until every system is done
+            while (m_num_unfinished_systems.load(std::memory_order_acquire) > 0)
+            {
+                if (!thread_pool.RunPendingTask())
+                    std::this_thread::yield();
+            }
+
+            // Sync point, apply the structural changes the systems recorded
+            registry.PlaybackCommands();
+            // Changes made between frames get a tick newer than every system's last run
+            registry.AdvanceChangeTick();
+        }
+
+        void Scheduler::StartSystem(uint32 system_index)
+        {
+            const System& system = m_systems[system_index];
+            SystemState& state = m_states[system_index];
+            state.start_time = std::chrono::steady_clock::now();
+            // The components the system writes from here on are stamped with a tick newer than everything before
+            state.run_tick = m_registry->AdvanceChangeTick();
+
+            if (system.prepare)
+                system.prepare(*m_registry);
+
+            uint32 num_slices = 1, slice_size = UINT32_MAX;
+            if (system.count)
+            {
+                const uint32 count = system.count(*m_registry);
+                num_slices = glm::clamp((count + kMinSliceSize - 1) / kMinSliceSize, 1u, m_max_slices);
+                slice_size = glm::max((count + num_slices - 1) / num_slices, 1u);
+            }
+
+            m_timings[system_index].last_num_slices = num_slices;
+            state.num_unfinished_slices.store(num_slices, std::memory_order_relaxed);
+            SliceJob* jobs = &m_jobs[(size_t)system_index * m_max_slices];
+            for (uint32 slice = 0; slice < num_slices; slice++)
+            {
+                const uint32 begin = slice * slice_size;
+                jobs[slice] = {this, system_index,
+                               {begin, slice + 1 == num_slices ? UINT32_MAX : begin + slice_size,
+                                m_last_run_ticks[system_index], state.run_tick}};
+                m_thread_pool->QueueTask(RunSliceJob, system.name, &jobs[slice], sizeof(SliceJob));
+            }
+            m_thread_pool->BeginWork(num_slices > 1);
+        }
+
+        void Scheduler::FinishSystem(uint32 system_index)
+        {
+            const SystemState& state = m_states[system_index];
+            SystemTiming& timing = m_timings[system_index];
+            timing.last_time_ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - state.start_time).count();
+            timing.total_time_ms += timing.last_time_ms;
+            timing.num_frames++;
+            m_last_run_ticks[system_index] = state.run_tick;
+
+            for (uint32 i = 0; i < state.num_dependents; i++)
+            {
+                const uint32 dependent = m_dependents[state.first_dependent + i];
+                if (m_states[dependent].num_waiting_dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    StartSystem(dependent);
+            }
+
+            m_num_unfinished_systems.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        void Scheduler::RunSliceJob(void *data, size_t data_size)
+        {
+            const SliceJob& job = *(const SliceJob*)data;
+            Scheduler& scheduler = *job.scheduler;
+            scheduler.m_systems[job.system_index].update(*scheduler.m_registry, job.slice);
+
+            if (scheduler.m_states[job.system_index].num_unfinished_slices.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                scheduler.FinishSystem(job.system_index);
+        }
+
+        void Scheduler::LogTimings() const
+        {
+            for (const SystemTiming& timing : m_timings)
+            {
+                if (timing.num_frames == 0)
+                    continue;
+                AmoLogger_Info("System %-24s avg %8.3f ms, last %8.3f ms in %u slices", timing.name,
+                               timing.total_time_ms / timing.num_frames, timing.last_time_ms, timing.last_num_slices);
+            }
+        }
+    }
@@ -15,8 +15,18 @@
 #include "core/ECS/Systems/character_system.h"
 #include "core/ECS/Systems/physics_system.h"
 #include "core/ECS/component.h"
+#include "core/ECS/scheduler.h"
+#include "core/global_thread_pool.h"
+#include "core/simulation_clock.h"
 #include "world/world.h"
+#include "world/fluid.h"
+#include "world/block_tick.h"
+#include "world/neighbor_update.h"
 #include "playercontroller/playercontroller.h"
+#include "renderer/render_device.h"
+#include "input/input.h"
+#include "input/input_replay.h"
+#include "benchmark/benchmark.h"
 
 namespace SymoCraft
 {
@@ -38,17 +48,35 @@ namespace SymoCraft
         const float kBlockChangeDebounceTime = 0.2f;
         float block_change_debounce = 0.0f;
         float delta_time = 0.016f;
+        // Headless runs advance by a fixed step so that replays are reproducible
+        constexpr float kHeadlessDeltaTime = 1.0f / 60.0f;
+        constexpr int kHeadlessWindowWidth = 1280, kHeadlessWindowHeight = 720;
 
 
         // Internal variables
-        // static GlobalThreadPool* global_thread_pool;
+        static GlobalThreadPool* global_thread_pool;
+        static SimulationClock simulation_clock;
+        static ECS::Scheduler scheduler;
         static Camera* camera;
+        static LaunchOptions launch_options;
 
-        void Init()
+        // Internal functions
+        static void ReportHeadlessRun(const std::vector<double>& frame_times);
+
+        void Init(const LaunchOptions& options)
         {
-            Window::Init();
+            launch_options = options;
+            RenderDevice::Init(options.headless ? RenderBackend::Null : RenderBackend::OpenGL);
+            if (options.headless)
+            {
+                if (!options.replay_path.empty())
+                    InputReplay::Load(options.replay_path);
+            }
+            else
+                Window::Init();
+
             Window& window = GetWindow();   // Get a reference pointer of the only Window
-            if (!window.window_ptr)
+            if (!options.headless && !window.window_ptr)
             {
                 AmoLogger_Error("Error: Could not create a window. ");
                 return;
@@ -61,6 +89,14 @@ namespace SymoCraft
             registry.RegisterComponent<Physics::HitBox>("HigBox");
             registry.RegisterComponent<Character::CharacterComponent>("CharacterComponent");
             registry.RegisterComponent<Character::PlayerComponent>("PlayerComponent");
+            registry.RegisterComponent<InterpolatedTransform>("InterpolatedTransform");
+
+            // The main thread runs jobs too while it waits for the systems
+            global_thread_pool = new GlobalThreadPool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+            Physics::SetThreadPool(global_thread_pool);
+            scheduler.AddSystem(TransformSystem::GetSystem());
+            scheduler.AddSystem(Physics::GetSystem());
+            scheduler.AddSystem(Character::Player::GetSystem());
 
             Renderer::Init();
             World::Init();
@@ -73,15 +109,21 @@ namespace SymoCraft
 
             std::cout << player << std::endl;
             Window& window = GetWindow();
-            double previous_frame_time = glfwGetTime();
+            double previous_frame_time = window.IsHeadless() ? 0.0 : glfwGetTime();
 
             stbi_set_flip_vertically_on_load(true);
             TextureArray texture_array;
-            texture_array = texture_array.CreateAtlasSlice("../assets/textures/texture_atlas.png", true);
+            texture_array = texture_array.CreateFromCache("../assets/textures/texture_atlas.png",
+                                                          "../assets/textures/texture_atlas.texcache", true);
 
-            glfwSetScrollCallback( (GLFWwindow *) window.window_ptr, MouseScrollCallBack);
-            glfwSetCursorPosCallback((GLFWwindow *) window.window_ptr, MouseMovementCallBack);
-            glfwSetInputMode((GLFWwindow*)window.window_ptr, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+            if (!window.IsHeadless())
+            {
+                glfwSetScrollCallback( (GLFWwindow *) window.window_ptr, MouseScrollCallBack);
+                glfwSetCursorPosCallback((GLFWwindow *) window.window_ptr, MouseMovementCallBack);
+                glfwSetKeyCallback((GLFWwindow *) window.window_ptr, KeyCallBack);
+                glfwSetMouseButtonCallback((GLFWwindow *) window.window_ptr, MouseButtonCallBack);
+            }
+            window.SetCursorMode(CursorMode::Lock);
 
             // Manual chunk generation for testing
             InitializeNoise();
@@ -89,7 +131,7 @@ namespace SymoCraft
                 for(int z = -World::chunk_radius; z <= World::chunk_radius; z++)
                     ChunkManager::CreateChunk({x, z});
 
-            for( auto chunk : ChunkManager::GetAllChunks() )
+            for( auto& chunk : ChunkManager::GetAllChunks() )
             {
                 chunk.second.GenerateTerrain();
                 chunk.second.GenerateVegetation();
@@ -107,39 +149,62 @@ namespace SymoCraft
             glm::vec3 start_pos{0.0f, 140.0f, 0.0f};
             auto &transform = registry.GetComponent<Transform>(World::GetPlayer());
             transform.position = start_pos;
+            registry.GetComponent<InterpolatedTransform>(World::GetPlayer()) = {start_pos, start_pos};
             // Renderer::ReportStatus(); # WIP
 
             // -------------------------------------------------------------------
             // Render Loop
-            while (!window.ShouldClose())
+            RenderDevice& device = RenderDevice::Get();
+            std::vector<double> frame_times;
+            for (uint32 frame = 0; !window.ShouldClose(); frame++)
             {
-                double current_frame_time = glfwGetTime();
-                delta_time = (float)(current_frame_time - previous_frame_time);
+                if (window.IsHeadless())
+                {
+                    if (frame >= launch_options.num_frames)
+                        break;
+
+                    // Only keep the commands of the current frame
+                    static_cast<NullRenderDevice&>(device).ClearCommandLog();
+                    InputReplay::Apply(frame);
+                    delta_time = kHeadlessDeltaTime;
+                }
+                else
+                {
+                    double current_frame_time = glfwGetTime();
+                    delta_time = (float)(current_frame_time - previous_frame_time);
+                    previous_frame_time = current_frame_time;
+                }
+                auto frame_begin_time = std::chrono::steady_clock::now();
+                simulation_clock.Advance(delta_time);
 
                 block_place_debounce -= delta_time;
                 block_change_debounce -= delta_time;
 
                 // Temporary Input Process Function
-                processInput((GLFWwindow*)GetWindow().window_ptr);
-                PlayerController::DoRayCast(registry, window);
-
-                //::Registry &registry = GetRegistry();
+                processInput();
+                PlayerController::DoRayCast(registry);
 
-                TransformSystem::Update(GetRegistry());
-                Physics::Update(GetRegistry());
-                Character::Player::Update(GetRegistry());
+                scheduler.Run(registry, GetGlobalThreadPool());
+                // The blocks changed by the player are updated before the ticks run
+                NeighborUpdate::Update(simulation_clock);
+                Fluid::Update(simulation_clock);
+                BlockTick::Update(simulation_clock);
 
+                ChunkManager::UpdateLodLevels(camera->GetCameraPos());
                 ChunkManager::UpdateAllChunks();
-                ChunkManager::LoadAllChunks();
+                ChunkManager::LoadAllChunks(camera->GetCameraPos());
 
-                glBindTextureUnit(0, texture_array.m_texture_Id);
+                device.BindTexture(0, texture_array.m_texture_Id);
                 Renderer::Render();
 
+                frame_times.push_back(Benchmark::MillisecondsSince(frame_begin_time));
+
                 window.SwapBuffers();
                 window.PollInt();
-
-                previous_frame_time = current_frame_time;
             }
+
+            if (window.IsHeadless())
+                ReportHeadlessRun(frame_times);
         }
 
         void Free()
@@ -147,20 +212,35 @@ namespace SymoCraft
             // Free assets
 
             // Free resources
-            // global_thread_pool->Free();
-            // delete global_thread_pool;
+            scheduler.LogTimings();
+            scheduler.Clear();
+            if (global_thread_pool)
+            {
+                Physics::SetThreadPool(nullptr);
+                global_thread_pool->Free();
+                delete global_thread_pool;
+                global_thread_pool = nullptr;
+            }
 
             Window& window = GetWindow();
+            bool is_headless = window.IsHeadless();
             window.Destroy();
-            Window::Free();
+            if (!is_headless)
+                Window::Free();
+            Fluid::Clear();
+            BlockTick::Clear();
             ChunkManager::FreeAllChunks();
             Renderer::Free();
+            RenderDevice::Free();
+            InputReplay::Clear();
             GetRegistry().Clear();
         }
 
         Window& GetWindow()
         {
-            static Window* window = Window::Create("SymoCraft");
+            static Window* window = launch_options.headless
+                    ? Window::CreateHeadless("SymoCraft", kHeadlessWindowWidth, kHeadlessWindowHeight)
+                    : Window::Create("SymoCraft");
             return *window;
         }
 
@@ -175,12 +255,17 @@ namespace SymoCraft
             static auto* registry = new ECS::Registry;
             return *registry;
         }
-/*
+
         GlobalThreadPool& GetGlobalThreadPool()
         {
             return *global_thread_pool;
         }
-*/
+
+        SimulationClock& GetSimulationClock()
+        {
+            return simulation_clock;
+        }
+
         void MouseMovementCallBack(GLFWwindow* window, double xpos_in, double ypos_in)
         {
             static float last_x = 0;       // last x position of cursor
@@ -188,7 +273,7 @@ namespace SymoCraft
             ECS::Registry &registry = Application::GetRegistry();
             //Transform &transform = registry.GetComponent<Transform>(camera->entity_id);
             auto &transform = registry.GetComponent<Transform>(World::GetPlayer());
-            auto &player_com = registry.GetComponent<Character::PlayerComponent>(World::GetPlayer());
+            const auto &player_com = registry.GetComponent<const Character::PlayerComponent>(World::GetPlayer());
             auto xpos = static_cast<float>(xpos_in);
             auto ypos = static_cast<float>(ypos_in);
 
@@ -221,10 +306,20 @@ namespace SymoCraft
             GetCamera()->InsMouseScrollCallBack(window, x_pos_in, y_pos_in);
         }
 
-        void processInput(GLFWwindow* window)
+        void KeyCallBack(GLFWwindow* window, int key, int scancode, int action, int mods)
         {
-            if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-                glfwSetWindowShouldClose(window, true);
+            Input::ProcessKeyEvent(key, action);
+        }
+
+        void MouseButtonCallBack(GLFWwindow* window, int button, int action, int mods)
+        {
+            Input::ProcessMouseButtonEvent(button, action);
+        }
+
+        void processInput()
+        {
+            if (Input::IsKeyPressed(GLFW_KEY_ESCAPE))
+                GetWindow().Close();
 
             ECS::Registry &registry = GetRegistry();
             auto &player_com = registry.GetComponent<Character::CharacterComponent>(World::GetPlayer());
@@ -234,14 +329,14 @@ namespace SymoCraft
             // process input for camera moving
 
 
-            player_com.is_running = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
+            player_com.is_running = Input::IsKeyPressed(GLFW_KEY_LEFT_SHIFT);
 
-            if (glfwGetKey(window, GLFW_KEY_CAPS_LOCK) == GLFW_PRESS)
+            if (Input::IsKeyPressed(GLFW_KEY_CAPS_LOCK))
             {
                 rigid_body.is_sensor = true;
                 rigid_body.use_gravity = false;
                 player_com.movement_axis.y =
-                        glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS
+                        Input::IsKeyPressed(GLFW_KEY_LEFT_CONTROL)
                         ? -1.0f
                         : 0.0f;
             }
@@ -252,20 +347,20 @@ namespace SymoCraft
             }
 
             player_com.movement_axis.x =
-                    glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS
+                    Input::IsKeyPressed(GLFW_KEY_W)
                     ? 1.0f
-                    :glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS
+                    :Input::IsKeyPressed(GLFW_KEY_S)
                       ? -1.0f
                       : 0.0f;
             player_com.movement_axis.z =
-                    glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS
+                    Input::IsKeyPressed(GLFW_KEY_D)
                     ? 1.0f
                     :
-                    glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS
+                    Input::IsKeyPressed(GLFW_KEY_A)
                       ? -1.0f
                       : 0.0f;
 
-            if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+            if (Input::IsKeyPressed(GLFW_KEY_SPACE))
             {
                 if (!player_com.is_jumping && rigid_body.on_ground)
                 {
@@ -273,7 +368,7 @@ namespace SymoCraft
                 }
             }
 
-            if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS && block_change_debounce <= 0.0f)
+            if (Input::IsKeyPressed(GLFW_KEY_E) && block_change_debounce <= 0.0f)
             {
                 new_block_id++;
                 if (new_block_id > kNumBlocks)
@@ -282,7 +377,7 @@ namespace SymoCraft
                 PlayerController::DisplayCurrentBlockName();
             }
 
-            if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS && block_change_debounce <= 0.0f)
+            if (Input::IsKeyPressed(GLFW_KEY_Q) && block_change_debounce <= 0.0f)
             {
                 new_block_id--;
                 if (new_block_id < 0)
@@ -293,6 +388,43 @@ namespace SymoCraft
 
         }
 
+        static void ReportHeadlessRun(const std::vector<double>& frame_times)
+        {
+            Benchmark::Report report;
+            std::vector<double> sorted_times = frame_times;
+            std::sort(sorted_times.begin(), sorted_times.end());
+            double total_time = 0.0;
+            for (double time : frame_times)
+                total_time += time;
+
+            report.Add("frames", (double)frame_times.size(), "");
+            if (!sorted_times.empty())
+            {
+                report.Add("frame_cpu_avg", total_time / (double)sorted_times.size(), "ms");
+                report.Add("frame_cpu_p50", sorted_times[sorted_times.size() / 2], "ms");
+                report.Add("frame_cpu_p99", sorted_times[sorted_times.size() * 99 / 100], "ms");
+                report.Add("frame_cpu_max", sorted_times.back(), "ms");
+            }
+
+            const RenderDevice& device = RenderDevice::Get();
+            const RenderDeviceStats& stats = device.GetStats();
+            report.Add("render_commands", (double)stats.GetTotalCommandCount(), "");
+            report.Add("draw_calls", (double)stats.GetCommandCount(RenderCommand::Draw), "");
+            report.Add("buffer_updates", (double)stats.GetCommandCount(RenderCommand::UpdateBuffer), "");
+            report.Add("uniform_uploads", (double)stats.GetCommandCount(RenderCommand::SetUniform), "");
+            report.Add("vertices_drawn", (double)stats.num_vertices_drawn, "");
+            report.Add("bytes_uploaded", (double)stats.bytes_uploaded, "B");
+            report.Add("last_frame_commands",
+                       (double)static_cast<const NullRenderDevice&>(device).GetCommandLog().size(), "");
+
+            for (const ECS::SystemTiming& timing : scheduler.GetTimings())
+                if (timing.num_frames > 0)
+                    report.Add(std::string("system/") + timing.name, timing.total_time_ms / timing.num_frames, "ms");
+
+            report.Print();
+            if (!launch_options.report_path.empty())
+                report.WriteJson(launch_options.report_path, "headless");
+        }
     }
 
 }
@@ -16,10 +16,10 @@ namespace SymoCraft
     }
 
     GlobalThreadPool::GlobalThreadPool(uint64_t num)
-            : cv(), queue_mtx(), general_mtx(), do_work(true), num_threads(num)
+            : cv(), queue_mtx(), do_work(true), num_threads(num)
     {
         worker_threads = new std::thread[num_threads];
-        for (int i = 0; i <= num_threads; i++)
+        for (uint32_t i = 0; i < num_threads; i++)
         {
             // point process loop
             // pass thread index to process loop
@@ -30,62 +30,72 @@ namespace SymoCraft
     void GlobalThreadPool::Free()
     {
         {
-            // access general mutex
-            std::lock_guard lock(general_mtx);
+            // access queue mutex, so no thread misses the notification while going to sleep
+            std::lock_guard lock(queue_mtx);
             // as soon as it is accessed, set working status to be false
-            do_work =false;
+            do_work = false;
         }
         // unblock all the threads
         cv.notify_all();
-        for (int i = 0; i < num_threads; i++)
+        for (uint32_t i = 0; i < num_threads; i++)
         {
             // wait for all the threads to end its job
             worker_threads[i].join();
         }
         // free worker_threads
         delete []worker_threads;
+        worker_threads = nullptr;
+        num_threads = 0;
     }
 
     void GlobalThreadPool::ProcessLoop(uint32_t thread_index)
     {
-        bool should_continue = true;
-        while (should_continue)
+        while (true)
         {
-            if (tasks.empty())
+            // begin to finish task
+            ThreadTask task;
             {
                 // Wait until tasks is not empty
-                std::unique_lock<std::mutex> lock(general_mtx);
+                // The queue is checked under the same mutex it is filled with, so no wake up is lost
+                std::unique_lock<std::mutex> lock(queue_mtx);
                 cv.wait(lock, [&]{ return (!do_work || !tasks.empty());});  // an anonymous function
-                should_continue = do_work && !tasks.empty();
-            }
+                if (!do_work)
+                    return;
 
-            // begin to finish task
-            ThreadTask task;
-            {
-                std::lock_guard<std::mutex> queue_lock(queue_mtx);
-                if (tasks.size() > 0)
-                {
-                    task = tasks.top();
-                    tasks.pop();
-                }
-                else
-                {
-                    task.func = nullptr;
-                }
+                task = tasks.top();
+                tasks.pop();
             }
 
-            // function pointer valid
-            if (task.func)
+            // may use OpTick to track thread
+            RunTask(task);
+        }
+    }
+
+    bool GlobalThreadPool::RunPendingTask()
+    {
+        ThreadTask task;
+        {
+            std::lock_guard<std::mutex> queue_lock(queue_mtx);
+            if (tasks.empty())
+                return false;
+            task = tasks.top();
+            tasks.pop();
+        }
+
+        RunTask(task);
+        return true;
+    }
+
+    void GlobalThreadPool::RunTask(const ThreadTask &task)
+    {
+        // function pointer valid
+        if (task.func)
+        {
+            task.func(task.data, task.data_size);
+            // callback function pointer valid
+            if (task.callback)
             {
-                {
-                    // may use OpTick to track thread
-                    task.func(task.data, task.data_size);
-                }
-                // callback function pointer valid
-                if (task.callback)
-                {
-                    task.callback(task.data, task.data_size);
-                }
+                task.callback(task.data, task.data_size);
             }
         }
     }
@@ -103,7 +113,7 @@ namespace SymoCraft
         task.task_name = task_name;
         {
             std::lock_guard<std::mutex> lockGuard(queue_mtx);   // avoid access conflict
-            task.counter = counter;
+            task.counter = counter++;
             tasks.push(task);
         }
     }
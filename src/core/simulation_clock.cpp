@@ -0,0 +1,29 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#include "core/simulation_clock.h"
+
+namespace SymoCraft
+{
+    SimulationClock::SimulationClock(float tick_duration, uint32 max_ticks_per_frame)
+            : m_tick_duration(tick_duration), m_max_ticks_per_frame(max_ticks_per_frame)
+    {
+    }
+
+    uint32 SimulationClock::Advance(float delta_time)
+    {
+        // The ticks of the previous frame have run by now
+        m_tick += m_frame_ticks;
+
+        m_accumulated_time += delta_time;
+        auto num_owed_ticks = (uint64)(m_accumulated_time / m_tick_duration);
+        m_accumulated_time -= (double)num_owed_ticks * m_tick_duration;
+        // Rounding can leave a tiny negative rest
+        m_accumulated_time = std::max(m_accumulated_time, 0.0);
+
+        m_frame_ticks = (uint32)std::min<uint64>(num_owed_ticks, m_max_ticks_per_frame);
+        m_num_dropped_ticks += num_owed_ticks - m_frame_ticks;
+        return m_frame_ticks;
+    }
+}
@@ -4,6 +4,7 @@
 
 #include "core/window.h"
 #include "core.h"
+#include "renderer/render_device.h"
 
 namespace SymoCraft
 {
@@ -15,7 +16,7 @@ namespace SymoCraft
         Window* user_window = (Window*) glfwGetWindowUserPointer(window_ptr);
         user_window->width = new_width;
         user_window->height = new_height;
-        glViewport(0, 0, new_width, new_height);
+        RenderDevice::Get().SetViewport(0, 0, new_width, new_height);
     }
 
 // Static functions
@@ -91,7 +92,21 @@ namespace SymoCraft
             return nullptr;
         }
 
-        glViewport(0, 0, res->width, res->height);
+        RenderDevice::Get().SetViewport(0, 0, res->width, res->height);
+
+        return res;
+    }
+
+    Window* Window::CreateHeadless(const char *window_title, int width, int height)
+    {
+        Window* res = new Window;
+        res->width = width;
+        res->height = height;
+        res->title = window_title;
+        res->window_ptr = nullptr;
+        AmoLogger_Info("Headless window created. ");
+
+        RenderDevice::Get().SetViewport(0, 0, res->width, res->height);
 
         return res;
     }
@@ -99,22 +114,34 @@ namespace SymoCraft
 
     void Window::MakeContextCurrent()
     {
+        if (IsHeadless())
+            return;
+
         glfwMakeContextCurrent((GLFWwindow*)window_ptr);
     }
 
     void Window::PollInt()
     {
+        if (IsHeadless())
+            return;
+
         //
         glfwPollEvents();
     }
 
     void Window::SwapBuffers()
     {
+        if (IsHeadless())
+            return;
+
         glfwSwapBuffers((GLFWwindow*)window_ptr);
     }
 
     bool Window::ShouldClose()
     {
+        if (IsHeadless())
+            return close_requested;
+
         return glfwWindowShouldClose((GLFWwindow*)window_ptr);
     }
 
@@ -124,17 +151,28 @@ namespace SymoCraft
 
     void Window::Close()
     {
+        if (IsHeadless())
+        {
+            close_requested = true;
+            return;
+        }
         glfwSetWindowShouldClose((GLFWwindow*)window_ptr, true);
     }
 
     void Window::Destroy()
     {
+        if (IsHeadless())
+            return;
+
         glfwDestroyWindow((GLFWwindow*)window_ptr);
         window_ptr = nullptr;
     }
 
     void Window::SetCursorMode(CursorMode cursorMode)
     {
+        if (IsHeadless())
+            return;
+
         int glfw_cursor_mode;
         switch (cursorMode)
         {
@@ -155,6 +193,9 @@ namespace SymoCraft
 
     void Window::SetVsync(bool on)
     {
+        if (IsHeadless())
+            return;
+
         if (on)
             glfwSwapInterval(1);
         else
@@ -163,11 +204,20 @@ namespace SymoCraft
 
     void Window::SetTitle(const char *new_title)
     {
+        if (IsHeadless())
+            return;
+
         glfwSetWindowTitle((GLFWwindow*)window_ptr, new_title);
     }
 
     void Window::SetSize(int width, int height)
     {
+        if (IsHeadless())
+        {
+            this->width = width;
+            this->height = height;
+            return;
+        }
         glfwSetWindowSize((GLFWwindow*)window_ptr, width, height);
     }
 
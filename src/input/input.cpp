@@ -12,6 +12,7 @@ namespace SymoCraft
     {
         bool key_pressed[GLFW_KEY_LAST] = {};
         bool key_begin_pressed[GLFW_KEY_LAST] = {};
+        bool mouse_button_pressed[GLFW_MOUSE_BUTTON_LAST + 1] = {};
 
         void EndFrame()
         {
@@ -21,7 +22,7 @@ namespace SymoCraft
         void ProcessKeyEvent( int key, int action)
         {
             // invalid key value
-            if (key < 0 || key > GLFW_KEY_LAST)
+            if (key < 0 || key >= GLFW_KEY_LAST)
                 return;
 
             if (action == GLFW_PRESS)
@@ -47,5 +48,23 @@ namespace SymoCraft
             AmoLogger_Assert( key >= 0 && key < GLFW_KEY_LAST, "Invalid key. ");
             return key_begin_pressed[key];
         }
+
+        void ProcessMouseButtonEvent( int button, int action)
+        {
+            // invalid button value
+            if (button < 0 || button > GLFW_MOUSE_BUTTON_LAST)
+                return;
+
+            if (action == GLFW_PRESS)
+                mouse_button_pressed[button] = true;
+            else if (action == GLFW_RELEASE)
+                mouse_button_pressed[button] = false;
+        }
+
+        bool IsMouseButtonPressed( int button)
+        {
+            AmoLogger_Assert( button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST, "Invalid mouse button. ");
+            return mouse_button_pressed[button];
+        }
     }
 }
\ No newline at end of file
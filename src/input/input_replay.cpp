@@ -0,0 +1,130 @@
+//
+// Created by Amo on 2022/7/20.
+//
+
+#include "input/input_replay.h"
+#include "input/input.h"
+#include "core/application.h"
+#include <sstream>
+
+namespace SymoCraft
+{
+    namespace InputReplay
+    {
+        enum class EventType : uint8
+        {
+            Key,
+            MouseButton,
+            MouseMove,
+        };
+
+        struct ReplayEvent
+        {
+            uint32 frame;
+            EventType type;
+            int code;       // key or mouse button
+            int action;     // GLFW_PRESS or GLFW_RELEASE
+            glm::dvec2 mouse_pos;
+        };
+
+        static std::vector<ReplayEvent> events;
+        static size_t next_event;
+
+        static bool ParseAction(const std::string& word, int& action)
+        {
+            if (word == "press")
+                action = GLFW_PRESS;
+            else if (word == "release")
+                action = GLFW_RELEASE;
+            else
+                return false;
+            return true;
+        }
+
+        bool Load(std::string_view filepath)
+        {
+            Clear();
+
+            std::ifstream replay_file(filepath.data());
+            if (!replay_file)
+            {
+                AmoLogger_Error("Could not open input replay: %s\n", filepath.data());
+                return false;
+            }
+
+            std::string line;
+            for (uint32 line_number = 1; std::getline(replay_file, line); line_number++)
+            {
+                line = line.substr(0, line.find('#'));
+                std::istringstream line_stream(line);
+
+                ReplayEvent event{};
+                std::string type, action;
+                if (!(line_stream >> event.frame >> type))
+                    continue;   // Empty line
+
+                bool is_valid;
+                if (type == "key")
+                {
+                    event.type = EventType::Key;
+                    is_valid = (bool)(line_stream >> event.code >> action) && ParseAction(action, event.action);
+                }
+                else if (type == "button")
+                {
+                    event.type = EventType::MouseButton;
+                    is_valid = (bool)(line_stream >> event.code >> action) && ParseAction(action, event.action);
+                }
+                else if (type == "mouse")
+                {
+                    event.type = EventType::MouseMove;
+                    is_valid = (bool)(line_stream >> event.mouse_pos.x >> event.mouse_pos.y);
+                }
+                else
+                    is_valid = false;
+
+                if (!is_valid)
+                {
+                    AmoLogger_Warning("Invalid input replay event at %s:%u\n", filepath.data(), line_number);
+                    continue;
+                }
+                events.push_back(event);
+            }
+
+            std::stable_sort(events.begin(), events.end(),
+                             [](const ReplayEvent& a, const ReplayEvent& b){ return a.frame < b.frame; });
+            AmoLogger_Log("Loaded %zu input replay events from %s\n", events.size(), filepath.data());
+            return true;
+        }
+
+        void Apply(uint32 frame)
+        {
+            for (; next_event < events.size() && events[next_event].frame <= frame; next_event++)
+            {
+                const ReplayEvent& event = events[next_event];
+                switch (event.type)
+                {
+                    case EventType::Key:
+                        Input::ProcessKeyEvent(event.code, event.action);
+                        break;
+                    case EventType::MouseButton:
+                        Input::ProcessMouseButtonEvent(event.code, event.action);
+                        break;
+                    case EventType::MouseMove:
+                        Application::MouseMovementCallBack(nullptr, event.mouse_pos.x, event.mouse_pos.y);
+                        break;
+                }
+            }
+        }
+
+        bool IsFinished()
+        {
+            return next_event >= events.size();
+        }
+
+        void Clear()
+        {
+            events.clear();
+            next_event = 0;
+        }
+    }
+}
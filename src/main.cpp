@@ -1,12 +1,37 @@
 #include <MemoryAllocator/AmoBase.h>
 #include "core/application.h"
+#include "benchmark/benchmark.h"
 
-int main()
+int main(int argc, char** argv)
 {
 #ifdef _DEBUG
     AmoBase::AmoMemory_Init(true, 1024);
 #endif
-    SymoCraft::Application::Init();
+    // Usage: SymoCraft --bench <name|prefix*|all> [--out <results.json>]
+    //        SymoCraft --headless [--frames <n>] [--replay <input.txt>] [--out <report.json>]
+    std::string_view bench_name, output_path;
+    SymoCraft::Application::LaunchOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        if (arg == "--headless")
+            options.headless = true;
+        else if (i + 1 >= argc)
+            break;
+        else if (arg == "--bench")
+            bench_name = argv[++i];
+        else if (arg == "--out")
+            output_path = argv[++i];
+        else if (arg == "--frames")
+            options.num_frames = (uint32)std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--replay")
+            options.replay_path = argv[++i];
+    }
+    if (!bench_name.empty())
+        return SymoCraft::Benchmark::Run(bench_name, output_path);
+    options.report_path = output_path;
+
+    SymoCraft::Application::Init(options);
     SymoCraft::Application::Run();
     SymoCraft::Application::Free();
 
@@ -4,32 +4,51 @@
 #include "playercontroller/playercontroller.h"
 #include "core.h"
 #include "core/constants.h"
-#include "core/window.h"
 #include "core/ECS/registry.h"
 #include "core/ECS/component.h"
 #include "core/ECS/Systems/physics_system.h"
 #include "world/world.h"
 #include "world/chunk_manager.h"
 #include "renderer/renderer.h"
+#include "input/input.h"
 
 namespace SymoCraft
 {
     namespace PlayerController
     {
-        void DoRayCast( ECS::Registry &registry, Window &window)
+        // Speed a left click adds to an entity, along the view direction
+        static const float kEntityPushSpeed = 6.0f;
+
+        void DoRayCast( ECS::Registry &registry)
         {
-            auto controller = registry.GetComponent<Character::CharacterComponent>(World::GetPlayer());
-            auto player_com = registry.GetComponent<Character::PlayerComponent>(World::GetPlayer());
-            auto &transform = registry.GetComponent<Transform>(World::GetPlayer());
+            const auto &player_com = registry.GetComponent<const Character::PlayerComponent>(World::GetPlayer());
+            const auto &transform = registry.GetComponent<const Transform>(World::GetPlayer());
+
+            const glm::vec3 eye = transform.position + player_com.camera_offset;
+            RaycastStaticResult res = Physics::RayCastStatic(eye, transform.front, 3.0f);
+
+            // An entity in front of the block is targeted instead of it, the player's own hit box is skipped
+            const RaycastEntityResult entity_res = Physics::RayCastEntities(eye, transform.front,
+                                                                            res.hit ? res.distance : 3.0f, World::GetPlayer());
+            if (entity_res.hit)
+            {
+                // Left click pushes the entity away
+                if (Input::IsMouseButtonPressed(GLFW_MOUSE_BUTTON_LEFT) && Application::block_place_debounce <= 0)
+                {
+                    if (registry.HasComponent<Physics::RigidBody>(entity_res.entity))
+                        registry.GetComponent<Physics::RigidBody>(entity_res.entity).velocity += transform.front * kEntityPushSpeed;
+                    Application::block_place_debounce = Application::kBlockPlaceDebounceTime;
+                }
+                return;
+            }
 
-            RaycastStaticResult res = Physics::RayCastStatic(transform.position + player_com.camera_offset, transform.front, 3.0f);
             if (res.hit)
             {
                 //printf("ray hitted\n");
                 glm::vec3 block_looking_atpos = res.point - (res.hit_normal * 0.1f);
                 Renderer::GenerateBlockFrameData(block_looking_atpos);
 
-                if (glfwGetMouseButton((GLFWwindow*)window.window_ptr, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS
+                if (Input::IsMouseButtonPressed(GLFW_MOUSE_BUTTON_RIGHT)
                     && Application::block_place_debounce <=0)
                 {
                     Block new_block = { 0, 0, 0, 0};
@@ -43,7 +62,7 @@ namespace SymoCraft
                     Application::block_place_debounce = Application::kBlockPlaceDebounceTime;
                 }
                 else
-                if (glfwGetMouseButton((GLFWwindow*)window.window_ptr , GLFW_MOUSE_BUTTON_LEFT)  == GLFW_PRESS
+                if (Input::IsMouseButtonPressed(GLFW_MOUSE_BUTTON_LEFT)
                     && Application::block_place_debounce <= 0)
                 {
                     static int num_delete;
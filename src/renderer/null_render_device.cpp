@@ -0,0 +1,193 @@
+#include "renderer/render_device.h"
+
+namespace SymoCraft
+{
+    // Find "uniform <type> <name>;" declarations, uniform blocks are skipped
+    static std::vector<std::string> ParseUniformNames(std::string_view source)
+    {
+        std::vector<std::string> names;
+        auto is_identifier_char = [](char c){ return std::isalnum((unsigned char)c) || c == '_'; };
+        auto skip_spaces = [&](size_t pos){
+            while (pos < source.size() && std::isspace((unsigned char)source[pos]))
+                pos++;
+            return pos;
+        };
+        auto read_identifier = [&](size_t& pos){
+            size_t begin = pos;
+            while (pos < source.size() && is_identifier_char(source[pos]))
+                pos++;
+            return source.substr(begin, pos - begin);
+        };
+
+        constexpr std::string_view keyword = "uniform";
+        for (size_t pos = source.find(keyword); pos != std::string_view::npos; pos = source.find(keyword, pos))
+        {
+            bool is_word = (pos == 0 || !is_identifier_char(source[pos - 1]))
+                    && pos + keyword.size() < source.size()
+                    && std::isspace((unsigned char)source[pos + keyword.size()]);
+            pos += keyword.size();
+            if (!is_word)
+                continue;
+
+            pos = skip_spaces(pos);
+            std::string_view type = read_identifier(pos);
+            pos = skip_spaces(pos);
+            std::string_view name = read_identifier(pos);
+            if (type.empty() || name.empty())
+                continue;
+            names.emplace_back(name);
+        }
+        return names;
+    }
+
+    void NullRenderDevice::Log(RenderCommand command, uint32 handle, uint64 bytes)
+    {
+        Record(command, bytes);
+        m_command_log.push_back({command, handle, bytes});
+    }
+
+    void NullRenderDevice::InitState()
+    {
+    }
+
+    void NullRenderDevice::SetViewport(int x, int y, int width, int height)
+    {
+        Log(RenderCommand::SetViewport);
+    }
+
+    void NullRenderDevice::Clear(const std::array<float, 4>& color, float depth)
+    {
+        Log(RenderCommand::Clear);
+    }
+
+    uint32 NullRenderDevice::CreateBuffer(size_t size)
+    {
+        Log(RenderCommand::CreateBuffer, m_next_handle);
+        return m_next_handle++;
+    }
+
+    void NullRenderDevice::UpdateBuffer(uint32 buffer, size_t offset, size_t size, const void* data)
+    {
+        Log(RenderCommand::UpdateBuffer, buffer, size);
+    }
+
+    void NullRenderDevice::DestroyBuffer(uint32 buffer)
+    {
+        Log(RenderCommand::DestroyBuffer, buffer);
+    }
+
+    void NullRenderDevice::BindUniformBuffer(uint32 binding, uint32 buffer)
+    {
+        Log(RenderCommand::BindUniformBuffer, buffer);
+    }
+
+    uint32 NullRenderDevice::CreateVertexArray(uint32 vertex_buffer, uint32 stride,
+                                               std::initializer_list<VertexAttribute> attributes)
+    {
+        Log(RenderCommand::CreateVertexArray, m_next_handle);
+        return m_next_handle++;
+    }
+
+    void NullRenderDevice::DestroyVertexArray(uint32 vertex_array)
+    {
+        Log(RenderCommand::DestroyVertexArray, vertex_array);
+    }
+
+    void NullRenderDevice::Draw(uint32 vertex_array, GLenum primitive_type, uint32 first_vertex, uint32 vertex_count)
+    {
+        Log(RenderCommand::Draw, vertex_array);
+        m_stats.num_vertices_drawn += vertex_count;
+    }
+
+    uint32 NullRenderDevice::CreateShader(ShaderType type, std::string_view source, std::string& info_log)
+    {
+        Log(RenderCommand::CreateShader, m_next_handle);
+        m_shader_sources[m_next_handle] = source;
+        return m_next_handle++;
+    }
+
+    void NullRenderDevice::DestroyShader(uint32 shader)
+    {
+        Log(RenderCommand::DestroyShader, shader);
+        m_shader_sources.erase(shader);
+    }
+
+    uint32 NullRenderDevice::LinkProgram(uint32 vertex_shader, uint32 fragment_shader, std::string& info_log)
+    {
+        Log(RenderCommand::LinkProgram, m_next_handle);
+
+        // Uniforms declared in both stages share one location
+        auto& uniforms = m_program_uniforms[m_next_handle];
+        for (uint32 shader : {vertex_shader, fragment_shader})
+        {
+            auto iter = m_shader_sources.find(shader);
+            if (iter == m_shader_sources.end())
+                continue;
+
+            for (std::string& name : ParseUniformNames(iter->second))
+            {
+                bool is_declared = std::any_of(uniforms.begin(), uniforms.end(),
+                                               [&](const ActiveUniform& uniform){ return uniform.name == name; });
+                if (!is_declared)
+                    uniforms.push_back({std::move(name), (int32)uniforms.size()});
+            }
+        }
+        return m_next_handle++;
+    }
+
+    std::vector<ActiveUniform> NullRenderDevice::GetActiveUniforms(uint32 program)
+    {
+        auto iter = m_program_uniforms.find(program);
+        return iter != m_program_uniforms.end() ? iter->second : std::vector<ActiveUniform>{};
+    }
+
+    void NullRenderDevice::DestroyProgram(uint32 program)
+    {
+        Log(RenderCommand::DestroyProgram, program);
+        m_program_uniforms.erase(program);
+    }
+
+    void NullRenderDevice::UseProgram(uint32 program)
+    {
+        Log(RenderCommand::UseProgram, program);
+    }
+
+    void NullRenderDevice::SetUniform(int32 location, UniformType type, const void* data, int32 count)
+    {
+        Log(RenderCommand::SetUniform, (uint32)location, GetUniformTypeSize(type) * count);
+    }
+
+    uint32 NullRenderDevice::CreateTexture(const TextureDesc& desc)
+    {
+        Log(RenderCommand::CreateTexture, m_next_handle);
+        return m_next_handle++;
+    }
+
+    void NullRenderDevice::UploadTexture(uint32 texture, int level, const glm::ivec3& offset, const glm::ivec3& size,
+                                         GLenum format, GLenum data_type, const void* pixels)
+    {
+        Log(RenderCommand::UploadTexture, texture, (uint64)size.x * size.y * size.z * GetPixelSize(format, data_type));
+    }
+
+    void NullRenderDevice::CopyTexture(uint32 src_texture, GLenum src_target, const glm::ivec3& src_offset,
+                                       uint32 dst_texture, GLenum dst_target, const glm::ivec3& dst_offset,
+                                       const glm::ivec3& size)
+    {
+        Log(RenderCommand::CopyTexture, dst_texture);
+    }
+
+    void NullRenderDevice::GenerateMipmaps(uint32 texture)
+    {
+        Log(RenderCommand::GenerateMipmaps, texture);
+    }
+
+    void NullRenderDevice::BindTexture(uint32 unit, uint32 texture)
+    {
+        Log(RenderCommand::BindTexture, texture);
+    }
+
+    void NullRenderDevice::DestroyTexture(uint32 texture)
+    {
+        Log(RenderCommand::DestroyTexture, texture);
+    }
+}
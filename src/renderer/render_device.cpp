@@ -0,0 +1,397 @@
+#include "renderer/render_device.h"
+
+namespace SymoCraft
+{
+    static RenderDevice* current_device = nullptr;
+
+    void RenderDevice::Init(RenderBackend backend)
+    {
+        if (current_device)
+            Free();
+
+        switch (backend)
+        {
+            case RenderBackend::OpenGL:
+                current_device = new OpenGLRenderDevice();
+                break;
+            case RenderBackend::Null:
+                current_device = new NullRenderDevice();
+                break;
+        }
+    }
+
+    void RenderDevice::Free()
+    {
+        delete current_device;
+        current_device = nullptr;
+    }
+
+    RenderDevice& RenderDevice::Get()
+    {
+        AmoLogger_Assert(current_device != nullptr, "Render device is not initialized.\n");
+        return *current_device;
+    }
+
+    uint64 RenderDeviceStats::GetTotalCommandCount() const
+    {
+        uint64 total = 0;
+        for (uint64 count : num_commands)
+            total += count;
+        return total;
+    }
+
+    void RenderDeviceStats::Reset()
+    {
+        num_commands.fill(0);
+        num_vertices_drawn = 0;
+        bytes_uploaded = 0;
+    }
+
+    size_t GetUniformTypeSize(UniformType type)
+    {
+        switch (type)
+        {
+            case UniformType::Float:
+            case UniformType::Int:
+            case UniformType::UInt:
+                return 4;
+            case UniformType::Vec2:
+            case UniformType::IVec2:
+                return 8;
+            case UniformType::Vec3:
+            case UniformType::IVec3:
+                return 12;
+            case UniformType::Vec4:
+            case UniformType::IVec4:
+                return 16;
+            case UniformType::Mat3:
+                return 36;
+            case UniformType::Mat4:
+                return 64;
+        }
+        return 0;
+    }
+
+    size_t GetPixelSize(GLenum format, GLenum data_type)
+    {
+        size_t num_channels;
+        switch (format)
+        {
+            case GL_RED:
+                num_channels = 1;
+                break;
+            case GL_RG:
+                num_channels = 2;
+                break;
+            case GL_RGB:
+                num_channels = 3;
+                break;
+            default:
+                num_channels = 4;
+                break;
+        }
+
+        switch (data_type)
+        {
+            case GL_FLOAT:
+                return num_channels * 4;
+            case GL_HALF_FLOAT:
+            case GL_UNSIGNED_SHORT:
+                return num_channels * 2;
+            default:
+                return num_channels;
+        }
+    }
+
+    // ----------------------------------------------------------------------
+    // OpenGL
+
+    void OpenGLRenderDevice::InitState()
+    {
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    void OpenGLRenderDevice::SetViewport(int x, int y, int width, int height)
+    {
+        Record(RenderCommand::SetViewport);
+        glViewport(x, y, width, height);
+    }
+
+    void OpenGLRenderDevice::Clear(const std::array<float, 4>& color, float depth)
+    {
+        Record(RenderCommand::Clear);
+        glClearNamedFramebufferfv(0, GL_COLOR, 0, color.data());
+        glClearNamedFramebufferfv(0, GL_DEPTH, 0, &depth);
+    }
+
+    uint32 OpenGLRenderDevice::CreateBuffer(size_t size)
+    {
+        Record(RenderCommand::CreateBuffer);
+        uint32 buffer;
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, (GLsizeiptr)size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        return buffer;
+    }
+
+    void OpenGLRenderDevice::UpdateBuffer(uint32 buffer, size_t offset, size_t size, const void* data)
+    {
+        Record(RenderCommand::UpdateBuffer, size);
+        glNamedBufferSubData(buffer, (GLintptr)offset, (GLsizeiptr)size, data);
+    }
+
+    void OpenGLRenderDevice::DestroyBuffer(uint32 buffer)
+    {
+        Record(RenderCommand::DestroyBuffer);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    void OpenGLRenderDevice::BindUniformBuffer(uint32 binding, uint32 buffer)
+    {
+        Record(RenderCommand::BindUniformBuffer);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    }
+
+    uint32 OpenGLRenderDevice::CreateVertexArray(uint32 vertex_buffer, uint32 stride,
+                                                 std::initializer_list<VertexAttribute> attributes)
+    {
+        Record(RenderCommand::CreateVertexArray);
+        uint32 vertex_array;
+        glCreateVertexArrays(1, &vertex_array);
+        glVertexArrayVertexBuffer(vertex_array, 0, vertex_buffer, 0, (GLsizei)stride);
+
+        // Draw float data solely for now
+        for (const auto& attribute : attributes)
+        {
+            glEnableVertexArrayAttrib(vertex_array, attribute.attribute_slot);
+            glVertexArrayAttribFormat(vertex_array, attribute.attribute_slot, attribute.element_amount,
+                                      attribute.data_type, GL_FALSE, attribute.offset);
+            glVertexArrayAttribBinding(vertex_array, attribute.attribute_slot, 0);
+        }
+        return vertex_array;
+    }
+
+    void OpenGLRenderDevice::DestroyVertexArray(uint32 vertex_array)
+    {
+        Record(RenderCommand::DestroyVertexArray);
+        glDeleteVertexArrays(1, &vertex_array);
+    }
+
+    void OpenGLRenderDevice::Draw(uint32 vertex_array, GLenum primitive_type, uint32 first_vertex, uint32 vertex_count)
+    {
+        Record(RenderCommand::Draw);
+        m_stats.num_vertices_drawn += vertex_count;
+        glBindVertexArray(vertex_array);
+        glDrawArrays(primitive_type, (GLint)first_vertex, (GLsizei)vertex_count);
+        glBindVertexArray(0);
+    }
+
+    uint32 OpenGLRenderDevice::CreateShader(ShaderType type, std::string_view source, std::string& info_log)
+    {
+        Record(RenderCommand::CreateShader);
+        GLenum gl_type = Shader::toGlShaderType(type);
+        if (gl_type == GL_INVALID_ENUM)
+        {
+            info_log = "ShaderType is unknown";
+            return UINT32_MAX;
+        }
+
+        // Send the shader source code to GL, and compile the shader
+        uint32 shader = glCreateShader(gl_type);
+        const char* source_c_str = source.data();
+        GLint source_length = (GLint)source.size();
+        glShaderSource(shader, 1, &source_c_str, &source_length);
+        glCompileShader(shader);
+
+        GLint is_compiled = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
+        if (is_compiled == GL_FALSE)
+        {
+            // The max length includes the NULL character
+            GLint max_length = 0;
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &max_length);
+            std::vector<GLchar> log(max_length + 1);
+            glGetShaderInfoLog(shader, max_length, &max_length, log.data());
+            info_log = log.data();
+
+            glDeleteShader(shader);
+            return UINT32_MAX;
+        }
+        return shader;
+    }
+
+    void OpenGLRenderDevice::DestroyShader(uint32 shader)
+    {
+        Record(RenderCommand::DestroyShader);
+        glDeleteShader(shader);
+    }
+
+    uint32 OpenGLRenderDevice::LinkProgram(uint32 vertex_shader, uint32 fragment_shader, std::string& info_log)
+    {
+        Record(RenderCommand::LinkProgram);
+        uint32 program = glCreateProgram();
+        glAttachShader(program, vertex_shader);
+        glAttachShader(program, fragment_shader);
+        glLinkProgram(program);
+
+        GLint is_linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+        if (is_linked == GL_FALSE)
+        {
+            GLint max_length = 0;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &max_length);
+            std::vector<GLchar> log(max_length + 1);
+            glGetProgramInfoLog(program, max_length, &max_length, log.data());
+            info_log = log.data();
+
+            glDeleteProgram(program);
+            return UINT32_MAX;
+        }
+
+        // Always detach shaders after a successful link
+        glDetachShader(program, vertex_shader);
+        glDetachShader(program, fragment_shader);
+        return program;
+    }
+
+    std::vector<ActiveUniform> OpenGLRenderDevice::GetActiveUniforms(uint32 program)
+    {
+        std::vector<ActiveUniform> uniforms;
+
+        int num_uniforms;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+        int max_char_length;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_char_length);
+        if (num_uniforms <= 0 || max_char_length <= 0)
+            return uniforms;
+
+        std::vector<char> char_buffer(max_char_length);
+        for (int i = 0; i < num_uniforms; i++)
+        {
+            int length, size;
+            GLenum data_type;
+            glGetActiveUniform(program, i, max_char_length, &length, &size, &data_type, char_buffer.data());
+            uniforms.push_back({char_buffer.data(), glGetUniformLocation(program, char_buffer.data())});
+        }
+        return uniforms;
+    }
+
+    void OpenGLRenderDevice::DestroyProgram(uint32 program)
+    {
+        Record(RenderCommand::DestroyProgram);
+        glDeleteProgram(program);
+    }
+
+    void OpenGLRenderDevice::UseProgram(uint32 program)
+    {
+        Record(RenderCommand::UseProgram);
+        glUseProgram(program);
+    }
+
+    void OpenGLRenderDevice::SetUniform(int32 location, UniformType type, const void* data, int32 count)
+    {
+        Record(RenderCommand::SetUniform, GetUniformTypeSize(type) * count);
+        switch (type)
+        {
+            case UniformType::Float:
+                glUniform1fv(location, count, (const float*)data);
+                break;
+            case UniformType::Int:
+                glUniform1iv(location, count, (const int*)data);
+                break;
+            case UniformType::UInt:
+                glUniform1uiv(location, count, (const uint32*)data);
+                break;
+            case UniformType::Vec2:
+                glUniform2fv(location, count, (const float*)data);
+                break;
+            case UniformType::Vec3:
+                glUniform3fv(location, count, (const float*)data);
+                break;
+            case UniformType::Vec4:
+                glUniform4fv(location, count, (const float*)data);
+                break;
+            case UniformType::IVec2:
+                glUniform2iv(location, count, (const int*)data);
+                break;
+            case UniformType::IVec3:
+                glUniform3iv(location, count, (const int*)data);
+                break;
+            case UniformType::IVec4:
+                glUniform4iv(location, count, (const int*)data);
+                break;
+            case UniformType::Mat3:
+                glUniformMatrix3fv(location, count, GL_FALSE, (const float*)data);
+                break;
+            case UniformType::Mat4:
+                glUniformMatrix4fv(location, count, GL_FALSE, (const float*)data);
+                break;
+        }
+    }
+
+    uint32 OpenGLRenderDevice::CreateTexture(const TextureDesc& desc)
+    {
+        Record(RenderCommand::CreateTexture);
+        uint32 texture;
+        glCreateTextures(desc.target, 1, &texture);
+
+        GLenum min_filter = desc.pixelated
+                ? (desc.levels > 1 ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST)
+                : (desc.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, (GLint)min_filter);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, desc.pixelated ? GL_NEAREST : GL_LINEAR);
+
+        if (desc.target == GL_TEXTURE_2D_ARRAY)
+            glTextureStorage3D(texture, desc.levels, desc.internal_format, desc.width, desc.height, desc.layers);
+        else
+            glTextureStorage2D(texture, desc.levels, desc.internal_format, desc.width, desc.height);
+
+        m_texture_targets[texture] = desc.target;
+        return texture;
+    }
+
+    void OpenGLRenderDevice::UploadTexture(uint32 texture, int level, const glm::ivec3& offset, const glm::ivec3& size,
+                                           GLenum format, GLenum data_type, const void* pixels)
+    {
+        Record(RenderCommand::UploadTexture, (uint64)size.x * size.y * size.z * GetPixelSize(format, data_type));
+        if (m_texture_targets[texture] == GL_TEXTURE_2D_ARRAY)
+            glTextureSubImage3D(texture, level, offset.x, offset.y, offset.z, size.x, size.y, size.z,
+                                format, data_type, pixels);
+        else
+            glTextureSubImage2D(texture, level, offset.x, offset.y, size.x, size.y, format, data_type, pixels);
+    }
+
+    void OpenGLRenderDevice::CopyTexture(uint32 src_texture, GLenum src_target, const glm::ivec3& src_offset,
+                                         uint32 dst_texture, GLenum dst_target, const glm::ivec3& dst_offset,
+                                         const glm::ivec3& size)
+    {
+        Record(RenderCommand::CopyTexture);
+        glCopyImageSubData(src_texture, src_target, 0, src_offset.x, src_offset.y, src_offset.z,
+                           dst_texture, dst_target, 0, dst_offset.x, dst_offset.y, dst_offset.z,
+                           size.x, size.y, size.z);
+    }
+
+    void OpenGLRenderDevice::GenerateMipmaps(uint32 texture)
+    {
+        Record(RenderCommand::GenerateMipmaps);
+        glGenerateTextureMipmap(texture);
+    }
+
+    void OpenGLRenderDevice::BindTexture(uint32 unit, uint32 texture)
+    {
+        Record(RenderCommand::BindTexture);
+        glBindTextureUnit(unit, texture);
+    }
+
+    void OpenGLRenderDevice::DestroyTexture(uint32 texture)
+    {
+        Record(RenderCommand::DestroyTexture);
+        m_texture_targets.erase(texture);
+        glDeleteTextures(1, &texture);
+    }
+}
@@ -3,6 +3,7 @@
 #include "core/window.h"
 #include "world/block.h"
 #include "core/constants.h"
+#include "renderer/render_device.h"
 
 namespace SymoCraft{
     Batch<BlockVertex3D> chunk_batch;
@@ -18,11 +19,20 @@ namespace SymoCraft{
         static glm::mat4 g_view_mat;
         static glm::mat4 g_combo_mat;
         static float g_normal;
+        static float g_time;
+
+        // Uniform names are hashed at compile time
+        constexpr uint32 kTextureArrayUniform = HashUniformName("u_texture_array");
+
+        static FrameConstants frame_constants;
+        static uint32 frame_constants_ubo;
 
         constexpr float depth_value = 1.0f;
         constexpr std::array<float, 4> clear_color = {0.529f, 0.808f, 0.922f, 1.0f};
 
         // Internal functions
+        static void CompileShaders();
+        static void UploadFrameConstants();
         static void GLAPIENTRY messageCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
                                                GLsizei length, const GLchar *message, const void *userParam);
 
@@ -30,33 +40,31 @@ namespace SymoCraft{
             Window &window = Application::GetWindow();
             camera = Application::GetCamera();
 
-            // Load OpenGL functions using Glad
-            if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-                AmoLogger_Error("Failed to initialize glad.\n");
-                return;
+            RenderDevice& device = RenderDevice::Get();
+            if (device.GetBackend() == RenderBackend::OpenGL)
+            {
+                // Load OpenGL functions using Glad
+                if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+                    AmoLogger_Error("Failed to initialize glad.\n");
+                    return;
+                }
+                std::cout << "GLAD initialized.\n";
+                std::cout << "Hello OpenGL " << GLVersion.major << '.' << GLVersion.minor << '\n';
+
+                // glEnable(GL_DEBUG_OUTPUT);
+                // glDebugMessageCallback(messageCallback, 0);
             }
-            std::cout << "GLAD initialized.\n";
-            std::cout << "Hello OpenGL " << GLVersion.major << '.' << GLVersion.minor << '\n';
-
-            // glEnable(GL_DEBUG_OUTPUT);
-            // glDebugMessageCallback(messageCallback, 0);
 
             // Enable render parameters
-            glEnable(GL_DEPTH_TEST);
-            glEnable(GL_CULL_FACE);
-            glCullFace(GL_BACK);
-            glDepthFunc(GL_LESS);
-            glDepthMask(GL_TRUE);
+            device.InitState();
 
 
             line_batch.SetPrimitiveType(GL_LINES);
             line_batch.SetBatchSize(100);
-            // Initialize shaders
-            block_shader.CompileAndLink("../assets/shaders/vs_BlockShader.glsl",
-                                        "../assets/shaders/fs_BlockShader.glsl");
-
-            line3D_shader.CompileAndLink("../assets/shaders/vs_FrameShader.glsl",
-                                         "../assets/shaders/fs_FrameShader.glsl");
+            // Initialize shaders and the per-frame uniform buffer
+            CompileShaders();
+            frame_constants_ubo = device.CreateBuffer(sizeof(FrameConstants));
+            device.BindUniformBuffer(kFrameConstantsBinding, frame_constants_ubo);
 
             // Initialize batches
             chunk_batch.Init({
@@ -65,7 +73,7 @@ namespace SymoCraft{
                                      {2, 1, GL_FLOAT, offsetof(BlockVertex3D, normal   )}});
 
             line_batch.Init({
-                                    {0, 3,   GL_INT, offsetof(BlockVertex3D, pos_coord)}});
+                                    {0, 3,   GL_INT, offsetof(LineVertex3D, pos_coord)}});
 
 
             LoadBlocks("../assets/configs/blockFormats.yaml");
@@ -75,6 +83,8 @@ namespace SymoCraft{
             chunk_batch.Free();
             line_batch.Free();
             block_shader.Destroy();
+            line3D_shader.Destroy();
+            RenderDevice::Get().DestroyBuffer(frame_constants_ubo);
         }
 
         void Render() {
@@ -87,43 +97,60 @@ namespace SymoCraft{
             block_shader.Destroy();
             line3D_shader.Destroy();
 
-            block_shader.CompileAndLink("assets/shaders/vs_BlockShader.glsl",
-                                        "assets/shaders/fs_BlockShader.glsl");
-            line3D_shader.CompileAndLink("../assets/shaders/vs_FrameShader.glsl",
-                                         "../assets/shaders/fs_FrameShader.glsl");
+            CompileShaders();
         }
 
         void DrawBatches3D() {
             g_projection_mat = camera->GetCameraProjMat();
             g_view_mat = camera->GetCameraViewMat();
             g_combo_mat = g_projection_mat * g_view_mat;
+            g_time += Application::delta_time;
+            UploadFrameConstants();
 
             block_shader.Bind();
-            block_shader.UploadMat4("u_combo_mat", g_combo_mat);
             chunk_batch.Draw();
             block_shader.Unbind();
 
             line3D_shader.Bind();
-            line3D_shader.UploadMat4("u_combo_mat", g_combo_mat);
             line_batch.ReloadData();
             line_batch.Draw();
             line3D_shader.Unbind();
         }
 
         void FlushBatches3D(const glm::mat4 &projection_mat, const glm::mat4 &view_mat) {
-            block_shader.Bind();
-
             g_combo_mat = projection_mat * view_mat;
-            block_shader.UploadMat4("u_combo_mat", g_combo_mat);
+            UploadFrameConstants();
+
+            block_shader.Bind();
             chunk_batch.Draw();
 
             block_shader.Unbind();
         }
 
 
+        static void CompileShaders() {
+            block_shader.CompileAndLink("../assets/shaders/vs_BlockShader.glsl",
+                                        "../assets/shaders/fs_BlockShader.glsl");
+
+            line3D_shader.CompileAndLink("../assets/shaders/vs_FrameShader.glsl",
+                                         "../assets/shaders/fs_FrameShader.glsl");
+
+            // Samplers never change, set them once after linking
+            block_shader.Bind();
+            block_shader.Upload(block_shader.GetUniformHandle<int>(kTextureArrayUniform), 0);
+            block_shader.Unbind();
+        }
+
+        // One buffer update per frame instead of one uniform upload per program
+        static void UploadFrameConstants() {
+            frame_constants.combo_mat = g_combo_mat;
+            frame_constants.camera_pos = glm::vec4(camera->GetCameraPos(), 1.0f);
+            frame_constants.time = g_time;
+            RenderDevice::Get().UpdateBuffer(frame_constants_ubo, 0, sizeof(FrameConstants), &frame_constants);
+        }
+
         void ClearBuffers() {
-            glClearNamedFramebufferfv(0, GL_COLOR, 0, clear_color.data());
-            glClearNamedFramebufferfv(0, GL_DEPTH, 0, &depth_value);
+            RenderDevice::Get().Clear(clear_color, depth_value);
         }
 
 
@@ -1,4 +1,5 @@
 #include "renderer/shader.h"
+#include "renderer/render_device.h"
 
 bool Shader::Compile(ShaderType type, std::string_view shaderFilepath)
 {
@@ -19,43 +20,16 @@ bool Shader::Compile(ShaderType type, std::string_view shaderFilepath)
         AmoLogger_Error("Could not open file: %s",  shaderFilepath.data());
 
 
-	GLenum shaderType = toGlShaderType(type);
-	if (shaderType == GL_INVALID_ENUM) {
-		AmoLogger_Error("ShaderType is unknown\n");
-		return false;
-	}
-
-	// Create an empty shader handle
-	shaderId = glCreateShader(shaderType);
-
-	// Send the shader source code to GL, and Compile the shader
-	const char* source_c_str = shader_source_code.c_str();
-	glShaderSource(shaderId, 1, &source_c_str, nullptr);
-	glCompileShader(shaderId);
-
-
-	// Check if the compilation succeeded
-	GLint isCompiled = 0;
-	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &isCompiled);
-	if (isCompiled == GL_FALSE)
+	// Compile the shader through the render device
+	std::string info_log;
+	shaderId = SymoCraft::RenderDevice::Get().CreateShader(type, shader_source_code, info_log);
+	if (shaderId == UINT32_MAX)
 	{
-		// If compilation failed, find out why and log the error
-		GLint maxLength = 0;
-		glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &maxLength);
-
-		// The maxLength includes the NULL character
-		std::vector<GLchar> infoLog(maxLength);
-		glGetShaderInfoLog(shaderId, maxLength, &maxLength, &infoLog[0]);
-
-		// We don't need the shader anymore if compilation failed
-		glDeleteShader(shaderId);
-
-		AmoLogger_Error("Shader Compilation failed: \n%s", infoLog.data());
-
-		shaderId = UINT32_MAX;
+		AmoLogger_Error("Shader Compilation failed: \n%s", info_log.data());
 		return false;
 	}
 
+	m_type = type;
 	return true;
 }
 
@@ -63,7 +37,7 @@ void Shader::Destroy()
 {
 	if (shaderId != UINT32_MAX)
 	{
-		glDeleteShader(shaderId);
+		SymoCraft::RenderDevice::Get().DestroyShader(shaderId);
 		shaderId = UINT32_MAX;
 	}
 }
@@ -1,40 +1,23 @@
 #include "renderer/shader_program.h"
+#include "renderer/render_device.h"
 
-// Internal Structures
-struct ShaderVariable
-{
-	std::string name;
-	GLint var_location{};
-	uint32 shaderProgramId{};
-
-	bool operator==(const ShaderVariable& other) const
-	{
-		return other.shaderProgramId == shaderProgramId && other.name == name;
-	}
-};
-
-struct HashShaderVar
-{
-	std::size_t operator()(const ShaderVariable& key) const
-	{
-		// This code was adapted from https://stackoverflow.com/questions/35985960/c-why-is-boosthash-combine-the-best-way-to-combine-hash-values
-		std::size_t seed = std::hash<std::string>()(key.name);
-		seed ^= std::hash<uint32>()(key.shaderProgramId) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-		return seed;
-	}
-};
+using SymoCraft::RenderDevice;
+using SymoCraft::UniformType;
 
 // Internal Variables
-static auto allShaderVariableLocations = robin_hood::unordered_set<ShaderVariable, HashShaderVar>();
+// Uniform locations of all programs, keyed by the program id in the high bits and the hashed name in the low bits
+static auto allShaderVariableLocations = robin_hood::unordered_flat_map<uint64, GLint>();
 
 // Forward Declarations
 static GLint getVariableLocation(const ShaderProgram& shader, const char* varName);
 
-bool ShaderProgram::CompileAndLink(std::string_view vertexShaderFile, std::string_view fragmentShaderFile)
+static inline uint64 toVariableKey(uint32 program_id, uint32 name_hash)
 {
-	// Create the shader program
-	GLuint program = glCreateProgram();
+	return ((uint64)program_id << 32) | name_hash;
+}
 
+bool ShaderProgram::CompileAndLink(std::string_view vertexShaderFile, std::string_view fragmentShaderFile)
+{
 	// Delete the shader if compilation fails( no sense to keep it )
 	Shader vertexShader{};
 	if (!vertexShader.Compile(ShaderType::Vertex, vertexShaderFile))
@@ -47,71 +30,34 @@ bool ShaderProgram::CompileAndLink(std::string_view vertexShaderFile, std::strin
 	Shader fragmentShader{};
 	if (!fragmentShader.Compile(ShaderType::Fragment, fragmentShaderFile))
 	{
+        vertexShader.Destroy();
         fragmentShader.Destroy();
         AmoLogger_Error("Failed to compile fragment shader.");
 		return false;
 	}
 
-	// Attach the vertex/fragment shaders and try to link them together
-	glAttachShader(program, vertexShader.shaderId);
-	glAttachShader(program, fragmentShader.shaderId);
-
-	// Try to link our program
-	glLinkProgram(program);
+	// Try to link our program, we don't need the shaders anymore either way
+	RenderDevice& device = RenderDevice::Get();
+	std::string info_log;
+	uint32 program = device.LinkProgram(vertexShader.shaderId, fragmentShader.shaderId, info_log);
+    vertexShader.Destroy();
+    fragmentShader.Destroy();
 
 	// Log errors if the linking failed
-	GLint isLinked = GL_FALSE;
-	glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
-	if (isLinked == GL_FALSE)
+	if (program == UINT32_MAX)
 	{
-		GLint maxLength = 0;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
-
-		// The maxLength includes the NULL character
-		std::vector<GLchar> infoLog(maxLength);
-		glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
-
-		// We don't need the program anymore if linking failed
-		glDeleteProgram(program);
-        vertexShader.Destroy();
-        fragmentShader.Destroy();
-
-        AmoLogger_Error("Shader linking failed:\n%s", infoLog.data());
+        AmoLogger_Error("Shader linking failed:\n%s", info_log.data());
 		programId = UINT32_MAX;
 		return false;
 	}
 
-	// Always detach shaders after a successful link and destroy them since we don't need them anymore
-	glDetachShader(program, vertexShader.shaderId);
-	glDetachShader(program, fragmentShader.shaderId);
-    vertexShader.Destroy();
-    fragmentShader.Destroy();
-
 	// If linking succeeded, get all the active uniforms and store them in our map of uniform variable locations
-	int numUniforms;
-	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
-
-	int max_char_length;
-	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_char_length);
-	if (numUniforms > 0 && max_char_length > 0)
+	for (const auto& uniform : device.GetActiveUniforms(program))
 	{
-		auto charBuffer = new char[max_char_length];
-
-		for (int i = 0; i < numUniforms; i++)
-		{
-			int length, size;
-			GLenum data_type;
-			glGetActiveUniform(program, i, max_char_length, &length, &size, &data_type, charBuffer);
-			GLint var_location = glGetUniformLocation(program, charBuffer);
-			ShaderVariable shaderVar;
-			shaderVar.name = charBuffer;
-			shaderVar.var_location = var_location;
-			shaderVar.shaderProgramId = program;
-			allShaderVariableLocations.emplace(shaderVar);
-		}
-
-		delete[] charBuffer;
-        charBuffer = nullptr;
+		auto [iter, is_inserted] = allShaderVariableLocations.emplace(toVariableKey(program, HashUniformName(uniform.name)),
+																	   uniform.location);
+		if (!is_inserted)
+			AmoLogger_Warning("Uniform name hash collision on '%s'.\n", uniform.name.c_str());
 	}
 
 	programId = program;
@@ -123,7 +69,16 @@ void ShaderProgram::Destroy()
 {
 	if (programId != UINT32_MAX)
 	{
-		glDeleteProgram(programId);
+		// Ids of deleted programs get reused, drop their uniforms
+		for (auto iter = allShaderVariableLocations.begin(); iter != allShaderVariableLocations.end();)
+		{
+			if ((uint32)(iter->first >> 32) == programId)
+				iter = allShaderVariableLocations.erase(iter);
+			else
+				++iter;
+		}
+
+		RenderDevice::Get().DestroyProgram(programId);
 		programId = UINT32_MAX;
 	}
 
@@ -131,90 +86,91 @@ void ShaderProgram::Destroy()
 
 void ShaderProgram::Bind() const
 {
-	glUseProgram(programId);
+	RenderDevice::Get().UseProgram(programId);
 }
 
 void ShaderProgram::Unbind() const
 {
-	glUseProgram(0);
+	RenderDevice::Get().UseProgram(0);
 }
 
 void ShaderProgram::UploadVec4(const char* varName, const glm::vec4& vec4) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform4f(var_location, vec4.x, vec4.y, vec4.z, vec4.w);
+	RenderDevice::Get().SetUniform(var_location, UniformType::Vec4, glm::value_ptr(vec4));
 }
 
 void ShaderProgram::UploadVec3(const char* varName, const glm::vec3& vec3) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform3f(var_location, vec3.x, vec3.y, vec3.z);
+	RenderDevice::Get().SetUniform(var_location, UniformType::Vec3, glm::value_ptr(vec3));
 }
 
 void ShaderProgram::UploadVec2(const char* varName, const glm::vec2& vec2) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform2f(var_location, vec2.x, vec2.y);
+	RenderDevice::Get().SetUniform(var_location, UniformType::Vec2, glm::value_ptr(vec2));
 }
 
 void ShaderProgram::UploadIVec4(const char* varName, const glm::ivec4& vec4) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform4i(var_location, vec4.x, vec4.y, vec4.z, vec4.w);
+	RenderDevice::Get().SetUniform(var_location, UniformType::IVec4, glm::value_ptr(vec4));
 }
 
 void ShaderProgram::UploadIVec3(const char* varName, const glm::ivec3& vec3) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform3i(var_location, vec3.x, vec3.y, vec3.z);
+	RenderDevice::Get().SetUniform(var_location, UniformType::IVec3, glm::value_ptr(vec3));
 }
 
 void ShaderProgram::UploadIVec2(const char* varName, const glm::ivec2& vec2) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform2i(var_location, vec2.x, vec2.y);
+	RenderDevice::Get().SetUniform(var_location, UniformType::IVec2, glm::value_ptr(vec2));
 }
 
 void ShaderProgram::UploadFloat(const char* varName, float value) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform1f(var_location, value);
+	RenderDevice::Get().SetUniform(var_location, UniformType::Float, &value);
 }
 
 void ShaderProgram::UploadInt(const char* varName, int value) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform1i(var_location, value);
+	RenderDevice::Get().SetUniform(var_location, UniformType::Int, &value);
 }
 
 void ShaderProgram::UploadUInt(const char* varName, uint32 value) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform1ui(var_location, value);
+	RenderDevice::Get().SetUniform(var_location, UniformType::UInt, &value);
 }
 
 void ShaderProgram::UploadMat4(const char* varName, const glm::mat4& mat4) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniformMatrix4fv(var_location, 1, GL_FALSE, glm::value_ptr(mat4));
+	RenderDevice::Get().SetUniform(var_location, UniformType::Mat4, glm::value_ptr(mat4));
 }
 
 void ShaderProgram::UploadMat3(const char* varName, const glm::mat3& mat3) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniformMatrix3fv(var_location, 1, GL_FALSE, glm::value_ptr(mat3));
+	RenderDevice::Get().SetUniform(var_location, UniformType::Mat3, glm::value_ptr(mat3));
 }
 
 void ShaderProgram::UploadIntArray(const char* varName, int length, const int* array) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform1iv(var_location, length, array);
+	RenderDevice::Get().SetUniform(var_location, UniformType::Int, array, length);
 }
 
 void ShaderProgram::UploadBool(const char* varName, bool value) const
 {
 	int var_location = getVariableLocation(*this, varName);
-	glUniform1i(var_location, value ? 1 : 0);
+	int int_value = value ? 1 : 0;
+	RenderDevice::Get().SetUniform(var_location, UniformType::Int, &int_value);
 }
 
 void ShaderProgram::clearAllShaderVariables()
@@ -222,20 +178,19 @@ void ShaderProgram::clearAllShaderVariables()
 	allShaderVariableLocations.clear();
 }
 
-// Private functions
-static GLint getVariableLocation(const ShaderProgram& shader, const char* varName)
+int32 ShaderProgram::getUniformLocation(uint32 name_hash) const
 {
-	ShaderVariable match = {
-		varName,
-		0,
-		shader.programId
-	};
-
-	auto iter = allShaderVariableLocations.find(match);
+	auto iter = allShaderVariableLocations.find(toVariableKey(programId, name_hash));
 	if (iter != allShaderVariableLocations.end())
 	{
-		return iter->var_location;
+		return iter->second;
 	}
 
 	return -1;
 }
+
+// Private functions
+static GLint getVariableLocation(const ShaderProgram& shader, const char* varName)
+{
+	return shader.GetUniformHandle<int>(HashUniformName(varName)).location;
+}
@@ -1,4 +1,8 @@
 #include "renderer/texture.h"
+#include "renderer/render_device.h"
+#include "renderer/texture_cache.h"
+
+using SymoCraft::RenderDevice;
 
 Texture Texture::CreateRegularTexture(std::string_view filepath, bool pixelated)
 {
@@ -20,24 +24,15 @@ Texture Texture::CreateRegularTexture(std::string_view filepath, bool pixelated)
         return Texture{};
     }
 
-    // Generate and bind the texture object
-    glCreateTextures(GL_TEXTURE_2D, 1, &res.m_texture_Id);
-
-    glTextureParameteri(res.m_texture_Id, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTextureParameteri(res.m_texture_Id, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTextureParameteri(res.m_texture_Id, GL_TEXTURE_MIN_FILTER, pixelated ? GL_NEAREST : GL_LINEAR);
-    glTextureParameteri(res.m_texture_Id, GL_TEXTURE_MAG_FILTER, pixelated ? GL_NEAREST : GL_LINEAR);
-
     if (pixels)
     {
-        glTextureStorage2D(res.m_texture_Id, 1,
-                           res.m_internal_format,
-                           res.m_width, res.m_height);
-        glTextureSubImage2D(res.m_texture_Id, 0,
-                            0, 0,
-                            res.m_width, res.m_height,
-                            res.m_texture_format, GL_UNSIGNED_BYTE, pixels);
-        glGenerateTextureMipmap(res.m_texture_Id);
+        // Generate the texture object and upload the image
+        RenderDevice& device = RenderDevice::Get();
+        res.m_texture_Id = device.CreateTexture({GL_TEXTURE_2D, res.m_width, res.m_height, 1, 1,
+                                                 (GLenum)res.m_internal_format, pixelated});
+        device.UploadTexture(res.m_texture_Id, 0, {0, 0, 0}, {res.m_width, res.m_height, 1},
+                             res.m_texture_format, GL_UNSIGNED_BYTE, pixels);
+        device.GenerateMipmaps(res.m_texture_Id);
     }
     else
     {
@@ -61,30 +56,66 @@ TextureArray TextureArray::CreateAtlasSlice(std::string_view filepath, bool pixe
 
 
     // Create texture array to store slices
+    RenderDevice& device = RenderDevice::Get();
     TextureArray tile_set;
     tile_set.layer_amount = tile_quantity;
-    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &tile_set.m_texture_Id);
-    glTextureStorage3D(tile_set.m_texture_Id, 1, tex_atlas.m_internal_format, tile_width, tile_height, tile_quantity);
+    tile_set.m_texture_Id = device.CreateTexture({GL_TEXTURE_2D_ARRAY, tile_width, tile_height, tile_quantity, 1,
+                                                  (GLenum)tex_atlas.m_internal_format, pixelated});
 
     for (GLsizei i = 0; i < tile_quantity; ++i)
     {
         // For "glCopyImageSubData", (0, 0, 0) is at the bottom left
         GLint x_coord = (i % tile_columns) * tile_width, // Whenever (i % tile_columns) == 0, reset to the first column
               y_coord = (i / tile_columns) * tile_height;  // Whenever (i / tile_columns)++, switch to the next row(upward)
-        glCopyImageSubData(tex_atlas.m_texture_Id, GL_TEXTURE_2D,
-                           0, x_coord, y_coord, 0,  // Source texture atlas mipmap level, x coord, y coord, z coord(null)
-                           tile_set.m_texture_Id, GL_TEXTURE_2D_ARRAY,
-                           0, 0, 0, i,  // Destiny texture array mipmap level, x coord, y coord, z coord(layers)
-                           tile_width, tile_height, 1);
+        device.CopyTexture(tex_atlas.m_texture_Id, GL_TEXTURE_2D, {x_coord, y_coord, 0},  // Source texture atlas x coord, y coord, z coord(null)
+                           tile_set.m_texture_Id, GL_TEXTURE_2D_ARRAY, {0, 0, i},  // Destiny texture array x coord, y coord, z coord(layers)
+                           {tile_width, tile_height, 1});
     }
-    glDeleteTextures(1, &tex_atlas.m_texture_Id);
+    device.DestroyTexture(tex_atlas.m_texture_Id);
+    device.GenerateMipmaps(tile_set.m_texture_Id);
+
+    return tile_set;
+}
+
+TextureArray TextureArray::CreateFromCache(std::string_view atlas_filepath, std::string_view cache_filepath, bool pixelated)
+{
+    using namespace SymoCraft;
+    constexpr uint16 tile_width = 64, tile_height = 64;
 
-    //Misc
-    glTextureParameteri(tile_set.m_texture_Id, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTextureParameteri(tile_set.m_texture_Id, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTextureParameteri(tile_set.m_texture_Id, GL_TEXTURE_MIN_FILTER, pixelated ? GL_NEAREST : GL_LINEAR);
-    glTextureParameteri(tile_set.m_texture_Id, GL_TEXTURE_MAG_FILTER, pixelated ? GL_NEAREST : GL_LINEAR);
-    glGenerateTextureMipmap(tile_set.m_texture_Id);
+    if (!TextureCache::IsUpToDate(atlas_filepath, cache_filepath, tile_width, tile_height)
+        && !TextureCache::Cook(atlas_filepath, cache_filepath, tile_width, tile_height))
+    {
+        AmoLogger_Warning("Falling back to slicing the atlas at runtime: %s", atlas_filepath.data());
+        return CreateAtlasSlice(atlas_filepath, pixelated);
+    }
+
+    TextureCache::MappedTextureCache cache;
+    if (!TextureCache::Map(cache_filepath, cache))
+        return CreateAtlasSlice(atlas_filepath, pixelated);
+    const TextureCache::TextureCacheHeader& header = *cache.header;
+
+    TextureArray tile_set;
+    tile_set.m_filepath = atlas_filepath;
+    tile_set.m_width = (int)header.tile_width;
+    tile_set.m_height = (int)header.tile_height;
+    tile_set.m_channel_amount = 4;
+    tile_set.m_texture_format = GL_RGBA;
+    tile_set.m_internal_format = GL_RGBA8;
+    tile_set.layer_amount = (uint16)header.layer_count;
+
+    // Upload every level straight from the mapped file
+    RenderDevice& device = RenderDevice::Get();
+    tile_set.m_texture_Id = device.CreateTexture({GL_TEXTURE_2D_ARRAY, tile_set.m_width, tile_set.m_height,
+                                                  (int)header.layer_count, (int)header.level_count,
+                                                  GL_RGBA8, pixelated});
+    for (uint32 level = 0; level < header.level_count; level++)
+    {
+        glm::ivec2 level_size = TextureCache::GetLevelSize(header, level);
+        device.UploadTexture(tile_set.m_texture_Id, (int)level, {0, 0, 0},
+                             {level_size.x, level_size.y, (int)header.layer_count},
+                             GL_RGBA, GL_UNSIGNED_BYTE, cache.pixels + TextureCache::GetLevelOffset(header, level));
+    }
 
+    TextureCache::Unmap(cache);
     return tile_set;
 }
@@ -0,0 +1,287 @@
+//
+// Created by Amo on 2022/7/21.
+//
+
+#include "renderer/texture_cache.h"
+#include <stb/stb_image.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SYMOCRAFT_TEXTURE_CACHE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace SymoCraft::TextureCache
+{
+    constexpr size_t kTexelSize = 4;
+
+    static bool GetSourceStamp(std::string_view atlas_filepath, uint64& size, int64& write_time)
+    {
+        std::error_code error;
+        std::filesystem::path path(atlas_filepath);
+        size = std::filesystem::file_size(path, error);
+        if (error)
+            return false;
+        write_time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        return !error;
+    }
+
+    glm::ivec2 GetLevelSize(const TextureCacheHeader& header, uint32 level)
+    {
+        return {std::max(1u, header.tile_width >> level), std::max(1u, header.tile_height >> level)};
+    }
+
+    size_t GetLevelOffset(const TextureCacheHeader& header, uint32 level)
+    {
+        size_t offset = 0;
+        for (uint32 i = 0; i < level; i++)
+        {
+            glm::ivec2 size = GetLevelSize(header, i);
+            offset += (size_t)size.x * size.y * kTexelSize * header.layer_count;
+        }
+        return offset;
+    }
+
+    // Average of the 2x2 block at (x, y) of the source, edges are clamped for odd or 1 texel wide sources
+    static inline void DownsampleTexel(const uint8* src, int src_width, int src_height, int x, int y, uint8* dst)
+    {
+        int x0 = std::min(x * 2, src_width - 1), x1 = std::min(x * 2 + 1, src_width - 1);
+        int y0 = std::min(y * 2, src_height - 1), y1 = std::min(y * 2 + 1, src_height - 1);
+        const uint8 *p00 = src + ((size_t)y0 * src_width + x0) * kTexelSize,
+                    *p01 = src + ((size_t)y0 * src_width + x1) * kTexelSize,
+                    *p10 = src + ((size_t)y1 * src_width + x0) * kTexelSize,
+                    *p11 = src + ((size_t)y1 * src_width + x1) * kTexelSize;
+        for (size_t channel = 0; channel < kTexelSize; channel++)
+            dst[channel] = (uint8)((p00[channel] + p01[channel] + p10[channel] + p11[channel] + 2) >> 2);
+    }
+
+    void DownsampleBox(const uint8* src, int src_width, int src_height, uint8* dst)
+    {
+        int dst_width = std::max(1, src_width / 2), dst_height = std::max(1, src_height / 2);
+        for (int y = 0; y < dst_height; y++)
+        {
+            int x = 0;
+#ifdef SYMOCRAFT_TEXTURE_CACHE_SSE2
+            // 4 destination texels from 2 rows of 8 source texels per iteration
+            if (src_width >= 2 && src_height >= 2)
+            {
+                const uint8* row0 = src + (size_t)(y * 2) * src_width * kTexelSize;
+                const uint8* row1 = row0 + (size_t)src_width * kTexelSize;
+                uint8* dst_row = dst + (size_t)y * dst_width * kTexelSize;
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i rounding = _mm_set1_epi16(2);
+                for (; x + 4 <= src_width / 2; x += 4)
+                {
+                    __m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+                    __m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+                    __m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+                    __m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+
+                    // Vertical sums of source texel pairs (0,1) (2,3) (4,5) (6,7) in 16 bits
+                    __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+                    __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+                    __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+                    __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+                    // Horizontal sums, each 64-bit half holds one texel
+                    __m128i d01 = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+                    __m128i d23 = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67), _mm_unpackhi_epi64(s45, s67));
+                    d01 = _mm_srli_epi16(_mm_add_epi16(d01, rounding), 2);
+                    d23 = _mm_srli_epi16(_mm_add_epi16(d23, rounding), 2);
+
+                    _mm_storeu_si128((__m128i*)(dst_row + x * kTexelSize), _mm_packus_epi16(d01, d23));
+                }
+            }
+#endif
+            for (; x < dst_width; x++)
+                DownsampleTexel(src, src_width, src_height, x, y, dst + ((size_t)y * dst_width + x) * kTexelSize);
+        }
+    }
+
+    bool Cook(std::string_view atlas_filepath, std::string_view cache_filepath, uint32 tile_width, uint32 tile_height)
+    {
+        AmoLogger_Log("Cooking texture cache: %s -> %s", atlas_filepath.data(), cache_filepath.data());
+
+        TextureCacheHeader header{};
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.tile_width = tile_width;
+        header.tile_height = tile_height;
+        if (!GetSourceStamp(atlas_filepath, header.source_size, header.source_write_time))
+        {
+            AmoLogger_Error("Could not find texture atlas: %s", atlas_filepath.data());
+            return false;
+        }
+
+        // Rows from the bottom up, the same as GL textures
+        int atlas_width, atlas_height, channel_amount;
+        stbi_set_flip_vertically_on_load(true);
+        uint8* atlas = stbi_load(atlas_filepath.data(), &atlas_width, &atlas_height, &channel_amount, 4);
+        if (!atlas)
+        {
+            AmoLogger_Error("STB failed to load image: %s\n STB Failure Reason: %s\n", atlas_filepath.data(), stbi_failure_reason());
+            return false;
+        }
+
+        uint32 tile_columns = atlas_width / tile_width, tile_rows = atlas_height / tile_height;
+        header.layer_count = tile_columns * tile_rows;
+        header.level_count = 1 + (uint32)std::log2(std::max(tile_width, tile_height));
+        if (header.layer_count == 0)
+        {
+            AmoLogger_Error("Texture atlas %s is smaller than a tile.", atlas_filepath.data());
+            stbi_image_free(atlas);
+            return false;
+        }
+
+        size_t pixels_size = GetLevelOffset(header, header.level_count);
+        std::vector<uint8> pixels(pixels_size);
+
+        // Level 0, slice the tiles, tile 0 is at the bottom left
+        size_t tile_row_size = tile_width * kTexelSize;
+        for (uint32 layer = 0; layer < header.layer_count; layer++)
+        {
+            uint32 x_coord = (layer % tile_columns) * tile_width,
+                   y_coord = (layer / tile_columns) * tile_height;
+            uint8* tile = pixels.data() + layer * tile_row_size * tile_height;
+            for (uint32 y = 0; y < tile_height; y++)
+                std::memcpy(tile + y * tile_row_size,
+                            atlas + ((size_t)(y_coord + y) * atlas_width + x_coord) * kTexelSize,
+                            tile_row_size);
+        }
+        stbi_image_free(atlas);
+
+        // Mip chains, every level from the one above
+        for (uint32 level = 1; level < header.level_count; level++)
+        {
+            glm::ivec2 src_size = GetLevelSize(header, level - 1), dst_size = GetLevelSize(header, level);
+            const uint8* src_level = pixels.data() + GetLevelOffset(header, level - 1);
+            uint8* dst_level = pixels.data() + GetLevelOffset(header, level);
+            for (uint32 layer = 0; layer < header.layer_count; layer++)
+                DownsampleBox(src_level + layer * (size_t)src_size.x * src_size.y * kTexelSize, src_size.x, src_size.y,
+                              dst_level + layer * (size_t)dst_size.x * dst_size.y * kTexelSize);
+        }
+
+        std::ofstream cache_file(cache_filepath.data(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!cache_file)
+        {
+            AmoLogger_Error("Could not open file: %s", cache_filepath.data());
+            return false;
+        }
+        cache_file.write((const char*)&header, sizeof(header));
+        cache_file.write((const char*)pixels.data(), (std::streamsize)pixels.size());
+        if (!cache_file)
+        {
+            AmoLogger_Error("Could not write texture cache: %s", cache_filepath.data());
+            return false;
+        }
+        return true;
+    }
+
+    bool IsUpToDate(std::string_view atlas_filepath, std::string_view cache_filepath, uint32 tile_width, uint32 tile_height)
+    {
+        std::ifstream cache_file(cache_filepath.data(), std::ios::in | std::ios::binary);
+        TextureCacheHeader header{};
+        if (!cache_file || !cache_file.read((char*)&header, sizeof(header)))
+            return false;
+
+        uint64 source_size;
+        int64 source_write_time;
+        if (!GetSourceStamp(atlas_filepath, source_size, source_write_time))
+            return false;
+
+        return header.magic == kMagic && header.version == kVersion
+               && header.tile_width == tile_width && header.tile_height == tile_height
+               && header.source_size == source_size && header.source_write_time == source_write_time;
+    }
+
+    bool Map(std::string_view cache_filepath, MappedTextureCache& cache)
+    {
+        cache = MappedTextureCache{};
+        const void* data = nullptr;
+
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(cache_filepath.data(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            AmoLogger_Error("Could not open file: %s", cache_filepath.data());
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file, &file_size);
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data)
+        {
+            if (mapping)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            AmoLogger_Error("Could not map texture cache: %s", cache_filepath.data());
+            return false;
+        }
+        cache.file_size = (size_t)file_size.QuadPart;
+        cache.file_handle = file;
+        cache.mapping_handle = mapping;
+#else
+        int file = open(cache_filepath.data(), O_RDONLY);
+        if (file < 0)
+        {
+            AmoLogger_Error("Could not open file: %s", cache_filepath.data());
+            return false;
+        }
+        struct stat file_stat{};
+        fstat(file, &file_stat);
+        data = file_stat.st_size > 0
+               ? mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0)
+               : MAP_FAILED;
+        close(file);
+        if (data == MAP_FAILED)
+        {
+            AmoLogger_Error("Could not map texture cache: %s", cache_filepath.data());
+            return false;
+        }
+        cache.file_size = (size_t)file_stat.st_size;
+#endif
+
+        cache.header = (const TextureCacheHeader*)data;
+        cache.pixels = (const uint8*)data + sizeof(TextureCacheHeader);
+
+        const TextureCacheHeader& header = *cache.header;
+        bool is_valid = cache.file_size >= sizeof(TextureCacheHeader)
+                        && header.magic == kMagic && header.version == kVersion && header.level_count <= 32
+                        && cache.file_size == sizeof(TextureCacheHeader) + GetLevelOffset(header, header.level_count);
+        if (!is_valid)
+        {
+            AmoLogger_Error("Invalid texture cache: %s", cache_filepath.data());
+            Unmap(cache);
+            return false;
+        }
+        return true;
+    }
+
+    void Unmap(MappedTextureCache& cache)
+    {
+        if (!cache.header)
+            return;
+
+#if defined(_WIN32)
+        UnmapViewOfFile(cache.header);
+        CloseHandle((HANDLE)cache.mapping_handle);
+        CloseHandle((HANDLE)cache.file_handle);
+#else
+        munmap((void*)cache.header, cache.file_size);
+#endif
+        cache = MappedTextureCache{};
+    }
+}
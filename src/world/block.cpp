@@ -3,6 +3,8 @@
 namespace SymoCraft{
     static robin_hood::unordered_flat_map<uint16, BlockFormat> block_format_map;
     static robin_hood::unordered_flat_map<std::string , uint16> name_to_id_map;
+    // Bit i is the m_is_solid of block id i, physics reads it for every block a body touches
+    static std::bitset<std::numeric_limits<uint16>::max() + 1> solid_blocks;
 
     uint16 get_block_id(std::string_view block_name)
     {
@@ -24,6 +26,11 @@ namespace SymoCraft{
     }
 
 
+    bool is_block_solid(uint16 block_id)
+    {
+        return solid_blocks.test(block_id);
+    }
+
     const BlockFormat& get_block(std::string_view name)
     {
         int blockId = get_block_id(name);
@@ -62,6 +69,7 @@ namespace SymoCraft{
                     top_texture, side_texture, bottom_texture,
                     isTransparent, isSolid, isBlendable,
                     isLightSource, lightLevel };
+            solid_blocks.set(id, isSolid);
         }
     }
 }
@@ -0,0 +1,243 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#include "world/block_tick.h"
+#include "world/chunk.h"
+#include "world/world.h"
+#include "world/fluid.h"
+#include "core/constants.h"
+#include "core/simulation_clock.h"
+
+namespace SymoCraft::BlockTick
+    {
+        // Block ids of blockFormats.yaml, the same as the terrain generator
+        static const uint16 kGrassBlockId = 2;
+        static const uint16 kSandBlockId = 3;
+        static const uint16 kDirtBlockId = 4;
+        static const uint16 kOakLogBlockId = 6;
+        static const uint16 kOakLeavesBlockId = 7;
+
+        // Leaves further than this from every log decay
+        static const int kLeafDecayDistance = 4;
+
+        static const glm::ivec3 kUp(0, 1, 0);
+        static const glm::ivec3 kDown(0, -1, 0);
+
+        static inline uint16 GetBlockId(const glm::ivec3& position)
+        {
+            return ChunkManager::GetBlock(glm::vec3(position)).block_id;
+        }
+
+        // Solid blocks that let no light through, grass dies under these but not under leaves
+        static inline bool IsOpaque(uint16 block_id)
+        {
+            return is_block_solid(block_id) && !get_block(block_id).m_is_transparent;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Scheduled ticks
+
+        struct ScheduledTick
+        {
+            uint64 tick;
+            uint64 key;
+            glm::ivec3 position;
+
+            inline bool operator>(const ScheduledTick& other) const
+            {
+                return tick != other.tick ? tick > other.tick : key > other.key;
+            }
+        };
+
+        // Earliest tick on top, ticks of the same tick in position order
+        static std::priority_queue<ScheduledTick, std::vector<ScheduledTick>, std::greater<>> scheduled_ticks;
+        // Positions in the queue
+        static robin_hood::unordered_flat_set<uint64> scheduled_keys;
+        // The last tick run
+        static uint64 current_tick = 0;
+
+        // Sand falls into air and water
+        static void FallSand(const glm::ivec3& position)
+        {
+            const uint16 below = GetBlockId(position + kDown);
+            if (below != BlockConstants::AIR_BLOCK.block_id && below != Fluid::kWaterBlockId)
+                return;
+
+            // Through the chunk manager, the neighbor updates schedule the sand above to fall after it
+            ChunkManager::RemoveBLock(glm::vec3(position));
+            ChunkManager::SetBlock(glm::vec3(position + kDown), kSandBlockId);
+        }
+
+        static void RunScheduledTick(const glm::ivec3& position)
+        {
+            // The block may have changed since it was scheduled
+            switch (GetBlockId(position))
+            {
+                case kSandBlockId:
+                    FallSand(position);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Random ticks
+
+        // Sections with a tickable block, rebuilt when a section starts or stops having one
+        static std::vector<std::pair<Chunk*, uint8>> tickable_sections;
+        static bool are_tickable_sections_changed = true;
+        // A fixed seed, the same world ticks the same way
+        static std::mt19937 random_engine(42);
+
+        static void GatherTickableSections()
+        {
+            tickable_sections.clear();
+            for (auto& pair : ChunkManager::GetAllChunks())
+                for (uint8 section = 0; section < k_num_sections; section++)
+                    if (pair.second.m_tickable_counts[section] != 0)
+                        tickable_sections.emplace_back(&pair.second, section);
+            are_tickable_sections_changed = false;
+        }
+
+        // Grass dies under an opaque block, and spreads to dirt with no opaque block on it
+        static void TickGrass(const glm::ivec3& position)
+        {
+            if (IsOpaque(GetBlockId(position + kUp)))
+            {
+                ChunkManager::SetBlock(glm::vec3(position), kDirtBlockId);
+                return;
+            }
+
+            std::uniform_int_distribution<int> side(-1, 1), height(-3, 1);
+            const glm::ivec3 target = position + glm::ivec3(side(random_engine), height(random_engine), side(random_engine));
+            if (GetBlockId(target) == kDirtBlockId && !IsOpaque(GetBlockId(target + kUp))
+                && GetBlockId(target + kUp) != Fluid::kWaterBlockId)
+                ChunkManager::SetBlock(glm::vec3(target), kGrassBlockId);
+        }
+
+        // Leaves decay without a log within kLeafDecayDistance blocks
+        static void TickLeaves(const glm::ivec3& position)
+        {
+            for (int x = -kLeafDecayDistance; x <= kLeafDecayDistance; x++)
+                for (int y = -kLeafDecayDistance; y <= kLeafDecayDistance; y++)
+                    for (int z = -kLeafDecayDistance; z <= kLeafDecayDistance; z++)
+                    {
+                        const uint16 block_id = GetBlockId(position + glm::ivec3(x, y, z));
+                        // A chunk that is not loaded may hold the log
+                        if (block_id == kOakLogBlockId || block_id == BlockConstants::NULL_BLOCK.block_id)
+                            return;
+                    }
+            ChunkManager::RemoveBLock(glm::vec3(position));
+        }
+
+        static void RunRandomTicks(TickStats& stats)
+        {
+            if (are_tickable_sections_changed)
+                GatherTickableSections();
+
+            for (auto [chunk, section] : tickable_sections)
+                for (uint32 i = 0; i < kRandomTicksPerSection; i++)
+                {
+                    // 12 random bits pick one of the 16 * 16 * 16 blocks
+                    const uint32 bits = random_engine();
+                    const int x = (int)(bits & 15), z = (int)((bits >> 4) & 15);
+                    const int y = section * k_section_height + (int)((bits >> 8) & 15);
+                    const uint16 block_id = chunk->GetLocalBlockInChunk(x, y, z).block_id;
+                    stats.num_random_picks++;
+                    if (!HasRandomTick(block_id))
+                        continue;
+
+                    stats.num_random_ticks++;
+                    const glm::ivec3 position(chunk->m_chunk_coord.x * k_chunk_length + x, y,
+                                              chunk->m_chunk_coord.y * k_chunk_width + z);
+                    if (block_id == kGrassBlockId)
+                        TickGrass(position);
+                    else if (block_id == kOakLeavesBlockId)
+                        TickLeaves(position);
+                }
+            stats.num_tickable_sections = (uint32)tickable_sections.size();
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Functions Implementation
+
+        bool HasRandomTick(uint16 block_id)
+        {
+            return block_id == kGrassBlockId || block_id == kOakLeavesBlockId;
+        }
+
+        void OnTickableSectionsChanged()
+        {
+            are_tickable_sections_changed = true;
+        }
+
+        void ScheduleTick(const glm::ivec3 &position, uint32 delay)
+        {
+            // A tick scheduled by a tick runs in a later tick
+            const uint64 key = World::GetBlockKey(position);
+            if (scheduled_keys.insert(key).second)
+                scheduled_ticks.push({current_tick + std::max(delay, 1u), key, position});
+        }
+
+        bool HasNeighborUpdate(uint16 block_id)
+        {
+            return block_id == kSandBlockId || block_id == kGrassBlockId;
+        }
+
+        void OnNeighborChanged(const glm::ivec3 &block_position, uint16 block_id, uint16 above_block_id)
+        {
+            switch (block_id)
+            {
+                case kSandBlockId:
+                    // The fall checks the block below when it runs
+                    ScheduleTick(block_position, kSandFallDelay);
+                    break;
+                case kGrassBlockId:
+                    if (IsOpaque(above_block_id))
+                        ChunkManager::SetBlock(glm::vec3(block_position), kDirtBlockId);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        void Update(const SimulationClock &clock)
+        {
+            for (uint32 tick = 0; tick < clock.GetFrameTicks(); tick++)
+                Tick(clock.GetTick() + tick);
+        }
+
+        TickStats Tick(uint64 tick)
+        {
+            current_tick = tick;
+            TickStats stats{};
+            while (!scheduled_ticks.empty() && scheduled_ticks.top().tick <= tick)
+            {
+                const ScheduledTick scheduled_tick = scheduled_ticks.top();
+                scheduled_ticks.pop();
+                scheduled_keys.erase(scheduled_tick.key);
+                RunScheduledTick(scheduled_tick.position);
+                stats.num_scheduled_ticks++;
+            }
+
+            if (tick % kTicksPerRandomTick == 0)
+                RunRandomTicks(stats);
+            return stats;
+        }
+
+        uint32 GetNumScheduledTicks()
+        {
+            return (uint32)scheduled_ticks.size();
+        }
+
+        void Clear()
+        {
+            scheduled_ticks = {};
+            scheduled_keys.clear();
+            tickable_sections.clear();
+            are_tickable_sections_changed = true;
+            current_tick = 0;
+        }
+    }
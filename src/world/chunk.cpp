@@ -5,6 +5,7 @@
 #include "renderer/renderer.h"
 #include "core/constants.h"
 #include "core/utils.h"
+#include "world/block_tick.h"
 
 
 namespace SymoCraft
@@ -56,6 +57,8 @@ namespace SymoCraft
                 if(left_neighbor)
                 return left_neighbor->SetLocalBlock(x, y, k_chunk_width + z, block_id);
             }
+            // No neighbor to hold the block, e.g. a tree at the edge of the world
+            return false;
         }
         else if (y >= k_chunk_height || y < 0)
             return false;
@@ -63,9 +66,12 @@ namespace SymoCraft
 
         int index = GetLocalBlockIndex(x, y, z);
         BlockFormat blockFormat = get_block(block_id);
+        UpdateTickableCount(y, m_local_blocks[index].block_id, block_id);
         m_local_blocks[index].block_id = block_id;
         m_local_blocks[index].SetTransparency(blockFormat.m_is_transparent);
         m_local_blocks[index].SetLightSource(blockFormat.m_is_lightSource);
+        // Placed water is a source
+        m_local_blocks[index].SetFluidLevel(0);
 
         UpdateChunkLocalBlocks({x, y, z});
         return true;
@@ -96,9 +102,11 @@ namespace SymoCraft
 
         // Replace the block with an air block
         int index = SymoCraft::Chunk::GetLocalBlockIndex(x, y, z);
+        UpdateTickableCount(y, m_local_blocks[index].block_id, BlockConstants::AIR_BLOCK.block_id);
         m_local_blocks[index].block_id = BlockConstants::AIR_BLOCK.block_id;
         m_local_blocks[index].SetTransparency(true);
         m_local_blocks[index].SetLightSource(false);
+        m_local_blocks[index].SetFluidLevel(0);
 
         UpdateChunkLocalBlocks({x, y, z});
         return true;
@@ -110,6 +118,31 @@ namespace SymoCraft
         return RemoveLocalBlock(localPosition.x, localPosition.y, localPosition.z);
     }
 
+    void Chunk::UpdateTickableCount(int y, uint16 old_block_id, uint16 new_block_id)
+    {
+        const bool was_tickable = BlockTick::HasRandomTick(old_block_id);
+        const bool is_tickable = BlockTick::HasRandomTick(new_block_id);
+        if (was_tickable == is_tickable)
+            return;
+
+        uint16& count = m_tickable_counts[y / k_section_height];
+        count += is_tickable ? 1 : -1;
+        // The section got its first or lost its last tickable block
+        if (count == (is_tickable ? 1 : 0))
+            BlockTick::OnTickableSectionsChanged();
+    }
+
+    void Chunk::CountTickableBlocks()
+    {
+        m_tickable_counts.fill(0);
+        for (int x = 0; x < k_chunk_length; x++)
+            for (int y = 0; y < k_chunk_height; y++)
+                for (int z = 0; z < k_chunk_width; z++)
+                    if (BlockTick::HasRandomTick(m_local_blocks[GetLocalBlockIndex(x, y, z)].block_id))
+                        m_tickable_counts[y / k_section_height]++;
+        BlockTick::OnTickableSectionsChanged();
+    }
+
     void InitializeNoise() {
         seed = mt();
 
@@ -228,6 +261,8 @@ namespace SymoCraft
                 }
             }
         }
+        // The blocks were written directly, SetLocalBlock keeps the counts from here on
+        CountTickableBlocks();
     }
 
     void Chunk::GenerateVegetation()
@@ -327,34 +362,37 @@ namespace SymoCraft
     void Chunk::Free() const
     {
         AmoMemory_Free(m_local_blocks);
-        AmoMemory_Free(m_vertex_data);
+        if (m_vertex_data)
+            AmoMemory_Free(m_vertex_data);
     }
 
-    void Chunk::GenerateRenderData()
+    // Scratch buckets of the mesher, one for each face direction
+    static std::array<std::vector<BlockVertex3D>, (size_t)FaceDirection::Count> face_buckets;
+    // Scratch grid of the downsampled blocks for level of detail meshes
+    static std::vector<Block> lod_blocks;
+
+    // Mesh a grid of blocks into the face buckets
+    // Each cell of the grid is a cube of scale * scale * scale blocks.
+    // With skirts on, the side faces on the border of the grid are only added for the top cell of a column,
+    // and stretched down by the skirt depth, to hide the seams between meshes of different levels of detail.
+    // Otherwise, get_cell is also called with x or z one cell out of the grid to cull the border faces.
+    // Parameters: grid size in cells, cell size in blocks, world coordinate of cell (0, 0, 0), use skirts?,
+    //             get_cell(x, y, z) returning the block of a cell, minimum y of the mesh, maximum y of the mesh
+    template<typename GetBlockFunc>
+    static void MeshBlockGrid(const glm::ivec3 &grid_size, int scale, const glm::ivec3 &world_origin, bool use_skirts,
+                              GetBlockFunc &&get_cell, int &min_y, int &max_y)
     {
-        //Clear old data
-        m_vertex_count = 0;
-        AmoMemory_Free(m_vertex_data);
-
-        //Initialization
-        m_vertex_data = (BlockVertex3D *) AmoMemory_Allocate(sizeof(BlockVertex3D) * World::max_vertices_per_chunk);
+        const int skirt_depth = std::max<int>(World::lod_min_skirt_depth, 8 * scale);
 
-        state = ChunkState::Updated;
-        if(m_is_fringe_chunk)
-            return;
-
-        const int kWorldChunkX = m_chunk_coord.x * 16;
-        const int kWorldChunkZ = m_chunk_coord.y * 16;
-
-        for (int y = 0; y < k_chunk_height; y++)
+        for (int y = 0; y < grid_size.y; y++)
         {
-            for (int x = 0; x < k_chunk_length; x++)
+            for (int x = 0; x < grid_size.x; x++)
             {
-                for (int z = 0; z < k_chunk_width; z++)
+                for (int z = 0; z < grid_size.z; z++)
                 {
 
                     // 36 Vertices per cube
-                    const Block &block = GetLocalBlock(x, y, z);
+                    const Block block = get_cell(x, y, z);
 
                     if (block == BlockConstants::NULL_BLOCK || block == BlockConstants::AIR_BLOCK) {
                         continue;
@@ -369,11 +407,23 @@ namespace SymoCraft
 
                     // The 6 neighbor blocks that the target block is facing
                     Block neighbor_blocks[6];
+                    bool is_skirt[6]{};
 
                     uint16 i;
 
                     for (i = 0; auto &neighbor_block: neighbor_blocks) {
-                        neighbor_block = GetLocalBlock(neighbor_block_x_coords[i], neighbor_block_y_coords[i], neighbor_block_z_coords[i]);
+                        const int nx = neighbor_block_x_coords[i], ny = neighbor_block_y_coords[i], nz = neighbor_block_z_coords[i];
+                        if (use_skirts && (nx < 0 || nx >= grid_size.x || nz < 0 || nz >= grid_size.z))
+                        {
+                            // Only the top cell of a column hangs a skirt
+                            Block above = y + 1 < grid_size.y ? get_cell(x, y + 1, z) : BlockConstants::AIR_BLOCK;
+                            is_skirt[i] = above == BlockConstants::AIR_BLOCK || above.IsTransparent();
+                            neighbor_block = is_skirt[i] ? BlockConstants::AIR_BLOCK : BlockConstants::NULL_BLOCK;
+                        }
+                        else if (ny < 0 || ny >= grid_size.y)
+                            neighbor_block = BlockConstants::NULL_BLOCK;
+                        else
+                            neighbor_block = get_cell(nx, ny, nz);
                         i++;
                     }
 
@@ -387,9 +437,11 @@ namespace SymoCraft
                             //If the face aren't culled, calculate its 4 vertices
                             for( int j = 0; j < 4; j++)
                             {
-                                block_faces[i][j].pos_coord = (glm::ivec3(x + kWorldChunkX, y, z + kWorldChunkZ) +
-                                        BlockConstants::pos_coords[BlockConstants::vertex_indices[i * 4 + j]]);
-                                block_faces[i][j].tex_coord = {BlockConstants::tex_coords[j % 4], // Set uv coords
+                                const glm::ivec3 &corner = BlockConstants::pos_coords[BlockConstants::vertex_indices[i * 4 + j]];
+                                block_faces[i][j].pos_coord = world_origin + (glm::ivec3(x, y, z) + corner) * scale;
+                                if (is_skirt[i] && corner.y == 0)
+                                    block_faces[i][j].pos_coord.y -= skirt_depth;
+                                block_faces[i][j].tex_coord = {BlockConstants::tex_coords[j % 4] * (float)scale, // Set uv coords, repeat the texture on each block
                                                                 (i * 4 + j >= 16) ? ((i * 4 + j >= 20)
                                                                  ? // Set layer i, sides first, the top second, the bottom last
                                                                  block_format.m_bottom_texture
@@ -398,27 +450,128 @@ namespace SymoCraft
                                 block_faces[i][j].normal = g_normal;
                             }
 
+                            // The face goes to the bucket of its direction
+                            std::vector<BlockVertex3D> &bucket = face_buckets[i];
 
                             // Add the face's top left triangle
-                            m_vertex_data[m_vertex_count++] = block_faces[i][0];
-                            m_vertex_data[m_vertex_count++] = block_faces[i][1];
-                            m_vertex_data[m_vertex_count++] = block_faces[i][2];
+                            bucket.push_back(block_faces[i][0]);
+                            bucket.push_back(block_faces[i][1]);
+                            bucket.push_back(block_faces[i][2]);
 
                             // Add the face's bottom right triangle
-                            m_vertex_data[m_vertex_count++] = block_faces[i][0];
-                            m_vertex_data[m_vertex_count++] = block_faces[i][2];
-                            m_vertex_data[m_vertex_count++] = block_faces[i][3];
+                            bucket.push_back(block_faces[i][0]);
+                            bucket.push_back(block_faces[i][2]);
+                            bucket.push_back(block_faces[i][3]);
 
-                            if(m_vertex_count > World::max_vertices_per_chunk)
-                                AmoLogger_Warning("Maximum vertex capacity exceeded.\n");
+                            min_y = std::min(min_y, world_origin.y + y * scale - (is_skirt[i] ? skirt_depth : 0));
+                            max_y = std::max(max_y, world_origin.y + (y + 1) * scale);
                         }
                         i++;
                     }
                 }
             }
         }
+    }
+
+    void Chunk::GenerateLodBlocks(int scale, std::vector<Block> &out_blocks) const
+    {
+        const int size_x = k_chunk_length / scale, size_y = k_chunk_height / scale, size_z = k_chunk_width / scale;
+        const int num_children = scale * scale * scale;
+        out_blocks.resize(size_x * size_y * size_z);
+
+        for (int y = 0; y < size_y; y++)
+            for (int x = 0; x < size_x; x++)
+                for (int z = 0; z < size_z; z++)
+                {
+                    // A cell is filled if at least half of its blocks are not air,
+                    // and takes the first block found from the top, so the surface keeps its look
+                    int num_filled = 0;
+                    Block representative = BlockConstants::AIR_BLOCK;
+                    for (int child_y = scale - 1; child_y >= 0; child_y--)
+                        for (int child_x = 0; child_x < scale; child_x++)
+                            for (int child_z = 0; child_z < scale; child_z++)
+                            {
+                                const Block &child = m_local_blocks[GetLocalBlockIndex(x * scale + child_x,
+                                                                                       y * scale + child_y,
+                                                                                       z * scale + child_z)];
+                                if (child == BlockConstants::NULL_BLOCK || child == BlockConstants::AIR_BLOCK)
+                                    continue;
+                                if (num_filled++ == 0)
+                                    representative = child;
+                            }
+
+                    if (num_filled * 2 < num_children)
+                        representative = BlockConstants::AIR_BLOCK;
+                    if (representative == BlockConstants::AIR_BLOCK)
+                        representative.SetTransparency(true);
+                    out_blocks[(y * size_x + x) * size_z + z] = representative;
+                }
+    }
+
+    void Chunk::GenerateRenderData()
+    {
+        //Clear old data
+        m_vertex_count = 0;
+        m_face_vertex_offsets.fill(0);
+        m_face_vertex_counts.fill(0);
+        if (m_vertex_data)
+            AmoMemory_Free(m_vertex_data);
+        m_vertex_data = nullptr;
+
+        state = ChunkState::Updated;
+        if(m_is_fringe_chunk)
+            return;
+
+        for (auto &bucket : face_buckets)
+            bucket.clear();
+
+        const glm::ivec3 kWorldChunkOrigin{m_chunk_coord.x * k_chunk_length, 0, m_chunk_coord.y * k_chunk_width};
+        int min_y = k_chunk_height, max_y = 0;
+
+        // Hang skirts when a neighbor is meshed at another level of detail, the faces between us would not match
+        bool use_skirts = m_lod_level != 0;
+        for (const Chunk *neighbor : {front_neighbor, back_neighbor, left_neighbor, right_neighbor})
+            use_skirts = use_skirts || (neighbor && neighbor->m_lod_level != m_lod_level);
+
+        if (m_lod_level == 0)
+        {
+            MeshBlockGrid({k_chunk_length, k_chunk_height, k_chunk_width}, 1, kWorldChunkOrigin, use_skirts,
+                          [this](int x, int y, int z){ return GetLocalBlock(x, y, z); },
+                          min_y, max_y);
+        }
+        else
+        {
+            const int scale = 1 << m_lod_level;
+            const glm::ivec3 grid_size{k_chunk_length / scale, k_chunk_height / scale, k_chunk_width / scale};
+            GenerateLodBlocks(scale, lod_blocks);
+            MeshBlockGrid(grid_size, scale, kWorldChunkOrigin, use_skirts,
+                          [&grid_size](int x, int y, int z){ return lod_blocks[(y * grid_size.x + x) * grid_size.z + z]; },
+                          min_y, max_y);
+        }
+
+        // Lay the buckets out one after another
+        size_t total_vertex_count = 0;
+        for (auto &bucket : face_buckets)
+            total_vertex_count += bucket.size();
+        if (total_vertex_count > World::max_vertices_per_chunk)
+        {
+            AmoLogger_Warning("Maximum vertex capacity exceeded.\n");
+            return;
+        }
+        if (total_vertex_count == 0)
+            return;
+
+        m_vertex_data = (BlockVertex3D *) AmoMemory_Allocate(sizeof(BlockVertex3D) * total_vertex_count);
+        for (size_t face = 0; face < face_buckets.size(); face++)
+        {
+            m_face_vertex_offsets[face] = m_vertex_count;
+            m_face_vertex_counts[face] = (uint16)face_buckets[face].size();
+            std::copy(face_buckets[face].begin(), face_buckets[face].end(), m_vertex_data + m_vertex_count);
+            m_vertex_count += m_face_vertex_counts[face];
+        }
 
-        AmoMemory_ReAlloc(m_vertex_data, sizeof(BlockVertex3D) * m_vertex_count);
+        m_mesh_min = glm::ivec3(kWorldChunkOrigin.x, min_y, kWorldChunkOrigin.z);
+        m_mesh_max = glm::ivec3(kWorldChunkOrigin.x + k_chunk_length, max_y, kWorldChunkOrigin.z + k_chunk_width);
     }
 
     void Chunk::UpdateChunkLocalBlocks(const glm::vec3& block_local_coord)
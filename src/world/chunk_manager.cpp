@@ -2,10 +2,15 @@
 #include "world/chunk.h"
 #include "core/constants.h"
 #include "renderer/renderer.h"
+#include "core/ECS/Systems/physics_system.h"
+#include "world/neighbor_update.h"
+#include "world/block_tick.h"
 
 namespace SymoCraft{
 
     static robin_hood::unordered_node_map<glm::ivec2, Chunk> chunks;
+    // Chunk the camera was in at the last LOD update, reset when the chunks are freed
+    static glm::ivec2 last_camera_chunk_coord{INT32_MAX, INT32_MAX};
 
     namespace ChunkManager {
         Block GetBlock(const glm::vec3 &worldPosition) {
@@ -30,7 +35,11 @@ namespace SymoCraft{
                 return;
             }
 
-            chunk->SetWorldBlock(worldPosition, block_id);
+            if (chunk->SetWorldBlock(worldPosition, block_id))
+            {
+                Physics::OnBlockChanged(glm::floor(worldPosition));
+                NeighborUpdate::Notify(glm::floor(worldPosition));
+            }
         }
 
         void RemoveBLock(const glm::vec3 &worldPosition) {
@@ -45,7 +54,11 @@ namespace SymoCraft{
                 return;
             }
 
-            chunk->RemoveWorldBlock(worldPosition);
+            if (chunk->RemoveWorldBlock(worldPosition))
+            {
+                Physics::OnBlockChanged(glm::floor(worldPosition));
+                NeighborUpdate::Notify(glm::floor(worldPosition));
+            }
         }
 
         Chunk *GetChunk(const glm::vec3 &worldPosition)
@@ -78,7 +91,7 @@ namespace SymoCraft{
                 Chunk new_chunk{};
                 new_chunk.m_local_blocks = (Block *)AmoMemory_Allocate(sizeof(Block) * k_chunk_length * k_chunk_width * k_chunk_height);
                 new_chunk.m_chunk_coord = chunk_coord;
-                new_chunk.m_vertex_data = (BlockVertex3D *) AmoMemory_Allocate(sizeof(BlockVertex3D) * World::max_vertices_per_chunk);
+                new_chunk.m_vertex_data = nullptr;
                 new_chunk.m_vertex_count = 0;
                 new_chunk.m_draw_command.first = chunk_index++ * sizeof(BlockVertex3D) * World::max_vertices_per_chunk;
                 new_chunk.m_draw_command.baseInstance = 0;
@@ -113,6 +126,29 @@ namespace SymoCraft{
             }
         }
 
+        void UpdateLodLevels(const glm::vec3 &camera_pos)
+        {
+            glm::ivec2 camera_chunk_coord = World::ToChunkCoords(camera_pos);
+            if (camera_chunk_coord == last_camera_chunk_coord)
+                return;
+            last_camera_chunk_coord = camera_chunk_coord;
+
+            for (auto &pair : chunks)
+            {
+                Chunk &chunk = pair.second;
+                uint8 lod_level = World::GetLodLevel(chunk.m_chunk_coord, camera_chunk_coord);
+                if (lod_level == chunk.m_lod_level)
+                    continue;
+
+                chunk.m_lod_level = lod_level;
+                chunk.state = ChunkState::ToBeUpdated;
+                // The neighbors may need to hang or drop their skirts
+                for (Chunk *neighbor : {chunk.front_neighbor, chunk.back_neighbor, chunk.left_neighbor, chunk.right_neighbor})
+                    if (neighbor)
+                        neighbor->state = ChunkState::ToBeUpdated;
+            }
+        }
+
         void UpdateAllChunks()
         {
             for(auto &pair : chunks)
@@ -124,13 +160,37 @@ namespace SymoCraft{
                     AmoLogger_Info("Unknown state of chunk updated\n");
         }
 
-        void LoadAllChunks()
+        void LoadAllChunks(const glm::vec3 &camera_pos)
         {
             for(auto &pair : chunks)
-                if(pair.second.m_vertex_count == 0 || pair.second.m_is_fringe_chunk)
+            {
+                const Chunk &chunk = pair.second;
+                if(chunk.m_vertex_count == 0 || chunk.m_is_fringe_chunk)
                     continue;
-                else
-                    chunk_batch.AddVertex(pair.second.m_vertex_data, pair.second.m_vertex_count);
+
+                // Skip the face buckets facing away from the camera,
+                // and merge the visible buckets that are next to each other into one upload
+                uint8 visible_faces = GetVisibleFaceMask(camera_pos, chunk.m_mesh_min, chunk.m_mesh_max);
+                uint16 run_offset = 0, run_count = 0;
+                for (int face = 0; face < (int)FaceDirection::Count; face++)
+                {
+                    if (!(visible_faces & (1 << face)) || chunk.m_face_vertex_counts[face] == 0)
+                        continue;
+
+                    if (run_count != 0 && run_offset + run_count == chunk.m_face_vertex_offsets[face])
+                    {
+                        run_count += chunk.m_face_vertex_counts[face];
+                        continue;
+                    }
+
+                    if (run_count != 0)
+                        chunk_batch.AddVertex(chunk.m_vertex_data + run_offset, run_count);
+                    run_offset = chunk.m_face_vertex_offsets[face];
+                    run_count = chunk.m_face_vertex_counts[face];
+                }
+                if (run_count != 0)
+                    chunk_batch.AddVertex(chunk.m_vertex_data + run_offset, run_count);
+            }
         }
 
         void FreeAllChunks()
@@ -138,6 +198,11 @@ namespace SymoCraft{
             for(auto &pair : chunks)
                 // if (pair.second.m_vertex_count != 0)
                     pair.second.Free();
+            chunks.clear();
+            // New chunks start at LOD 0, the next update has to visit them all
+            last_camera_chunk_coord = {INT32_MAX, INT32_MAX};
+            NeighborUpdate::Clear();
+            BlockTick::OnTickableSectionsChanged();
 
         }
     }
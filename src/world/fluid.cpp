@@ -0,0 +1,294 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#include "world/fluid.h"
+#include "world/chunk.h"
+#include "world/world.h"
+#include "core/constants.h"
+#include "core/simulation_clock.h"
+
+namespace SymoCraft::Fluid
+    {
+        static_assert(k_chunk_length == 16 && k_chunk_width == 16, "ChunkCache splits coordinates with shifts.");
+
+        static const glm::ivec3 kUp(0, 1, 0);
+        static const glm::ivec3 kDown(0, -1, 0);
+        static const glm::ivec3 kSides[4] = {{1, 0, 0}, {0, 0, 1}, {-1, 0, 0}, {0, 0, -1}};
+
+        // Reads and writes the blocks of a tick
+        // Water spreads block by block, the chunk of the last block is kept so only a chunk change goes
+        // through the chunk map
+        struct ChunkCache
+        {
+            glm::ivec2 chunk_coord{INT32_MAX};
+            Chunk* chunk = nullptr;
+
+            // return nullptr outside of the loaded chunks
+            inline Block* GetBlock(const glm::ivec3& position)
+            {
+                if (position.y < 0 || position.y >= k_chunk_height)
+                    return nullptr;
+
+                // Shifts round down for negative coordinates too
+                const glm::ivec2 coord(position.x >> 4, position.z >> 4);
+                if (coord != chunk_coord)
+                {
+                    chunk_coord = coord;
+                    chunk = ChunkManager::GetChunk(coord);
+                }
+                return chunk ? &chunk->GetLocalBlockInChunk(position.x & 15, position.y, position.z & 15) : nullptr;
+            }
+        };
+
+        static inline bool IsFluid(const Block* block)
+        {
+            return block && block->block_id == kWaterBlockId;
+        }
+
+        static inline bool IsAir(const Block* block)
+        {
+            return block && block->block_id == BlockConstants::AIR_BLOCK.block_id;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Active cells
+
+        struct ScheduledCell
+        {
+            uint64 tick;
+            glm::ivec3 position;
+        };
+
+        // Every cell is scheduled kTicksPerFlow ticks after the tick it was activated in,
+        // so the queue is sorted by tick
+        static std::deque<ScheduledCell> scheduled_cells;
+        // Cells in the queue, a cell is queued once however often it is activated
+        static robin_hood::unordered_flat_set<uint64> scheduled_keys;
+        // The last tick run
+        static uint64 current_tick = 0;
+        static uint32 cells_per_tick = kDefaultCellsPerTick;
+
+        static void Schedule(const glm::ivec3& position)
+        {
+            if (scheduled_keys.insert(World::GetBlockKey(position)).second)
+                scheduled_cells.push_back({current_tick + kTicksPerFlow, position});
+        }
+
+        // Activate the water at a position and next to it
+        static void ScheduleAround(ChunkCache& cache, const glm::ivec3& position)
+        {
+            if (IsFluid(cache.GetBlock(position)))
+                Schedule(position);
+            if (IsFluid(cache.GetBlock(position + kUp)))
+                Schedule(position + kUp);
+            if (IsFluid(cache.GetBlock(position + kDown)))
+                Schedule(position + kDown);
+            for (const glm::ivec3& side : kSides)
+                if (IsFluid(cache.GetBlock(position + side)))
+                    Schedule(position + side);
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Remeshing
+
+        // Borders of a chunk touched by the changed blocks, its neighbors there are remeshed too
+        enum ChunkBorder : uint8
+        {
+            kBackBorder = 1 << 0,   // x == 0
+            kFrontBorder = 1 << 1,  // x == 15
+            kLeftBorder = 1 << 2,   // z == 0
+            kRightBorder = 1 << 3,  // z == 15
+        };
+
+        // Chunks changed in the current tick
+        static std::vector<std::pair<Chunk*, uint8>> changed_chunks;
+
+        static void AddChangedChunk(Chunk* chunk, const glm::ivec3& position)
+        {
+            const int x = position.x & 15, z = position.z & 15;
+            const uint8 borders = (x == 0 ? kBackBorder : 0) | (x == 15 ? kFrontBorder : 0)
+                                  | (z == 0 ? kLeftBorder : 0) | (z == 15 ? kRightBorder : 0);
+            // Water spreads block by block, most changes are in the chunk of the change before
+            if (!changed_chunks.empty() && changed_chunks.back().first == chunk)
+                changed_chunks.back().second |= borders;
+            else
+                changed_chunks.emplace_back(chunk, borders);
+        }
+
+        // Mark every changed chunk for remeshing once
+        // return the number of chunks changed
+        static uint32 FlushChangedChunks()
+        {
+            std::sort(changed_chunks.begin(), changed_chunks.end());
+            uint32 num_chunks = 0;
+            for (size_t i = 0; i < changed_chunks.size(); i++)
+            {
+                Chunk* chunk = changed_chunks[i].first;
+                uint8 borders = changed_chunks[i].second;
+                while (i + 1 < changed_chunks.size() && changed_chunks[i + 1].first == chunk)
+                    borders |= changed_chunks[++i].second;
+
+                chunk->state = ChunkState::ToBeUpdated;
+                if ((borders & kBackBorder) && chunk->back_neighbor)
+                    chunk->back_neighbor->state = ChunkState::ToBeUpdated;
+                if ((borders & kFrontBorder) && chunk->front_neighbor)
+                    chunk->front_neighbor->state = ChunkState::ToBeUpdated;
+                if ((borders & kLeftBorder) && chunk->left_neighbor)
+                    chunk->left_neighbor->state = ChunkState::ToBeUpdated;
+                if ((borders & kRightBorder) && chunk->right_neighbor)
+                    chunk->right_neighbor->state = ChunkState::ToBeUpdated;
+                num_chunks++;
+            }
+            changed_chunks.clear();
+            return num_chunks;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Flow
+
+        // Set a block to water, or to air for level kMaxFluidLevel + 1, and activate the cells around it
+        static void SetFluidLevel(ChunkCache& cache, const glm::ivec3& position, uint8 level)
+        {
+            Block* block = cache.GetBlock(position);
+            if (level > kMaxFluidLevel)
+            {
+                block->block_id = BlockConstants::AIR_BLOCK.block_id;
+                block->SetTransparency(true);
+                block->SetBlendability(false);
+                block->SetFluidLevel(0);
+            }
+            else
+            {
+                // The same as the water of the terrain generator
+                block->block_id = kWaterBlockId;
+                block->SetTransparency(false);
+                block->SetBlendability(true);
+                block->SetFluidLevel(level);
+            }
+            block->SetLightSource(false);
+
+            AddChangedChunk(cache.chunk, position);
+            ScheduleAround(cache, position);
+        }
+
+        // Level the water at a position is fed to, kMaxFluidLevel + 1 if nothing feeds it
+        static uint8 GetFedLevel(ChunkCache& cache, const glm::ivec3& position)
+        {
+            if (IsFluid(cache.GetBlock(position + kUp)))
+                return 1;
+
+            uint8 level = kMaxFluidLevel + 1;
+            for (const glm::ivec3& side : kSides)
+            {
+                const Block* neighbor = cache.GetBlock(position + side);
+                if (!IsFluid(neighbor))
+                    continue;
+                // Flowing water falling down a hole does not flow to the sides
+                const uint8 neighbor_level = neighbor->GetFluidLevel();
+                if (neighbor_level != 0 && IsAir(cache.GetBlock(position + side + kDown)))
+                    continue;
+                level = std::min<uint8>(level, neighbor_level + 1);
+            }
+            return level;
+        }
+
+        // Update an active cell
+        // return the number of blocks changed
+        static uint32 UpdateCell(ChunkCache& cache, const glm::ivec3& position)
+        {
+            // The block may have changed since it was activated
+            Block* block = cache.GetBlock(position);
+            if (!IsFluid(block))
+                return 0;
+
+            uint32 num_changed = 0;
+            uint8 level = block->GetFluidLevel();
+            if (level != 0)
+            {
+                const uint8 fed_level = GetFedLevel(cache, position);
+                if (fed_level != level)
+                {
+                    SetFluidLevel(cache, position, fed_level);
+                    if (fed_level > kMaxFluidLevel)
+                        return 1;
+                    level = fed_level;
+                    num_changed++;
+                }
+            }
+
+            // Fall first, a block of water over a hole does not spread to the sides
+            const Block* below = cache.GetBlock(position + kDown);
+            if (IsAir(below) || (IsFluid(below) && below->GetFluidLevel() > 1))
+            {
+                SetFluidLevel(cache, position + kDown, 1);
+                return num_changed + 1;
+            }
+            // Water falling onto water joins it
+            if (!below || IsFluid(below) || level >= kMaxFluidLevel)
+                return num_changed;
+
+            for (const glm::ivec3& side : kSides)
+            {
+                const Block* neighbor = cache.GetBlock(position + side);
+                if (IsAir(neighbor) || (IsFluid(neighbor) && neighbor->GetFluidLevel() > level + 1))
+                {
+                    SetFluidLevel(cache, position + side, level + 1);
+                    num_changed++;
+                }
+            }
+            return num_changed;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Functions Implementation
+
+        void OnNeighborChanged(const glm::ivec3 &block_position)
+        {
+            Schedule(block_position);
+        }
+
+        void Update(const SimulationClock &clock)
+        {
+            for (uint32 tick = 0; tick < clock.GetFrameTicks(); tick++)
+                Tick(clock.GetTick() + tick);
+        }
+
+        TickStats Tick(uint64 tick)
+        {
+            current_tick = tick;
+            TickStats stats{};
+            ChunkCache cache;
+            // Cells over the budget stay in front of the queue for the next tick
+            while (!scheduled_cells.empty() && scheduled_cells.front().tick <= tick
+                   && stats.num_updated_cells < cells_per_tick)
+            {
+                const glm::ivec3 position = scheduled_cells.front().position;
+                scheduled_cells.pop_front();
+                scheduled_keys.erase(World::GetBlockKey(position));
+
+                stats.num_changed_cells += UpdateCell(cache, position);
+                stats.num_updated_cells++;
+            }
+            stats.num_remeshed_chunks = FlushChangedChunks();
+            return stats;
+        }
+
+        void SetCellsPerTick(uint32 max_cells)
+        {
+            cells_per_tick = max_cells;
+        }
+
+        uint32 GetNumActiveCells()
+        {
+            return (uint32)scheduled_cells.size();
+        }
+
+        void Clear()
+        {
+            scheduled_cells.clear();
+            scheduled_keys.clear();
+            changed_chunks.clear();
+            current_tick = 0;
+        }
+    }
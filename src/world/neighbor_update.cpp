@@ -0,0 +1,145 @@
+//
+// Created by Amo on 2022/7/30.
+//
+
+#include "world/neighbor_update.h"
+#include "world/chunk.h"
+#include "world/world.h"
+#include "world/fluid.h"
+#include "world/block_tick.h"
+#include "core/constants.h"
+#include "core/simulation_clock.h"
+
+namespace SymoCraft::NeighborUpdate
+    {
+        static const glm::ivec3 kNeighbors[7] = {{0, 0, 0}, {0, 1, 0}, {0, -1, 0},
+                                                 {1, 0, 0}, {-1, 0, 0}, {0, 0, 1}, {0, 0, -1}};
+
+        struct Notification
+        {
+            uint64 chunk_key;
+            uint64 key;
+            glm::ivec3 position;
+
+            inline bool operator<(const Notification& other) const
+            {
+                return chunk_key != other.chunk_key ? chunk_key < other.chunk_key : key < other.key;
+            }
+        };
+
+        // Changed positions of the next batch
+        static std::vector<Notification> queued;
+        static robin_hood::unordered_flat_set<uint64> queued_keys;
+        // The batch being processed, swapped with queued so the updates can queue the next batch
+        static std::vector<Notification> batch;
+        // Blocks updated in the batch being processed
+        static robin_hood::unordered_flat_set<uint64> updated_keys;
+
+        static inline uint64 GetChunkKey(const glm::ivec3& position)
+        {
+            return ((uint64)(uint32)(position.x >> 4) << 32) | (uint64)(uint32)(position.z >> 4);
+        }
+
+        // Block ids of a batch, the chunk of the last block is kept
+        struct ChunkCache
+        {
+            glm::ivec2 chunk_coord{INT32_MAX};
+            Chunk* chunk = nullptr;
+
+            // return NULL_BLOCK outside of the loaded chunks
+            inline uint16 GetBlockId(const glm::ivec3& position)
+            {
+                if (position.y < 0 || position.y >= k_chunk_height)
+                    return BlockConstants::NULL_BLOCK.block_id;
+
+                const glm::ivec2 coord(position.x >> 4, position.z >> 4);
+                if (coord != chunk_coord)
+                {
+                    chunk_coord = coord;
+                    chunk = ChunkManager::GetChunk(coord);
+                }
+                return chunk ? chunk->GetLocalBlockInChunk(position.x & 15, position.y, position.z & 15).block_id
+                             : BlockConstants::NULL_BLOCK.block_id;
+            }
+        };
+
+        // Update a block next to a changed block
+        static void UpdateBlock(ChunkCache& cache, const glm::ivec3& position, uint16 block_id)
+        {
+            if (block_id == Fluid::kWaterBlockId)
+                Fluid::OnNeighborChanged(position);
+            else if (BlockTick::HasNeighborUpdate(block_id))
+                // The update may change the block, which queues it for the next batch
+                BlockTick::OnNeighborChanged(position, block_id, cache.GetBlockId(position + kNeighbors[1]));
+        }
+
+        // Process a batch sorted by chunk
+        static void ProcessBatch(TickStats& stats)
+        {
+            std::sort(batch.begin(), batch.end());
+            ChunkCache cache;
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                if (i == 0 || batch[i].chunk_key != batch[i - 1].chunk_key)
+                    stats.num_chunk_groups++;
+
+                for (const glm::ivec3& offset : kNeighbors)
+                {
+                    const glm::ivec3 position = batch[i].position + offset;
+                    if (!updated_keys.insert(World::GetBlockKey(position)).second)
+                        continue;
+
+                    const uint16 block_id = cache.GetBlockId(position);
+                    if (block_id == BlockConstants::NULL_BLOCK.block_id || block_id == BlockConstants::AIR_BLOCK.block_id)
+                        continue;
+                    UpdateBlock(cache, position, block_id);
+                    stats.num_updates++;
+                }
+            }
+            stats.num_notifications += (uint32)batch.size();
+            stats.num_batches++;
+            updated_keys.clear();
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Functions Implementation
+
+        void Notify(const glm::ivec3 &block_position)
+        {
+            const uint64 key = World::GetBlockKey(block_position);
+            if (queued_keys.insert(key).second)
+                queued.push_back({GetChunkKey(block_position), key, block_position});
+        }
+
+        void Update(const SimulationClock &clock)
+        {
+            for (uint32 tick = 0; tick < clock.GetFrameTicks(); tick++)
+                Tick();
+        }
+
+        TickStats Tick()
+        {
+            TickStats stats{};
+            while (!queued.empty() && stats.num_batches < kMaxCascadeDepth)
+            {
+                batch.swap(queued);
+                queued_keys.clear();
+                ProcessBatch(stats);
+                batch.clear();
+            }
+            return stats;
+        }
+
+        uint32 GetNumQueued()
+        {
+            return (uint32)queued.size();
+        }
+
+        void Clear()
+        {
+            queued.clear();
+            queued_keys.clear();
+            batch.clear();
+            updated_keys.clear();
+        }
+    }
@@ -26,30 +26,19 @@ namespace SymoCraft::World{
     {
         ECS::Registry &registry = Application::GetRegistry();
         Camera *camera = Application::GetCamera();
-        player = registry.CreateEntity();
-        registry.AddComponent<Transform>(player);
-        registry.AddComponent<Physics::HitBox>(player);
-        registry.AddComponent<Physics::RigidBody>(player);
-        registry.AddComponent<Character::CharacterComponent>(player);
-        registry.AddComponent<Character::PlayerComponent>(player);
+
+        ECS::Prefab player_prefab;
+        player_prefab.Set<Transform>();
 
         // Hit box init
-        auto& boxCollider = registry.GetComponent<Physics::HitBox>(player);
-        boxCollider.size.x = 0.55f;
-        boxCollider.size.y = 1.8f;
-        boxCollider.size.z = 0.55f;
+        auto &box_collider = player_prefab.Set<Physics::HitBox>();
+        box_collider.size = glm::vec3(0.55f, 1.8f, 0.55f);
 
-        // transform init
-        auto& transform = registry.GetComponent<Transform>(player);
-        auto& camera_transform = registry.GetComponent<Transform>(camera->entity_id);
-        transform.position.x = camera_transform.position.x;
-        transform.position.y = camera_transform.position.y - 0.65f;
-        transform.position.z = camera_transform.position.z;
-        transform.yaw = camera_transform.yaw;
-        transform.pitch = camera_transform.pitch;
+        // rigid body init
+        player_prefab.Set<Physics::RigidBody>().use_gravity = true;
 
         //  character component init
-        auto &controller = registry.GetComponent<Character::CharacterComponent>(player);
+        auto &controller = player_prefab.Set<Character::CharacterComponent>();
         controller.base_speed = 4.4f;
         controller.run_speed = 6.2f;
         controller.is_running = false;
@@ -58,13 +47,21 @@ namespace SymoCraft::World{
         controller.jump_force = 7.6f;
         controller.down_jump_force = -25.0f;
 
-        // rigid body init
-        auto &rigid_body = registry.GetComponent<Physics::RigidBody>(player);
-        rigid_body.use_gravity = true;
-
-        auto &player_com = registry.GetComponent<Character::PlayerComponent>(player);
+        auto &player_com = player_prefab.Set<Character::PlayerComponent>();
         player_com.camera_offset = glm::vec3(0.0f, 0.65f, 0.0f);
         player_com.movement_sensitivity = 0.25f;
+
+        // transform init, the player starts under the camera
+        auto &transform = player_prefab.Get<Transform>();
+        const auto &camera_transform = registry.GetComponent<const Transform>(camera->entity_id);
+        transform.position = camera_transform.position - glm::vec3(0.0f, 0.65f, 0.0f);
+        transform.yaw = camera_transform.yaw;
+        transform.pitch = camera_transform.pitch;
+
+        // The camera follows the player between physics ticks
+        player_prefab.Set<InterpolatedTransform>({transform.position, transform.position});
+
+        player = registry.Instantiate(player_prefab);
     }
 
     ECS::EntityId GetPlayer()